@@ -0,0 +1,37 @@
+# - Locate LZ4
+#
+# This module defines:
+#
+#  LZ4_INCLUDE_DIR
+#  LZ4_LIBRARY
+#  LZ4_FOUND
+#
+# If LZ4 is successfully detected, it also adds an IMPORTED library target: imported-lz4
+#
+# To find LZ4, specify:
+#   find_package(LZ4 [REQUIRED])
+#
+
+find_package(PkgConfig QUIET)
+if(PkgConfig_FOUND)
+	pkg_check_modules(_LZ4_PKGCONFIG QUIET liblz4)
+endif()
+
+find_path(LZ4_INCLUDE_DIR NAMES lz4frame.h HINTS ${_LZ4_PKGCONFIG_INCLUDEDIR})
+find_library(LZ4_LIBRARY NAMES lz4 liblz4 HINTS ${_LZ4_PKGCONFIG_LIBDIR})
+
+include(FindPackageHandleStandardArgs)
+
+find_package_handle_standard_args(
+	LZ4
+	REQUIRED_VARS LZ4_INCLUDE_DIR LZ4_LIBRARY
+)
+
+if(LZ4_FOUND)
+	add_library(imported-lz4 UNKNOWN IMPORTED)
+	set_target_properties(imported-lz4
+		PROPERTIES
+		IMPORTED_LOCATION ${LZ4_LIBRARY}
+		INTERFACE_INCLUDE_DIRECTORIES ${LZ4_INCLUDE_DIR}
+	)
+endif()
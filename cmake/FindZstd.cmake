@@ -0,0 +1,37 @@
+# - Locate zstd
+#
+# This module defines:
+#
+#  ZSTD_INCLUDE_DIR
+#  ZSTD_LIBRARY
+#  ZSTD_FOUND
+#
+# If zstd is successfully detected, it also adds an IMPORTED library target: imported-zstd
+#
+# To find zstd, specify:
+#   find_package(Zstd [REQUIRED])
+#
+
+find_package(PkgConfig QUIET)
+if(PkgConfig_FOUND)
+	pkg_check_modules(_ZSTD_PKGCONFIG QUIET libzstd)
+endif()
+
+find_path(ZSTD_INCLUDE_DIR NAMES zstd.h zdict.h HINTS ${_ZSTD_PKGCONFIG_INCLUDEDIR})
+find_library(ZSTD_LIBRARY NAMES zstd zstd_static libzstd HINTS ${_ZSTD_PKGCONFIG_LIBDIR})
+
+include(FindPackageHandleStandardArgs)
+
+find_package_handle_standard_args(
+	Zstd
+	REQUIRED_VARS ZSTD_INCLUDE_DIR ZSTD_LIBRARY
+)
+
+if(ZSTD_FOUND)
+	add_library(imported-zstd UNKNOWN IMPORTED)
+	set_target_properties(imported-zstd
+		PROPERTIES
+		IMPORTED_LOCATION ${ZSTD_LIBRARY}
+		INTERFACE_INCLUDE_DIRECTORIES ${ZSTD_INCLUDE_DIR}
+	)
+endif()
@@ -0,0 +1,434 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file object_list.h
+ * Ordered list of in-game object handles, stored contiguously.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// Drop-in replacement for `std::list<T>` (where `T` is a small, trivially
+/// copyable handle, such as a pointer to a game object), which keeps all
+/// elements in a single contiguous array of slots instead of separately
+/// allocated list nodes.
+///
+/// Elements are linked together by slot indices, so the container has the
+/// same ordering and iterator guarantees as `std::list`:
+/// * iteration order is exactly the insertion order (deterministic, which
+///   is required for the game state to stay in sync),
+/// * inserting never invalidates iterators,
+/// * erasing only invalidates iterators to the erased elements.
+///
+/// Unlike `std::list`, references to elements (as opposed to iterators) are
+/// invalidated by insertion, since the slot array may need to grow.
+///
+/// Erased slots go to a free list and are recycled by later insertions,
+/// so after lots of churn neighbouring elements may no longer be neighbours
+/// in memory. `compact()` rewrites the slots in iteration order; it is the
+/// only operation (besides `clear()`, assignment and destruction) which
+/// invalidates all iterators, so it must only be called at points where
+/// nobody is holding on to one (see `objmemUpdate()`).
+///
+/// Slot 0 is a sentinel, which doubles as the `end()` position. The list is
+/// circular through it, so there are no special cases for the first and last
+/// elements.
+/// </summary>
+/// <typeparam name="T">Element type. Should be cheap to copy, such as a pointer.</typeparam>
+template <typename T>
+class ObjectList
+{
+	using SlotIndexType = uint32_t;
+
+	static constexpr SlotIndexType SENTINEL_SLOT_IDX = 0;
+
+	struct Slot
+	{
+		T value;
+		SlotIndexType prev;
+		SlotIndexType next;
+	};
+
+	template <bool IsConst>
+	class IteratorImpl
+	{
+		friend class ObjectList;
+		using ListPtr = std::conditional_t<IsConst, const ObjectList*, ObjectList*>;
+
+		ListPtr _list = nullptr;
+		SlotIndexType _slot = SENTINEL_SLOT_IDX;
+
+		IteratorImpl(ListPtr list, SlotIndexType slot)
+			: _list(list), _slot(slot)
+		{}
+
+	public:
+
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = ptrdiff_t;
+		using pointer = std::conditional_t<IsConst, const T*, T*>;
+		using reference = std::conditional_t<IsConst, const T&, T&>;
+
+		IteratorImpl() = default;
+
+		// Allow conversion from `iterator` to `const_iterator`.
+		template <bool WasConst, typename = std::enable_if_t<IsConst && !WasConst>>
+		IteratorImpl(const IteratorImpl<WasConst>& other)
+			: _list(other._list), _slot(other._slot)
+		{}
+
+		reference operator*() const
+		{
+			return _list->_slots[_slot].value;
+		}
+
+		pointer operator->() const
+		{
+			return &_list->_slots[_slot].value;
+		}
+
+		IteratorImpl& operator++()
+		{
+			_slot = _list->_slots[_slot].next;
+			return *this;
+		}
+
+		IteratorImpl operator++(int)
+		{
+			IteratorImpl res = *this;
+			++(*this);
+			return res;
+		}
+
+		IteratorImpl& operator--()
+		{
+			_slot = _list->_slots[_slot].prev;
+			return *this;
+		}
+
+		IteratorImpl operator--(int)
+		{
+			IteratorImpl res = *this;
+			--(*this);
+			return res;
+		}
+
+		bool operator==(const IteratorImpl& other) const
+		{
+			return _slot == other._slot && _list == other._list;
+		}
+
+		bool operator!=(const IteratorImpl& other) const
+		{
+			return !(*this == other);
+		}
+
+		template <bool>
+		friend class IteratorImpl;
+	};
+
+public:
+
+	using value_type = T;
+	using size_type = size_t;
+	using difference_type = ptrdiff_t;
+	using reference = T&;
+	using const_reference = const T&;
+	using iterator = IteratorImpl<false>;
+	using const_iterator = IteratorImpl<true>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	ObjectList()
+	{
+		resetSlots();
+	}
+
+	ObjectList(std::initializer_list<T> values)
+		: ObjectList()
+	{
+		insert(end(), values.begin(), values.end());
+	}
+
+	ObjectList(const ObjectList& other) = default;
+	ObjectList& operator=(const ObjectList& other) = default;
+
+	ObjectList(ObjectList&& other) noexcept
+		: _slots(std::move(other._slots))
+		, _freeSlots(std::move(other._freeSlots))
+		, _size(other._size)
+		, _disorder(other._disorder)
+	{
+		other.resetSlots();
+	}
+
+	ObjectList& operator=(ObjectList&& other) noexcept
+	{
+		if (this != &other)
+		{
+			_slots = std::move(other._slots);
+			_freeSlots = std::move(other._freeSlots);
+			_size = other._size;
+			_disorder = other._disorder;
+			other.resetSlots();
+		}
+		return *this;
+	}
+
+	iterator begin() { return iterator(this, _slots[SENTINEL_SLOT_IDX].next); }
+	const_iterator begin() const { return const_iterator(this, _slots[SENTINEL_SLOT_IDX].next); }
+	const_iterator cbegin() const { return begin(); }
+	iterator end() { return iterator(this, SENTINEL_SLOT_IDX); }
+	const_iterator end() const { return const_iterator(this, SENTINEL_SLOT_IDX); }
+	const_iterator cend() const { return end(); }
+
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	bool empty() const { return _size == 0; }
+	size_t size() const { return _size; }
+
+	T& front() { return _slots[_slots[SENTINEL_SLOT_IDX].next].value; }
+	const T& front() const { return _slots[_slots[SENTINEL_SLOT_IDX].next].value; }
+	T& back() { return _slots[_slots[SENTINEL_SLOT_IDX].prev].value; }
+	const T& back() const { return _slots[_slots[SENTINEL_SLOT_IDX].prev].value; }
+
+	iterator insert(const_iterator pos, const T& value)
+	{
+		return iterator(this, link(pos._slot, value));
+	}
+
+	template <typename InputIt>
+	iterator insert(const_iterator pos, InputIt first, InputIt last)
+	{
+		SlotIndexType firstInserted = pos._slot;
+		for (; first != last; ++first)
+		{
+			SlotIndexType slot = link(pos._slot, *first);
+			if (firstInserted == pos._slot)
+			{
+				firstInserted = slot;
+			}
+		}
+		return iterator(this, firstInserted);
+	}
+
+	template <typename... Args>
+	iterator emplace(const_iterator pos, Args&&... args)
+	{
+		return insert(pos, T(std::forward<Args>(args)...));
+	}
+
+	void push_front(const T& value) { link(_slots[SENTINEL_SLOT_IDX].next, value); }
+	void push_back(const T& value) { link(SENTINEL_SLOT_IDX, value); }
+
+	template <typename... Args>
+	T& emplace_front(Args&&... args)
+	{
+		return _slots[link(_slots[SENTINEL_SLOT_IDX].next, T(std::forward<Args>(args)...))].value;
+	}
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args)
+	{
+		return _slots[link(SENTINEL_SLOT_IDX, T(std::forward<Args>(args)...))].value;
+	}
+
+	void pop_front() { unlink(_slots[SENTINEL_SLOT_IDX].next); }
+	void pop_back() { unlink(_slots[SENTINEL_SLOT_IDX].prev); }
+
+	iterator erase(const_iterator pos)
+	{
+		return iterator(this, unlink(pos._slot));
+	}
+
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		SlotIndexType slot = first._slot;
+		while (slot != last._slot)
+		{
+			slot = unlink(slot);
+		}
+		return iterator(this, slot);
+	}
+
+	size_t remove(const T& value)
+	{
+		return remove_if([&value](const T& v) { return v == value; });
+	}
+
+	template <typename Predicate>
+	size_t remove_if(Predicate pred)
+	{
+		size_t removed = 0;
+		SlotIndexType slot = _slots[SENTINEL_SLOT_IDX].next;
+		while (slot != SENTINEL_SLOT_IDX)
+		{
+			if (pred(_slots[slot].value))
+			{
+				slot = unlink(slot);
+				++removed;
+			}
+			else
+			{
+				slot = _slots[slot].next;
+			}
+		}
+		return removed;
+	}
+
+	/// Reverses the order of the elements. Iterators stay valid, just like for `std::list::reverse()`.
+	void reverse()
+	{
+		SlotIndexType slot = SENTINEL_SLOT_IDX;
+		do
+		{
+			Slot& s = _slots[slot];
+			std::swap(s.prev, s.next);
+			slot = s.prev;  // The old `next`.
+		} while (slot != SENTINEL_SLOT_IDX);
+		_disorder += _size;
+	}
+
+	void clear()
+	{
+		resetSlots();
+	}
+
+	void swap(ObjectList& other) noexcept
+	{
+		_slots.swap(other._slots);
+		_freeSlots.swap(other._freeSlots);
+		std::swap(_size, other._size);
+		std::swap(_disorder, other._disorder);
+	}
+
+	/// True if iterating the list no longer walks through memory mostly front to back.
+	bool fragmented() const
+	{
+		return _disorder > 16 + _size / 4;
+	}
+
+	/// Rewrites the slots in iteration order and releases recycled slots, so that iterating
+	/// the list is a linear scan again. Invalidates all iterators and references!
+	void compact()
+	{
+		if (_disorder == 0)
+		{
+			return;
+		}
+		std::vector<Slot> slots;
+		slots.reserve(_size + 1);
+		slots.push_back(Slot{T(), static_cast<SlotIndexType>(_size), _size > 0 ? 1u : SENTINEL_SLOT_IDX});
+		SlotIndexType newSlot = 1;
+		for (SlotIndexType slot = _slots[SENTINEL_SLOT_IDX].next; slot != SENTINEL_SLOT_IDX; slot = _slots[slot].next, ++newSlot)
+		{
+			slots.push_back(Slot{_slots[slot].value, static_cast<SlotIndexType>(newSlot - 1), static_cast<SlotIndexType>(newSlot < _size ? newSlot + 1 : SENTINEL_SLOT_IDX)});
+		}
+		_slots = std::move(slots);
+		_freeSlots.clear();
+		_disorder = 0;
+	}
+
+	friend bool operator==(const ObjectList& a, const ObjectList& b)
+	{
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+	}
+
+	friend bool operator!=(const ObjectList& a, const ObjectList& b)
+	{
+		return !(a == b);
+	}
+
+private:
+
+	void resetSlots()
+	{
+		_slots.clear();
+		_slots.push_back(Slot{T(), SENTINEL_SLOT_IDX, SENTINEL_SLOT_IDX});
+		_freeSlots.clear();
+		_size = 0;
+		_disorder = 0;
+	}
+
+	/// Links `value` in before the element at `before`, returning its slot.
+	SlotIndexType link(SlotIndexType before, const T& value)
+	{
+		const SlotIndexType after = _slots[before].prev;
+		SlotIndexType slot;
+		if (!_freeSlots.empty())
+		{
+			slot = _freeSlots.back();
+			_freeSlots.pop_back();
+			_slots[slot] = Slot{value, after, before};
+			++_disorder;
+		}
+		else
+		{
+			slot = static_cast<SlotIndexType>(_slots.size());
+			_slots.push_back(Slot{value, after, before});
+			// Appending to the back of the list is the only insertion that keeps the layout in order.
+			if (after != slot - 1)
+			{
+				++_disorder;
+			}
+		}
+		_slots[after].next = slot;
+		_slots[before].prev = slot;
+		++_size;
+		return slot;
+	}
+
+	/// Unlinks the element in `slot`, returning the slot of the element that followed it.
+	SlotIndexType unlink(SlotIndexType slot)
+	{
+		Slot& s = _slots[slot];
+		const SlotIndexType next = s.next;
+		_slots[s.prev].next = next;
+		_slots[next].prev = s.prev;
+		s.value = T();
+		_freeSlots.push_back(slot);
+		--_size;
+		++_disorder;
+		return next;
+	}
+
+	std::vector<Slot> _slots;
+	std::vector<SlotIndexType> _freeSlots;
+	size_t _size = 0;
+	/// Number of operations since the last `compact()` that left the slots out of iteration order.
+	size_t _disorder = 0;
+};
+
+template <typename T>
+void swap(ObjectList<T>& a, ObjectList<T>& b) noexcept
+{
+	a.swap(b);
+}
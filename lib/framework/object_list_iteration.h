@@ -37,7 +37,7 @@ enum class IterationResult
 ///
 /// Currently two callable signatures are supported:
 /// * `IterationResult(ObjectType*)`
-/// * `IterationResult(std::list<ObjectType*>::iterator)`
+/// * `IterationResult(ListType::iterator)`
 ///
 /// The latter overload is convenient when one needs to erase from or
 /// insert into the list being iterated directly inside the handler's body,
@@ -54,47 +54,47 @@ struct LoopBodyHandlerCallStrategy
 	//
 	// This is the most simple way to constrain and choose a correct overload
 	// of `Invoke` function depending on the callable signature given C++17 capabilities.
-	template <typename ObjectType>
+	template <typename ListType>
 	static constexpr bool handler_accepts_ptr = std::is_convertible<
 		Callable,
-		std::function<IterationResult(ObjectType*)>>::value;
-	template <typename ObjectType>
+		std::function<IterationResult(typename ListType::value_type)>>::value;
+	template <typename ListType>
 	static constexpr bool handler_accepts_iter = std::is_convertible<
 		Callable,
-		std::function<IterationResult(typename std::list<ObjectType*>::iterator)>>::value;
+		std::function<IterationResult(typename ListType::iterator)>>::value;
 
 
-	template <typename ObjectType>
-	static IterationResult Invoke(Callable handler, typename std::list<ObjectType*>::iterator iter)
+	template <typename ListType>
+	static IterationResult Invoke(Callable handler, typename ListType::iterator iter)
 	{
-		if constexpr (handler_accepts_iter<ObjectType>)
+		if constexpr (handler_accepts_iter<ListType>)
 		{
 			// `Invoke` overload for Callable taking a list iterator as the argument
 			return handler(iter);
 		}
-		else if constexpr (handler_accepts_ptr<ObjectType>)
+		else if constexpr (handler_accepts_ptr<ListType>)
 		{
 			// `Invoke` overload for Callable taking a pointer to `ObjectType` as the argument
 			return handler(*iter);
 		}
 		else
 		{
-			static_assert(sizeof(ObjectType) != sizeof(ObjectType), "Unsupported loop body handler signature");
+			static_assert(sizeof(ListType) != sizeof(ListType), "Unsupported loop body handler signature");
 		}
 	}
 };
 
-// Common iteration helper for lists of game objects
-// with an ability to execute loop body handlers which can
+// Common iteration helper for lists of game objects (either `std::list<ObjectType*>`
+// or `ObjectList<ObjectType*>`) with an ability to execute loop body handlers which can
 // possibly invalidate the any iterator in the range `[begin(), currentIterator]`.
-template <typename ObjectType, typename MaybeErasingLoopBodyHandler>
-void mutating_list_iterate(std::list<ObjectType*>& list, MaybeErasingLoopBodyHandler handler)
+template <typename ListType, typename MaybeErasingLoopBodyHandler>
+void mutating_list_iterate(ListType& list, MaybeErasingLoopBodyHandler handler)
 {
 	using HandlerCallStrategy = LoopBodyHandlerCallStrategy<MaybeErasingLoopBodyHandler>;
 
 	static_assert(
-		   HandlerCallStrategy::template handler_accepts_ptr<ObjectType>
-		|| HandlerCallStrategy::template handler_accepts_iter<ObjectType>,
+		   HandlerCallStrategy::template handler_accepts_ptr<ListType>
+		|| HandlerCallStrategy::template handler_accepts_iter<ListType>,
 		"Unsupported loop body handler signature: "
 		"should return IterationResult and take either an ObjectType* or an iterator");
 
@@ -103,12 +103,12 @@ void mutating_list_iterate(std::list<ObjectType*>& list, MaybeErasingLoopBodyHan
 		return;
 	}
 
-	typename std::remove_reference_t<decltype(list)>::iterator it = list.begin(), itNext;
+	typename ListType::iterator it = list.begin(), itNext;
 	while (it != list.end())
 	{
 		itNext = std::next(it);
 		// Can possibly invalidate `it` and anything before it.
-		const auto res = HandlerCallStrategy::template Invoke<ObjectType>(handler, it);
+		const auto res = HandlerCallStrategy::template Invoke<ListType>(handler, it);
 		if (res == IterationResult::BREAK_ITERATION)
 		{
 			break;
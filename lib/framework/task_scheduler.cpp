@@ -0,0 +1,359 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "lib/framework/task_scheduler.h"
+#include "lib/framework/frame.h"
+#include "lib/framework/wzapp.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Default limit on the number of worker threads, so a big machine running several games isn't oversubscribed by
+// each of them starting a thread per core. Can be raised with wzTaskSchedulerInitialise().
+#define MAX_DEFAULT_TASK_THREADS 8
+
+namespace
+{
+
+/// A queued task. Whoever claims it first runs it, which lets threads waiting for a TaskGroup or TaskStrand run
+/// tasks still in the queue themselves. Workers skip tasks already claimed.
+struct Task
+{
+	explicit Task(std::function<void ()> function_) : function(std::move(function_)) {}
+
+	bool claim()
+	{
+		return !claimed.exchange(true, std::memory_order_acq_rel);
+	}
+
+	std::function<void ()> function;
+	std::atomic<bool> claimed{false};
+};
+typedef std::shared_ptr<Task> TaskPtr;
+
+constexpr size_t TASK_PRIORITY_COUNT = 3;
+
+std::vector<WZ_THREAD *> taskThreads;
+std::unique_ptr<std::atomic<uint64_t>[]> taskThreadBusyMicroseconds;  ///< One per worker thread, total time spent running tasks.
+std::mutex taskMutex;
+std::condition_variable taskWake;
+std::deque<TaskPtr> taskQueues[TASK_PRIORITY_COUNT];  ///< One per TaskPriority. Protected by taskMutex.
+bool taskQuit = false;                                ///< Protected by taskMutex.
+std::thread::id taskMainThread = std::this_thread::get_id();
+
+std::mutex taskMainThreadMutex;
+std::deque<std::function<void ()>> taskMainThreadQueue;  ///< Protected by taskMainThreadMutex.
+
+void taskPush(TaskPtr const &task, TaskPriority priority)
+{
+	if (taskThreads.empty())
+	{
+		task->claim();
+		task->function();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(taskMutex);
+		taskQueues[static_cast<size_t>(priority)].push_back(task);
+	}
+	taskWake.notify_one();
+}
+
+/// Takes the oldest task of the highest priority. Call with taskMutex locked.
+TaskPtr taskPop()
+{
+	for (auto &queue : taskQueues)
+	{
+		if (!queue.empty())
+		{
+			TaskPtr task = std::move(queue.front());
+			queue.pop_front();
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+/** This runs in a separate thread */
+int taskThreadFunc(void *data)
+{
+	std::atomic<uint64_t> &busyMicroseconds = taskThreadBusyMicroseconds[reinterpret_cast<uintptr_t>(data)];
+	while (true)
+	{
+		TaskPtr task;
+		{
+			std::unique_lock<std::mutex> lock(taskMutex);
+			taskWake.wait(lock, [] {
+				return taskQuit || std::any_of(std::begin(taskQueues), std::end(taskQueues), [](std::deque<TaskPtr> const &queue) { return !queue.empty(); });
+			});
+			task = taskPop();
+		}
+		if (task == nullptr)
+		{
+			break;  // Quitting, and nothing left to do.
+		}
+		if (task->claim())
+		{
+			auto start = std::chrono::steady_clock::now();
+			task->function();
+			busyMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+	return 0;
+}
+
+} // anonymous namespace
+
+void wzTaskSchedulerInitialise(size_t numThreads)
+{
+	ASSERT_OR_RETURN(, taskThreads.empty(), "Task scheduler already initialised");
+
+	if (numThreads == 0)
+	{
+		const uint32_t logicalCPUCount = wzGetLogicalCPUCount();
+		// subtract one for the main thread, which runs tasks too when waiting for them
+		numThreads = logicalCPUCount > 1 ? std::min<size_t>(logicalCPUCount - 1, MAX_DEFAULT_TASK_THREADS) : 0;
+	}
+	debug(LOG_INFO, "Using task threads: %zu", numThreads);
+
+	taskMainThread = std::this_thread::get_id();
+	taskQuit = false;
+	taskThreads.resize(numThreads, nullptr);
+	taskThreadBusyMicroseconds = std::make_unique<std::atomic<uint64_t>[]>(numThreads);
+	for (size_t i = 0; i < taskThreads.size(); ++i)
+	{
+		taskThreadBusyMicroseconds[i] = 0;
+		taskThreads[i] = wzThreadCreate(taskThreadFunc, reinterpret_cast<void *>(i), "wzTask");
+		wzThreadStart(taskThreads[i]);
+	}
+}
+
+void wzTaskSchedulerShutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(taskMutex);
+		taskQuit = true;
+	}
+	taskWake.notify_all();
+	for (WZ_THREAD *thread : taskThreads)
+	{
+		wzThreadJoin(thread);
+	}
+	taskThreads.clear();
+	taskThreadBusyMicroseconds.reset();
+	wzTaskRunMainThreadTasks();
+}
+
+size_t wzTaskSchedulerThreadCount()
+{
+	return taskThreads.size();
+}
+
+uint64_t wzTaskSchedulerBusyMicroseconds(size_t thread)
+{
+	ASSERT_OR_RETURN(0, thread < taskThreads.size(), "No task thread %zu", thread);
+	return taskThreadBusyMicroseconds[thread];
+}
+
+bool wzTaskSchedulerIsMainThread()
+{
+	return std::this_thread::get_id() == taskMainThread;
+}
+
+void wzTaskSubmit(std::function<void ()> task, TaskPriority priority)
+{
+	taskPush(std::make_shared<Task>(std::move(task)), priority);
+}
+
+void wzTaskSubmitMainThread(std::function<void ()> task)
+{
+	std::lock_guard<std::mutex> lock(taskMainThreadMutex);
+	taskMainThreadQueue.push_back(std::move(task));
+}
+
+void wzTaskRunMainThreadTasks()
+{
+	ASSERT_OR_RETURN(, wzTaskSchedulerIsMainThread(), "Not on the main thread");
+
+	while (true)
+	{
+		std::function<void ()> task;
+		{
+			std::lock_guard<std::mutex> lock(taskMainThreadMutex);
+			if (taskMainThreadQueue.empty())
+			{
+				return;
+			}
+			task = std::move(taskMainThreadQueue.front());
+			taskMainThreadQueue.pop_front();
+		}
+		task();
+	}
+}
+
+void wzTaskParallelFor(size_t count, std::function<void (size_t)> const &body, TaskPriority priority)
+{
+	if (taskThreads.empty() || count <= 1)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			body(i);
+		}
+		return;
+	}
+
+	std::atomic<size_t> next{0};
+	auto runIndices = [&body, &next, count]() {
+		for (size_t i = next++; i < count; i = next++)
+		{
+			body(i);
+		}
+	};
+	TaskGroup group(priority);
+	const size_t helpers = std::min(taskThreads.size(), count - 1);
+	for (size_t i = 0; i < helpers; ++i)
+	{
+		group.run(runIndices);
+	}
+	runIndices();
+	group.wait();
+}
+
+struct TaskGroup::State
+{
+	std::mutex mutex;
+	std::condition_variable done;
+	size_t pending = 0;          ///< Protected by mutex.
+	std::vector<TaskPtr> tasks;  ///< Started since the last wait(). Only used by the thread owning the group.
+};
+
+TaskGroup::TaskGroup(TaskPriority priority_) : priority(priority_), state(std::make_unique<State>()) {}
+
+TaskGroup::~TaskGroup()
+{
+	wait();
+}
+
+void TaskGroup::run(std::function<void ()> task)
+{
+	State *s = state.get();  // The group outlives its tasks, since it waits for them.
+	{
+		std::lock_guard<std::mutex> lock(s->mutex);
+		++s->pending;
+	}
+	s->tasks.push_back(std::make_shared<Task>([s, task = std::move(task)]() {
+		task();
+		std::lock_guard<std::mutex> lock(s->mutex);
+		--s->pending;
+		s->done.notify_all();
+	}));
+	taskPush(s->tasks.back(), priority);
+}
+
+void TaskGroup::wait()
+{
+	for (TaskPtr const &task : state->tasks)
+	{
+		if (task->claim())
+		{
+			task->function();
+		}
+	}
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [this] { return state->pending == 0; });
+	state->tasks.clear();
+}
+
+struct TaskStrand::State
+{
+	mutable std::mutex mutex;
+	std::condition_variable done;
+	std::deque<std::function<void ()>> tasks;  ///< Not yet started. Protected by mutex.
+	size_t unfinished = 0;                     ///< Protected by mutex.
+	TaskPtr runner;                            ///< Runs the tasks, or nullptr if there are none. Protected by mutex.
+
+	void runTasks()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!tasks.empty())
+		{
+			std::function<void ()> task = std::move(tasks.front());
+			tasks.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+			--unfinished;
+		}
+		runner = nullptr;
+		done.notify_all();
+	}
+};
+
+TaskStrand::TaskStrand(TaskPriority priority_) : priority(priority_), state(std::make_unique<State>()) {}
+
+TaskStrand::~TaskStrand()
+{
+	wait();
+}
+
+void TaskStrand::submit(std::function<void ()> task)
+{
+	State *s = state.get();  // The strand outlives its tasks, since it waits for them.
+	TaskPtr runner;
+	{
+		std::lock_guard<std::mutex> lock(s->mutex);
+		s->tasks.push_back(std::move(task));
+		++s->unfinished;
+		if (s->runner == nullptr)
+		{
+			s->runner = std::make_shared<Task>([s]() { s->runTasks(); });
+			runner = s->runner;
+		}
+	}
+	if (runner != nullptr)
+	{
+		taskPush(runner, priority);
+	}
+}
+
+void TaskStrand::wait()
+{
+	TaskPtr runner;
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		runner = state->runner;
+	}
+	if (runner != nullptr && runner->claim())
+	{
+		runner->function();
+	}
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [this] { return state->unfinished == 0; });
+}
+
+size_t TaskStrand::pending() const
+{
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->unfinished;
+}
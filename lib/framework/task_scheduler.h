@@ -0,0 +1,105 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file task_scheduler.h
+ * Engine-wide pool of worker threads, shared by everything which runs work in the background.
+ *
+ * The scheduler makes no promises about which thread runs a task, or when, so anything which must give the same
+ * results on every client has to split its work into tasks whose results don't depend on that: tasks which write
+ * disjoint state, merged in a fixed order afterwards (see wzTaskParallelFor()), or tasks which depend on each
+ * other run in order through a TaskStrand.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+
+/// Workers take queued tasks of higher priority first. Tasks already running are never interrupted.
+enum class TaskPriority
+{
+	High,    ///< Somebody is waiting for the result right now, such as the main thread in wzTaskParallelFor().
+	Normal,  ///< Results needed soon, such as path finding jobs.
+	Low,     ///< Background work, such as writing files.
+};
+
+/// Starts numThreads worker threads, or one less than the number of logical CPUs (up to a limit) if 0.
+/// Must be called from the main thread. Before this is called (or with no workers), tasks run on the thread submitting them.
+void wzTaskSchedulerInitialise(size_t numThreads = 0);
+/// Runs any tasks still queued, and stops the worker threads.
+void wzTaskSchedulerShutdown();
+/// Number of worker threads, not counting the main thread.
+size_t wzTaskSchedulerThreadCount();
+/// Total time worker thread (from 0 to wzTaskSchedulerThreadCount() - 1) has spent running tasks, in microseconds.
+uint64_t wzTaskSchedulerBusyMicroseconds(size_t thread);
+bool wzTaskSchedulerIsMainThread();
+
+/// Runs task on some worker thread.
+void wzTaskSubmit(std::function<void ()> task, TaskPriority priority = TaskPriority::Normal);
+/// Runs task on the main thread, the next time it calls wzTaskRunMainThreadTasks(). May be called from any thread.
+void wzTaskSubmitMainThread(std::function<void ()> task);
+/// Runs the tasks submitted with wzTaskSubmitMainThread(), in the order they were submitted. Main thread only.
+void wzTaskRunMainThreadTasks();
+
+/// Calls body(i) for each i in [0, count), on the calling thread and up to count - 1 workers, and returns when all calls
+/// are done. Which thread gets which index is not deterministic, so the calls must not depend on each other.
+void wzTaskParallelFor(size_t count, std::function<void (size_t)> const &body, TaskPriority priority = TaskPriority::High);
+
+/// Fork/join: tasks started with run() may run in parallel, wait() returns once they are all done.
+/// While waiting, the waiting thread runs those of the group's tasks which no worker has started yet, so a worker
+/// may wait for a group of its own without deadlocking.
+class TaskGroup
+{
+public:
+	explicit TaskGroup(TaskPriority priority = TaskPriority::High);
+	~TaskGroup();  ///< Waits for all tasks.
+	TaskGroup(TaskGroup const &) = delete;
+	TaskGroup &operator =(TaskGroup const &) = delete;
+
+	void run(std::function<void ()> task);  ///< Only to be called by the thread owning the group.
+	void wait();
+
+	struct State;
+
+private:
+	TaskPriority priority;
+	std::unique_ptr<State> state;
+};
+
+/// Serial queue: tasks run one at a time, in the order they were submitted, on whichever thread is free.
+/// Tasks submitted while earlier ones are running are run by the same thread, without going back to the scheduler.
+class TaskStrand
+{
+public:
+	explicit TaskStrand(TaskPriority priority = TaskPriority::Normal);
+	~TaskStrand();  ///< Waits for all tasks.
+	TaskStrand(TaskStrand const &) = delete;
+	TaskStrand &operator =(TaskStrand const &) = delete;
+
+	void submit(std::function<void ()> task);  ///< May be called from any thread.
+	void wait();  ///< Returns once no tasks are left. Runs them itself if no worker has started on them.
+	size_t pending() const;  ///< Number of tasks submitted but not yet finished.
+
+	struct State;
+
+private:
+	TaskPriority priority;
+	std::unique_ptr<State> state;
+};
@@ -21,7 +21,14 @@
 #include <array>
 #include <glm/glm.hpp>
 #include <algorithm>
-#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define WZ_CULLING_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define WZ_CULLING_NEON
+#endif
 
 BoundingBox transformBoundingBox(const glm::mat4& worldViewProjectionMatrix, const BoundingBox& worldSpaceBoundingBox)
 {
@@ -35,20 +42,197 @@ BoundingBox transformBoundingBox(const glm::mat4& worldViewProjectionMatrix, con
 	return bboxInClipSpace;
 }
 
+ViewFrustum extractViewFrustum(const glm::mat4& viewProjectionMatrix)
+{
+	// Each plane is the last row of the matrix plus or minus one of the others (Gribb & Hartmann)
+	const glm::mat4& m = viewProjectionMatrix;
+	auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+	ViewFrustum frustum;
+	frustum.planes = {
+		row(3) + row(0),  // left
+		row(3) - row(0),  // right
+		row(3) + row(1),  // bottom
+		row(3) - row(1),  // top
+		row(3) + row(2),  // near
+		row(3) - row(2),  // far
+	};
+	for (glm::vec4& plane : frustum.planes)
+	{
+		const float length = glm::length(glm::vec3(plane));
+		if (length > 0.f)
+		{
+			plane /= length;
+		}
+	}
+	return frustum;
+}
+
+void BoundingSphereList::clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	radius.clear();
+}
+
+void BoundingSphereList::reserve(size_t count)
+{
+	x.reserve(count);
+	y.reserve(count);
+	z.reserve(count);
+	radius.reserve(count);
+}
+
+void BoundingSphereList::push_back(const glm::vec3& centre, float sphereRadius)
+{
+	x.push_back(centre.x);
+	y.push_back(centre.y);
+	z.push_back(centre.z);
+	radius.push_back(sphereRadius);
+}
 
-bool isBBoxInClipSpace(const IntersectionOfHalfSpace& intersectionOfHalfSpace, const BoundingBox& points)
+void cullBoundingSpheres(const ViewFrustum& frustum, const BoundingSphereList& spheres, uint8_t* visible)
 {
-	// We test against the complement of the half space
-	// If all points lies in the complement a half space, it can't be part of the intersection
-	auto CheckAllPointsInSpace = [&points](const HalfSpaceCheck& predicate)
+	const size_t count = spheres.size();
+	size_t i = 0;
+
+	// A sphere is outside if its centre is further than its radius behind any plane.
+#if defined(WZ_CULLING_SSE2)
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(&spheres.x[i]);
+		const __m128 y = _mm_loadu_ps(&spheres.y[i]);
+		const __m128 z = _mm_loadu_ps(&spheres.z[i]);
+		const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+		__m128 inside = _mm_cmpeq_ps(x, x);  // all set, unless NaN
+		for (const glm::vec4& plane : frustum.planes)
 		{
-			return std::all_of(points.begin(), points.end(), [&predicate](const auto& v) { return !predicate(v); });
-		};
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+			                                   _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+		const int mask = _mm_movemask_ps(inside);
+		visible[i + 0] = mask & 1;
+		visible[i + 1] = (mask >> 1) & 1;
+		visible[i + 2] = (mask >> 2) & 1;
+		visible[i + 3] = (mask >> 3) & 1;
+	}
+#elif defined(WZ_CULLING_NEON)
+	for (; i + 4 <= count; i += 4)
+	{
+		const float32x4_t x = vld1q_f32(&spheres.x[i]);
+		const float32x4_t y = vld1q_f32(&spheres.y[i]);
+		const float32x4_t z = vld1q_f32(&spheres.z[i]);
+		const float32x4_t negRadius = vnegq_f32(vld1q_f32(&spheres.radius[i]));
+		uint32x4_t inside = vceqq_f32(x, x);  // all set, unless NaN
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			const float32x4_t distance = vaddq_f32(vaddq_f32(vmulq_n_f32(x, plane.x), vmulq_n_f32(y, plane.y)),
+			                                       vaddq_f32(vmulq_n_f32(z, plane.z), vdupq_n_f32(plane.w)));
+			inside = vandq_u32(inside, vcgeq_f32(distance, negRadius));
+		}
+		uint32_t lanes[4];
+		vst1q_u32(lanes, inside);
+		for (size_t lane = 0; lane < 4; ++lane)
+		{
+			visible[i + lane] = lanes[lane] != 0;
+		}
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const float x = spheres.x[i], y = spheres.y[i], z = spheres.z[i], negRadius = -spheres.radius[i];
+		bool inside = x == x;  // false if NaN, as above
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			inside &= (x * plane.x + y * plane.y) + (z * plane.z + plane.w) >= negRadius;
+		}
+		visible[i] = inside;
+	}
+}
+
+void ClipSpaceBoxList::clear()
+{
+	minX.clear();
+	maxX.clear();
+	minY.clear();
+	maxY.clear();
+	minZ.clear();
+	maxZ.clear();
+}
 
-	for (const auto& predicate : intersectionOfHalfSpace)
+void ClipSpaceBoxList::reserve(size_t count)
+{
+	minX.reserve(count);
+	maxX.reserve(count);
+	minY.reserve(count);
+	maxY.reserve(count);
+	minZ.reserve(count);
+	maxZ.reserve(count);
+}
+
+void ClipSpaceBoxList::push_back(const BoundingBox& clipSpaceBoundingBox, bool flipY)
+{
+	glm::vec3 boxMin = clipSpaceBoundingBox[0];
+	glm::vec3 boxMax = clipSpaceBoundingBox[0];
+	for (const glm::vec3& point : clipSpaceBoundingBox)
+	{
+		boxMin = glm::min(boxMin, point);
+		boxMax = glm::max(boxMax, point);
+	}
+	if (flipY)
+	{
+		std::swap(boxMin.y, boxMax.y);
+		boxMin.y = -boxMin.y;
+		boxMax.y = -boxMax.y;
+	}
+	minX.push_back(boxMin.x);
+	maxX.push_back(boxMax.x);
+	minY.push_back(boxMin.y);
+	maxY.push_back(boxMax.y);
+	minZ.push_back(boxMin.z);
+	maxZ.push_back(boxMax.z);
+}
+
+void cullClipSpaceBoxes(const glm::vec3& regionMin, const glm::vec3& regionMax, const ClipSpaceBoxList& boxes, uint8_t* visible)
+{
+	const size_t count = boxes.size();
+	size_t i = 0;
+
+#if defined(WZ_CULLING_SSE2)
+	const __m128 regionMinX = _mm_set1_ps(regionMin.x), regionMaxX = _mm_set1_ps(regionMax.x);
+	const __m128 regionMinY = _mm_set1_ps(regionMin.y), regionMaxY = _mm_set1_ps(regionMax.y);
+	const __m128 regionMinZ = _mm_set1_ps(regionMin.z), regionMaxZ = _mm_set1_ps(regionMax.z);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 overlap = _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(&boxes.maxX[i]), regionMinX), _mm_cmple_ps(_mm_loadu_ps(&boxes.minX[i]), regionMaxX));
+		overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(&boxes.maxY[i]), regionMinY), _mm_cmple_ps(_mm_loadu_ps(&boxes.minY[i]), regionMaxY)));
+		overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(&boxes.maxZ[i]), regionMinZ), _mm_cmple_ps(_mm_loadu_ps(&boxes.minZ[i]), regionMaxZ)));
+		const int mask = _mm_movemask_ps(overlap);
+		visible[i + 0] = mask & 1;
+		visible[i + 1] = (mask >> 1) & 1;
+		visible[i + 2] = (mask >> 2) & 1;
+		visible[i + 3] = (mask >> 3) & 1;
+	}
+#elif defined(WZ_CULLING_NEON)
+	for (; i + 4 <= count; i += 4)
+	{
+		uint32x4_t overlap = vandq_u32(vcgeq_f32(vld1q_f32(&boxes.maxX[i]), vdupq_n_f32(regionMin.x)), vcleq_f32(vld1q_f32(&boxes.minX[i]), vdupq_n_f32(regionMax.x)));
+		overlap = vandq_u32(overlap, vandq_u32(vcgeq_f32(vld1q_f32(&boxes.maxY[i]), vdupq_n_f32(regionMin.y)), vcleq_f32(vld1q_f32(&boxes.minY[i]), vdupq_n_f32(regionMax.y))));
+		overlap = vandq_u32(overlap, vandq_u32(vcgeq_f32(vld1q_f32(&boxes.maxZ[i]), vdupq_n_f32(regionMin.z)), vcleq_f32(vld1q_f32(&boxes.minZ[i]), vdupq_n_f32(regionMax.z))));
+		uint32_t lanes[4];
+		vst1q_u32(lanes, overlap);
+		for (size_t lane = 0; lane < 4; ++lane)
+		{
+			visible[i + lane] = lanes[lane] != 0;
+		}
+	}
+#endif
+	for (; i < count; ++i)
 	{
-		if (CheckAllPointsInSpace(predicate))
-			return false;
+		visible[i] = boxes.maxX[i] >= regionMin.x && boxes.minX[i] <= regionMax.x
+			&& boxes.maxY[i] >= regionMin.y && boxes.minY[i] <= regionMax.y
+			&& boxes.maxZ[i] >= regionMin.z && boxes.minZ[i] <= regionMax.z;
 	}
-	return true;
 }
@@ -22,17 +22,51 @@
 
 #include <array>
 #include <glm/glm.hpp>
-#include <algorithm>
-#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
 
 using BoundingBox = std::array<glm::vec3, 8>;
 
 /// Project a bounding box in clip space
 BoundingBox transformBoundingBox(const glm::mat4& worldViewProjectionMatrix, const BoundingBox& worldSpaceBoundingBox);
 
-/// Define a half space
-using HalfSpaceCheck = std::function<bool(const glm::vec3&)>;
-/// Define a view frustum (as an intersection of half space
-using IntersectionOfHalfSpace = std::array< HalfSpaceCheck, 6>;
+/// A view frustum, as six planes (a, b, c, d) with normalised (a, b, c): a point p is inside a plane if dot(a b c, p) + d >= 0
+struct ViewFrustum
+{
+	std::array<glm::vec4, 6> planes;
+};
 
-bool isBBoxInClipSpace(const IntersectionOfHalfSpace& intersectionOfHalfSpace, const BoundingBox& points);
+/// The frustum of a perspective or orthographic view projection matrix. The near plane is that of [-1, 1] clip space depth,
+/// so the frustum is also right (if slightly too deep) for matrices made for [0, 1] depth.
+ViewFrustum extractViewFrustum(const glm::mat4& viewProjectionMatrix);
+
+/// Bounding spheres, stored as structure of arrays so that cullBoundingSpheres() can test several at once.
+struct BoundingSphereList
+{
+	std::vector<float> x, y, z, radius;
+
+	size_t size() const { return x.size(); }
+	void clear();
+	void reserve(size_t count);
+	void push_back(const glm::vec3& centre, float sphereRadius);
+};
+
+/// Sets visible[i] to 1 if sphere i may be inside the frustum, or to 0 if it is certainly outside. visible must hold spheres.size() bytes.
+void cullBoundingSpheres(const ViewFrustum& frustum, const BoundingSphereList& spheres, uint8_t* visible);
+
+/// Axis aligned boxes in clip space, stored as structure of arrays so that cullClipSpaceBoxes() can test several at once.
+struct ClipSpaceBoxList
+{
+	std::vector<float> minX, maxX, minY, maxY, minZ, maxZ;
+
+	size_t size() const { return minX.size(); }
+	void clear();
+	void reserve(size_t count);
+	/// Adds the box around clipSpaceBoundingBox, mirrored vertically if flipY.
+	void push_back(const BoundingBox& clipSpaceBoundingBox, bool flipY = false);
+};
+
+/// Sets visible[i] to 1 if box i overlaps the box from regionMin to regionMax (bounds included), or to 0 if not.
+/// visible must hold boxes.size() bytes.
+void cullClipSpaceBoxes(const glm::vec3& regionMin, const glm::vec3& regionMax, const ClipSpaceBoxList& boxes, uint8_t* visible);
@@ -28,6 +28,7 @@
 #include "gfx_api_image_basis_priv.h"
 #include "gfx_api_mipmap_priv.h"
 #include "lib/framework/physfs_ext.h"
+#include "lib/framework/task_scheduler.h"
 #include <unordered_map>
 #include <algorithm>
 
@@ -110,6 +111,12 @@ bool gfx_api::context::isInitialized()
 	return current_backend_context != nullptr;
 }
 
+void gfx_api::context::setSelfTestContext(context* ctx)
+{
+	ASSERT_OR_RETURN(, ctx == nullptr || current_backend_context == nullptr, "A backend is already initialised");
+	current_backend_context = ctx;
+}
+
 // MARK: - Per-texture compression overrides
 
 #include "lib/framework/file.h"
@@ -812,6 +819,26 @@ void gfx_api::context::warmCompiledRenderGraph(std::vector<RenderPassDesc>& /*pa
 {
 }
 
+// Run the record callbacks of every pass in a batch, on the calling thread
+static void recordExecutionBatch(gfx_api::context& ctx, const gfx_api::PassGraphCompileResult& compileResult,
+	const gfx_api::ExecutionBatch& batch)
+{
+	const size_t batchEnd = batch.startIndex + batch.count;
+	for (size_t j = batch.startIndex; j < batchEnd; ++j)
+	{
+		const gfx_api::CompiledPass& batchPass = compileResult.passes[j];
+		if (j != batch.startIndex)
+		{
+			ctx.debugStringMarker(batchPass.desc.debugName.c_str());
+		}
+		if (batchPass.desc.recordFunc)
+		{
+			const gfx_api::RenderPassContext batchContext = gfx_api::buildRenderPassContext(batchPass);
+			batchPass.desc.recordFunc(batchContext);
+		}
+	}
+}
+
 void gfx_api::context::executeCompiledRenderGraph(std::vector<RenderPassDesc>& passes,
 	const PassGraphCompileResult& compileResult)
 {
@@ -826,15 +853,59 @@ void gfx_api::context::executeCompiledRenderGraph(std::vector<RenderPassDesc>& p
 			[](const CompiledPass& p) { return !p.skipped; }),
 		"executeCompiledRenderGraph: non-skipped passes but no execution batches");
 
-	for (const ExecutionBatch& batch : compileResult.executionBatches)
+	// Batches made only of parallelRecord passes get a recorder each, and are recorded on workers
+	// (the main thread helps once it reaches the first of them); the rest are recorded inline below.
+	_parallelBatchSlots.assign(compileResult.executionBatches.size(), SIZE_MAX);
+	_parallelBatchHeads.clear();
+	if (supportsParallelPassRecording() && wzTaskSchedulerThreadCount() > 0)
+	{
+		for (size_t i = 0; i < compileResult.executionBatches.size(); ++i)
+		{
+			const ExecutionBatch& batch = compileResult.executionBatches[i];
+			if (batch.count == 0 || batch.startIndex > compileResult.passes.size()
+				|| batch.count > compileResult.passes.size() - batch.startIndex)
+			{
+				continue;  // Reported below.
+			}
+			const auto batchBegin = compileResult.passes.begin() + batch.startIndex;
+			if (std::all_of(batchBegin, batchBegin + batch.count, [](const CompiledPass& p) { return p.desc.parallelRecord; }))
+			{
+				_parallelBatchSlots[i] = _parallelBatchHeads.size();
+				_parallelBatchHeads.push_back(&compileResult.passes[batch.startIndex]);
+			}
+		}
+	}
+
+	TaskGroup recordGroup;
+	bool parallelRecordingDone = _parallelBatchHeads.empty();
+	if (!parallelRecordingDone)
 	{
+		prepareParallelPassRecording(_parallelBatchHeads);
+		for (size_t i = 0; i < compileResult.executionBatches.size(); ++i)
+		{
+			const size_t slot = _parallelBatchSlots[i];
+			if (slot == SIZE_MAX)
+			{
+				continue;
+			}
+			const ExecutionBatch batch = compileResult.executionBatches[i];
+			recordGroup.run([this, &compileResult, batch, slot]() {
+				beginParallelPassRecording(slot);
+				recordExecutionBatch(*this, compileResult, batch);
+				endParallelPassRecording(slot);
+			});
+		}
+	}
+
+	for (size_t i = 0; i < compileResult.executionBatches.size(); ++i)
+	{
+		const ExecutionBatch& batch = compileResult.executionBatches[i];
 		ASSERT(batch.startIndex <= compileResult.passes.size()
 			&& batch.count <= compileResult.passes.size() - batch.startIndex,
 			"executeCompiledRenderGraph: batch range out of bounds (start=%zu count=%zu compiled=%zu)",
 			batch.startIndex, batch.count, compileResult.passes.size());
 
 		const CompiledPass& head = compileResult.passes[batch.startIndex];
-		const size_t batchEnd = batch.startIndex + batch.count;
 
 #if defined(DEBUG)
 		ASSERT(passes[head.graphIndex].debugName == head.desc.debugName,
@@ -848,24 +919,23 @@ void gfx_api::context::executeCompiledRenderGraph(std::vector<RenderPassDesc>& p
 		// pipelineBarrier for the whole batch.
 		emitPrePassBarriers(batch, compileResult.passes);
 
-		beginPass(head.desc, &head);
-
-		for (size_t j = batch.startIndex; j < batchEnd; ++j)
+		const size_t slot = _parallelBatchSlots[i];
+		if (slot != SIZE_MAX)
 		{
-			const CompiledPass& batchPass = compileResult.passes[j];
-			if (j != batch.startIndex)
-			{
-				debugStringMarker(batchPass.desc.debugName.c_str());
-			}
-			if (batchPass.desc.recordFunc)
+			if (!parallelRecordingDone)
 			{
-				const RenderPassContext batchContext = buildRenderPassContext(batchPass);
-				batchPass.desc.recordFunc(batchContext);
+				recordGroup.wait();
+				parallelRecordingDone = true;
 			}
+			executeParallelPassRecording(slot, head);
+			continue;
 		}
 
+		beginPass(head.desc, &head);
+		recordExecutionBatch(*this, compileResult, batch);
 		endPass(&head);
 	}
 
+	recordGroup.wait();
 	setRenderGraphExecuting(false);
 }
@@ -410,6 +410,8 @@ namespace gfx_api
 		static context& get();
 		static bool initialize(const gfx_api::backend_Impl_Factory& impl, int32_t antialiasing, swap_interval_mode mode, optional<float> mipLodBias, uint32_t depthMapResolution, gfx_api::backend_type backend);
 		static bool isInitialized();
+		/// Makes get() return ctx, which isn't initialised, until called again with nullptr. For self-tests run before any backend is initialised.
+		static void setSelfTestContext(context* ctx);
 		virtual size_t numDepthPasses() { return 0; }
 		virtual bool setDepthPassProperties(size_t numDepthPasses, size_t depthBufferResolution) { return false; }
 		virtual void beginPass(const RenderPassDesc& pass, const CompiledPass* compiledPass = nullptr) = 0;
@@ -598,6 +600,9 @@ namespace gfx_api
 		// sharing one render pass). Called once before beginPass, outside any active render pass.
 		virtual void emitPrePassBarriers(const ExecutionBatch& batch,
 			const std::vector<CompiledPass>& compiledPasses) {}
+		/// True if the backend can record batches whose passes all set `RenderPassDesc::parallelRecord`
+		/// on task scheduler workers (one recorder per batch), while the main thread records the others.
+		virtual bool supportsParallelPassRecording() const { return false; }
 		virtual void debugStringMarker(const char *str) = 0;
 		virtual void debugSceneBegin(const char *descr) = 0;
 		virtual void debugSceneEnd(const char *descr) = 0;
@@ -652,9 +657,22 @@ namespace gfx_api
 
 		gfx_api::texture* createTextureForCompatibleImageUploads(const size_t& mipmap_count, const iV_Image& bitmap, const std::string& filename);
 
-	protected:
 		// True while executeCompiledRenderGraph() is running. Draw/bind APIs must only be called from record callbacks.
 		bool renderGraphExecuting() const { return _renderGraphExecuting; }
+
+	protected:
+		/// Parallel pass recording, see supportsParallelPassRecording(). executeCompiledRenderGraph() calls
+		/// prepareParallelPassRecording() on the main thread with the head pass of each parallel batch, in graph
+		/// order; recorder `slot` is the index in that list. Each batch is then recorded on some worker between
+		/// beginParallelPassRecording(slot) and endParallelPassRecording(slot), with bind/draw calls made by that
+		/// thread in between going to the recorder. Once all recorders are done, the main thread calls
+		/// executeParallelPassRecording() for each slot at the batch's place in graph order, instead of
+		/// beginPass()/endPass().
+		virtual void prepareParallelPassRecording(const std::vector<const CompiledPass*>& batchHeads) {}
+		virtual void beginParallelPassRecording(size_t slot) {}
+		virtual void endParallelPassRecording(size_t slot) {}
+		virtual void executeParallelPassRecording(size_t slot, const CompiledPass& head) {}
+
 		void setRenderGraphExecuting(bool executing) { _renderGraphExecuting = executing; }
 		void bumpRenderGraphEpoch() { ++_renderGraphEpoch; }
 
@@ -663,6 +681,9 @@ namespace gfx_api
 		optional<GpuFrameTiming> _lastGpuFrameTiming;
 
 	private:
+		/// Per execution batch: parallel recorder slot, or SIZE_MAX if recorded inline. Scratch for executeCompiledRenderGraph().
+		std::vector<size_t> _parallelBatchSlots;
+		std::vector<const CompiledPass*> _parallelBatchHeads;
 		bool _renderGraphExecuting = false;
 		uint64_t _renderGraphEpoch = 1;
 		bool _screenGeometryDirty = true;
@@ -740,14 +761,9 @@ namespace gfx_api
 			return object;
 		}
 
+		// Only reads pso: parallel pass recorders may all bind the same helper at once
 		void bind()
 		{
-			if (this->nextpso != nullptr && !this->nextpso->broken)
-			{
-				if (this->pso != nullptr) delete this->pso;
-				this->pso = this->nextpso;
-				this->nextpso = nullptr;
-			}
 			gfx_api::context::get().bind_pipeline(pso, std::tuple_size<texture_inputs>::value == 0);
 		}
 
@@ -814,10 +830,11 @@ namespace gfx_api
 			context::get().draw_elements_instanced(offset, count, primitive, index, instance_count);
 		}
 
+		// Swaps the rebuilt pipeline in right away, so must be called on the main thread outside executeCompiledRenderGraph()
 		bool recompile()
 		{
-			nextpso = gfx_api::context::get().build_pipeline(pso, pipeline_create_info(rasterizer::get(), shader, primitive, untuple_typeinfo(uniform_inputs{}), texture_descriptions(), untuple<vertex_buffer>(vertex_buffer_inputs{})));
-			return nextpso != nullptr && !nextpso->broken;
+			ASSERT(!gfx_api::context::get().renderGraphExecuting(), "Pipeline recompiled while passes are being recorded");
+			return build();
 		}
 
 		bool isBroken()
@@ -827,11 +844,26 @@ namespace gfx_api
 
 	private:
 		pipeline_state_object* pso = nullptr;
-		pipeline_state_object* nextpso = nullptr;
+		pipeline_state_object* nextpso = nullptr;  // A broken rebuild, kept for isBroken(), while pso stays in use
 
 		pipeline_state_helper()
 		{
-			recompile();
+			build();
+		}
+
+		bool build()
+		{
+			pipeline_state_object* rebuilt = gfx_api::context::get().build_pipeline(pso, pipeline_create_info(rasterizer::get(), shader, primitive, untuple_typeinfo(uniform_inputs{}), texture_descriptions(), untuple<vertex_buffer>(vertex_buffer_inputs{})));
+			delete nextpso;
+			nextpso = nullptr;
+			if (rebuilt == nullptr || rebuilt->broken)
+			{
+				nextpso = rebuilt;
+				return false;
+			}
+			delete pso;
+			pso = rebuilt;
+			return true;
 		}
 
 //		// Requires C++14 (+)
@@ -20,6 +20,12 @@
 #include "lib/framework/frame.h"
 #include "gfx_api_null.h"
 #include "lib/exceptionhandler/dumpinfo.h"
+#include "lib/framework/task_scheduler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <numeric>
 
 // MARK: null_texture
 
@@ -212,17 +218,19 @@ gfx_api::pipeline_state_object * null_context::build_pipeline(gfx_api::pipeline_
 
 void null_context::bind_pipeline(gfx_api::pipeline_state_object* pso, bool notextures)
 {
+	noteRecordedCommand(__FUNCTION__);
 	null_pipeline_state_object* new_program = static_cast<null_pipeline_state_object*>(pso);
-	if (current_program != new_program)
+	if (currentProgram() != new_program)
 	{
-		current_program = new_program;
+		currentProgram() = new_program;
 	}
 }
 
 void null_context::bind_vertex_buffers(const std::size_t& first, const std::vector<std::tuple<gfx_api::buffer*, std::size_t>>& vertex_buffers_offset)
 {
-	ASSERT_OR_RETURN(, current_program != nullptr, "current_program == NULL");
-	for (size_t i = 0, e = vertex_buffers_offset.size(); i < e && (first + i) < current_program->vertex_buffer_desc.size(); ++i)
+	noteRecordedCommand(__FUNCTION__);
+	ASSERT_OR_RETURN(, currentProgram() != nullptr, "current_program == NULL");
+	for (size_t i = 0, e = vertex_buffers_offset.size(); i < e && (first + i) < currentProgram()->vertex_buffer_desc.size(); ++i)
 	{
 		auto* buffer = static_cast<null_buffer*>(std::get<0>(vertex_buffers_offset[i]));
 		if (buffer == nullptr)
@@ -236,7 +244,7 @@ void null_context::bind_vertex_buffers(const std::size_t& first, const std::vect
 
 void null_context::unbind_vertex_buffers(const std::size_t& first, const std::vector<std::tuple<gfx_api::buffer*, std::size_t>>& vertex_buffers_offset)
 {
-	ASSERT_OR_RETURN(, current_program != nullptr, "current_program == NULL");
+	ASSERT_OR_RETURN(, currentProgram() != nullptr, "current_program == NULL");
 	// no-op
 }
 
@@ -247,14 +255,16 @@ void null_context::disable_all_vertex_buffers()
 
 void null_context::bind_streamed_vertex_buffers(const void* data, const std::size_t size)
 {
-	ASSERT_OR_RETURN(, current_program != nullptr, "current_program == NULL");
+	noteRecordedCommand(__FUNCTION__);
+	ASSERT_OR_RETURN(, currentProgram() != nullptr, "current_program == NULL");
 	ASSERT(size > 0, "bind_streamed_vertex_buffers called with size 0");
 	// no-op
 }
 
 void null_context::bind_index_buffer(gfx_api::buffer& _buffer, const gfx_api::index_type&)
 {
-	ASSERT_OR_RETURN(, current_program != nullptr, "current_program == NULL");
+	noteRecordedCommand(__FUNCTION__);
+	ASSERT_OR_RETURN(, currentProgram() != nullptr, "current_program == NULL");
 	auto& buffer = static_cast<null_buffer&>(_buffer);
 	ASSERT(buffer.usage == gfx_api::buffer::usage::index_buffer, "Passed gfx_api::buffer is not an index buffer");
 	// no-op
@@ -267,41 +277,44 @@ void null_context::unbind_index_buffer(gfx_api::buffer&)
 
 void null_context::bind_textures(const std::vector<gfx_api::texture_input>& texture_descriptions, const std::vector<gfx_api::abstract_texture*>& textures)
 {
-	ASSERT_OR_RETURN(, current_program != nullptr, "current_program == NULL");
+	noteRecordedCommand(__FUNCTION__);
+	ASSERT_OR_RETURN(, currentProgram() != nullptr, "current_program == NULL");
 	ASSERT(textures.size() <= texture_descriptions.size(), "Received more textures than expected");
 	// no-op
 }
 
 void null_context::set_constants(const void* buffer, const size_t& size)
 {
-	ASSERT_OR_RETURN(, current_program != nullptr, "current_program == NULL");
+	noteRecordedCommand(__FUNCTION__);
+	ASSERT_OR_RETURN(, currentProgram() != nullptr, "current_program == NULL");
 	// no-op
 }
 
 void null_context::set_uniforms(const size_t& first, const std::vector<std::tuple<const void*, size_t>>& uniform_blocks)
 {
-	ASSERT_OR_RETURN(, current_program != nullptr, "current_program == NULL");
+	noteRecordedCommand(__FUNCTION__);
+	ASSERT_OR_RETURN(, currentProgram() != nullptr, "current_program == NULL");
 	// no-op
 }
 
 void null_context::draw(const size_t& offset, const size_t &count, const gfx_api::primitive_type &primitive)
 {
-	// no-op
+	noteRecordedCommand(__FUNCTION__);
 }
 
 void null_context::draw_instanced(const std::size_t& offset, const std::size_t &count, const gfx_api::primitive_type &primitive, std::size_t instance_count)
 {
-	// no-op
+	noteRecordedCommand(__FUNCTION__);
 }
 
 void null_context::draw_elements(const size_t& offset, const size_t &count, const gfx_api::primitive_type &primitive, const gfx_api::index_type& index)
 {
-	// no-op
+	noteRecordedCommand(__FUNCTION__);
 }
 
 void null_context::draw_elements_instanced(const std::size_t& offset, const std::size_t &count, const gfx_api::primitive_type &primitive, const gfx_api::index_type& index, std::size_t instance_count)
 {
-	// no-op
+	noteRecordedCommand(__FUNCTION__);
 }
 
 void null_context::set_polygon_offset(const float& factor, const float& units)
@@ -430,9 +443,14 @@ void null_context::warmCompiledRenderGraph(std::vector<gfx_api::RenderPassDesc>&
 {
 }
 
-void null_context::beginPass(const gfx_api::RenderPassDesc& pass, const gfx_api::CompiledPass* /*compiledPass*/)
+void null_context::beginPass(const gfx_api::RenderPassDesc& pass, const gfx_api::CompiledPass* compiledPass)
 {
 	(void)pass;
+	checkParallelRecording(threadRecorder == nullptr, "beginPass called inside a parallel pass recorder");
+	if (compiledPass != nullptr)
+	{
+		parallelStats.passOrder.push_back(compiledPass->graphIndex);
+	}
 	frameHasDrawCommands = true;
 }
 
@@ -440,6 +458,238 @@ void null_context::endPass(const gfx_api::CompiledPass* /*compiledPass*/)
 {
 }
 
+// MARK: null_context parallel pass recording
+
+thread_local null_context::PassRecorder* null_context::threadRecorder = nullptr;
+
+null_pipeline_state_object*& null_context::currentProgram()
+{
+	return (threadRecorder != nullptr) ? threadRecorder->current_program : current_program;
+}
+
+void null_context::checkParallelRecording(bool condition, const char *message)
+{
+	if (condition)
+	{
+		return;
+	}
+	debug(LOG_ERROR, "Parallel pass recording: %s", message);
+	std::lock_guard<std::mutex> lock(parallelStatsMutex);
+	++parallelStats.errors;
+}
+
+void null_context::noteRecordedCommand(const char *function)
+{
+	PassRecorder* recorder = threadRecorder;
+	if (recorder == nullptr)
+	{
+		if (!wzTaskSchedulerIsMainThread())
+		{
+			debug(LOG_ERROR, "Parallel pass recording: %s called from a worker outside a pass recorder", function);
+			std::lock_guard<std::mutex> lock(parallelStatsMutex);
+			++parallelStats.errors;
+		}
+		return;
+	}
+	checkParallelRecording(recorder->recording && recorder->thread == std::this_thread::get_id(), "command recorded outside begin/endParallelPassRecording");
+	++recorder->commandCount;
+}
+
+void null_context::prepareParallelPassRecording(const std::vector<const gfx_api::CompiledPass*>& batchHeads)
+{
+	checkParallelRecording(wzTaskSchedulerIsMainThread(), "prepareParallelPassRecording called off the main thread");
+	checkParallelRecording(executedParallelRecorders == parallelRecorders.size(), "previous recorders were never executed");
+	parallelRecorders.assign(batchHeads.size(), PassRecorder());
+	for (size_t slot = 0; slot < batchHeads.size(); ++slot)
+	{
+		parallelRecorders[slot].head = batchHeads[slot];
+	}
+	executedParallelRecorders = 0;
+}
+
+void null_context::beginParallelPassRecording(size_t slot)
+{
+	ASSERT_OR_RETURN(, slot < parallelRecorders.size(), "Invalid recorder slot %zu", slot);
+	PassRecorder& recorder = parallelRecorders[slot];
+	checkParallelRecording(threadRecorder == nullptr, "recorders nested on one thread");
+	checkParallelRecording(!recorder.recording && !recorder.recorded, "recorder begun twice");
+	recorder.recording = true;
+	recorder.thread = std::this_thread::get_id();
+	threadRecorder = &recorder;
+}
+
+void null_context::endParallelPassRecording(size_t slot)
+{
+	ASSERT_OR_RETURN(, slot < parallelRecorders.size(), "Invalid recorder slot %zu", slot);
+	PassRecorder& recorder = parallelRecorders[slot];
+	checkParallelRecording(threadRecorder == &recorder && recorder.recording, "recorder ended on a different thread than it began");
+	recorder.recording = false;
+	recorder.recorded = true;
+	threadRecorder = nullptr;
+}
+
+void null_context::executeParallelPassRecording(size_t slot, const gfx_api::CompiledPass& head)
+{
+	ASSERT_OR_RETURN(, slot < parallelRecorders.size(), "Invalid recorder slot %zu", slot);
+	PassRecorder& recorder = parallelRecorders[slot];
+	checkParallelRecording(wzTaskSchedulerIsMainThread(), "recorder executed off the main thread");
+	checkParallelRecording(recorder.recorded && !recorder.recording, "recorder executed before its recording finished");
+	checkParallelRecording(!recorder.executed, "recorder executed twice");
+	checkParallelRecording(recorder.head == &head, "recorder executed for a different batch");
+	checkParallelRecording(slot == executedParallelRecorders, "recorders executed out of graph order");
+	recorder.executed = true;
+	++executedParallelRecorders;
+
+	parallelStats.passOrder.push_back(head.graphIndex);
+	parallelStats.recorderPipelines.push_back(recorder.current_program);
+	parallelStats.recordedCommands += recorder.commandCount;
+	++parallelStats.executedRecorders;
+	frameHasDrawCommands = true;
+}
+
+// Bound by every parallel pass of the self-test, as the shadow cascades all bind the same depth-only pipelines
+using SelfTestPSO = gfx_api::pipeline_state_helper<gfx_api::rasterizer_state<REND_OPAQUE, DEPTH_CMP_LEQ_WRT_OFF, 255, gfx_api::polygon_offset::disabled, gfx_api::stencil_mode::stencil_disabled, gfx_api::cull_mode::none>, gfx_api::primitive_type::triangles, gfx_api::index_type::u16,
+	std::tuple<gfx_api::constant_buffer_type<SHADER_GENERIC_COLOR>>,
+	std::tuple<
+	gfx_api::vertex_buffer_description<12, gfx_api::vertex_attribute_input_rate::vertex, gfx_api::vertex_attribute_description<gfx_api::position, gfx_api::vertex_attribute_type::float3, 0>>
+	>, gfx_api::notexture, SHADER_GENERIC_COLOR>;
+
+bool gfx_api::runParallelPassRecordingSelfTest()
+{
+	bool ok = true;
+	const auto check = [&ok](bool cond, const char *msg)
+	{
+		if (!cond)
+		{
+			fprintf(stderr, "[render-graph-selftest] FAIL: %s\n", msg);
+			ok = false;
+		}
+	};
+
+	// Recording on workers needs workers.
+	const bool startedScheduler = wzTaskSchedulerThreadCount() == 0;
+	if (startedScheduler)
+	{
+		wzTaskSchedulerInitialise(3);
+	}
+
+	null_context ctx(false);
+	// pipeline_state_helper builds and binds through context::get()
+	const bool installedContext = !context::isInitialized();
+	if (installedContext)
+	{
+		context::setSelfTestContext(&ctx);
+	}
+	const std::thread::id mainThread = std::this_thread::get_id();
+	constexpr size_t drawsPerParallelPass = 64;
+
+	struct TestPass
+	{
+		PassId id;
+		bool parallel;
+	};
+	const TestPass testPasses[] = {
+		{PassId::Backdrop, false},
+		{PassId::ShadowCascade0, true},
+		{PassId::ShadowCascade1, true},
+		{PassId::ShadowCascade2, true},
+		{PassId::ShadowCascade3, true},
+		{PassId::ScenePass, false},
+		{PassId::InGameUI, false},
+	};
+	constexpr size_t passCount = sizeof(testPasses) / sizeof(testPasses[0]);
+	std::array<std::atomic<size_t>, passCount> runs;
+	std::array<std::thread::id, passCount> recordThreads;
+
+	std::vector<RenderPassDesc> descs(passCount);
+	for (size_t i = 0; i < passCount; ++i)
+	{
+		descs[i].debugName = "SelfTest" + std::to_string(i);
+		descs[i].passId = testPasses[i].id;
+		descs[i].parallelRecord = testPasses[i].parallel;
+		const bool parallel = testPasses[i].parallel;
+		descs[i].recordFunc = [&ctx, &runs, &recordThreads, i, parallel, installedContext](const RenderPassContext&) {
+			++runs[i];
+			recordThreads[i] = std::this_thread::get_id();
+			if (parallel && installedContext)
+			{
+				SelfTestPSO::get().bind();
+			}
+			else
+			{
+				ctx.bind_pipeline(nullptr, true);
+			}
+			for (size_t draw = 0; parallel && draw < drawsPerParallelPass; ++draw)
+			{
+				ctx.draw(0, 3, primitive_type::triangles);
+			}
+		};
+	}
+	PassGraphCompileResult compiled;
+	compiled.passes.resize(passCount);
+	for (size_t i = 0; i < passCount; ++i)
+	{
+		compiled.passes[i].desc = descs[i];
+		compiled.passes[i].graphIndex = i;
+		compiled.executionBatches.push_back(ExecutionBatch{i, 1});
+	}
+
+	// A few frames, so recorders are reused as they would be in game. The pipeline is rebuilt between frames,
+	// as the debug menu does, and all recorders must then bind the rebuilt one.
+	const pipeline_state_object* previousFramePipeline = nullptr;
+	for (int frame = 0; frame < 3; ++frame)
+	{
+		for (auto& count : runs)
+		{
+			count = 0;
+		}
+		if (installedContext && frame > 0)
+		{
+			check(SelfTestPSO::get().recompile(), "pipeline recompiled");
+		}
+		ctx.resetParallelRecordingStats();
+		ctx.executeCompiledRenderGraph(descs, compiled);
+
+		const auto& stats = ctx.parallelRecordingStats();
+		check(std::all_of(runs.begin(), runs.end(), [](const std::atomic<size_t>& count) { return count == 1; }), "every pass recorded exactly once");
+		bool inlineOnMain = true;
+		for (size_t i = 0; i < passCount; ++i)
+		{
+			inlineOnMain = inlineOnMain && (testPasses[i].parallel || recordThreads[i] == mainThread);
+		}
+		check(inlineOnMain, "inline passes recorded on the main thread");
+		std::vector<size_t> graphOrder(passCount);
+		std::iota(graphOrder.begin(), graphOrder.end(), 0);
+		check(stats.passOrder == graphOrder, "passes joined in graph order");
+		check(stats.executedRecorders == 4, "one recorder per parallel pass");
+		check(stats.recordedCommands == 4 * (1 + drawsPerParallelPass), "recorders saw every command of their pass");
+		check(stats.errors == 0, "no recording rule broken");
+		if (installedContext)
+		{
+			// The rebuilt pipeline is made while the previous one still exists, so their addresses differ
+			const auto& pipelines = stats.recorderPipelines;
+			const pipeline_state_object* framePipeline = pipelines.empty() ? nullptr : pipelines.front();
+			check(pipelines.size() == 4 && framePipeline != nullptr && std::all_of(pipelines.begin(), pipelines.end(), [framePipeline](const pipeline_state_object* pso) { return pso == framePipeline; }), "recorders bound the same pipeline");
+			check(framePipeline != previousFramePipeline, "recorders bound the recompiled pipeline");
+			previousFramePipeline = framePipeline;
+		}
+	}
+
+	if (installedContext)
+	{
+		context::setSelfTestContext(nullptr);
+	}
+	if (startedScheduler)
+	{
+		wzTaskSchedulerShutdown();
+	}
+	if (ok)
+	{
+		fprintf(stderr, "[render-graph-selftest] PASS (%zu passes, 4 recorded in parallel)\n", passCount);
+	}
+	return ok;
+}
+
 void null_context::beginScreenFrame()
 {
 	frameHasDrawCommands = false;
@@ -21,6 +21,10 @@
 
 #include "gfx_api.h"
 
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace gfx_api
 {
 	class backend_Null_Impl
@@ -136,6 +140,7 @@ public:
 	virtual void purgeFrameResources() override;
 	virtual void warmCompiledRenderGraph(std::vector<gfx_api::RenderPassDesc>& passes,
 		gfx_api::PassGraphCompileResult& compileResult) override;
+	virtual bool supportsParallelPassRecording() const override { return true; }
 	virtual void debugStringMarker(const char *str) override;
 	virtual void debugSceneBegin(const char *descr) override;
 	virtual void debugSceneEnd(const char *descr) override;
@@ -169,11 +174,62 @@ public:
 	virtual void draw_elements_instanced(const std::size_t& offset, const std::size_t& count, const gfx_api::primitive_type& primitive, const gfx_api::index_type& index, std::size_t instance_count) override;
 	// debug apis for recompiling pipelines
 	virtual bool debugRecompileAllPipelines() override;
+
+	/// What the parallel pass recorders saw since the last resetParallelRecordingStats(), for the self-test.
+	struct ParallelRecordingStats
+	{
+		size_t recordedCommands = 0;     ///< Bind/draw calls made inside a recorder
+		size_t executedRecorders = 0;    ///< Recorders joined into the frame
+		size_t errors = 0;               ///< Broken recording rules (each is also logged)
+		std::vector<size_t> passOrder;   ///< graphIndex of each pass begun or executed, in order
+		std::vector<const gfx_api::pipeline_state_object*> recorderPipelines;  ///< Pipeline each executed recorder bound last
+	};
+	const ParallelRecordingStats& parallelRecordingStats() const { return parallelStats; }
+	void resetParallelRecordingStats() { parallelStats = ParallelRecordingStats(); }
+
+protected:
+	virtual void prepareParallelPassRecording(const std::vector<const gfx_api::CompiledPass*>& batchHeads) override;
+	virtual void beginParallelPassRecording(size_t slot) override;
+	virtual void endParallelPassRecording(size_t slot) override;
+	virtual void executeParallelPassRecording(size_t slot, const gfx_api::CompiledPass& head) override;
+
 private:
 	virtual bool _initialize(const gfx_api::backend_Impl_Factory& impl, int32_t antialiasing, swap_interval_mode mode, optional<float> mipLodBias, uint32_t depthMapResolution) override;
 	bool setSwapIntervalInternal(gfx_api::context::swap_interval_mode mode);
+
+	/// Stands in for a secondary command buffer: checks that commands are recorded on one thread, between
+	/// begin and end, and joined once, in graph order.
+	struct PassRecorder
+	{
+		const gfx_api::CompiledPass* head = nullptr;
+		null_pipeline_state_object* current_program = nullptr;
+		std::thread::id thread;
+		size_t commandCount = 0;
+		bool recording = false;
+		bool recorded = false;
+		bool executed = false;
+	};
+
+	static thread_local PassRecorder* threadRecorder;  ///< Recorder the calling thread is recording into, if any
+
+	null_pipeline_state_object*& currentProgram();
+	void noteRecordedCommand(const char *function);
+	void checkParallelRecording(bool condition, const char *message);
+
 private:
 
 	size_t frameNum = 0;
 	bool frameHasDrawCommands = false;
+	std::vector<PassRecorder> parallelRecorders;  ///< Sized on the main thread before any recorder starts
+	size_t executedParallelRecorders = 0;
+	std::mutex parallelStatsMutex;
+	ParallelRecordingStats parallelStats;         ///< Protected by parallelStatsMutex while recorders run
 };
+
+namespace gfx_api
+{
+	/// Records a small graph with parallel passes through a null_context and checks the recorders' commands
+	/// and join order, and that recorders binding the same pipeline_state_helper all get the pipeline last
+	/// recompiled. Returns false (and logs to stderr) on failure.
+	bool runParallelPassRecordingSelfTest();
+}
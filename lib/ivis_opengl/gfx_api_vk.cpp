@@ -64,6 +64,7 @@
 #include "vk/transfer_recording_context.h"
 #include "lib/framework/physfs_ext.h"
 #include "lib/framework/wzapp.h"
+#include "lib/framework/task_scheduler.h"
 #include "lib/exceptionhandler/dumpinfo.h"
 
 #include <algorithm>
@@ -828,6 +829,7 @@ perFrameResources_t::perFrameResources_t(vk::Device& _dev, const VmaAllocator& a
 	, streamedVertexBufferAllocator(allocator, 128 * 1024, vk::BufferUsageFlagBits::eVertexBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU, true)
 	, uniformBufferAllocator(allocator, 1024 * 1024, vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU, true)
 	, pVkDynLoader(&vkDynLoader)
+	, graphicsQueueFamilyIndex(graphicsQueueFamilyIndex)
 {
 	combinedImageSamplerDescriptorPools.push_back(createNewDescriptorPool(vk::DescriptorType::eCombinedImageSampler, descriptorPoolMaxSetsDefault, descriptorPoolSizeDescriptorCountDefault));
 	uniformDynamicDescriptorPools.push_back(createNewDescriptorPool(vk::DescriptorType::eUniformBufferDynamic, descriptorPoolMaxSetsDefault, descriptorPoolSizeDescriptorCountDefault));
@@ -867,6 +869,27 @@ perFrameResources_t::DescriptorPoolDetails perFrameResources_t::createNewDescrip
 		), poolSize, maxSets);
 }
 
+void perFrameResources_t::ensureParallelRecordCommands(size_t count)
+{
+	while (parallelRecordCommands.size() < count)
+	{
+		ParallelRecordCommands commands;
+		commands.pool = dev.createCommandPool(
+			vk::CommandPoolCreateInfo()
+			.setQueueFamilyIndex(graphicsQueueFamilyIndex)
+			, nullptr, *pVkDynLoader
+		);
+		commands.cmd = dev.allocateCommandBuffers(
+			vk::CommandBufferAllocateInfo()
+			.setCommandPool(commands.pool)
+			.setCommandBufferCount(1)
+			.setLevel(vk::CommandBufferLevel::eSecondary)
+			, *pVkDynLoader
+		)[0];
+		parallelRecordCommands.push_back(commands);
+	}
+}
+
 void perFrameResources_t::ensureDrawCmdBufferBegun()
 {
 	if (!drawCmdBufferBegun)
@@ -993,6 +1016,10 @@ void perFrameResources_t::clean()
 perFrameResources_t::~perFrameResources_t()
 {
 	dev.destroyCommandPool(pool, nullptr, *pVkDynLoader);
+	for (const auto& commands : parallelRecordCommands)
+	{
+		dev.destroyCommandPool(commands.pool, nullptr, *pVkDynLoader);
+	}
 	for (const auto& descriptorPoolDetails : combinedImageSamplerDescriptorPools.pools)
 	{
 		dev.destroyDescriptorPool(descriptorPoolDetails.poolHandle, nullptr, *pVkDynLoader);
@@ -1096,6 +1123,10 @@ void buffering_mechanism::swap(vk::Device dev, const WZ_vk::DispatchLoaderDynami
 	dev.resetFences(fences, vkDynLoader);
 	buffering_mechanism::get_current_resources().resetDescriptorPools();
 	dev.resetCommandPool(buffering_mechanism::get_current_resources().pool, vk::CommandPoolResetFlagBits(), vkDynLoader);
+	for (const auto& commands : buffering_mechanism::get_current_resources().parallelRecordCommands)
+	{
+		dev.resetCommandPool(commands.pool, vk::CommandPoolResetFlagBits(), vkDynLoader);
+	}
 	buffering_mechanism::get_current_resources().drawCmdBufferBegun = false;
 	buffering_mechanism::get_current_resources().copyCmdBufferBegun = false;
 	buffering_mechanism::get_current_resources().transferWorkRecorded = false;
@@ -2822,7 +2853,33 @@ VkRoot::~VkRoot()
 
 const VkRoot::RenderPassDetails& VkRoot::currentRenderPass()
 {
-	return renderPasses[currentRenderPassId];
+	return renderPasses[recordingRenderPassId()];
+}
+
+thread_local VkRoot::ParallelPassRecorder* VkRoot::_threadRecorder = nullptr;
+
+vk::CommandBuffer* VkRoot::recordCmdBuffer()
+{
+	if (_threadRecorder != nullptr)
+	{
+		return &_threadRecorder->cmd;
+	}
+	return buffering_mechanism::get_current_resources().currentDrawCmdBuffer();
+}
+
+VkPSO*& VkRoot::boundPSO()
+{
+	return (_threadRecorder != nullptr) ? _threadRecorder->currentPSO : currentPSO;
+}
+
+size_t VkRoot::recordingRenderPassId() const
+{
+	return (_threadRecorder != nullptr) ? _threadRecorder->renderPassId : currentRenderPassId;
+}
+
+bool VkRoot::recordingPassActive() const
+{
+	return _threadRecorder != nullptr || hasActivePass;
 }
 
 gfx_api::pipeline_state_object * VkRoot::build_pipeline(gfx_api::pipeline_state_object *existing_pso, const gfx_api::pipeline_create_info& createInfo)
@@ -2834,10 +2891,15 @@ gfx_api::pipeline_state_object * VkRoot::build_pipeline(gfx_api::pipeline_state_
 		psoID = existingPSOId->psoID;
 	}
 
+	// Parallel pass recorders look pipelines up in createdPipelines, and may build missing ones
+	std::lock_guard<std::mutex> lock(_recordMutex);
+	const size_t renderPassId = recordingRenderPassId();
+
 	// build a pipeline, return an indirect VkPSOId (to enable rebuilding pipelines if needed)
 	VkPSO* pipeline = nullptr;
 	try {
-		pipeline = new VkPSO(dev, physDeviceProps.limits, createInfo, currentRenderPass().rp, currentRenderPass().rp_compat_info, currentRenderPass().msaaSamples, vkDynLoader, *this);
+		const auto& renderPass = renderPasses[renderPassId];
+		pipeline = new VkPSO(dev, physDeviceProps.limits, createInfo, renderPass.rp, renderPass.rp_compat_info, renderPass.msaaSamples, vkDynLoader, *this);
 	}
 	catch (const vk::SystemError& e)
 	{
@@ -2884,16 +2946,16 @@ gfx_api::pipeline_state_object * VkRoot::build_pipeline(gfx_api::pipeline_state_
 	{
 		createdPipelines.emplace_back(createInfo, renderPasses.size());
 		psoID = createdPipelines.size() - 1;
-		createdPipelines[psoID.value()].renderPassPSO[currentRenderPassId] = pipeline;
+		createdPipelines[psoID.value()].renderPassPSO[renderPassId] = pipeline;
 	}
 	else
 	{
 		auto& builtPipelineRegistry = createdPipelines[psoID.value()];
-		if (builtPipelineRegistry.renderPassPSO[currentRenderPassId] != nullptr)
+		if (builtPipelineRegistry.renderPassPSO[renderPassId] != nullptr)
 		{
-			buffering_mechanism::get_current_resources().pso_to_delete.emplace_back(builtPipelineRegistry.renderPassPSO[currentRenderPassId]);
+			buffering_mechanism::get_current_resources().pso_to_delete.emplace_back(builtPipelineRegistry.renderPassPSO[renderPassId]);
 		}
-		builtPipelineRegistry.renderPassPSO[currentRenderPassId] = pipeline;
+		builtPipelineRegistry.renderPassPSO[renderPassId] = pipeline;
 	}
 
 	return new VkPSOId(psoID.value(), false); // always return a new indirect reference
@@ -5371,42 +5433,42 @@ void VkRoot::getQueues()
 
 void VkRoot::draw(const std::size_t& offset, const std::size_t& count, const gfx_api::primitive_type&)
 {
-	ASSERT_OR_RETURN(, renderGraphExecuting() && hasActivePass,
+	ASSERT_OR_RETURN(, renderGraphExecuting() && recordingPassActive(),
 		"draw() called outside render graph record callback");
 
 	ASSERT(offset <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "offset (%zu) exceeds uint32_t max", offset);
 	ASSERT(count <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "count (%zu) exceeds uint32_t max", count);
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->draw(static_cast<uint32_t>(count), 1, static_cast<uint32_t>(offset), 0, vkDynLoader);
+	recordCmdBuffer()->draw(static_cast<uint32_t>(count), 1, static_cast<uint32_t>(offset), 0, vkDynLoader);
 }
 
 void VkRoot::draw_instanced(const std::size_t& offset, const std::size_t &count, const gfx_api::primitive_type &primitive, std::size_t instance_count)
 {
 	ASSERT(offset <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "offset (%zu) exceeds uint32_t max", offset);
 	ASSERT(count <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "count (%zu) exceeds uint32_t max", count);
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->draw(static_cast<uint32_t>(count), static_cast<uint32_t>(instance_count), static_cast<uint32_t>(offset), 0, vkDynLoader);
+	recordCmdBuffer()->draw(static_cast<uint32_t>(count), static_cast<uint32_t>(instance_count), static_cast<uint32_t>(offset), 0, vkDynLoader);
 }
 
 void VkRoot::draw_elements(const std::size_t& offset, const std::size_t& count, const gfx_api::primitive_type&, const gfx_api::index_type&)
 {
-	ASSERT_OR_RETURN(, renderGraphExecuting() && hasActivePass,
+	ASSERT_OR_RETURN(, renderGraphExecuting() && recordingPassActive(),
 		"draw_elements() called outside render graph record callback");
-	ASSERT_OR_RETURN(, currentPSO != nullptr, "currentPSO == NULL");
+	ASSERT_OR_RETURN(, boundPSO() != nullptr, "currentPSO == NULL");
 	ASSERT(offset <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "offset (%zu) exceeds uint32_t max", offset);
 	ASSERT(count <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "count (%zu) exceeds uint32_t max", count);
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->drawIndexed(static_cast<uint32_t>(count), 1, static_cast<uint32_t>(offset) >> 2, 0, 0, vkDynLoader);
+	recordCmdBuffer()->drawIndexed(static_cast<uint32_t>(count), 1, static_cast<uint32_t>(offset) >> 2, 0, 0, vkDynLoader);
 }
 
 void VkRoot::draw_elements_instanced(const std::size_t& offset, const std::size_t &count, const gfx_api::primitive_type &primitive, const gfx_api::index_type& index, std::size_t instance_count)
 {
-	ASSERT_OR_RETURN(, currentPSO != nullptr, "currentPSO == NULL");
+	ASSERT_OR_RETURN(, boundPSO() != nullptr, "currentPSO == NULL");
 	ASSERT(offset <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "offset (%zu) exceeds uint32_t max", offset);
 	ASSERT(count <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "count (%zu) exceeds uint32_t max", count);
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->drawIndexed(static_cast<uint32_t>(count), static_cast<uint32_t>(instance_count), static_cast<uint32_t>(offset) >> 2, 0, 0, vkDynLoader);
+	recordCmdBuffer()->drawIndexed(static_cast<uint32_t>(count), static_cast<uint32_t>(instance_count), static_cast<uint32_t>(offset) >> 2, 0, 0, vkDynLoader);
 }
 
 void VkRoot::bind_vertex_buffers(const std::size_t& first, const std::vector<std::tuple<gfx_api::buffer*, std::size_t>>& vertex_buffers_offset)
 {
-	ASSERT_OR_RETURN(, currentPSO != nullptr, "currentPSO == NULL");
+	ASSERT_OR_RETURN(, boundPSO() != nullptr, "currentPSO == NULL");
 	std::vector<vk::Buffer> buffers;
 	std::vector<VkDeviceSize> offsets;
 	buffers.reserve(vertex_buffers_offset.size());
@@ -5420,7 +5482,7 @@ void VkRoot::bind_vertex_buffers(const std::size_t& first, const std::vector<std
 		offsets.push_back(std::get<1>(input));
 	}
 	ASSERT(first <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "first (%zu) exceeds uint32_t max", first);
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->bindVertexBuffers(static_cast<uint32_t>(first), buffers, offsets, vkDynLoader);
+	recordCmdBuffer()->bindVertexBuffers(static_cast<uint32_t>(first), buffers, offsets, vkDynLoader);
 }
 
 void VkRoot::unbind_vertex_buffers(const std::size_t& first, const std::vector<std::tuple<gfx_api::buffer*, std::size_t>>& vertex_buffers_offset)
@@ -5435,18 +5497,20 @@ void VkRoot::disable_all_vertex_buffers()
 
 void VkRoot::bind_streamed_vertex_buffers(const void* data, const std::size_t size)
 {
-	ASSERT_OR_RETURN(, currentPSO != nullptr, "currentPSO == NULL");
+	ASSERT_OR_RETURN(, boundPSO() != nullptr, "currentPSO == NULL");
 	ASSERT(size > 0, "bind_streamed_vertex_buffers called with size 0");
 	ASSERT(size <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "size (%zu) exceeds uint32_t max", size);
 	auto& frameResources = buffering_mechanism::get_current_resources();
+	std::unique_lock<std::mutex> lock(_recordMutex);
 	const auto streamedMemory = frameResources.streamedVertexBufferAllocator.alloc(static_cast<uint32_t>(size), 16);
 	const auto mappedPtr = frameResources.streamedVertexBufferAllocator.mapMemory(streamedMemory);
 	ASSERT(mappedPtr != nullptr, "Failed to map memory");
 	memcpy(mappedPtr, data, size);
 	frameResources.streamedVertexBufferAllocator.unmapMemory(streamedMemory);
+	lock.unlock();
 	const auto buffers = std::array<vk::Buffer, 1> { streamedMemory.buffer };
 	const auto offsets = std::array<vk::DeviceSize, 1> { streamedMemory.offset };
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->bindVertexBuffers(0, buffers, offsets, vkDynLoader);
+	recordCmdBuffer()->bindVertexBuffers(0, buffers, offsets, vkDynLoader);
 }
 
 // throws a vk::SystemError on an unrecoverable error (like OOM)
@@ -5675,6 +5739,7 @@ gfx_api::buffer* VkRoot::create_buffer_object(const gfx_api::buffer::usage &usag
 std::vector<vk::DescriptorSet> VkRoot::allocateDescriptorSet(vk::DescriptorSetLayout arg, vk::DescriptorType descriptorType, uint32_t numDescriptors)
 {
 	const auto descriptorSet = std::array<vk::DescriptorSetLayout, 1>{ arg };
+	std::lock_guard<std::mutex> lock(_recordMutex);
 	buffering_mechanism::get_current_resources().numalloc++;
 	return dev.allocateDescriptorSets(
 		vk::DescriptorSetAllocateInfo()
@@ -5686,6 +5751,7 @@ std::vector<vk::DescriptorSet> VkRoot::allocateDescriptorSet(vk::DescriptorSetLa
 
 std::vector<vk::DescriptorSet> VkRoot::allocateDescriptorSets(std::vector<vk::DescriptorSetLayout> args, vk::DescriptorType descriptorType, uint32_t numDescriptors)
 {
+	std::lock_guard<std::mutex> lock(_recordMutex);
 	buffering_mechanism::get_current_resources().numalloc++;
 	return dev.allocateDescriptorSets(
 		vk::DescriptorSetAllocateInfo()
@@ -5710,10 +5776,10 @@ vk::IndexType VkRoot::to_vk(const gfx_api::index_type& index)
 
 void VkRoot::bind_index_buffer(gfx_api::buffer& index_buffer, const gfx_api::index_type& index)
 {
-	ASSERT_OR_RETURN(, currentPSO != nullptr, "currentPSO == NULL");
+	ASSERT_OR_RETURN(, boundPSO() != nullptr, "currentPSO == NULL");
 	auto& casted_buf = static_cast<VkBuf&>(index_buffer);
 	ASSERT(casted_buf.usage == gfx_api::buffer::usage::index_buffer, "Passed gfx_api::buffer is not an index buffer");
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->bindIndexBuffer(casted_buf.object, 0, to_vk(index), vkDynLoader);
+	recordCmdBuffer()->bindIndexBuffer(casted_buf.object, 0, to_vk(index), vkDynLoader);
 }
 
 void VkRoot::unbind_index_buffer(gfx_api::buffer&)
@@ -5723,11 +5789,11 @@ void VkRoot::unbind_index_buffer(gfx_api::buffer&)
 
 void VkRoot::bind_textures(const std::vector<gfx_api::texture_input>& attribute_descriptions, const std::vector<gfx_api::abstract_texture*>& textures)
 {
-	ASSERT_OR_RETURN(, currentPSO != nullptr, "currentPSO == NULL");
+	ASSERT_OR_RETURN(, boundPSO() != nullptr, "currentPSO == NULL");
 	ASSERT(textures.size() <= attribute_descriptions.size(), "Received more textures than expected");
 	ASSERT(textures.size() <= std::numeric_limits<uint32_t>::max(), "Too many textures: %zu", textures.size());
 
-	const auto set = allocateDescriptorSet(currentPSO->textures_set_layout, vk::DescriptorType::eCombinedImageSampler, static_cast<uint32_t>(textures.size()));
+	const auto set = allocateDescriptorSet(boundPSO()->textures_set_layout, vk::DescriptorType::eCombinedImageSampler, static_cast<uint32_t>(textures.size()));
 
 	uint32_t i = 0;
 	auto image_descriptor = std::vector<vk::DescriptorImageInfo>{};
@@ -5822,7 +5888,7 @@ void VkRoot::bind_textures(const std::vector<gfx_api::texture_input>& attribute_
 		i++;
 	}
 	dev.updateDescriptorSets(write_info, nullptr, vkDynLoader);
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, currentPSO->layout, currentPSO->textures_first_set, set, nullptr, vkDynLoader);
+	recordCmdBuffer()->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, boundPSO()->layout, boundPSO()->textures_first_set, set, nullptr, vkDynLoader);
 }
 
 void VkRoot::set_constants(const void* buffer, const std::size_t& size)
@@ -5832,17 +5898,22 @@ void VkRoot::set_constants(const void* buffer, const std::size_t& size)
 
 void VkRoot::set_uniforms_set(const size_t& uniform_set, const void* buffer, size_t size)
 {
-	ASSERT_OR_RETURN(, currentPSO != nullptr, "currentPSO == NULL");
+	VkPSO* pso = boundPSO();
+	ASSERT_OR_RETURN(, pso != nullptr, "currentPSO == NULL");
 	ASSERT(size <= static_cast<size_t>(std::numeric_limits<uint32_t>::max()), "size (%zu) exceeds uint32_t max", size);
-	const auto stagingMemory = buffering_mechanism::get_current_resources().uniformBufferAllocator.alloc(static_cast<uint32_t>(size), physDeviceProps.limits.minUniformBufferOffsetAlignment);
-	void * pDynamicUniformBufferMapped = buffering_mechanism::get_current_resources().uniformBufferAllocator.mapMemory(stagingMemory);
+	auto& frameResources = buffering_mechanism::get_current_resources();
+	auto& perPSODescriptorSets = frameResources.perPSO_dynamicUniformBufferDescriptorSets;
+
+	std::unique_lock<std::mutex> lock(_recordMutex);
+	const auto stagingMemory = frameResources.uniformBufferAllocator.alloc(static_cast<uint32_t>(size), physDeviceProps.limits.minUniformBufferOffsetAlignment);
+	void * pDynamicUniformBufferMapped = frameResources.uniformBufferAllocator.mapMemory(stagingMemory);
 	memcpy(reinterpret_cast<uint8_t*>(pDynamicUniformBufferMapped), buffer, size);
 
 	const auto bufferInfo = vk::DescriptorBufferInfo(stagingMemory.buffer, 0, size);
 
 	vk::DescriptorSet descSet;
-	auto perFrame_perPSO_dynamicUniformDescriptorSets = buffering_mechanism::get_current_resources().perPSO_dynamicUniformBufferDescriptorSets.find(currentPSO);
-	if ((perFrame_perPSO_dynamicUniformDescriptorSets != buffering_mechanism::get_current_resources().perPSO_dynamicUniformBufferDescriptorSets.end())
+	auto perFrame_perPSO_dynamicUniformDescriptorSets = perPSODescriptorSets.find(pso);
+	if ((perFrame_perPSO_dynamicUniformDescriptorSets != perPSODescriptorSets.end())
 		&& (perFrame_perPSO_dynamicUniformDescriptorSets->second.size() > uniform_set))
 	{
 		auto &uniformSetDescriptorSets = perFrame_perPSO_dynamicUniformDescriptorSets->second[uniform_set];
@@ -5854,7 +5925,8 @@ void VkRoot::set_uniforms_set(const size_t& uniform_set, const void* buffer, siz
 
 	if (!descSet)
 	{
-		auto sets = allocateDescriptorSet(currentPSO->cbuffer_set_layout[uniform_set], vk::DescriptorType::eUniformBufferDynamic, 1);
+		lock.unlock();
+		auto sets = allocateDescriptorSet(pso->cbuffer_set_layout[uniform_set], vk::DescriptorType::eUniformBufferDynamic, 1);
 		descSet = sets[0];
 		const auto descriptorWrite = std::array<vk::WriteDescriptorSet, 1>{
 			vk::WriteDescriptorSet()
@@ -5865,22 +5937,22 @@ void VkRoot::set_uniforms_set(const size_t& uniform_set, const void* buffer, siz
 				.setDstSet(descSet)
 		};
 		dev.updateDescriptorSets(descriptorWrite, nullptr, vkDynLoader);
-		if (perFrame_perPSO_dynamicUniformDescriptorSets == buffering_mechanism::get_current_resources().perPSO_dynamicUniformBufferDescriptorSets.end())
-		{
-			auto result = buffering_mechanism::get_current_resources().perPSO_dynamicUniformBufferDescriptorSets.insert(perFrameResources_t::PerPSODynamicUniformBufferDescriptorSets::value_type(currentPSO, std::vector<optional<perFrameResources_t::DynamicUniformBufferDescriptorSets>>()));
-			perFrame_perPSO_dynamicUniformDescriptorSets = result.first;
-		}
-		perFrame_perPSO_dynamicUniformDescriptorSets->second.resize(currentPSO->cbuffer_set_layout.size());
+		lock.lock();
+		// Another recorder may have changed the map meanwhile
+		auto result = perPSODescriptorSets.insert(perFrameResources_t::PerPSODynamicUniformBufferDescriptorSets::value_type(pso, std::vector<optional<perFrameResources_t::DynamicUniformBufferDescriptorSets>>()));
+		perFrame_perPSO_dynamicUniformDescriptorSets = result.first;
+		perFrame_perPSO_dynamicUniformDescriptorSets->second.resize(pso->cbuffer_set_layout.size());
 		perFrame_perPSO_dynamicUniformDescriptorSets->second[uniform_set] = perFrameResources_t::DynamicUniformBufferDescriptorSets( bufferInfo, descSet);
 	}
+	lock.unlock();
 	const auto dynamicOffsets = std::array<uint32_t, 1> { stagingMemory.offset };
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, currentPSO->layout, static_cast<uint32_t>(uniform_set), descSet, dynamicOffsets, vkDynLoader);
+	recordCmdBuffer()->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pso->layout, static_cast<uint32_t>(uniform_set), descSet, dynamicOffsets, vkDynLoader);
 }
 
 void VkRoot::set_uniforms(const size_t& first, const std::vector<std::tuple<const void*, size_t>>& uniform_blocks)
 {
-	ASSERT_OR_RETURN(, currentPSO != nullptr, "currentPSO == NULL");
-	for (size_t i = 0, e = uniform_blocks.size(); i < e && (first + i) < currentPSO->cbuffer_set_layout.size(); ++i)
+	ASSERT_OR_RETURN(, boundPSO() != nullptr, "currentPSO == NULL");
+	for (size_t i = 0, e = uniform_blocks.size(); i < e && (first + i) < boundPSO()->cbuffer_set_layout.size(); ++i)
 	{
 		auto* buffer = std::get<0>(uniform_blocks[i]);
 		if (buffer == nullptr)
@@ -5893,24 +5965,30 @@ void VkRoot::set_uniforms(const size_t& first, const std::vector<std::tuple<cons
 
 void VkRoot::bind_pipeline(gfx_api::pipeline_state_object* pso, bool /*notextures*/)
 {
-	ASSERT_OR_RETURN(, renderGraphExecuting() && hasActivePass,
+	ASSERT_OR_RETURN(, renderGraphExecuting() && recordingPassActive(),
 		"bind_pipeline() called outside render graph record callback");
 
 	VkPSOId* newPSOId = static_cast<VkPSOId*>(pso);
-	// lookup PSO
-	auto& pipelineInfo = createdPipelines[newPSOId->psoID];
-	VkPSO* newPSO = pipelineInfo.renderPassPSO[currentRenderPassId];
-	if (!newPSO)
+	const size_t renderPassId = recordingRenderPassId();
+	VkPSO* newPSO = nullptr;
 	{
-		// Must build this pipeline for a different render pass
-		auto& renderPass = renderPasses[currentRenderPassId];
-		newPSO = new VkPSO(dev, physDeviceProps.limits, pipelineInfo.createInfo, renderPass.rp, renderPass.rp_compat_info, renderPass.msaaSamples, vkDynLoader, *this);
-		pipelineInfo.renderPassPSO[currentRenderPassId] = newPSO;
+		std::lock_guard<std::mutex> lock(_recordMutex);
+		// lookup PSO
+		auto& pipelineInfo = createdPipelines[newPSOId->psoID];
+		newPSO = pipelineInfo.renderPassPSO[renderPassId];
+		if (!newPSO)
+		{
+			// Must build this pipeline for a different render pass
+			auto& renderPass = renderPasses[renderPassId];
+			newPSO = new VkPSO(dev, physDeviceProps.limits, pipelineInfo.createInfo, renderPass.rp, renderPass.rp_compat_info, renderPass.msaaSamples, vkDynLoader, *this);
+			pipelineInfo.renderPassPSO[renderPassId] = newPSO;
+		}
 	}
+	VkPSO*& currentPSO = boundPSO();
 	if (currentPSO != newPSO)
 	{
 		currentPSO = newPSO;
-		buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->bindPipeline(vk::PipelineBindPoint::eGraphics, currentPSO->object, vkDynLoader);
+		recordCmdBuffer()->bindPipeline(vk::PipelineBindPoint::eGraphics, currentPSO->object, vkDynLoader);
 	}
 }
 
@@ -6865,7 +6943,30 @@ const gfx_api::vk::VulkanWarmEntry& VkRoot::warmEntry(size_t graphIndex) const
 	return _warmEntries[graphIndex];
 }
 
+size_t VkRoot::resolvePassRenderPassId(const gfx_api::RenderPassDesc& pass, const gfx_api::CompiledPass* compiledPass)
+{
+	if (compiledPass != nullptr)
+	{
+		const gfx_api::vk::VulkanWarmEntry& warm = warmEntry(compiledPass->graphIndex);
+		if (warm.renderPassLayoutId != gfx_api::vk::VulkanWarmEntry::INVALID_LAYOUT_ID
+			&& warm.warmEpoch == getRenderGraphEpoch())
+		{
+			return warm.renderPassLayoutId;
+		}
+	}
+	ASSERT_OR_RETURN(INVALID_RENDER_PASS_ID, buildPassLayoutKey(_passLayoutScratch, pass, compiledPass),
+		"Failed to build pass layout key");
+	// May add to renderPasses, which parallel pass recorders read
+	std::lock_guard<std::mutex> lock(_recordMutex);
+	return getOrCreatePassRenderPassId(_passLayoutScratch);
+}
+
 void VkRoot::beginPass(const gfx_api::RenderPassDesc& pass, const gfx_api::CompiledPass* compiledPass)
+{
+	beginPassInternal(pass, compiledPass, false);
+}
+
+void VkRoot::beginPassInternal(const gfx_api::RenderPassDesc& pass, const gfx_api::CompiledPass* compiledPass, bool secondaryContents)
 {
 	ASSERT_OR_RETURN(, !hasActivePass, "beginPass called while another pass is active");
 	ASSERT_OR_RETURN(, pass.viewportSize.has_value(), "Pass requires resolved viewportSize");
@@ -6879,21 +6980,12 @@ void VkRoot::beginPass(const gfx_api::RenderPassDesc& pass, const gfx_api::Compi
 	const uint32_t passWidth = pass.viewportSize->first;
 	const uint32_t passHeight = pass.viewportSize->second;
 
-	size_t renderPassId = INVALID_RENDER_PASS_ID;
-	if (compiledPass != nullptr)
-	{
-		const gfx_api::vk::VulkanWarmEntry& warm = warmEntry(compiledPass->graphIndex);
-		if (warm.renderPassLayoutId != gfx_api::vk::VulkanWarmEntry::INVALID_LAYOUT_ID
-			&& warm.warmEpoch == getRenderGraphEpoch())
-		{
-			renderPassId = warm.renderPassLayoutId;
-		}
-	}
+	const size_t renderPassId = resolvePassRenderPassId(pass, compiledPass);
 	if (renderPassId == INVALID_RENDER_PASS_ID)
 	{
-		ASSERT_OR_RETURN(, buildPassLayoutKey(_passLayoutScratch, pass, compiledPass),
-			"Failed to build pass layout key");
-		renderPassId = getOrCreatePassRenderPassId(_passLayoutScratch);
+		hasActivePass = false;
+		_activePassTargetsSwapchain = false;
+		return;
 	}
 
 	buffering_mechanism::get_current_resources().ensureDrawCmdBufferBegun();
@@ -6960,12 +7052,16 @@ void VkRoot::beginPass(const gfx_api::RenderPassDesc& pass, const gfx_api::Compi
 			.setPClearValues(_clearValuesScratch.data())
 			.setRenderPass(renderPasses[renderPassId].rp)
 			.setRenderArea(vk::Rect2D(vk::Offset2D(), vk::Extent2D(passWidth, passHeight))),
-		vk::SubpassContents::eInline,
+		secondaryContents ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline,
 		vkDynLoader);
 
-	applyViewport(drawCmdBuffer, passWidth, passHeight,
-		_activePassTargetsSwapchain ? _viewportMinDepth : 0.f,
-		_activePassTargetsSwapchain ? _viewportMaxDepth : 1.f);
+	// Secondary command buffers set their own viewport (see beginParallelPassRecording)
+	if (!secondaryContents)
+	{
+		applyViewport(drawCmdBuffer, passWidth, passHeight,
+			_activePassTargetsSwapchain ? _viewportMinDepth : 0.f,
+			_activePassTargetsSwapchain ? _viewportMaxDepth : 1.f);
+	}
 
 	currentRenderPassId = renderPassId;
 	currentPSO = nullptr;
@@ -7008,6 +7104,67 @@ void VkRoot::endPass(const gfx_api::CompiledPass* compiledPass)
 	_activePassTargetsSwapchain = false;
 }
 
+void VkRoot::prepareParallelPassRecording(const std::vector<const gfx_api::CompiledPass*>& batchHeads)
+{
+	ASSERT(wzTaskSchedulerIsMainThread(), "Parallel pass recording prepared off the main thread");
+	auto& frameResources = buffering_mechanism::get_current_resources();
+	frameResources.ensureParallelRecordCommands(batchHeads.size());
+	_parallelRecorders.assign(batchHeads.size(), ParallelPassRecorder());
+	for (size_t slot = 0; slot < batchHeads.size(); ++slot)
+	{
+		const gfx_api::RenderPassDesc& pass = batchHeads[slot]->desc;
+		ASSERT_OR_RETURN(, pass.viewportSize.has_value(), "Pass requires resolved viewportSize");
+		const bool targetsSwapchain = gfx_api::passTargetsSwapchainColor(pass);
+		auto& recorder = _parallelRecorders[slot];
+		recorder.cmd = frameResources.parallelRecordCommands[slot].cmd;
+		recorder.renderPassId = resolvePassRenderPassId(pass, batchHeads[slot]);
+		recorder.width = pass.viewportSize->first;
+		recorder.height = pass.viewportSize->second;
+		recorder.minDepth = targetsSwapchain ? _viewportMinDepth : 0.f;
+		recorder.maxDepth = targetsSwapchain ? _viewportMaxDepth : 1.f;
+	}
+}
+
+void VkRoot::beginParallelPassRecording(size_t slot)
+{
+	ASSERT_OR_RETURN(, slot < _parallelRecorders.size(), "Invalid parallel recorder slot %zu", slot);
+	ASSERT_OR_RETURN(, _threadRecorder == nullptr, "Thread already has a parallel pass recorder");
+	auto& recorder = _parallelRecorders[slot];
+	ASSERT_OR_RETURN(, recorder.renderPassId != INVALID_RENDER_PASS_ID, "Parallel recorder slot %zu has no render pass", slot);
+	const auto inheritanceInfo = vk::CommandBufferInheritanceInfo()
+		.setRenderPass(renderPasses[recorder.renderPassId].rp)
+		.setSubpass(0);
+	recorder.cmd.begin(
+		vk::CommandBufferBeginInfo()
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+			.setPInheritanceInfo(&inheritanceInfo),
+		vkDynLoader);
+	applyViewport(recorder.cmd, recorder.width, recorder.height, recorder.minDepth, recorder.maxDepth);
+	recorder.currentPSO = nullptr;
+	_threadRecorder = &recorder;
+}
+
+void VkRoot::endParallelPassRecording(size_t slot)
+{
+	ASSERT_OR_RETURN(, slot < _parallelRecorders.size() && _threadRecorder == &_parallelRecorders[slot],
+		"Parallel recorder slot %zu not recording on this thread", slot);
+	_threadRecorder->cmd.end(vkDynLoader);
+	_threadRecorder = nullptr;
+}
+
+void VkRoot::executeParallelPassRecording(size_t slot, const gfx_api::CompiledPass& head)
+{
+	ASSERT_OR_RETURN(, slot < _parallelRecorders.size(), "Invalid parallel recorder slot %zu", slot);
+	beginPassInternal(head.desc, &head, true);
+	if (!hasActivePass)
+	{
+		return;
+	}
+	const auto commands = std::array<vk::CommandBuffer, 1> { _parallelRecorders[slot].cmd };
+	buffering_mechanism::get_current_resources().drawCmdBuffer().executeCommands(commands, vkDynLoader);
+	endPass(&head);
+}
+
 size_t VkRoot::numDepthPasses()
 {
 	return depthPassCount;
@@ -7275,11 +7432,17 @@ void VkRoot::set_polygon_offset(const float& factor, const float& units)
 {
 	// vkCmdSetDepthBias takes (constantFactor, clamp, slopeFactor) - the reverse
 	// of this function's glPolygonOffset-style (factor, units) order
-	buffering_mechanism::get_current_resources().currentDrawCmdBuffer()->setDepthBias(units, (physDeviceFeatures.depthBiasClamp) ? 1.0f : 0.f, factor, vkDynLoader);
+	recordCmdBuffer()->setDepthBias(units, (physDeviceFeatures.depthBiasClamp) ? 1.0f : 0.f, factor, vkDynLoader);
 }
 
 void VkRoot::set_depth_range(const float& min, const float& max)
 {
+	if (_threadRecorder != nullptr)
+	{
+		// Parallel recorders draw off-screen only, and mustn't touch the main thread's viewport state
+		applyViewport(_threadRecorder->cmd, _threadRecorder->width, _threadRecorder->height, min, max);
+		return;
+	}
 	_viewportMinDepth = min;
 	_viewportMaxDepth = max;
 
@@ -45,6 +45,7 @@
 #include <map>
 #include <vector>
 #include <limits>
+#include <mutex>
 #include <unordered_map>
 #include <typeindex>
 
@@ -247,6 +248,14 @@ struct perFrameResources_t
 	DescriptorPoolsContainer uniformDynamicDescriptorPools;
 	uint32_t numalloc = 0;
 	vk::CommandPool pool;
+	/// Secondary command buffers of the passes recorded in parallel, one per recorder slot. Each has its own pool,
+	/// since a pool may only be used by one thread at a time. Reset with `pool` when the ring slot is reused.
+	struct ParallelRecordCommands
+	{
+		vk::CommandPool pool;
+		vk::CommandBuffer cmd;
+	};
+	std::vector<ParallelRecordCommands> parallelRecordCommands;
 	vk::Fence previousSubmission;
 	vk::Semaphore imageAcquireSemaphore;
 	std::vector</*WZ_vk::UniqueBuffer*/vk::Buffer> buffer_to_delete;
@@ -278,6 +287,8 @@ public:
 	vk::CommandBuffer drawCmdBuffer();
 
 	void ensureDrawCmdBufferBegun();
+	/// Grow parallelRecordCommands to at least `count` slots. Main thread only.
+	void ensureParallelRecordCommands(size_t count);
 	void endCopyCmdBufferIfRecording();
 	void endDrawCmdBufferIfRecording();
 
@@ -323,6 +334,7 @@ private:
 private:
 	const WZ_vk::DispatchLoaderDynamic *pVkDynLoader;
 	vk::CommandBuffer *pCurrentDrawCmdBuffer = nullptr;
+	uint32_t graphicsQueueFamilyIndex = 0;
 };
 
 struct perSwapchainImageResources_t
@@ -959,8 +971,14 @@ public:
 	virtual optional<std::pair<uint32_t, uint32_t>> getRenderTargetDimensions(gfx_api::abstract_texture* texture) override;
 	virtual void warmCompiledRenderGraph(std::vector<gfx_api::RenderPassDesc>& passes,
 		gfx_api::PassGraphCompileResult& compileResult) override;
+	virtual bool supportsParallelPassRecording() const override { return true; }
 	virtual void set_polygon_offset(const float& factor, const float& units) override;
 	virtual void set_depth_range(const float& min, const float& max) override;
+protected:
+	virtual void prepareParallelPassRecording(const std::vector<const gfx_api::CompiledPass*>& batchHeads) override;
+	virtual void beginParallelPassRecording(size_t slot) override;
+	virtual void endParallelPassRecording(size_t slot) override;
+	virtual void executeParallelPassRecording(size_t slot, const gfx_api::CompiledPass& head) override;
 private:
 	enum class SwapchainAcquireStatus
 	{
@@ -1034,6 +1052,14 @@ private:
 	std::string calculateFormattedRendererInfoString() const;
 	void set_uniforms_set(const size_t& set_idx, const void* buffer, size_t bufferSize);
 	const RenderPassDetails& currentRenderPass();
+	/// Render pass layout id for a graph pass: the warm id when current, else looked up (or created) from its layout key.
+	size_t resolvePassRenderPassId(const gfx_api::RenderPassDesc& pass, const gfx_api::CompiledPass* compiledPass);
+	void beginPassInternal(const gfx_api::RenderPassDesc& pass, const gfx_api::CompiledPass* compiledPass, bool secondaryContents);
+	/// Recording state of the calling thread: its parallel pass recorder if it has one, else the main pass state.
+	vk::CommandBuffer* recordCmdBuffer();
+	VkPSO*& boundPSO();
+	size_t recordingRenderPassId() const;
+	bool recordingPassActive() const;
 	bool recreateSwapchain(const vk::Result& reason);
 	void sealActivePassForFrameFinish();
 	void sealDrawCommandBufferForPresent();
@@ -1137,6 +1163,24 @@ private:
 	float _viewportMaxDepth = 1.f;
 	bool _activePassTargetsSwapchain = false;
 	vk::Framebuffer _activeDynamicFramebuffer;
+
+	/// A batch recorded on a worker into a secondary command buffer (see prepareParallelPassRecording()).
+	struct ParallelPassRecorder
+	{
+		vk::CommandBuffer cmd;
+		size_t renderPassId = INVALID_RENDER_PASS_ID;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		float minDepth = 0.f;
+		float maxDepth = 1.f;
+		VkPSO* currentPSO = nullptr;
+	};
+	/// Sized on the main thread before any recorder starts; each worker only touches its own entry.
+	std::vector<ParallelPassRecorder> _parallelRecorders;
+	static thread_local ParallelPassRecorder* _threadRecorder;
+	/// Guards what recorders share with each other and with the main thread: descriptor pools, the per-frame
+	/// uniform and streamed vertex allocators, the pipeline registry and the render pass list.
+	std::mutex _recordMutex;
 };
 
 #endif // defined(WZ_VULKAN_ENABLED)
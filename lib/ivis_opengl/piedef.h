@@ -48,6 +48,11 @@ struct iIMDShape;
  */
 /***************************************************************************/
 bool pie_Draw3DShape(const iIMDShape *shape, int frame, int team, PIELIGHT colour, int pieFlag, int pieFlagData, const glm::mat4 &modelMatrix, const glm::mat4 &viewMatrix, float stretchDepth = 0.f, bool onlySingleLevel = false);
+/// Like pie_Draw3DShape, for objects drawn the same way frame after frame, such as structures and features. Their instance
+/// data stays in a GPU buffer between frames, and is only uploaded again when it changes. owner and part identify the
+/// instance from one frame to the next; instances which aren't drawn in a frame are dropped at the end of it.
+/// Meshes which can't be retained (translucent ones, or any without instanced rendering) are drawn as by pie_Draw3DShape.
+bool pie_Draw3DShapeRetained(const void *owner, uint32_t part, const iIMDShape *shape, int frame, int team, PIELIGHT colour, int pieFlag, int pieFlagData, const glm::mat4 &modelMatrix, const glm::mat4 &viewMatrix, float stretchDepth = 0.f, bool onlySingleLevel = false);
 void pie_Draw3DButton(const iIMDShape *shape, PIELIGHT teamcolour, const glm::mat4 &modelMatrix, const glm::mat4 &viewMatrix);
 
 void pie_GetResetCounts(size_t *pPieCount, size_t *pPolyCount);
@@ -40,11 +40,13 @@
 #include "lib/ivis_opengl/pielight_convert.h"
 #include "piematrix.h"
 #include "pielighting.h"
+#include "culling.h"
 #include "screen.h"
 
 #include <string.h>
 #include <vector>
 #include <algorithm>
+#include <atomic>
 #include <unordered_set>
 #include <utility>
 
@@ -69,8 +71,9 @@
  */
 
 static size_t pieCount = 0;
-static size_t polyCount = 0;
-static size_t drawCallsCount = 0;
+// Shadow cascade passes may be recorded on several threads at once (see RenderPassDesc::parallelRecord)
+static std::atomic<size_t> polyCount{0};
+static std::atomic<size_t> drawCallsCount{0};
 static bool shadows = false;
 static bool shadowsHasBeenInit = false;
 static ShadowMode shadowMode = ShadowMode::Shadow_Mapping;
@@ -1031,10 +1034,14 @@ public:
 
 	// Queues a mesh for drawing
 	bool Draw3DShape(const iIMDShape *shape, int frame, PIELIGHT teamcolour, PIELIGHT colour, int pieFlag, int pieFlagData, const glm::mat4 &modelMatrix, const glm::mat4 &viewMatrix, float stretchDepth);
+	// Queues a mesh for drawing from its retained slot (see pie_Draw3DShapeRetained)
+	// Returns false, without queuing anything, for meshes which can't be retained
+	bool Draw3DShapeRetained(const void *owner, uint32_t part, const iIMDShape *shape, int frame, PIELIGHT teamcolour, PIELIGHT colour, int pieFlag, int pieFlagData, const glm::mat4 &modelMatrix, float stretchDepth);
 
 	// Finalizes queued meshes, ready for one or more DrawAll calls
 	// (After this is called, Draw3DShape should not be called until the InstancedMeshRenderer is clear()-ed)
-	bool FinalizeInstances();
+	// Shadow casters are also culled against each of the given shadow cascades (view-projection matrices)
+	bool FinalizeInstances(const std::vector<glm::mat4>& shadowCascadeViewProjections);
 
 	enum DrawParts
 	{
@@ -1046,10 +1053,11 @@ public:
 	static constexpr int DrawParts_All = DrawParts::ShadowCastingShapes | DrawParts::TranslucentShapes | DrawParts::AdditiveShapes;
 
 	// Draws all queued meshes, given a projection + view matrix
-	bool DrawAll(uint64_t currentGameFrame, const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix, const Vector3f &cameraPos, const ShadowCascadesInfo& shadowMVPMatrix, gfx_api::abstract_texture* shadowMap, int drawParts = DrawParts_All, bool depthPass = false);
+	// (A depth pass for shadowCascade only draws the shadow casters found inside that cascade by FinalizeInstances)
+	bool DrawAll(uint64_t currentGameFrame, const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix, const Vector3f &cameraPos, const ShadowCascadesInfo& shadowMVPMatrix, gfx_api::abstract_texture* shadowMap, int drawParts = DrawParts_All, bool depthPass = false, int shadowCascade = -1);
 public:
 	// New, instanced rendering
-	void Draw3DShapes_Instanced(uint64_t currentGameFrame, ShaderOnce& globalsOnce, const gfx_api::Draw3DShapeInstancedGlobalUniforms& globalUniforms, gfx_api::abstract_texture* shadowMap, int drawParts = DrawParts_All, bool depthPass = false);
+	void Draw3DShapes_Instanced(uint64_t currentGameFrame, ShaderOnce& globalsOnce, const gfx_api::Draw3DShapeInstancedGlobalUniforms& globalUniforms, gfx_api::abstract_texture* shadowMap, int drawParts = DrawParts_All, bool depthPass = false, int shadowCascade = -1);
 	// Old, non-instanced rendering
 	void Draw3DShapes_Old(uint64_t currentGameFrame, ShaderOnce& globalsOnce, const gfx_api::Draw3DShapeGlobalUniforms& globalUniforms, int drawParts = DrawParts_All);
 public:
@@ -1127,6 +1135,75 @@ private:
 	size_t startIdxTranslucentDrawCalls = 0;
 	size_t startIdxTranslucentNoDepthWriteDrawCalls = 0;
 	size_t startIdxAdditiveDrawCalls = 0;
+
+	// The opaque shadow casters inside each shadow cascade, with their instances stored after all of the above
+	std::array<std::vector<InstancedDrawCall>, WZ_MAX_SHADOW_CASCADES> cascadeDrawCalls;
+	size_t culledShadowCascadeCount = 0;
+	BoundingSphereList shadowCasterSpheres;
+	std::vector<uint8_t> shadowCasterVisibility;
+
+private:
+	// Retained instances each have a slot in their batch's own buffer, which keeps its contents from one frame to the
+	// next, so only the slots which changed are uploaded. Each frame draws the range of slots drawn into. Slots which
+	// weren't are freed at the end of the frame, and given a degenerate instance, so drawing over them is harmless.
+	struct RetainedBatch
+	{
+		std::vector<gfx_api::Draw3DShapePerInstanceInterleavedData> slots;  // what the buffer holds (or will, once uploaded)
+		std::vector<uint32_t> freeSlots;
+		gfx_api::buffer* buffer = nullptr;
+		size_t bufferSlots = 0;  // the number of slots the buffer was created with
+		size_t dirtyBegin = SIZE_MAX;
+		size_t dirtyEnd = 0;
+		size_t drawBegin = SIZE_MAX;
+		size_t drawEnd = 0;
+	};
+	struct RetainedInstanceKey
+	{
+		const void *owner;
+		uint32_t part;
+		const iIMDShape *shape;
+
+		bool operator ==(const RetainedInstanceKey &o) const
+		{
+			return owner == o.owner && part == o.part && shape == o.shape;
+		}
+	};
+	struct RetainedInstanceKeyHash
+	{
+		size_t operator()(const RetainedInstanceKey &k) const
+		{
+			std::size_t h = 0;
+			hash_combine(h, k.owner, k.part, k.shape);
+			return h;
+		}
+	};
+	struct RetainedInstance
+	{
+		templatedState state;
+		RetainedBatch *batch = nullptr;
+		uint32_t slot = 0;
+		uint64_t lastDrawnFrame = 0;
+	};
+	struct RetainedDrawCall
+	{
+		templatedState state;
+		gfx_api::buffer *buffer;
+		size_t firstSlot;
+		size_t slotCount;
+		// The range of slots holding the shadow casters inside each shadow cascade (which may include others between them)
+		std::array<size_t, WZ_MAX_SHADOW_CASCADES> cascadeFirstSlot;
+		std::array<size_t, WZ_MAX_SHADOW_CASCADES> cascadeSlotCount;
+	};
+	uint32_t allocateRetainedSlot(RetainedBatch &batch);
+	void releaseRetainedSlot(const RetainedInstance &instance);
+	void FinalizeRetainedInstances(const std::array<ViewFrustum, WZ_MAX_SHADOW_CASCADES>& cascadeFrustums);
+	void releaseRetainedInstances();
+
+	std::unordered_map<templatedState, RetainedBatch> retainedBatches;
+	std::unordered_map<RetainedInstanceKey, RetainedInstance, RetainedInstanceKeyHash> retainedInstances;
+	std::vector<RetainedDrawCall> retainedDrawCalls;
+	uint64_t retainedFrame = 1;  // 0 is never drawn
+	static constexpr size_t minRetainedBatchSlots = 64;
 };
 
 InstancedMeshRenderer::InstancedMeshRenderer()
@@ -1197,6 +1274,19 @@ void InstancedMeshRenderer::clear()
 		instanceTranslucentMeshes.compact();
 		instanceTranslucentMeshesNoDepthWrite.compact();
 		instanceAdditiveMeshes.compact();
+
+		for (auto it = retainedBatches.begin(); it != retainedBatches.end(); )
+		{
+			if (it->second.freeSlots.size() == it->second.slots.size())
+			{
+				delete it->second.buffer;
+				it = retainedBatches.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
 	}
 	else
 	{
@@ -1209,6 +1299,12 @@ void InstancedMeshRenderer::clear()
 	instanceTranslucentMeshes.clearRetainingCapacity();
 	instanceTranslucentMeshesNoDepthWrite.clearRetainingCapacity();
 	instanceAdditiveMeshes.clearRetainingCapacity();
+	++retainedFrame;
+	for (auto& batch : retainedBatches)
+	{
+		batch.second.drawBegin = SIZE_MAX;
+		batch.second.drawEnd = 0;
+	}
 	instancesCount = 0;
 	translucentInstancesCount = 0;
 	additiveInstancesCount = 0;
@@ -1233,6 +1329,14 @@ void InstancedMeshRenderer::releaseBatchMemory()
 	ShapeVector(poolAllocator).swap(shapes);
 	std::vector<gfx_api::Draw3DShapePerInstanceInterleavedData>().swap(instancesData);
 	std::vector<InstancedDrawCall>().swap(finalizedDrawCalls);
+	for (auto& drawCalls : cascadeDrawCalls)
+	{
+		std::vector<InstancedDrawCall>().swap(drawCalls);
+	}
+	culledShadowCascadeCount = 0;
+	shadowCasterSpheres = BoundingSphereList();
+	std::vector<uint8_t>().swap(shadowCasterVisibility);
+	releaseRetainedInstances();
 	lightmapTexture = nullptr;
 	modelUVLightmapMatrix = glm::mat4();
 }
@@ -1384,6 +1488,179 @@ bool InstancedMeshRenderer::Draw3DShape(const iIMDShape *shape, int frame, PIELI
 	return true;
 }
 
+bool InstancedMeshRenderer::Draw3DShapeRetained(const void *owner, uint32_t part, const iIMDShape *shape, int frame, PIELIGHT teamcolour, PIELIGHT colour, int pieFlag, int pieFlagData, const glm::mat4 &modelMatrix, float stretchDepth)
+{
+	// Only plain opaque meshes: the others are drawn in order, or change their model matrix every frame anyway
+	if (!useInstancedRendering
+		|| (pieFlag & (pie_ADDITIVE | pie_TRANSLUCENT | pie_PREMULTIPLIED | pie_SHIELD | pie_HEIGHT_SCALED | pie_RAISE))
+		|| (shadows && shadowMode == ShadowMode::Fallback_Stencil_Shadows))
+	{
+		return false;
+	}
+
+	frame %= std::max<int>(1, shape->numFrames);
+	const templatedState state(SHADER_COMPONENT_INSTANCED, shape, pieFlag);
+	const gfx_api::Draw3DShapePerInstanceInterleavedData instanceData = GenerateInstanceData(frame, colour, teamcolour, pieFlag, pieFlagData, modelMatrix, stretchDepth);
+
+	auto [it, inserted] = retainedInstances.try_emplace(RetainedInstanceKey{owner, part, shape});
+	RetainedInstance &instance = it->second;
+	if (!inserted && instance.lastDrawnFrame == retainedFrame)
+	{
+		return false;  // Drawn twice in one frame, so the caller has to tell the two apart with part
+	}
+	if (!inserted && !(instance.state == state))
+	{
+		releaseRetainedSlot(instance);
+		inserted = true;
+	}
+	if (inserted)
+	{
+		instance.state = state;
+		instance.batch = &retainedBatches[state];
+		instance.slot = allocateRetainedSlot(*instance.batch);
+	}
+
+	RetainedBatch &batch = *instance.batch;
+	const size_t slot = instance.slot;
+	if (inserted || memcmp(&batch.slots[slot], &instanceData, sizeof(instanceData)) != 0)
+	{
+		batch.slots[slot] = instanceData;
+		batch.dirtyBegin = std::min(batch.dirtyBegin, slot);
+		batch.dirtyEnd = std::max(batch.dirtyEnd, slot + 1);
+	}
+	instance.lastDrawnFrame = retainedFrame;
+	batch.drawBegin = std::min(batch.drawBegin, slot);
+	batch.drawEnd = std::max(batch.drawEnd, slot + 1);
+	return true;
+}
+
+// A shape's sradius bounds it around its origin
+static void pushShadowCasterSphere(BoundingSphereList& spheres, const gfx_api::Draw3DShapePerInstanceInterleavedData& instance, float shapeRadius)
+{
+	const glm::mat4& modelMatrix = instance.ModelViewMatrix;
+	const float scale = std::max({glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))});
+	const float stretch = std::abs(instance.shaderStretch_ecmState_alphaTest_animFrameNumber.x);
+	spheres.push_back(glm::vec3(modelMatrix[3]), (shapeRadius + stretch) * scale);
+}
+
+uint32_t InstancedMeshRenderer::allocateRetainedSlot(RetainedBatch &batch)
+{
+	if (batch.freeSlots.empty())
+	{
+		// Grow geometrically, so the buffer doesn't have to be recreated often. New slots are used lowest first.
+		const size_t oldSize = batch.slots.size();
+		const size_t newSize = std::max(oldSize * 2, minRetainedBatchSlots);
+		batch.slots.resize(newSize, gfx_api::Draw3DShapePerInstanceInterleavedData{glm::mat4(0.f), glm::vec4(0.f), 0, 0});
+		for (size_t slot = newSize; slot > oldSize; --slot)
+		{
+			batch.freeSlots.push_back(static_cast<uint32_t>(slot - 1));
+		}
+	}
+	const uint32_t slot = batch.freeSlots.back();
+	batch.freeSlots.pop_back();
+	return slot;
+}
+
+void InstancedMeshRenderer::releaseRetainedSlot(const RetainedInstance &instance)
+{
+	RetainedBatch &batch = *instance.batch;
+	const size_t slot = instance.slot;
+	batch.slots[slot] = gfx_api::Draw3DShapePerInstanceInterleavedData{glm::mat4(0.f), glm::vec4(0.f), 0, 0};
+	batch.dirtyBegin = std::min(batch.dirtyBegin, slot);
+	batch.dirtyEnd = std::max(batch.dirtyEnd, slot + 1);
+	batch.freeSlots.push_back(instance.slot);
+}
+
+void InstancedMeshRenderer::FinalizeRetainedInstances(const std::array<ViewFrustum, WZ_MAX_SHADOW_CASCADES>& cascadeFrustums)
+{
+	retainedDrawCalls.clear();
+
+	for (auto it = retainedInstances.begin(); it != retainedInstances.end(); )
+	{
+		if (it->second.lastDrawnFrame != retainedFrame)
+		{
+			releaseRetainedSlot(it->second);
+			it = retainedInstances.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	for (auto &entry : retainedBatches)
+	{
+		RetainedBatch &batch = entry.second;
+		if (batch.buffer == nullptr)
+		{
+			batch.buffer = gfx_api::context::get().create_buffer_object(gfx_api::buffer::usage::vertex_buffer, gfx_api::context::buffer_storage_hint::dynamic_draw, "InstancedMeshRenderer::retainedInstanceBuffer");
+		}
+		if (batch.bufferSlots != batch.slots.size())
+		{
+			batch.buffer->upload(batch.slots.size() * sizeof(gfx_api::Draw3DShapePerInstanceInterleavedData), batch.slots.data());
+			batch.bufferSlots = batch.slots.size();
+		}
+		else if (batch.dirtyBegin < batch.dirtyEnd)
+		{
+			batch.buffer->update(batch.dirtyBegin * sizeof(gfx_api::Draw3DShapePerInstanceInterleavedData), (batch.dirtyEnd - batch.dirtyBegin) * sizeof(gfx_api::Draw3DShapePerInstanceInterleavedData), &batch.slots[batch.dirtyBegin]);
+		}
+		batch.dirtyBegin = SIZE_MAX;
+		batch.dirtyEnd = 0;
+
+		if (batch.drawBegin >= batch.drawEnd)
+		{
+			continue;
+		}
+		RetainedDrawCall call{entry.first, batch.buffer, batch.drawBegin, batch.drawEnd - batch.drawBegin, {}, {}};
+		call.cascadeFirstSlot.fill(call.firstSlot);
+		call.cascadeSlotCount.fill(call.slotCount);
+
+		// Slots can't be reordered without uploading them again, so each cascade draws the range from its first to its last
+		// shadow caster, and nothing if it has none.
+		const int pieFlag = entry.first.pieFlag;
+		if (culledShadowCascadeCount > 0 && (pieFlag & pie_SHADOW || pieFlag & pie_STATIC_SHADOW) && !(pieFlag & pie_NODEPTHWRITE))
+		{
+			const float shapeRadius = static_cast<float>(entry.first.shape->sradius);
+			shadowCasterSpheres.clear();
+			shadowCasterSpheres.reserve(call.slotCount);
+			for (size_t slot = batch.drawBegin; slot < batch.drawEnd; ++slot)
+			{
+				pushShadowCasterSphere(shadowCasterSpheres, batch.slots[slot], shapeRadius);
+			}
+			shadowCasterVisibility.resize(call.slotCount);
+			for (size_t cascade = 0; cascade < culledShadowCascadeCount; ++cascade)
+			{
+				cullBoundingSpheres(cascadeFrustums[cascade], shadowCasterSpheres, shadowCasterVisibility.data());
+				size_t first = call.slotCount;
+				size_t last = 0;
+				for (size_t i = 0; i < call.slotCount; ++i)
+				{
+					// Free slots have an all zero matrix
+					if (shadowCasterVisibility[i] && batch.slots[batch.drawBegin + i].ModelViewMatrix[3][3] != 0.f)
+					{
+						first = std::min(first, i);
+						last = i;
+					}
+				}
+				call.cascadeFirstSlot[cascade] = call.firstSlot + first;
+				call.cascadeSlotCount[cascade] = (first <= last) ? last + 1 - first : 0;
+			}
+		}
+		retainedDrawCalls.push_back(call);
+	}
+}
+
+void InstancedMeshRenderer::releaseRetainedInstances()
+{
+	for (auto &batch : retainedBatches)
+	{
+		delete batch.second.buffer;
+	}
+	retainedBatches.clear();
+	retainedInstances.clear();
+	std::vector<RetainedDrawCall>().swap(retainedDrawCalls);
+}
+
 static InstancedMeshRenderer instancedMeshRenderer;
 
 void pie_InitializeInstancedRenderer()
@@ -1438,6 +1715,35 @@ bool pie_Draw3DShape(const iIMDShape *shape, int frame, int team, PIELIGHT colou
 	return retVal;
 }
 
+bool pie_Draw3DShapeRetained(const void *owner, uint32_t part, const iIMDShape *shape, int frame, int team, PIELIGHT colour, int pieFlag, int pieFlagData, const glm::mat4 &modelMatrix, const glm::mat4 &viewMatrix, float stretchDepth, bool onlySingleLevel)
+{
+	if (pieFlag & pie_BUTTON)
+	{
+		return pie_Draw3DShape(shape, frame, team, colour, pieFlag, pieFlagData, modelMatrix, viewMatrix, stretchDepth, onlySingleLevel);
+	}
+
+	pieCount++;
+
+	ASSERT(frame >= 0, "Negative frame %d", frame);
+	ASSERT(team >= 0, "Negative team %d", team);
+
+	bool retVal = false;
+	const bool drawAllLevels = (shape->modelLevel == 0) && !onlySingleLevel;
+	const PIELIGHT teamcolour = shape->getTeamColourForModel(team);
+
+	const iIMDShape *pCurrShape = shape;
+	do
+	{
+		retVal = instancedMeshRenderer.Draw3DShapeRetained(owner, part, pCurrShape, frame, teamcolour, colour, pieFlag, pieFlagData, modelMatrix, stretchDepth)
+			|| instancedMeshRenderer.Draw3DShape(pCurrShape, frame, teamcolour, colour, pieFlag, pieFlagData, modelMatrix, viewMatrix, stretchDepth);
+
+		pCurrShape = pCurrShape->next.get();
+
+	} while (drawAllLevels && pCurrShape && retVal);
+
+	return retVal;
+}
+
 static void pie_ShadowDrawLoop(ShadowCache &shadowCache, const glm::mat4& projectionMatrix)
 {
 //	size_t cachedShadowDraws = 0;
@@ -1507,8 +1813,6 @@ struct less_than_shape
 	}
 };
 
-static ShaderOnce perFrameUniformsShaderOnce;
-
 void pie_StartMeshes()
 {
 	instancedMeshRenderer.clear();
@@ -1519,12 +1823,12 @@ void pie_UpdateLightmap(gfx_api::texture* lightmapTexture, const glm::mat4& mode
 	instancedMeshRenderer.setLightmap(lightmapTexture, modelUVLightmapMatrix);
 }
 
-void pie_FinalizeMeshes(uint64_t currentGameFrame)
+void pie_FinalizeMeshes(uint64_t currentGameFrame, const std::vector<glm::mat4>& shadowCascadeViewProjections)
 {
-	instancedMeshRenderer.FinalizeInstances();
+	instancedMeshRenderer.FinalizeInstances(shadowCascadeViewProjections);
 }
 
-void pie_DrawAllMeshes(uint64_t currentGameFrame, const glm::mat4 &projectionMatrix, const glm::mat4& viewMatrix, const Vector3f &cameraPos, const ShadowCascadesInfo& shadowMVPMatrix, gfx_api::abstract_texture* shadowMap, bool depthPass)
+void pie_DrawAllMeshes(uint64_t currentGameFrame, const glm::mat4 &projectionMatrix, const glm::mat4& viewMatrix, const Vector3f &cameraPos, const ShadowCascadesInfo& shadowMVPMatrix, gfx_api::abstract_texture* shadowMap, bool depthPass, int shadowCascade)
 {
 	int drawParts = InstancedMeshRenderer::DrawParts_All;
 	if (shadowMode == ShadowMode::Fallback_Stencil_Shadows)
@@ -1544,10 +1848,10 @@ void pie_DrawAllMeshes(uint64_t currentGameFrame, const glm::mat4 &projectionMat
 	{
 		return;
 	}
-	instancedMeshRenderer.DrawAll(currentGameFrame, projectionMatrix, viewMatrix, cameraPos, shadowMVPMatrix, shadowMap, drawParts, depthPass);
+	instancedMeshRenderer.DrawAll(currentGameFrame, projectionMatrix, viewMatrix, cameraPos, shadowMVPMatrix, shadowMap, drawParts, depthPass, shadowCascade);
 }
 
-bool InstancedMeshRenderer::FinalizeInstances()
+bool InstancedMeshRenderer::FinalizeInstances(const std::vector<glm::mat4>& shadowCascadeViewProjections)
 {
 	if (!useInstancedRendering)
 	{
@@ -1557,6 +1861,24 @@ bool InstancedMeshRenderer::FinalizeInstances()
 
 	instancesData.clear();
 	finalizedDrawCalls.clear();
+	startIdxTranslucentDrawCalls = 0;
+	startIdxTranslucentNoDepthWriteDrawCalls = 0;
+	startIdxAdditiveDrawCalls = 0;
+	for (auto& drawCalls : cascadeDrawCalls)
+	{
+		drawCalls.clear();
+	}
+
+	// Each shadow cascade only covers part of the view, so give every cascade its own copy of the shadow casters inside it,
+	// rather than having each depth pass draw all of them.
+	culledShadowCascadeCount = std::min<size_t>(shadowCascadeViewProjections.size(), WZ_MAX_SHADOW_CASCADES);
+	std::array<ViewFrustum, WZ_MAX_SHADOW_CASCADES> cascadeFrustums;
+	for (size_t cascade = 0; cascade < culledShadowCascadeCount; ++cascade)
+	{
+		cascadeFrustums[cascade] = extractViewFrustum(shadowCascadeViewProjections[cascade]);
+	}
+
+	FinalizeRetainedInstances(cascadeFrustums);
 
 	if (instancesCount + translucentInstancesCount + additiveInstancesCount == 0)
 	{
@@ -1608,6 +1930,40 @@ bool InstancedMeshRenderer::FinalizeInstances()
 		finalizedDrawCalls.emplace_back(mesh.first, meshInstances.size(), startingIdxInInstancesBuffer);
 	}
 
+	for (const auto& mesh : instanceMeshes)
+	{
+		const auto& meshInstances = mesh.second;
+		const int pieFlag = mesh.first.pieFlag;
+		if (culledShadowCascadeCount == 0 || meshInstances.empty() || !(pieFlag & pie_SHADOW || pieFlag & pie_STATIC_SHADOW) || (pieFlag & pie_NODEPTHWRITE))
+		{
+			continue;
+		}
+		const float shapeRadius = static_cast<float>(mesh.first.shape->sradius);
+		shadowCasterSpheres.clear();
+		shadowCasterSpheres.reserve(meshInstances.size());
+		for (const auto& instance : meshInstances)
+		{
+			pushShadowCasterSphere(shadowCasterSpheres, instance, shapeRadius);
+		}
+		shadowCasterVisibility.resize(meshInstances.size());
+		for (size_t cascade = 0; cascade < culledShadowCascadeCount; ++cascade)
+		{
+			cullBoundingSpheres(cascadeFrustums[cascade], shadowCasterSpheres, shadowCasterVisibility.data());
+			size_t startingIdxInInstancesBuffer = instancesData.size();
+			for (size_t i = 0; i < meshInstances.size(); ++i)
+			{
+				if (shadowCasterVisibility[i])
+				{
+					instancesData.push_back(meshInstances[i]);
+				}
+			}
+			if (instancesData.size() > startingIdxInInstancesBuffer)
+			{
+				cascadeDrawCalls[cascade].emplace_back(mesh.first, instancesData.size() - startingIdxInInstancesBuffer, startingIdxInInstancesBuffer);
+			}
+		}
+	}
+
 	// Upload buffer
 	++currInstanceBufferIdx;
 	if (currInstanceBufferIdx >= instanceDataBuffers.size())
@@ -1621,9 +1977,10 @@ bool InstancedMeshRenderer::FinalizeInstances()
 	return true;
 }
 
-bool InstancedMeshRenderer::DrawAll(uint64_t currentGameFrame, const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, const Vector3f &cameraPos, const ShadowCascadesInfo& shadowCascades, gfx_api::abstract_texture* shadowMap, int drawParts, bool depthPass)
+bool InstancedMeshRenderer::DrawAll(uint64_t currentGameFrame, const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, const Vector3f &cameraPos, const ShadowCascadesInfo& shadowCascades, gfx_api::abstract_texture* shadowMap, int drawParts, bool depthPass, int shadowCascade)
 {
-	perFrameUniformsShaderOnce.reset();
+	// Per call rather than per frame: the shadow cascades may run this on several threads at once
+	ShaderOnce perFrameUniformsShaderOnce;
 
 	// Generate global (per-frame) uniforms
 	glm::vec4 sceneColor(lighting0[LIGHT_EMISSIVE][0], lighting0[LIGHT_EMISSIVE][1], lighting0[LIGHT_EMISSIVE][2], lighting0[LIGHT_EMISSIVE][3]);
@@ -1647,7 +2004,7 @@ bool InstancedMeshRenderer::DrawAll(uint64_t currentGameFrame, const glm::mat4&
 			{shadowCascades.shadowCascadeSplit[0], shadowCascades.shadowCascadeSplit[1], shadowCascades.shadowCascadeSplit[2], pie_getPerspectiveZFar()}, shadowCascades.shadowMapSize,
 			renderState.fogBegin, renderState.fogEnd, pie_GetShaderTime(), renderState.fogEnabled, static_cast<int>(dimension.first), static_cast<int>(dimension.second), gfx_api::context::get().getSceneMipLodBias(), bucketLight.positions, bucketLight.colorAndEnergy, bucketLight.bucketOffsetAndSize, bucketLight.light_index, static_cast<int>(bucketLight.bucketDimensionUsed)
 		};
-		Draw3DShapes_Instanced(currentGameFrame, perFrameUniformsShaderOnce, globalUniforms, shadowMap, drawParts, depthPass);
+		Draw3DShapes_Instanced(currentGameFrame, perFrameUniformsShaderOnce, globalUniforms, shadowMap, drawParts, depthPass, shadowCascade);
 	}
 	else
 	{
@@ -1774,14 +2131,18 @@ static void pie_Draw3DShape2_Instanced(ShaderOnce& globalsOnce, const gfx_api::D
 
 	++drawCallsCount;
 
-	/* Set fog status */
-	if (!(pieFlag & pie_FORCE_FOG) && (pieFlag & pie_ADDITIVE || pieFlag & pie_TRANSLUCENT || pieFlag & pie_PREMULTIPLIED))
-	{
-		pie_SetFogStatus(false);
-	}
-	else
+	/* Set fog status. Depth-only draws don't use fog, and leave the shared render state alone, since shadow
+	 * cascades may be recorded on several threads at once. */
+	if (!depthPass)
 	{
-		pie_SetFogStatus(true);
+		if (!(pieFlag & pie_FORCE_FOG) && (pieFlag & pie_ADDITIVE || pieFlag & pie_TRANSLUCENT || pieFlag & pie_PREMULTIPLIED))
+		{
+			pie_SetFogStatus(false);
+		}
+		else
+		{
+			pie_SetFogStatus(true);
+		}
 	}
 
 	/* Set translucency */
@@ -1826,9 +2187,9 @@ static void pie_Draw3DShape2_Instanced(ShaderOnce& globalsOnce, const gfx_api::D
 	polyCount += shape->polys.size();
 }
 
-void InstancedMeshRenderer::Draw3DShapes_Instanced(uint64_t currentGameFrame, ShaderOnce& globalsOnce, const gfx_api::Draw3DShapeInstancedGlobalUniforms& globalUniforms, gfx_api::abstract_texture* shadowMap, int drawParts, bool depthPass)
+void InstancedMeshRenderer::Draw3DShapes_Instanced(uint64_t currentGameFrame, ShaderOnce& globalsOnce, const gfx_api::Draw3DShapeInstancedGlobalUniforms& globalUniforms, gfx_api::abstract_texture* shadowMap, int drawParts, bool depthPass, int shadowCascade)
 {
-	if (finalizedDrawCalls.empty())
+	if (finalizedDrawCalls.empty() && retainedDrawCalls.empty())
 	{
 		return;
 	}
@@ -1837,9 +2198,16 @@ void InstancedMeshRenderer::Draw3DShapes_Instanced(uint64_t currentGameFrame, Sh
 	{
 		// Draw opaque models
 		gfx_api::context::get().debugStringMarker("Remaining passes - opaque models");
-		for (size_t i = 0; i < startIdxTranslucentDrawCalls; ++i)
+		const InstancedDrawCall* opaqueDrawCalls = finalizedDrawCalls.data();
+		size_t opaqueDrawCallCount = startIdxTranslucentDrawCalls;
+		if (depthPass && shadowCascade >= 0 && static_cast<size_t>(shadowCascade) < culledShadowCascadeCount)
 		{
-			const auto& call = finalizedDrawCalls[i];
+			opaqueDrawCalls = cascadeDrawCalls[shadowCascade].data();
+			opaqueDrawCallCount = cascadeDrawCalls[shadowCascade].size();
+		}
+		for (size_t i = 0; i < opaqueDrawCallCount; ++i)
+		{
+			const auto& call = opaqueDrawCalls[i];
 			const iIMDShape * shape = call.state.shape;
 			const int pieFlag = call.state.pieFlag;
 			if (depthPass && !(pieFlag & pie_SHADOW || pieFlag & pie_STATIC_SHADOW))
@@ -1847,12 +2215,38 @@ void InstancedMeshRenderer::Draw3DShapes_Instanced(uint64_t currentGameFrame, Sh
 				continue;
 			}
 			size_t instanceBufferOffset = static_cast<size_t>(sizeof(gfx_api::Draw3DShapePerInstanceInterleavedData) * call.startingIdxInInstancesBuffer);
-			pie_Draw3DShape2_Instanced(perFrameUniformsShaderOnce, globalUniforms, shape, call.state.pieFlag, instanceDataBuffers[currInstanceBufferIdx], instanceBufferOffset, call.instance_count, depthPass, shadowMap, lightmapTexture);
+			pie_Draw3DShape2_Instanced(globalsOnce, globalUniforms, shape, call.state.pieFlag, instanceDataBuffers[currInstanceBufferIdx], instanceBufferOffset, call.instance_count, depthPass, shadowMap, lightmapTexture);
+		}
+		if (opaqueDrawCallCount > 0)
+		{
+			// unbind last index buffer bound inside pie_Draw3DShape2
+			gfx_api::context::get().unbind_index_buffer(*((opaqueDrawCalls[opaqueDrawCallCount-1].state.shape)->buffers[VBO_INDEX]));
+		}
+
+		// Then the retained ones, straight from their own buffers
+		const bool culledCascade = depthPass && shadowCascade >= 0 && static_cast<size_t>(shadowCascade) < culledShadowCascadeCount;
+		const iIMDShape *lastRetainedShape = nullptr;
+		for (const auto& call : retainedDrawCalls)
+		{
+			const int pieFlag = call.state.pieFlag;
+			if (depthPass && !(pieFlag & pie_SHADOW || pieFlag & pie_STATIC_SHADOW))
+			{
+				continue;
+			}
+			const size_t firstSlot = (culledCascade) ? call.cascadeFirstSlot[shadowCascade] : call.firstSlot;
+			const size_t slotCount = (culledCascade) ? call.cascadeSlotCount[shadowCascade] : call.slotCount;
+			if (slotCount == 0)
+			{
+				continue;
+			}
+			size_t instanceBufferOffset = static_cast<size_t>(sizeof(gfx_api::Draw3DShapePerInstanceInterleavedData) * firstSlot);
+			pie_Draw3DShape2_Instanced(globalsOnce, globalUniforms, call.state.shape, pieFlag, call.buffer, instanceBufferOffset, slotCount, depthPass, shadowMap, lightmapTexture);
+			lastRetainedShape = call.state.shape;
 		}
-		if (startIdxTranslucentDrawCalls > 0)
+		if (lastRetainedShape)
 		{
 			// unbind last index buffer bound inside pie_Draw3DShape2
-			gfx_api::context::get().unbind_index_buffer(*((finalizedDrawCalls[startIdxTranslucentDrawCalls-1].state.shape)->buffers[VBO_INDEX]));
+			gfx_api::context::get().unbind_index_buffer(*(lastRetainedShape->buffers[VBO_INDEX]));
 		}
 	}
 
@@ -1875,7 +2269,7 @@ void InstancedMeshRenderer::Draw3DShapes_Instanced(uint64_t currentGameFrame, Sh
 			const auto& call = finalizedDrawCalls[i];
 			const iIMDShape * shape = call.state.shape;
 			size_t instanceBufferOffset = static_cast<size_t>(sizeof(gfx_api::Draw3DShapePerInstanceInterleavedData) * call.startingIdxInInstancesBuffer);
-			pie_Draw3DShape2_Instanced(perFrameUniformsShaderOnce, globalUniforms, shape, call.state.pieFlag, instanceDataBuffers[currInstanceBufferIdx], instanceBufferOffset, call.instance_count, depthPass, shadowMap, lightmapTexture);
+			pie_Draw3DShape2_Instanced(globalsOnce, globalUniforms, shape, call.state.pieFlag, instanceDataBuffers[currInstanceBufferIdx], instanceBufferOffset, call.instance_count, depthPass, shadowMap, lightmapTexture);
 		}
 		if (startIdxTranslucentDrawCalls < startIdxTranslucentNoDepthWriteDrawCalls)
 		{
@@ -1890,7 +2284,7 @@ void InstancedMeshRenderer::Draw3DShapes_Instanced(uint64_t currentGameFrame, Sh
 			const auto& call = finalizedDrawCalls[i];
 			const iIMDShape * shape = call.state.shape;
 			size_t instanceBufferOffset = static_cast<size_t>(sizeof(gfx_api::Draw3DShapePerInstanceInterleavedData) * call.startingIdxInInstancesBuffer);
-			pie_Draw3DShape2_Instanced(perFrameUniformsShaderOnce, globalUniforms, shape, call.state.pieFlag, instanceDataBuffers[currInstanceBufferIdx], instanceBufferOffset, call.instance_count, depthPass, shadowMap, lightmapTexture);
+			pie_Draw3DShape2_Instanced(globalsOnce, globalUniforms, shape, call.state.pieFlag, instanceDataBuffers[currInstanceBufferIdx], instanceBufferOffset, call.instance_count, depthPass, shadowMap, lightmapTexture);
 		}
 		if (startIdxTranslucentNoDepthWriteDrawCalls < startIdxAdditiveDrawCalls)
 		{
@@ -1908,7 +2302,7 @@ void InstancedMeshRenderer::Draw3DShapes_Instanced(uint64_t currentGameFrame, Sh
 			const auto& call = finalizedDrawCalls[i];
 			const iIMDShape * shape = call.state.shape;
 			size_t instanceBufferOffset = static_cast<size_t>(sizeof(gfx_api::Draw3DShapePerInstanceInterleavedData) * call.startingIdxInInstancesBuffer);
-			pie_Draw3DShape2_Instanced(perFrameUniformsShaderOnce, globalUniforms, shape, call.state.pieFlag, instanceDataBuffers[currInstanceBufferIdx], instanceBufferOffset, call.instance_count, depthPass, shadowMap, lightmapTexture);
+			pie_Draw3DShape2_Instanced(globalsOnce, globalUniforms, shape, call.state.pieFlag, instanceDataBuffers[currInstanceBufferIdx], instanceBufferOffset, call.instance_count, depthPass, shadowMap, lightmapTexture);
 		}
 		if (startIdxAdditiveDrawCalls < finalizedDrawCalls.size())
 		{
@@ -1936,7 +2330,7 @@ void InstancedMeshRenderer::Draw3DShapes_Old(uint64_t currentGameFrame, ShaderOn
 		gfx_api::context::get().debugStringMarker("Remaining passes - opaque models");
 		for (SHAPE const &shape : shapes)
 		{
-			lastState = pie_Draw3DShape2(lastState, perFrameUniformsShaderOnce, globalUniforms, shape.shape, shape.frame, shape.colour, shape.teamcolour, shape.flag, shape.flag_data, shape.modelMatrix, shape.stretch);
+			lastState = pie_Draw3DShape2(lastState, globalsOnce, globalUniforms, shape.shape, shape.frame, shape.colour, shape.teamcolour, shape.flag, shape.flag_data, shape.modelMatrix, shape.stretch);
 		}
 		gfx_api::context::get().disable_all_vertex_buffers();
 		if (!shapes.empty())
@@ -1964,7 +2358,7 @@ void InstancedMeshRenderer::Draw3DShapes_Old(uint64_t currentGameFrame, ShaderOn
 		lastState = templatedState();
 		for (SHAPE const &shape : tshapes)
 		{
-			lastState = pie_Draw3DShape2(lastState, perFrameUniformsShaderOnce, globalUniforms, shape.shape, shape.frame, shape.colour, shape.teamcolour, shape.flag, shape.flag_data, shape.modelMatrix, shape.stretch);
+			lastState = pie_Draw3DShape2(lastState, globalsOnce, globalUniforms, shape.shape, shape.frame, shape.colour, shape.teamcolour, shape.flag, shape.flag_data, shape.modelMatrix, shape.stretch);
 		}
 		gfx_api::context::get().disable_all_vertex_buffers();
 		if (!tshapes.empty())
@@ -24,6 +24,7 @@
 #include <glm/mat4x4.hpp>
 #include "pietypes.h"
 #include "shadows.h"
+#include <vector>
 
 namespace gfx_api
 {
@@ -33,5 +34,5 @@ namespace gfx_api
 
 void pie_StartMeshes();
 void pie_UpdateLightmap(gfx_api::texture* lightmapTexture, const glm::mat4& modelUVLightmapMatrix);
-void pie_FinalizeMeshes(uint64_t currentGameFrame);
-void pie_DrawAllMeshes(uint64_t currentGameFrame, const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix, const Vector3f &cameraPos, const ShadowCascadesInfo& shadowMVPMatrix, gfx_api::abstract_texture* shadowMap, bool depthPass);
+void pie_FinalizeMeshes(uint64_t currentGameFrame, const std::vector<glm::mat4>& shadowCascadeViewProjections);
+void pie_DrawAllMeshes(uint64_t currentGameFrame, const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix, const Vector3f &cameraPos, const ShadowCascadesInfo& shadowMVPMatrix, gfx_api::abstract_texture* shadowMap, bool depthPass, int shadowCascade = -1);
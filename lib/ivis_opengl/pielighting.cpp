@@ -23,7 +23,6 @@
 #include <array>
 #include <glm/glm.hpp>
 #include <algorithm>
-#include <functional>
 #include <unordered_map>
 #include "culling.h"
 #include "src/profiling.h"
@@ -142,27 +141,15 @@ void renderingNew::LightingManager::ComputeFrameData(const LightingData& data, L
 	PointLightBuckets result;
 	const bool yAxisInverted = gfx_api::context::get().isYAxisInverted();
 
-	// Pick the first lights inside the view frustum
-	auto viewFrustum = IntersectionOfHalfSpace{
-		[](const glm::vec3& in) { return in.x >= -1.f; },
-		[](const glm::vec3& in) { return in.x <= 1.f; },
-		[yAxisInverted](const glm::vec3& in) {
-			if (yAxisInverted)
-			{
-				return -in.y >= -1.f;
-			}
-			return in.y >= -1.f;
-		},
-		[yAxisInverted](const glm::vec3& in) {
-			if (yAxisInverted)
-			{
-				return -in.y <= 1.f;
-			}
-			return in.y <= 1.f;
-		},
-		[](const glm::vec3& in) { return in.z >= 0; },
-		[](const glm::vec3& in) { return in.z <= 1; }
-	};
+	// Pick the first lights inside the view frustum, testing all of them at once
+	candidateLightBoxes.clear();
+	candidateLightBoxes.reserve(data.lights.size());
+	for (const auto& light : data.lights)
+	{
+		candidateLightBoxes.push_back(transformBoundingBox(worldViewProjectionMatrix, getLightBoundingBox(light)), yAxisInverted);
+	}
+	lightVisibility.resize(candidateLightBoxes.size());
+	cullClipSpaceBoxes(glm::vec3(-1.f, -1.f, 0.f), glm::vec3(1.f, 1.f, 1.f), candidateLightBoxes, lightVisibility.data());
 
 	std::unordered_map<std::pair<int32_t, int32_t>, std::vector<size_t>, TileCoordsHasher> tileRangeLights; // map tile coordinates to vector of culledLight indexes
 	constexpr size_t maxRangedLightsPerTile = 16;
@@ -173,17 +160,17 @@ void renderingNew::LightingManager::ComputeFrameData(const LightingData& data, L
 	size_t tinyLightsSkipped = 0;
 
 	culledLights.clear();
-	for (const auto& light : data.lights)
+	for (size_t candidateIndex = 0, end = data.lights.size(); candidateIndex < end; candidateIndex++)
 	{
 		if (culledLights.size() >= gfx_api::max_lights)
 		{
 			break;
 		}
-		auto clipSpaceBoundingBox = transformBoundingBox(worldViewProjectionMatrix, getLightBoundingBox(light));
-		if (!isBBoxInClipSpace(viewFrustum, clipSpaceBoundingBox))
+		if (!lightVisibility[candidateIndex])
 		{
 			continue;
 		}
+		const auto& light = data.lights[candidateIndex];
 
 		if (light.range >= minLightRange)
 		{
@@ -216,7 +203,7 @@ void renderingNew::LightingManager::ComputeFrameData(const LightingData& data, L
 							calcLight.colour.z += (existingLight.light.colour.z) * weight;
 
 							existingLight.light = calcLight;
-							existingLight.clipSpaceBoundingBox = clipSpaceBoundingBox;
+							existingLight.boxIndex = candidateIndex;
 						}
 						else
 						{
@@ -258,7 +245,20 @@ void renderingNew::LightingManager::ComputeFrameData(const LightingData& data, L
 		calcLight.colour = glm::vec3(light.colour.byte.r / 255.f, light.colour.byte.g / 255.f, light.colour.byte.b / 255.f);
 		calcLight.range = light.range;
 
-		culledLights.push_back({std::move(calcLight), std::move(clipSpaceBoundingBox)});
+		culledLights.push_back({std::move(calcLight), candidateIndex});
+	}
+
+	culledLightBoxes.clear();
+	culledLightBoxes.reserve(culledLights.size());
+	for (const auto& culledLight : culledLights)
+	{
+		const size_t i = culledLight.boxIndex;
+		culledLightBoxes.minX.push_back(candidateLightBoxes.minX[i]);
+		culledLightBoxes.maxX.push_back(candidateLightBoxes.maxX[i]);
+		culledLightBoxes.minY.push_back(candidateLightBoxes.minY[i]);
+		culledLightBoxes.maxY.push_back(candidateLightBoxes.maxY[i]);
+		culledLightBoxes.minZ.push_back(candidateLightBoxes.minZ[i]);
+		culledLightBoxes.maxZ.push_back(candidateLightBoxes.maxZ[i]);
 	}
 
 	if (lightsSkipped > 0 || lightsCombined > 0 || tinyLightsSkipped > 0)
@@ -304,22 +304,7 @@ void renderingNew::LightingManager::ComputeFrameData(const LightingData& data, L
 				auto bucketFrustumY0 = -1.f + 2 * static_cast<float>(j) / bucketDimension;
 				auto bucketFrustumY1 = -1.f + 2 * static_cast<float>(j + 1) / bucketDimension;
 
-				auto frustum = IntersectionOfHalfSpace{
-					[bucketFrustumX0](const glm::vec3& in) { return in.x >= bucketFrustumX0; },
-					[bucketFrustumX1](const glm::vec3& in) { return in.x <= bucketFrustumX1; },
-					[bucketFrustumY0, yAxisInverted](const glm::vec3& in) {
-						if (yAxisInverted)
-							return -in.y >= bucketFrustumY0;
-						return in.y >= bucketFrustumY0;
-					},
-					[bucketFrustumY1, yAxisInverted](const glm::vec3& in) {
-						if (yAxisInverted)
-							return -in.y <= bucketFrustumY1;
-						return in.y <= bucketFrustumY1;
-					},
-					[](const glm::vec3& in) { return in.z >= 0; },
-					[](const glm::vec3& in) { return in.z <= 1; }
-				};
+				cullClipSpaceBoxes(glm::vec3(bucketFrustumX0, bucketFrustumY0, 0.f), glm::vec3(bucketFrustumX1, bucketFrustumY1, 1.f), culledLightBoxes, lightVisibility.data());
 
 				size_t bucketSize = 0;
 				for (size_t lightIndex = 0; lightIndex < culledLights.size(); lightIndex++)
@@ -330,9 +315,7 @@ void renderingNew::LightingManager::ComputeFrameData(const LightingData& data, L
 						reduceNumberOfBucketsNeeded = true;
 						break;
 					}
-					const BoundingBox& clipSpaceBoundingBox = culledLights[lightIndex].clipSpaceBoundingBox;
-
-					if (isBBoxInClipSpace(frustum, clipSpaceBoundingBox))
+					if (lightVisibility[lightIndex])
 					{
 						lightList[overallId + bucketSize] = lightIndex;
 
@@ -111,9 +111,12 @@ namespace renderingNew
 		struct CulledLightInfo
 		{
 			CalculatedPointLight light;
-			BoundingBox clipSpaceBoundingBox;
+			size_t boxIndex;  // in candidateLightBoxes
 		};
 		std::vector<CulledLightInfo> culledLights;
+		ClipSpaceBoxList candidateLightBoxes;  // one per light in the LightingData
+		ClipSpaceBoxList culledLightBoxes;     // one per culledLights entry
+		std::vector<uint8_t> lightVisibility;
 	};
 }
 
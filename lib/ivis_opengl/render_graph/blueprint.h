@@ -54,11 +54,15 @@ struct RecordFuncTable
 {
 	/// Per `PassId` record callbacks; empty slots are skipped at execute time.
 	std::array<RenderPassDesc::RecordFunc, static_cast<size_t>(PassId::Count)> funcs{};
+	/// Per `PassId` `RenderPassDesc::parallelRecord` flags.
+	std::array<bool, static_cast<size_t>(PassId::Count)> parallelRecord{};
 
-	/// Register the draw callback for a pass slot.
-	void set(PassId id, RenderPassDesc::RecordFunc func)
+	/// Register the draw callback for a pass slot. Pass `recordInParallel` only for callbacks that
+	/// are safe to run on a worker thread (see `RenderPassDesc::parallelRecord`).
+	void set(PassId id, RenderPassDesc::RecordFunc func, bool recordInParallel = false)
 	{
 		funcs[static_cast<size_t>(id)] = std::move(func);
+		parallelRecord[static_cast<size_t>(id)] = recordInParallel;
 	}
 };
 
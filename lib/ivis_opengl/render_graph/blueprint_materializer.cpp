@@ -97,6 +97,7 @@ std::vector<RenderPassDesc> BlueprintMaterializer::materialize(const PassGraphTo
 			return {};
 		}
 		desc.recordFunc = recordFuncs.funcs[funcIndex];
+		desc.parallelRecord = recordFuncs.parallelRecord[funcIndex];
 
 		desc.colorAttachments.reserve(bpPass.colorAttachments.size());
 		for (const BlueprintAttachment& colorAttachment : bpPass.colorAttachments)
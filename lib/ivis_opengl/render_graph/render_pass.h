@@ -117,6 +117,9 @@ struct RenderPassDesc
 	using RecordFunc = std::function<void(const RenderPassContext&)>;
 	/// Draw callback; often populated from `RecordFuncTable` at materialize time.
 	RecordFunc recordFunc;
+	/// `recordFunc` only reads frame state prepared before the graph executes, so backends that
+	/// support it may record the pass on a worker thread, concurrently with other passes.
+	bool parallelRecord = false;
 
 	std::vector<AttachmentDesc> colorAttachments;
 	optional<AttachmentDesc> depthAttachment;
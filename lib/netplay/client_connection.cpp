@@ -200,6 +200,48 @@ net::result<ssize_t> IClientConnection::writeAll(const void* buf, size_t size, s
 	return size;
 }
 
+net::result<ssize_t> IClientConnection::writeAllShared(const void* buf, size_t size, const std::vector<uint8_t>& sharedBlock, size_t* rawByteCount, bool* usedSharedBlock)
+{
+	if (usedSharedBlock)
+	{
+		*usedSharedBlock = false;
+	}
+	if (!isCompressed() || !compressionAdapter_->supportsSharedBlocks() || size == 0)
+	{
+		return writeAll(buf, size, rawByteCount);
+	}
+
+	if (!isValid())
+	{
+		debug(LOG_ERROR, "IClientConnection::writeAllShared: Invalid socket (EBADF)");
+		return tl::make_unexpected(make_network_error_code(EBADF));
+	}
+
+	auto writeErr = writeErrorCode();
+	if (writeErr.has_value())
+	{
+		return tl::make_unexpected(writeErr.value());
+	}
+
+	auto appendRes = compressionAdapter_->appendSharedBlock(sharedBlock, buf, size);
+	if (!appendRes.has_value())
+	{
+		const auto errMsg = appendRes.error().message();
+		debug(LOG_NET, "IClientConnection::writeAllShared: can't use shared block, compressing separately: %s", errMsg.c_str());
+		return writeAll(buf, size, rawByteCount);
+	}
+
+	if (rawByteCount)
+	{
+		*rawByteCount = 0;
+	}
+	if (usedSharedBlock)
+	{
+		*usedSharedBlock = true;
+	}
+	return size;
+}
+
 net::result<void> IClientConnection::flush(size_t* rawByteCount)
 {
 	if (!isValid())
@@ -253,7 +295,7 @@ net::result<void> IClientConnection::flush(size_t* rawByteCount)
 	return {};
 }
 
-void IClientConnection::enableCompression()
+void IClientConnection::enableCompression(CompressionAlgorithm algorithm)
 {
 	if (isCompressed_)
 	{
@@ -262,9 +304,14 @@ void IClientConnection::enableCompression()
 
 	ASSERT_OR_RETURN(, compressionProvider_ != nullptr, "Invalid compression provider");
 
-	pwm_->executeUnderLock([this]
+	pwm_->executeUnderLock([this, algorithm]
 	{
-		compressionAdapter_ = compressionProvider_->newCompressionAdapter();
+		compressionAdapter_ = compressionProvider_->newCompressionAdapter(algorithm);
+		if (!compressionAdapter_)
+		{
+			debug(LOG_ERROR, "Compression algorithm %u not supported. Sockets won't work properly!", static_cast<unsigned>(algorithm));
+			return;
+		}
 		const auto initRes = compressionAdapter_->initialize();
 		if (!initRes.has_value())
 		{
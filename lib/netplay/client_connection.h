@@ -105,6 +105,18 @@ public:
 	/// <param name="rawByteCount">Output parameter: raw count of bytes (after compression) written.</param>
 	/// <returns>The total number of bytes written.</returns>
 	net::result<ssize_t> writeAll(const void* buf, size_t size, size_t* rawByteCount);
+	/// <summary>
+	/// Same as `writeAll()`, for data which is sent to several connections: `sharedBlock` is `buf`
+	/// compressed once by `ICompressionAdapter::encodeSharedBlock()`, and is used as is instead of
+	/// compressing `buf` again, if this connection's compression algorithm supports it.
+	/// </summary>
+	/// <param name="buf">Source buffer to read the data from.</param>
+	/// <param name="size">The number of bytes to write to the socket.</param>
+	/// <param name="sharedBlock">`buf` compressed by `ICompressionAdapter::encodeSharedBlock()`.</param>
+	/// <param name="rawByteCount">Output parameter: raw count of bytes (after compression) written.</param>
+	/// <param name="usedSharedBlock">Output parameter: whether `sharedBlock` was used.</param>
+	/// <returns>The total number of bytes written.</returns>
+	net::result<ssize_t> writeAllShared(const void* buf, size_t size, const std::vector<uint8_t>& sharedBlock, size_t* rawByteCount, bool* usedSharedBlock);
 
 	/// <summary>
 	/// Low-level implementation method to send raw data (stored in `data`)
@@ -149,8 +161,11 @@ public:
 	///
 	/// This makes all subsequent write operations asynchronous, plus
 	/// the written data will need to be flushed explicitly at some point.
+	///
+	/// Both ends of the connection must use the same `algorithm`, as agreed on in
+	/// the connection handshake (see `WzCompressionProvider::chooseAlgorithm()`).
 	/// </summary>
-	void enableCompression();
+	void enableCompression(CompressionAlgorithm algorithm = CompressionAlgorithm::Zlib);
 
 	bool isCompressed() const
 	{
@@ -25,6 +25,19 @@
 #include <stdint.h>
 #include <vector>
 
+/// <summary>
+/// Compression algorithms which connections can use, as sent in the connection handshake
+/// (so the values must not change).
+/// </summary>
+enum class CompressionAlgorithm : uint8_t
+{
+	Zlib = 0,
+	Zstd = 1,
+	/// Zstd, with the dictionary trained on game messages (see `WzCompressionProvider`).
+	ZstdDictionary = 2,
+	Lz4 = 3,
+};
+
 /// <summary>
 /// Generic facade for integration of various compression algorithms into WZ's
 /// networking code.
@@ -49,6 +62,11 @@ public:
 	/// </returns>
 	virtual net::result<void> initialize() = 0;
 
+	/// <summary>
+	/// The algorithm this adapter implements. Both ends of a connection must use the same one.
+	/// </summary>
+	virtual CompressionAlgorithm algorithm() const = 0;
+
 	/// <summary>
 	/// Executes the compression routine against `src` buffer of a given size.
 	/// The result (compressed buffer) can be later accessed via `compressionOutBuffer()` function.
@@ -137,4 +155,48 @@ public:
 	/// </summary>
 	/// <param name="size">New size for the decompression input stream</param>
 	virtual void resetDecompressionStreamInputSize(size_t size) = 0;
+
+	/// <summary>
+	/// Returns `true` if the algorithm can compress a message once for several connections,
+	/// via `encodeSharedBlock()` and `appendSharedBlock()`.
+	/// </summary>
+	virtual bool supportsSharedBlocks() const
+	{
+		return false;
+	}
+	/// <summary>
+	/// Compress `src` into `out` as a self-contained block, which doesn't refer to any
+	/// data compressed before it, and so can be appended to the compression output of any
+	/// adapter of the same type via `appendSharedBlock()`.
+	///
+	/// This uses the adapter's own compression stream, so it should be called on a dedicated
+	/// adapter instance, which is not used for `compress()`.
+	/// </summary>
+	/// <param name="src">Source buffer containing uncompressed data</param>
+	/// <param name="size">Size of the source buffer in bytes</param>
+	/// <param name="out">Destination for the compressed block (replaced, not appended to)</param>
+	/// <returns>
+	/// In case of failure, returns an error code describing the error.
+	/// </returns>
+	virtual net::result<void> encodeSharedBlock(const void* /*src*/, size_t /*size*/, std::vector<uint8_t>& /*out*/)
+	{
+		return tl::make_unexpected(std::make_error_code(std::errc::operation_not_supported));
+	}
+	/// <summary>
+	/// Append `block`, made by `encodeSharedBlock()` from `src`, to the compression output buffer.
+	/// The result is the same for the receiving side as `compress(src, size)` followed by a flush,
+	/// without compressing the data again.
+	///
+	/// The block is not appended on failure, so the caller can fall back to `compress()`.
+	/// </summary>
+	/// <param name="block">Compressed block from `encodeSharedBlock()`</param>
+	/// <param name="src">The uncompressed data `block` was made from</param>
+	/// <param name="size">Size of the uncompressed data in bytes</param>
+	/// <returns>
+	/// In case of failure, returns an error code describing the error.
+	/// </returns>
+	virtual net::result<void> appendSharedBlock(const std::vector<uint8_t>& /*block*/, const void* /*src*/, size_t /*size*/)
+	{
+		return tl::make_unexpected(std::make_error_code(std::errc::operation_not_supported));
+	}
 };
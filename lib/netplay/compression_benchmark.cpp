@@ -0,0 +1,259 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "compression_benchmark.h"
+
+#include "lib/framework/frame.h"
+#include "lib/framework/file.h"
+#include "lib/framework/physfs_ext.h"
+#include "lib/netplay/netreplay.h"
+#include "lib/netplay/wz_compression_provider.h"
+#include "lib/netplay/zlib_compression_adapter.h"
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+# include "lib/netplay/zstd_compression_adapter.h"
+# include <zdict.h>
+#endif
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+# include "lib/netplay/lz4_compression_adapter.h"
+#endif
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+// Zstd's recommendation for dictionaries of small messages; the game sends a few dozen kinds.
+static const size_t DictionaryCapacity = 32 * 1024;
+// Training takes long, and gains little, past this much data.
+static const size_t MaxTrainingBytes = 128 * 1024 * 1024;
+
+namespace
+{
+
+struct ReplayMessage
+{
+	uint8_t player;
+	std::vector<uint8_t> rawData;  ///< As sent over the network.
+};
+
+typedef std::function<std::unique_ptr<ICompressionAdapter> ()> AdapterFactory;
+
+} // anonymous namespace
+
+static bool loadReplayMessages(std::string const &replayDir, std::vector<ReplayMessage> &messages, size_t maxBytes)
+{
+	size_t replayCount = 0;
+	size_t totalBytes = 0;
+	WZ_PHYSFS_enumerateFiles(replayDir.c_str(), [&](const char *file) -> bool {
+		const std::string name = file;
+		if (name.size() < 5 || name.compare(name.size() - 5, 5, ".wzrp") != 0)
+		{
+			return true;  // continue
+		}
+		const bool read = NETreplayReadNetMessages(replayDir + "/" + name, [&](uint8_t player, NetMessage const &message) {
+			if (totalBytes < maxBytes)
+			{
+				messages.push_back({player, std::vector<uint8_t>(message.rawData().begin(), message.rawData().end())});
+				totalBytes += message.rawData().size();
+			}
+		});
+		replayCount += read ? 1 : 0;
+		return totalBytes < maxBytes;
+	});
+	fprintf(stdout, "Read %zu messages (%zu bytes) from %zu replays in %s\n", messages.size(), totalBytes, replayCount, replayDir.c_str());
+	return !messages.empty();
+}
+
+// Sends the messages through a connection compressed with the adapters from makeAdapter, flushing whenever the next
+// message comes from another player (messages in a row from one player were sent together, one game tick at a time).
+static bool benchmarkAdapter(const char *name, AdapterFactory const &makeAdapter, std::vector<ReplayMessage> const &messages)
+{
+	auto sender = makeAdapter();
+	auto receiver = makeAdapter();
+	if (!sender || !receiver || !sender->initialize().has_value() || !receiver->initialize().has_value())
+	{
+		fprintf(stdout, "%-16s FAIL: could not initialize\n", name);
+		return false;
+	}
+
+	size_t rawBytes = 0;
+	size_t compressedBytes = 0;
+	std::chrono::steady_clock::duration compressTime {0};
+	std::chrono::steady_clock::duration decompressTime {0};
+	std::vector<uint8_t> batch;
+	std::vector<uint8_t> decompressed;
+	for (size_t first = 0; first < messages.size();)
+	{
+		size_t end = first + 1;
+		while (end < messages.size() && messages[end].player == messages[first].player)
+		{
+			++end;
+		}
+		batch.clear();
+		for (size_t i = first; i < end; ++i)
+		{
+			batch.insert(batch.end(), messages[i].rawData.begin(), messages[i].rawData.end());
+		}
+
+		const auto compressStart = std::chrono::steady_clock::now();
+		bool compressed = true;
+		for (size_t i = first; i < end && compressed; ++i)
+		{
+			compressed = sender->compress(messages[i].rawData.data(), messages[i].rawData.size()).has_value();
+		}
+		compressed = compressed && sender->flushCompressionStream().has_value();
+		compressTime += std::chrono::steady_clock::now() - compressStart;
+		if (!compressed)
+		{
+			fprintf(stdout, "%-16s FAIL: compression error\n", name);
+			return false;
+		}
+
+		// What the receiving end of the connection does with what it reads, see IClientConnection::readNoInt()
+		auto &sent = sender->compressionOutBuffer();
+		receiver->decompressionInBuffer().assign(sent.begin(), sent.end());
+		receiver->resetDecompressionStreamInputSize(sent.size());
+		compressedBytes += sent.size();
+		sent.clear();
+
+		decompressed.resize(batch.size());
+		size_t received = 0;
+		const auto decompressStart = std::chrono::steady_clock::now();
+		while (received < decompressed.size())
+		{
+			const size_t wanted = decompressed.size() - received;
+			if (!receiver->decompress(decompressed.data() + received, wanted).has_value())
+			{
+				break;
+			}
+			const size_t got = wanted - receiver->availableSpaceToDecompress();
+			received += got;
+			if (got == 0 && receiver->decompressionStreamConsumedAllInput())
+			{
+				break;
+			}
+		}
+		decompressTime += std::chrono::steady_clock::now() - decompressStart;
+		if (received != batch.size() || !receiver->decompressionStreamConsumedAllInput() || decompressed != batch)
+		{
+			fprintf(stdout, "%-16s FAIL: messages %zu-%zu didn't decompress to what was sent\n", name, first, end - 1);
+			return false;
+		}
+
+		rawBytes += batch.size();
+		first = end;
+	}
+
+	auto megabytesPerSecond = [rawBytes](std::chrono::steady_clock::duration time) {
+		const double seconds = std::chrono::duration<double>(time).count();
+		return seconds > 0 ? rawBytes / seconds / 1e6 : 0.;
+	};
+	fprintf(stdout, "%-16s ratio %6.2f  (%zu -> %zu bytes)  compress %8.1f MB/s  decompress %8.1f MB/s\n", name,
+		compressedBytes > 0 ? static_cast<double>(rawBytes) / compressedBytes : 0., rawBytes, compressedBytes,
+		megabytesPerSecond(compressTime), megabytesPerSecond(decompressTime));
+	return true;
+}
+
+bool NETcompressionBenchmark(std::string const &replayDir, std::string const &dictionaryFile)
+{
+	std::vector<ReplayMessage> messages;
+	if (!loadReplayMessages(replayDir, messages, SIZE_MAX))
+	{
+		fprintf(stdout, "No replay messages to compress\n");
+		return false;
+	}
+
+	bool success = benchmarkAdapter("zlib", [] { return std::make_unique<ZlibCompressionAdapter>(); }, messages);
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+	success = benchmarkAdapter("zstd", [] { return std::make_unique<ZstdCompressionAdapter>(nullptr); }, messages) && success;
+	if (!dictionaryFile.empty())
+	{
+		std::vector<char> data;
+		std::shared_ptr<const ZstdDictionary> dictionary;
+		if (loadFileToBufferVector(dictionaryFile.c_str(), data, false, false))
+		{
+			dictionary = ZstdDictionary::create(data.data(), data.size(), ZstdCompressionAdapter::CompressionLevel);
+		}
+		if (!dictionary)
+		{
+			fprintf(stdout, "%s is not a zstd dictionary\n", dictionaryFile.c_str());
+			return false;
+		}
+		success = benchmarkAdapter("zstd+dictionary", [dictionary] { return std::make_unique<ZstdCompressionAdapter>(dictionary); }, messages) && success;
+	}
+#else
+	(void)dictionaryFile;
+	fprintf(stdout, "zstd not supported by this build\n");
+#endif
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+	success = benchmarkAdapter("lz4", [] { return std::make_unique<Lz4CompressionAdapter>(); }, messages) && success;
+#else
+	fprintf(stdout, "lz4 not supported by this build\n");
+#endif
+	return success;
+}
+
+bool NETtrainCompressionDictionary(std::string const &replayDir, std::string const &outputFile)
+{
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+	std::vector<ReplayMessage> messages;
+	if (!loadReplayMessages(replayDir, messages, MaxTrainingBytes))
+	{
+		fprintf(stdout, "No replay messages to train on\n");
+		return false;
+	}
+
+	std::vector<uint8_t> samples;
+	std::vector<size_t> sampleSizes;
+	sampleSizes.reserve(messages.size());
+	for (auto const &message : messages)
+	{
+		samples.insert(samples.end(), message.rawData.begin(), message.rawData.end());
+		sampleSizes.push_back(message.rawData.size());
+	}
+
+	std::vector<uint8_t> dictionary(DictionaryCapacity);
+	const size_t dictionarySize = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), samples.data(), sampleSizes.data(), static_cast<unsigned>(sampleSizes.size()));
+	if (ZDICT_isError(dictionarySize))
+	{
+		fprintf(stdout, "Dictionary training failed: %s\n", ZDICT_getErrorName(dictionarySize));
+		return false;
+	}
+	dictionary.resize(dictionarySize);
+
+	PHYSFS_file *handle = PHYSFS_openWrite(outputFile.c_str());
+	if (handle == nullptr)
+	{
+		fprintf(stdout, "Could not create %s: %s\n", outputFile.c_str(), WZ_PHYSFS_getLastError());
+		return false;
+	}
+	const bool written = WZ_PHYSFS_writeBytes(handle, dictionary.data(), static_cast<PHYSFS_uint32>(dictionary.size())) == static_cast<PHYSFS_sint64>(dictionary.size());
+	if (!PHYSFS_close(handle) || !written)
+	{
+		fprintf(stdout, "Could not write %s: %s\n", outputFile.c_str(), WZ_PHYSFS_getLastError());
+		return false;
+	}
+	fprintf(stdout, "Wrote dictionary %" PRIu32 " (%zu bytes) to %s\n", ZDICT_getDictID(dictionary.data(), dictionary.size()), dictionary.size(), outputFile.c_str());
+	return true;
+#else
+	(void)replayDir;
+	(void)outputFile;
+	fprintf(stdout, "zstd not supported by this build\n");
+	return false;
+#endif
+}
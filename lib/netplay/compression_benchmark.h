@@ -0,0 +1,36 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file compression_benchmark.h
+ * Offline tools for the net message compression algorithms, fed with the messages of recorded replays.
+ */
+
+#pragma once
+
+#include <string>
+
+/// Sends the messages of every replay (`.wzrp`) in PhysFS directory `replayDir` through each compression algorithm
+/// this build supports, checks they decompress to the same messages, and prints the compression ratio and
+/// throughput of each. If `dictionaryFile` (a PhysFS path) isn't empty, zstd is also tried with that dictionary.
+/// Returns false if no messages could be read, or an algorithm failed.
+bool NETcompressionBenchmark(std::string const &replayDir, std::string const &dictionaryFile);
+
+/// Trains a zstd dictionary on the messages of the replays in PhysFS directory `replayDir`, and writes it to
+/// `outputFile` in the PhysFS write directory. Shipped as `WzCompressionProvider::DictionaryPath`, connections
+/// between games with the same dictionary compress with it.
+bool NETtrainCompressionDictionary(std::string const &replayDir, std::string const &outputFile);
@@ -30,6 +30,13 @@
 #endif
 
 #include <zlib.h>
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+# include <zstd.h>
+# include <zstd_errors.h>
+#endif
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+# include <lz4frame.h>
+#endif
 
 std::string GenericSystemErrorCategory::message(int ev) const
 {
@@ -122,6 +129,21 @@ std::string ZlibErrorCategory::message(int ev) const
 	}
 }
 
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+std::string ZstdErrorCategory::message(int ev) const
+{
+	return ZSTD_getErrorString(static_cast<ZSTD_ErrorCode>(ev));
+}
+#endif
+
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+std::string Lz4ErrorCategory::message(int ev) const
+{
+	// LZ4F functions return error codes negated
+	return LZ4F_getErrorName(static_cast<LZ4F_errorCode_t>(-static_cast<ptrdiff_t>(ev)));
+}
+#endif
+
 const std::error_category& generic_system_error_category()
 {
 	static GenericSystemErrorCategory instance;
@@ -154,3 +176,29 @@ std::error_code make_zlib_error_code(int ev)
 {
 	return { ev, zlib_error_category() };
 }
+
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+const std::error_category& zstd_error_category()
+{
+	static ZstdErrorCategory instance;
+	return instance;
+}
+
+std::error_code make_zstd_error_code(size_t zstdResult)
+{
+	return { static_cast<int>(ZSTD_getErrorCode(zstdResult)), zstd_error_category() };
+}
+#endif
+
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+const std::error_category& lz4_error_category()
+{
+	static Lz4ErrorCategory instance;
+	return instance;
+}
+
+std::error_code make_lz4_error_code(size_t lz4fResult)
+{
+	return { static_cast<int>(-static_cast<ptrdiff_t>(lz4fResult)), lz4_error_category() };
+}
+#endif
@@ -88,10 +88,64 @@ public:
 	std::string message(int ev) const override;
 };
 
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+/// <summary>
+/// Custom error category which maps `ZSTD_ErrorCode` values from zstd to
+/// the appropriate error messages.
+/// </summary>
+class ZstdErrorCategory : public std::error_category
+{
+public:
+
+	constexpr ZstdErrorCategory() = default;
+
+	const char* name() const noexcept override
+	{
+		return "zstd";
+	}
+
+	std::string message(int ev) const override;
+};
+#endif
+
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+/// <summary>
+/// Custom error category which maps `LZ4F_errorCodes` values from the LZ4 frame
+/// library to the appropriate error messages.
+/// </summary>
+class Lz4ErrorCategory : public std::error_category
+{
+public:
+
+	constexpr Lz4ErrorCategory() = default;
+
+	const char* name() const noexcept override
+	{
+		return "lz4";
+	}
+
+	std::string message(int ev) const override;
+};
+#endif
+
 const std::error_category& generic_system_error_category();
 const std::error_category& getaddrinfo_error_category();
 const std::error_category& zlib_error_category();
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+const std::error_category& zstd_error_category();
+#endif
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+const std::error_category& lz4_error_category();
+#endif
 
 std::error_code make_network_error_code(int ev);
 std::error_code make_getaddrinfo_error_code(int ev);
 std::error_code make_zlib_error_code(int ev);
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+/// Makes an error code from the result of a zstd function, which must be an error (`ZSTD_isError()`).
+std::error_code make_zstd_error_code(size_t zstdResult);
+#endif
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+/// Makes an error code from the result of an LZ4 frame function, which must be an error (`LZ4F_isError()`).
+std::error_code make_lz4_error_code(size_t lz4fResult);
+#endif
@@ -0,0 +1,134 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "lz4_compression_adapter.h"
+#include "error_categories.h"
+
+#include "lib/framework/frame.h" // for `ASSERT`
+
+#include <cstring>
+
+Lz4CompressionAdapter::Lz4CompressionAdapter()
+{
+	std::memset(&preferences_, 0, sizeof(preferences_));
+	preferences_.frameInfo.blockSizeID = LZ4F_max64KB;
+	preferences_.frameInfo.blockMode = LZ4F_blockLinked;  // Blocks may refer to the previous 64 KiB of data.
+	preferences_.compressionLevel = 0;  // Fast mode.
+}
+
+Lz4CompressionAdapter::~Lz4CompressionAdapter()
+{
+	LZ4F_freeCompressionContext(cctx_);
+	LZ4F_freeDecompressionContext(dctx_);
+}
+
+net::result<void> Lz4CompressionAdapter::initialize()
+{
+	LZ4F_errorCode_t ret = LZ4F_createCompressionContext(&cctx_, LZ4F_VERSION);
+	if (!LZ4F_isError(ret))
+	{
+		ret = LZ4F_createDecompressionContext(&dctx_, LZ4F_VERSION);
+	}
+	ASSERT(!LZ4F_isError(ret), "Failed to create LZ4 contexts! Sockets won't work.");
+	if (LZ4F_isError(ret))
+	{
+		return tl::make_unexpected(make_lz4_error_code(ret));
+	}
+
+	// The frame header goes first.
+	compressOutBuf_.resize(LZ4F_HEADER_SIZE_MAX);
+	const size_t headerSize = LZ4F_compressBegin(cctx_, compressOutBuf_.data(), compressOutBuf_.size(), &preferences_);
+	if (LZ4F_isError(headerSize))
+	{
+		compressOutBuf_.clear();
+		return tl::make_unexpected(make_lz4_error_code(headerSize));
+	}
+	compressOutBuf_.resize(headerSize);
+
+	decompressNeedInput_ = true;
+
+	return {};
+}
+
+net::result<void> Lz4CompressionAdapter::compress(const void* src, size_t size)
+{
+	const size_t alreadyHave = compressOutBuf_.size();
+	// Always enough, including any data buffered from previous calls.
+	compressOutBuf_.resize(alreadyHave + LZ4F_compressBound(size, &preferences_));
+
+	const size_t written = LZ4F_compressUpdate(cctx_, &compressOutBuf_[alreadyHave], compressOutBuf_.size() - alreadyHave, src, size, nullptr);
+	if (LZ4F_isError(written))
+	{
+		compressOutBuf_.resize(alreadyHave);
+		ASSERT(false, "LZ4 compression failed: %s", LZ4F_getErrorName(written));
+		return tl::make_unexpected(make_lz4_error_code(written));
+	}
+	// Remove unused part of buffer.
+	compressOutBuf_.resize(alreadyHave + written);
+	return {};
+}
+
+net::result<void> Lz4CompressionAdapter::flushCompressionStream()
+{
+	const size_t alreadyHave = compressOutBuf_.size();
+	compressOutBuf_.resize(alreadyHave + LZ4F_compressBound(0, &preferences_));
+
+	// Ends the current block, but not the frame.
+	const size_t written = LZ4F_flush(cctx_, &compressOutBuf_[alreadyHave], compressOutBuf_.size() - alreadyHave, nullptr);
+	if (LZ4F_isError(written))
+	{
+		compressOutBuf_.resize(alreadyHave);
+		return tl::make_unexpected(make_lz4_error_code(written));
+	}
+	compressOutBuf_.resize(alreadyHave + written);
+	return {};
+}
+
+net::result<void> Lz4CompressionAdapter::decompress(void* dst, size_t size)
+{
+	uint8_t* out = static_cast<uint8_t*>(dst);
+	decompressOutAvailable_ = size;
+
+	// A single call may stop before either buffer runs out.
+	do
+	{
+		size_t outSize = decompressOutAvailable_;
+		size_t inSize = decompressInSize_ - decompressInPos_;
+		const size_t ret = LZ4F_decompress(dctx_, out, &outSize, decompressInBuf_.data() + decompressInPos_, &inSize, nullptr);
+		if (LZ4F_isError(ret))
+		{
+			debug(LOG_ERROR, "Couldn't decompress data from socket. LZ4 error %s", LZ4F_getErrorName(ret));
+			return tl::make_unexpected(make_lz4_error_code(ret));
+		}
+		out += outSize;
+		decompressOutAvailable_ -= outSize;
+		decompressInPos_ += inSize;
+		if (outSize == 0 && inSize == 0)
+		{
+			break;
+		}
+	} while (decompressInPos_ < decompressInSize_ && decompressOutAvailable_ > 0);
+	return {};
+}
+
+void Lz4CompressionAdapter::resetDecompressionStreamInputSize(size_t size)
+{
+	decompressInPos_ = 0;
+	decompressInSize_ = size;
+}
@@ -56,6 +56,7 @@
 #include "lib/netplay/connection_provider_registry.h"
 #include "lib/netplay/pending_writes_manager.h"
 #include "lib/netplay/pending_writes_manager_map.h"
+#include "lib/netplay/wz_compression_provider.h"
 #include "netpermissions.h"
 #include "sync_debug.h"
 #include "port_mapping_manager.h"
@@ -138,6 +139,8 @@ struct NETSTATS  // data regarding the last one second or so.
 	Statistic       rawBytes;               // Number of actual bytes, in about 1 sec.
 	Statistic       uncompressedBytes;      // Number of bytes sent, before compression, in about 1 sec.
 	Statistic       packets;                // Number of calls to writeAll, in about 1 sec.
+	Statistic       sharedCompressionBytes; // Bytes of broadcasts not compressed again per connection, thanks to compressing them once, in about 1 sec.
+	Statistic       sharedCompressionMicros; // Estimated compression time saved that way, in microseconds, in about 1 sec.
 };
 
 struct NET_PLAYER_DATA
@@ -240,11 +243,16 @@ static IConnectionPollGroup* server_socket_set = nullptr;
  */
 #define NET_PING_TMP_PING_CHALLENGE_SIZE 128
 
+// A joining client first sends NETCODE_VERSION_MAJOR and NETCODE_VERSION_MINOR, then (if it is the right version) the
+// compression algorithms it supports and its zstd dictionary ID (see WzCompressionProvider).
+static const size_t ClientHelloVersionSize = 2 * sizeof(uint32_t);
+static const size_t ClientHelloSize = ClientHelloVersionSize + sizeof(uint8_t) + sizeof(uint32_t);
+
 struct TmpSocketInfo
 {
 	std::string ip;
 	std::chrono::steady_clock::time_point connectTime;
-	char buffer[10] = {'\0'};
+	char buffer[16] = {'\0'};
 	size_t usedBuffer = 0;
 	std::vector<uint8_t> connectChallenge;
 	enum class TmpConnectState
@@ -320,10 +328,18 @@ static int32_t          NetGameFlags[4] = { 0, 0, 0, 0 };
 char iptoconnect[PATH_MAX] = "\0"; // holds IP/hostname from command line
 bool cliConnectAsSpectator = false; // for cli option
 
-static NETSTATS nStats              = {{0, 0}, {0, 0}, {0, 0}};
-static NETSTATS nStatsLastSec       = {{0, 0}, {0, 0}, {0, 0}};
-static NETSTATS nStatsSecondLastSec = {{0, 0}, {0, 0}, {0, 0}};
-static const NETSTATS nZeroStats    = {{0, 0}, {0, 0}, {0, 0}};
+static NETSTATS nStats              = {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}};
+static NETSTATS nStatsLastSec       = {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}};
+static NETSTATS nStatsSecondLastSec = {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}};
+static const NETSTATS nZeroStats    = {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}};
+
+/// Compressor for broadcasts: each is compressed once into `broadcastBlock`, which every connection it goes to
+/// appends to its own compressed stream (see `NETsend()`).
+static std::unique_ptr<ICompressionAdapter> broadcastCompressor;
+static std::vector<uint8_t> broadcastBlock;
+/// Compression time saved, not yet added to `nStats.sharedCompressionMicros` (less than a microsecond).
+static std::chrono::nanoseconds broadcastSavedTime {0};
+
 static int nStatsLastUpdateTime = 0;
 
 unsigned NET_PlayerConnectionStatus[CONNECTIONSTATUS_NORMAL][MAX_CONNECTED_PLAYERS];
@@ -1419,6 +1435,10 @@ int NETshutdown()
 
 	activeConnProvider = nullptr;
 
+	broadcastCompressor = nullptr;
+	broadcastBlock.clear();
+	broadcastBlock.shrink_to_fit();
+
 	// Reset net usage statistics.
 	nStats = nZeroStats;
 	nStatsLastSec = nZeroStats;
@@ -1533,6 +1553,8 @@ size_t NETgetStatistic(NetStatisticType type, bool sent, bool isTotal)
 	case NetStatisticRawBytes:          statsType = &NETSTATS::rawBytes;          break;
 	case NetStatisticUncompressedBytes: statsType = &NETSTATS::uncompressedBytes; break;
 	case NetStatisticPackets:           statsType = &NETSTATS::packets;           break;
+	case NetStatisticSharedCompressionBytes:  statsType = &NETSTATS::sharedCompressionBytes;  break;
+	case NetStatisticSharedCompressionMicros: statsType = &NETSTATS::sharedCompressionMicros; break;
 	default: ASSERT(false, " "); return 0;
 	}
 
@@ -1553,6 +1575,52 @@ size_t NETgetStatistic(NetStatisticType type, bool sent, bool isTotal)
 
 static std::set<uint32_t> netSendPendingDisconnectPlayerIndexes;
 
+// Whether the connection can append blocks made by `broadcastCompressor`.
+static bool NETcanUseBroadcastBlock(IClientConnection* socket)
+{
+	return broadcastCompressor && socket->isCompressed() && socket->compressionAdapter().supportsSharedBlocks()
+		&& socket->compressionAdapter().algorithm() == broadcastCompressor->algorithm();
+}
+
+// Compress a broadcast message once into `broadcastBlock`, for all the connections it goes to, if at least two
+// of them can use it (see `IClientConnection::writeAllShared()`). Returns how long that took, or nullopt if not done.
+static optional<std::chrono::nanoseconds> NETencodeBroadcastBlock(IClientConnection** sockets, NETQUEUE queue, const NetMsgDataVector& rawData)
+{
+	if (!broadcastCompressor)
+	{
+		broadcastCompressor = WzCompressionProvider::Instance().newCompressionAdapter();
+		if (!broadcastCompressor->initialize().has_value() || !broadcastCompressor->supportsSharedBlocks())
+		{
+			debug(LOG_NET, "Broadcast messages will be compressed separately for each connection");
+			broadcastCompressor = nullptr;
+			return nullopt;
+		}
+	}
+
+	size_t sharingConnections = 0;
+	for (int player = 0; player < MAX_CONNECTED_PLAYERS; ++player)
+	{
+		if (sockets[player] != nullptr && player != queue.exclude && NETcanUseBroadcastBlock(sockets[player]))
+		{
+			++sharingConnections;
+		}
+	}
+	if (sharingConnections < 2)
+	{
+		return nullopt;  // Compressing within the connection's own stream compresses better.
+	}
+
+	const auto encodeStart = std::chrono::steady_clock::now();
+	const auto encodeRes = broadcastCompressor->encodeSharedBlock(rawData.data(), rawData.size(), broadcastBlock);
+	if (!encodeRes.has_value())
+	{
+		const auto errMsg = encodeRes.error().message();
+		debug(LOG_NET, "Failed to compress broadcast message: %s", errMsg.c_str());
+		return nullopt;
+	}
+	return std::chrono::steady_clock::now() - encodeStart;
+}
+
 void NETsendProcessDelayedActions()
 {
 	if (netSendPendingDisconnectPlayerIndexes.empty())
@@ -1612,6 +1680,16 @@ bool NETsend(NETQUEUE queue, NetMessage const& message)
 	{
 		int firstPlayer = player == NET_ALL_PLAYERS ? 0                         : player;
 		int lastPlayer  = player == NET_ALL_PLAYERS ? MAX_CONNECTED_PLAYERS - 1 : player;
+
+		// Broadcasts are compressed once, instead of once per connection
+		optional<std::chrono::nanoseconds> sharedEncodeTime;
+		std::chrono::nanoseconds sharedAppendTime {0};
+		size_t sharedBlockUses = 0;
+		if (queue.queueType == QUEUE_BROADCAST && !message.rawData().empty())
+		{
+			sharedEncodeTime = NETencodeBroadcastBlock(sockets, queue, message.rawData());
+		}
+
 		for (player = firstPlayer; player <= lastPlayer; ++player)
 		{
 			// We are the host, send directly to player.
@@ -1626,7 +1704,22 @@ bool NETsend(NETQUEUE queue, NetMessage const& message)
 				uint8_t msgType = message.type();
 				ssize_t rawLen = rawData.size();
 				size_t compressedRawLen;
-				const auto writeResult = sockets[player]->writeAll(rawData.data(), rawLen, &compressedRawLen);
+				net::result<ssize_t> writeResult;
+				if (sharedEncodeTime.has_value() && NETcanUseBroadcastBlock(sockets[player]))
+				{
+					bool usedSharedBlock = false;
+					const auto appendStart = std::chrono::steady_clock::now();
+					writeResult = sockets[player]->writeAllShared(rawData.data(), rawLen, broadcastBlock, &compressedRawLen, &usedSharedBlock);
+					if (usedSharedBlock)
+					{
+						sharedAppendTime += std::chrono::steady_clock::now() - appendStart;
+						++sharedBlockUses;
+					}
+				}
+				else
+				{
+					writeResult = sockets[player]->writeAll(rawData.data(), rawLen, &compressedRawLen);
+				}
 				const auto res = writeResult.value_or(SOCKET_ERROR);
 
 				if (res == rawLen)
@@ -1648,6 +1741,21 @@ bool NETsend(NETQUEUE queue, NetMessage const& message)
 				}
 			}
 		}
+
+		if (sharedBlockUses > 0)
+		{
+			// Compressing separately would have cost about one encode per connection
+			nStats.sharedCompressionBytes.sent += (sharedBlockUses - 1) * message.rawData().size();
+			const auto separateTime = sharedEncodeTime.value() * sharedBlockUses;
+			const auto sharedTime = sharedEncodeTime.value() + sharedAppendTime;
+			if (separateTime > sharedTime)
+			{
+				broadcastSavedTime += separateTime - sharedTime;
+				const auto savedMicros = std::chrono::duration_cast<std::chrono::microseconds>(broadcastSavedTime);
+				nStats.sharedCompressionMicros.sent += static_cast<size_t>(savedMicros.count());
+				broadcastSavedTime -= savedMicros;
+			}
+		}
 		return true;
 	}
 	else if (player == NetPlay.hostPlayer)
@@ -2961,48 +3069,95 @@ bool NETrecvGame(NETQUEUE *queue, uint8_t *type)
 
 // ////////////////////////////////////////////////////////////////////////
 // File Transfer programs.
-/** Send file. It returns % of file sent when 100 it's complete. Call until it returns 100.
-*  @TODO: more error checking (?) different file types (?)
-*          Maybe should close file handle, and seek each time?
-*
+/*
 *  @NOTE: MAX_FILE_TRANSFER_PACKET is set to 4k per packet since 7*4 = 28K which is pretty
 *         much our limit.  Don't screw with that without having a bigger buffer!
 *         NET_BUFFER_SIZE is at 256k.  (also remember text chat, plus all the other cruff)
 */
 #define MAX_FILE_TRANSFER_PACKET 4096
-int NETsendFile(WZFile &file, unsigned player)
+// How far the host may send ahead of what the client has acknowledged, so that a download
+// isn't limited to a chunk per frame, and doesn't flood the connection either.
+#define FILE_TRANSFER_WINDOW (64 * MAX_FILE_TRANSFER_PACKET)
+// The client acknowledges what it has received every this many bytes, and at the end.
+#define FILE_TRANSFER_ACK_INTERVAL (16 * MAX_FILE_TRANSFER_PACKET)
+
+// Files being sent, by hash. Loaded once, however many players download them at the same time.
+static std::unordered_map<Sha256, std::weak_ptr<const std::vector<uint8_t>>> filesToSend;
+
+std::shared_ptr<const std::vector<uint8_t>> NETloadFileToSend(std::string const &filename, Sha256 const &hash)
 {
-	ASSERT_OR_RETURN(100, NetPlay.isHost, "Trying to send a file and we are not the host!");
-	ASSERT_OR_RETURN(100, file.handle() != nullptr, "Null file handle");
+	for (auto it = filesToSend.begin(); it != filesToSend.end();)
+	{
+		it = it->second.expired() ? filesToSend.erase(it) : std::next(it);
+	}
+	auto it = filesToSend.find(hash);
+	if (it != filesToSend.end())
+	{
+		return it->second.lock();
+	}
+
+	// PhysFS files may be inside archives, so they are read into memory rather than mapped.
+	PHYSFS_file *fileHandle = PHYSFS_openRead(filename.c_str());
+	ASSERT_OR_RETURN(nullptr, fileHandle != nullptr, "Could not open %s for reading: %s", filename.c_str(), WZ_PHYSFS_getLastError());
+	std::unique_ptr<PHYSFS_file, void(*)(PHYSFS_file*)> handle(fileHandle, physfs_file_safe_close);
 
-	uint8_t inBuff[MAX_FILE_TRANSFER_PACKET];
-	memset(inBuff, 0x0, sizeof(inBuff));
+	PHYSFS_sint64 fileSize_64 = PHYSFS_fileLength(fileHandle);
+	ASSERT_OR_RETURN(nullptr, fileSize_64 >= 0, "Filesize < 0; can't be determined");
+	ASSERT_OR_RETURN(nullptr, fileSize_64 <= MAX_NET_TRANSFERRABLE_FILE_SIZE, "Filesize is too large; (size: %" PRIi64")", static_cast<int64_t>(fileSize_64));
 
-	// read some bytes.
-	PHYSFS_sint64 readBytesResult = WZ_PHYSFS_readBytes(file.handle(), inBuff, MAX_FILE_TRANSFER_PACKET);
-	if (readBytesResult < 0)
+	auto contents = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(fileSize_64));
+	if (!contents->empty())
 	{
-		ASSERT(readBytesResult >= 0, "Error reading file.");
-		file.closeFile();
-		return 100;
+		PHYSFS_sint64 readBytesResult = WZ_PHYSFS_readBytes(fileHandle, contents->data(), static_cast<PHYSFS_uint32>(contents->size()));
+		ASSERT_OR_RETURN(nullptr, readBytesResult == fileSize_64, "Error reading %s: %s", filename.c_str(), WZ_PHYSFS_getLastError());
 	}
-	uint32_t bytesToRead = static_cast<uint32_t>(readBytesResult);
 
-	auto w = NETbeginEncode(NETnetQueue(player), NET_FILE_PAYLOAD);
-	NETbin(w, file.hash.bytes, file.hash.Bytes);
-	NETuint32_t(w, file.size);  // total bytes in this file. (we don't support 64bit yet)
-	NETuint32_t(w, file.pos);  // start byte
-	NETuint32_t(w, bytesToRead);  // bytes in this packet
-	NETbin(w, inBuff, bytesToRead);
+	std::shared_ptr<const std::vector<uint8_t>> sharedContents = std::move(contents);
+	filesToSend[hash] = sharedContents;
+	return sharedContents;
+}
+
+void NETrequestFile(Sha256 const &hash, uint32_t offset, Sha256 const &prefixHash)
+{
+	auto w = NETbeginEncode(NETnetQueue(NetPlay.hostPlayer), NET_FILE_REQUESTED);
+	NETbin(w, hash.bytes, hash.Bytes);
+	NETuint32_t(w, offset);  // bytes we have already
+	NETbin(w, prefixHash.bytes, prefixHash.Bytes);  // hash of those bytes, so the host can tell whether they are the start of this file
 	NETend(w);
+}
 
-	file.pos += bytesToRead;  // update position!
-	if (file.pos == file.size)
-	{
-		file.closeFile(); // We are done sending to this client.
+/** Send file. It returns % of file the receiver has acknowledged, when 100 it's complete. Call until it returns 100.
+*   Keeps up to FILE_TRANSFER_WINDOW bytes in flight, the rest waits for the receiver's NETrequestFile().
+*/
+int NETsendFile(WZFile &file, unsigned player)
+{
+	ASSERT_OR_RETURN(100, NetPlay.isHost, "Trying to send a file and we are not the host!");
+	ASSERT_OR_RETURN(100, file.contents() != nullptr, "No file contents");
+
+	const uint8_t *contents = file.contents()->data();
+	// An empty file still gets one (empty) packet, which completes the download on the receiving end.
+	bool sendEmptyPacket = file.size == 0 && file.pos == 0;
+	while ((file.pos < file.size || sendEmptyPacket) && file.pos - file.acked < FILE_TRANSFER_WINDOW)
+	{
+		sendEmptyPacket = false;
+		uint32_t bytesToSend = std::min<uint32_t>(file.size - file.pos, MAX_FILE_TRANSFER_PACKET);
+
+		auto w = NETbeginEncode(NETnetQueue(player), NET_FILE_PAYLOAD);
+		NETbin(w, file.hash.bytes, file.hash.Bytes);
+		NETuint32_t(w, file.size);  // total bytes in this file. (we don't support 64bit yet)
+		NETuint32_t(w, file.pos);  // start byte
+		NETuint32_t(w, bytesToSend);  // bytes in this packet
+		NETbin(w, contents + file.pos, bytesToSend);
+		NETend(w);
+
+		file.pos += bytesToSend;  // update position!
 	}
 
-	return static_cast<int>((uint64_t)file.pos * 100 / file.size);
+	if (file.size == 0)
+	{
+		return 100;
+	}
+	return static_cast<int>((uint64_t)file.acked * 100 / file.size);
 }
 
 bool validateReceivedFile(const WZFile& file)
@@ -3037,7 +3192,7 @@ bool validateReceivedFile(const WZFile& file)
 	Sha256 actualFileHash;
 	crypto_hash_sha256_state state;
 	crypto_hash_sha256_init(&state);
-	size_t bufferSize = std::min<size_t>(actualFileSize, 4 * 1024 * 1024);
+	size_t bufferSize = std::max<size_t>(std::min<size_t>(actualFileSize, 4 * 1024 * 1024), 1);
 	std::vector<unsigned char> fileChunkBuffer(bufferSize, '\0');
 	PHYSFS_sint64 length_read = 0;
 	do {
@@ -3167,7 +3322,7 @@ int NETrecvFile(NETQUEUE queue)
 	}
 
 	auto terminateFileDownload = [sendCancelFileDownload](std::vector<WZFile>::iterator &file) {
-		if (!file->closeFile())
+		if (file->handle() != nullptr && !file->closeFile())
 		{
 			debug(LOG_ERROR, "Could not close file handle after trying to terminate download: %s", WZ_PHYSFS_getLastError());
 		}
@@ -3202,10 +3357,26 @@ int NETrecvFile(NETQUEUE queue)
 		return 100;
 	}
 
-	if (PHYSFS_tell(file->handle()) != static_cast<PHYSFS_sint64>(pos))
+	if (pos == 0 && file->pos != 0)
+	{
+		// the host couldn't resume from the end of our incomplete file, and is sending all of it
+		debug(LOG_INFO, "Restarting download of %s", file->filename.c_str());
+		file->closeFile();
+		PHYSFS_file *fileHandle = PHYSFS_openWrite(file->filename.c_str());
+		if (fileHandle == nullptr)
+		{
+			debug(LOG_ERROR, "Failed to open %s for writing: %s", file->filename.c_str(), WZ_PHYSFS_getLastError());
+			terminateFileDownload(file); // 'file' is now an invalidated iterator.
+			return 100;
+		}
+		WZFile restartedFile(fileHandle, file->filename, file->hash, file->size);
+		*file = std::move(restartedFile);
+	}
+
+	if (file->pos != pos)
 	{
 		// actual position in file does not equal the expected position in the file (sent by the host)
-		debug(LOG_ERROR, "Invalid file position in downloaded file; (desired: %" PRIu32")", pos);
+		debug(LOG_ERROR, "Invalid file position in downloaded file; (desired: %" PRIu32", actual: %" PRIu32")", pos, file->pos);
 		terminateFileDownload(file); // 'file' is now an invalidated iterator.
 		return 100;
 	}
@@ -3216,6 +3387,13 @@ int NETrecvFile(NETQUEUE queue)
 	uint32_t newPos = pos + bytesToRead;
 	file->pos = newPos;
 
+	if (size > 0 && (newPos >= size || newPos - file->acked >= FILE_TRANSFER_ACK_INTERVAL))
+	{
+		// let the host send more, see NETsendFile() (the host has already finished sending an empty file, so that isn't acknowledged)
+		NETrequestFile(file->hash, newPos, Sha256());
+		file->acked = newPos;
+	}
+
 	if (newPos >= size)  // last packet
 	{
 		if (!file->closeFile())
@@ -3243,7 +3421,6 @@ int NETrecvFile(NETQUEUE queue)
 	{
 		return (newPos * 100) / size;
 	}
-	debug(LOG_ERROR, "Received 0 byte file from host?");
 	return 100;		// file is nullbyte, so we are done.
 }
 
@@ -3258,7 +3435,9 @@ unsigned NETgetDownloadProgress(unsigned player)
 	uint32_t progress = 100;
 	for (WZFile const &file : *files)
 	{
-		progress = std::min<uint32_t>(progress, (uint32_t)((uint64_t)file.pos * 100 / (uint64_t)std::max<uint32_t>(file.size, 1)));
+		// The host counts what the player has acknowledged, not what is still on the way.
+		const uint32_t done = player == selectedPlayer ? file.pos : file.acked;
+		progress = std::min<uint32_t>(progress, (uint32_t)((uint64_t)done * 100 / (uint64_t)std::max<uint32_t>(file.size, 1)));
 	}
 	return static_cast<unsigned>(progress);
 }
@@ -3783,7 +3962,9 @@ static void NETallowJoining()
 			{
 				char *p_buffer = tmp_connectState[i].buffer;
 
-				const auto sizeReadResult = tmp_socket[i]->readNoInt(p_buffer + tmp_connectState[i].usedBuffer, 8 - tmp_connectState[i].usedBuffer, nullptr);
+				// Only read past the version once it's known, so a client of another version can still be told so.
+				const size_t helloSize = tmp_connectState[i].usedBuffer < ClientHelloVersionSize ? ClientHelloVersionSize : ClientHelloSize;
+				const auto sizeReadResult = tmp_socket[i]->readNoInt(p_buffer + tmp_connectState[i].usedBuffer, helloSize - tmp_connectState[i].usedBuffer, nullptr);
 				if (sizeReadResult.has_value())
 				{
 					tmp_connectState[i].usedBuffer += sizeReadResult.value();
@@ -3798,7 +3979,7 @@ static void NETallowJoining()
 					NETaddSessionBanBadIP(tmp_connectState[i].ip);
 					connectFailed = true;
 				}
-				else if (tmp_connectState[i].usedBuffer >= 8)
+				else if (tmp_connectState[i].usedBuffer >= ClientHelloVersionSize)
 				{
 					// New clients send NETCODE_VERSION_MAJOR and NETCODE_VERSION_MINOR
 					// Check these numbers with our own.
@@ -3820,14 +4001,28 @@ static void NETallowJoining()
 					}
 					else if (NETisCorrectVersion(major, minor))
 					{
+						if (tmp_connectState[i].usedBuffer < ClientHelloSize)
+						{
+							// Continue to wait (until timeout) for the compression algorithms the client supports
+							continue;
+						}
+						const uint8_t clientAlgorithms = static_cast<uint8_t>(tmp_connectState[i].buffer[ClientHelloVersionSize]);
+						uint32_t clientDictionaryId = 0;
+						memcpy(&clientDictionaryId, tmp_connectState[i].buffer + ClientHelloVersionSize + sizeof(uint8_t), sizeof(uint32_t));
+						clientDictionaryId = wz_ntohl(clientDictionaryId);
+						const CompressionAlgorithm algorithm = WzCompressionProvider::Instance().chooseAlgorithm(clientAlgorithms, clientDictionaryId);
+						debug(LOG_NET, "Using compression algorithm %u for tmpSocket[%u]", static_cast<unsigned>(algorithm), i);
+
+						// Reply with the result, and the compression algorithm to use
 						result = wz_htonl(ERROR_NOERROR);
 						memcpy(&tmp_connectState[i].buffer, &result, sizeof(result));
-						const auto writeResult = tmp_socket[i]->writeAll(&tmp_connectState[i].buffer, sizeof(result), nullptr);
+						tmp_connectState[i].buffer[sizeof(result)] = static_cast<char>(algorithm);
+						const auto writeResult = tmp_socket[i]->writeAll(&tmp_connectState[i].buffer, sizeof(result) + sizeof(uint8_t), nullptr);
 						if (!writeResult.has_value())
 						{
 							debug(LOG_NET, "writeAll to tmpSocket[%u] failed with error?: %d", i, writeResult.error().value());
 						}
-						tmp_socket[i]->enableCompression();
+						tmp_socket[i]->enableCompression(algorithm);
 
 						// Connection is successful.
 						connectFailed = false;
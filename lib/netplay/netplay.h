@@ -323,7 +323,9 @@ WZ_DECL_NONNULL(1, 2) bool NETrecvNet(NETQUEUE *queue, uint8_t *type);        //
 WZ_DECL_NONNULL(1, 2) bool NETrecvGame(NETQUEUE *queue, uint8_t *type);       ///< recv a message from the game queues which is sceduled to execute by time, if possible.
 void NETflush();                                                              ///< Flushes any data stuck in compression buffers.
 
-int NETsendFile(WZFile &file, unsigned player);  ///< Send file chunk. Returns 100 when done.
+std::shared_ptr<const std::vector<uint8_t>> NETloadFileToSend(std::string const &filename, Sha256 const &hash);  ///< Contents of a file to send, shared by all downloads of it. nullptr on failure.
+void NETrequestFile(Sha256 const &hash, uint32_t offset, Sha256 const &prefixHash);  ///< Ask the host for a file, from offset on, given the hash of the first offset bytes we have. Also acknowledges the data received so far.
+int NETsendFile(WZFile &file, unsigned player);  ///< Send the file chunks the receiver has room for. Returns 100 when the receiver has acknowledged all of it.
 int NETrecvFile(NETQUEUE queue);                 ///< Receive file chunk. Returns 100 when done.
 unsigned NETgetDownloadProgress(unsigned player);     ///< Returns 100 when done.
 
@@ -339,7 +341,10 @@ void NETremRedirects();
 /// (NETrecvNet, in particular) when the operation is complete.
 void NETinitPortMapping();
 
-enum NetStatisticType {NetStatisticRawBytes, NetStatisticUncompressedBytes, NetStatisticPackets};
+enum NetStatisticType {NetStatisticRawBytes, NetStatisticUncompressedBytes, NetStatisticPackets,
+	NetStatisticSharedCompressionBytes,  ///< Bytes of host broadcasts which didn't need compressing again per connection (sent only).
+	NetStatisticSharedCompressionMicros, ///< Estimated compression time saved that way, in microseconds (sent only).
+};
 size_t NETgetStatistic(NetStatisticType type, bool sent, bool isTotal = false);     // Return some statistic. Call regularly for good results.
 
 void NETplayerKicked(UDWORD index, bool quiet = false);			// Cleanup after player has been kicked
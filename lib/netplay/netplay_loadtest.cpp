@@ -0,0 +1,553 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "netplay_loadtest.h"
+
+#include "lib/framework/frame.h"
+#include "lib/framework/physfs_ext.h"
+#include "lib/gamelib/gtime.h"
+#include "lib/netplay/client_connection.h"
+#include "lib/netplay/connection_address.h"
+#include "lib/netplay/connection_poll_group.h"
+#include "lib/netplay/connection_provider_registry.h"
+#include "lib/netplay/listen_socket.h"
+#include "lib/netplay/netplay.h"
+#include "lib/netplay/netqueue.h"
+#include "lib/netplay/netreplay.h"
+#include "lib/netplay/pending_writes_manager.h"
+#include "lib/netplay/pending_writes_manager_map.h"
+#include "lib/netplay/wz_compression_provider.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <thread>
+
+static const std::chrono::milliseconds TickInterval(1000 / GAME_UPDATES_PER_SEC);
+static const size_t ReadBufferSize = 256 * 1024;  // As NET_BUFFER_SIZE.
+static const unsigned ConnectTimeout = 5000;  // In milliseconds.
+// The game's port may be in use by a running game, try the ones after it too.
+static const unsigned PortsToTry = 100;
+// Scripted orders: a player gives an order about this often, in ticks.
+static const unsigned TicksPerOrder = 4;
+
+typedef std::chrono::steady_clock Clock;
+
+namespace
+{
+
+/// What each player sends in one tick, as sent over the network.
+typedef std::vector<std::vector<uint8_t>> TickOrders;
+
+struct Client
+{
+	Client()
+	{
+		received.setWillNeverGetMessagesForNet();
+		hostReceived.setWillNeverGetMessagesForNet();
+	}
+
+	IClientConnection *conn = nullptr;      ///< The client's end of the connection.
+	IClientConnection *hostConn = nullptr;  ///< The host's end.
+	NetQueue received;                      ///< Messages from the host.
+	NetQueue hostReceived;                  ///< Messages from this client, at the host.
+	uint32_t nextTick = 0;                  ///< Tick whose marker is expected next.
+	bool failed = false;
+};
+
+struct Statistics
+{
+	std::vector<double> tickMillis;
+	std::vector<size_t> queueBytes;
+	std::vector<size_t> queueConnections;
+	std::vector<double> latencyMillis;
+	size_t rawBytesSent = 0;
+	size_t uncompressedBytesSent = 0;
+	size_t packetsSent = 0;
+	size_t rawBytesReceived = 0;
+	size_t ticksOverrun = 0;
+};
+
+} // anonymous namespace
+
+template <typename T>
+static T percentile(std::vector<T> values, unsigned percent)
+{
+	if (values.empty())
+	{
+		return T();
+	}
+	std::sort(values.begin(), values.end());
+	return values[std::min(values.size() - 1, values.size() * percent / 100)];
+}
+
+static double millisecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void printStatistics(const char *label, Statistics const &stats, double seconds)
+{
+	const double perSecond = seconds > 0 ? 1 / seconds : 0;
+	fprintf(stdout, "%s host tick %.2f/%.2f/%.2f ms (p50/p99/max), %zu over %lld ms | queue %.1f/%.1f KB, %zu conns (p99/max) | out %.1f KB/s (%.1f KB/s uncompressed), %.0f packets/s | in %.1f KB/s | latency %.2f/%.2f/%.2f ms (p50/p99/max)\n",
+		label,
+		percentile(stats.tickMillis, 50), percentile(stats.tickMillis, 99), percentile(stats.tickMillis, 100), stats.ticksOverrun, static_cast<long long>(TickInterval.count()),
+		percentile(stats.queueBytes, 99) / 1024., percentile(stats.queueBytes, 100) / 1024., percentile(stats.queueConnections, 100),
+		stats.rawBytesSent * perSecond / 1024, stats.uncompressedBytesSent * perSecond / 1024, stats.packetsSent * perSecond,
+		stats.rawBytesReceived * perSecond / 1024,
+		percentile(stats.latencyMillis, 50), percentile(stats.latencyMillis, 99), percentile(stats.latencyMillis, 100));
+}
+
+static const char *algorithmName(CompressionAlgorithm algorithm)
+{
+	switch (algorithm)
+	{
+	case CompressionAlgorithm::Zlib: return "zlib";
+	case CompressionAlgorithm::Zstd: return "zstd";
+	case CompressionAlgorithm::ZstdDictionary: return "zstd+dictionary";
+	case CompressionAlgorithm::Lz4: return "lz4";
+	}
+	return "unknown";
+}
+
+static void appendMessage(std::vector<uint8_t> &out, uint8_t type, std::vector<uint8_t> const &payload)
+{
+	NetMessageBuilder builder(type, NetMessage::HEADER_LENGTH + payload.size());
+	builder.append(payload.data(), payload.size());
+	builder.build().rawDataAppendToVector(out);
+}
+
+static void appendUint32(std::vector<uint8_t> &out, uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+// About the size and make-up of what players send: a game time message every tick (with a CRC, which doesn't
+// compress), and now and then an order for a group of droids.
+static std::vector<TickOrders> scriptedOrders(unsigned players, unsigned ticks)
+{
+	std::vector<TickOrders> orders(ticks, TickOrders(players));
+	uint32_t random = 1;
+	auto nextRandom = [&random]() {
+		random = random * 1103515245 + 12345;
+		return random >> 8;
+	};
+	std::vector<uint8_t> payload;
+	for (unsigned tick = 0; tick < ticks; ++tick)
+	{
+		for (unsigned player = 0; player < players; ++player)
+		{
+			payload.clear();
+			appendUint32(payload, tick * GAME_TICKS_PER_UPDATE);
+			appendUint32(payload, nextRandom());
+			payload.push_back(static_cast<uint8_t>(nextRandom()));
+			appendMessage(orders[tick][player], GAME_GAME_TIME, payload);
+
+			if ((tick + player) % TicksPerOrder == 0)
+			{
+				payload.clear();
+				payload.push_back(static_cast<uint8_t>(nextRandom() % 8));  // order
+				appendUint32(payload, nextRandom() % (256 * 128));  // x
+				appendUint32(payload, nextRandom() % (256 * 128));  // y
+				const unsigned droids = 1 + nextRandom() % 16;
+				payload.push_back(static_cast<uint8_t>(droids));
+				const uint32_t firstDroid = 1000 * (player + 1) + nextRandom() % 500;
+				for (unsigned droid = 0; droid < droids; ++droid)
+				{
+					appendUint32(payload, firstDroid + droid);
+				}
+				appendMessage(orders[tick][player], GAME_DROIDINFO, payload);
+			}
+		}
+	}
+	return orders;
+}
+
+// The orders of the replays in `replayDir`. A tick ends where the first player sending a game time message sends
+// the next one. Replay players are mapped to the players here in the order they first send something.
+static std::vector<TickOrders> replayOrders(std::string const &replayDir, unsigned players)
+{
+	std::vector<TickOrders> orders;
+	WZ_PHYSFS_enumerateFiles(replayDir.c_str(), [&](const char *file) -> bool {
+		const std::string name = file;
+		if (name.size() < 5 || name.compare(name.size() - 5, 5, ".wzrp") != 0)
+		{
+			return true;  // continue
+		}
+		std::map<uint8_t, unsigned> playerMap;
+		int tickPlayer = -1;
+		orders.emplace_back(players);
+		NETreplayReadNetMessages(replayDir + "/" + name, [&](uint8_t replayPlayer, NetMessage const &message) {
+			if (message.type() == GAME_GAME_TIME)
+			{
+				if (tickPlayer < 0)
+				{
+					tickPlayer = replayPlayer;
+				}
+				else if (tickPlayer == replayPlayer)
+				{
+					orders.emplace_back(players);
+				}
+			}
+			const unsigned player = playerMap.emplace(replayPlayer, static_cast<unsigned>(playerMap.size())).first->second % players;
+			message.rawDataAppendToVector(orders.back()[player]);
+		});
+		return true;
+	});
+	fprintf(stdout, "Read %zu ticks of orders from the replays in %s\n", orders.size(), replayDir.c_str());
+	return orders;
+}
+
+// Connects a client to the host at `address`, and accepts the connection on the host's side.
+static bool connectClient(WzConnectionProvider &connProvider, IListenSocket &listenSocket, IConnectionAddress const &address, Client &client)
+{
+	auto connRes = connProvider.openClientConnectionAny(address, ConnectTimeout);
+	if (!connRes.has_value())
+	{
+		const auto errMsg = connRes.error().message();
+		fprintf(stdout, "Could not connect: %s\n", errMsg.c_str());
+		return false;
+	}
+	const auto start = Clock::now();
+	while ((client.hostConn = listenSocket.accept()) == nullptr)
+	{
+		if (millisecondsSince(start) > ConnectTimeout)
+		{
+			fprintf(stdout, "Host did not accept the connection\n");
+			connRes.value()->close();
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	client.conn = connRes.value();
+	return true;
+}
+
+// Reads everything `conn` has received into `queue`. Returns false if the connection failed.
+static bool readConnection(IClientConnection *conn, NetQueue &queue, std::vector<uint8_t> &buffer, size_t &rawBytes)
+{
+	if (!conn->readReady())
+	{
+		return true;
+	}
+	// A full buffer means the decompressor may have more, without reading from the socket.
+	net::result<ssize_t> readRes;
+	do
+	{
+		size_t received = 0;
+		readRes = conn->readNoInt(buffer.data(), buffer.size(), &received);
+		if (!readRes.has_value())
+		{
+			if (readRes.error() == std::errc::resource_unavailable_try_again || readRes.error() == std::errc::operation_would_block)
+			{
+				return true;
+			}
+			const auto errMsg = readRes.error().message();
+			fprintf(stdout, "Read from %s failed: %s\n", conn->textAddress().c_str(), errMsg.c_str());
+			return false;
+		}
+		rawBytes += received;
+		queue.writeRawData(buffer.data(), static_cast<size_t>(readRes.value()));
+	} while (static_cast<size_t>(readRes.value()) == buffer.size());
+	return true;
+}
+
+bool NETloopbackLoadTest(NetLoadTestOptions const &options)
+{
+	const unsigned players = std::min(options.players, options.clients);
+	const unsigned ticks = options.seconds * GAME_UPDATES_PER_SEC;
+	if (options.clients == 0 || ticks == 0)
+	{
+		fprintf(stdout, "Nothing to test\n");
+		return false;
+	}
+
+	std::vector<TickOrders> orders = options.replayDir.empty() ? scriptedOrders(players, ticks) : replayOrders(options.replayDir, std::max(players, 1u));
+	if (orders.empty())
+	{
+		fprintf(stdout, "No orders to send\n");
+		return false;
+	}
+
+	// As NETinit().
+	ConnectionProviderRegistry::Instance().Register(ConnectionProviderType::TCP_DIRECT);
+	auto connProvider = ConnectionProviderRegistry::Instance().Get(ConnectionProviderType::TCP_DIRECT);
+	ASSERT_OR_RETURN(false, connProvider != nullptr, "Null connectionProvider");
+	connProvider->initialize();
+	PendingWritesManager &pwm = PendingWritesManagerMap::instance().get(*connProvider);
+	pwm.initialize(*connProvider);
+
+	std::unique_ptr<IListenSocket> listenSocket;
+	uint16_t port = 0;
+	for (unsigned attempt = 0; attempt < PortsToTry && !listenSocket; ++attempt)
+	{
+		port = static_cast<uint16_t>(NETgetGameserverPort() + attempt);
+		auto listenRes = connProvider->openListenSocket(port);
+		if (listenRes.has_value())
+		{
+			listenSocket.reset(listenRes.value());
+		}
+	}
+	auto addressRes = connProvider->resolveHost("127.0.0.1", port);
+	if (!listenSocket || !addressRes.has_value())
+	{
+		fprintf(stdout, "Could not listen on localhost\n");
+		listenSocket.reset();
+		PendingWritesManagerMap::instance().Shutdown();
+		ConnectionProviderRegistry::Instance().Shutdown();
+		return false;
+	}
+
+	const CompressionAlgorithm algorithm = WzCompressionProvider::Instance().chooseAlgorithm(WzCompressionProvider::Instance().supportedAlgorithms(), WzCompressionProvider::Instance().dictionaryId());
+	std::unique_ptr<IConnectionPollGroup> clientPollGroup(connProvider->newConnectionPollGroup());
+	std::unique_ptr<IConnectionPollGroup> hostPollGroup(connProvider->newConnectionPollGroup());
+	std::vector<std::unique_ptr<Client>> clients;
+	bool success = true;
+	for (unsigned i = 0; i < options.clients && success; ++i)
+	{
+		clients.emplace_back(new Client());
+		Client &client = *clients.back();
+		success = connectClient(*connProvider, *listenSocket, *addressRes.value(), client);
+		if (success)
+		{
+			client.conn->useNagleAlgorithm(false);
+			client.hostConn->useNagleAlgorithm(false);
+			client.conn->enableCompression(algorithm);
+			client.hostConn->enableCompression(algorithm);
+			clientPollGroup->add(client.conn);
+			if (i < players)
+			{
+				hostPollGroup->add(client.hostConn);
+			}
+		}
+	}
+	fprintf(stdout, "Connected %zu clients (%u players) on port %u, compressed with %s (measuring the transport layer only, through a relay host)\n", clients.size(), players, static_cast<unsigned>(port), algorithmName(algorithm));
+
+	// As NETsend() for broadcast messages: compressed once, if the algorithm can.
+	auto broadcastCompressor = WzCompressionProvider::Instance().newCompressionAdapter(algorithm);
+	if (!broadcastCompressor || !broadcastCompressor->initialize().has_value() || !broadcastCompressor->supportsSharedBlocks())
+	{
+		broadcastCompressor = nullptr;
+	}
+	std::vector<uint8_t> broadcastBlock;
+
+	Statistics total;
+	Statistics second;
+	std::vector<Clock::time_point> tickStarts;
+	std::vector<uint8_t> readBuffer(ReadBufferSize);
+	std::vector<std::pair<unsigned, std::vector<uint8_t>>> relay;  // (sender, message)
+	std::vector<uint8_t> marker;
+	const auto testStart = Clock::now();
+	auto secondStart = testStart;
+	auto nextTickTime = testStart;
+
+	// Host receives from the players, and sends on what they sent, plus a marker to measure the latency with.
+	// This stands in for the real host's message handling, see netplay_loadtest.h.
+	auto hostTick = [&](uint32_t tick) {
+		const auto tickStart = Clock::now();
+		tickStarts.push_back(tickStart);
+		size_t rawBytesReceived = 0;
+		relay.clear();
+		if (players > 0 && hostPollGroup->checkConnectionsReadable(std::chrono::milliseconds(0)).value_or(0) > 0)
+		{
+			for (unsigned player = 0; player < players; ++player)
+			{
+				Client &client = *clients[player];
+				client.failed = client.failed || !readConnection(client.hostConn, client.hostReceived, readBuffer, rawBytesReceived);
+				for (; client.hostReceived.haveMessage(); client.hostReceived.popMessage())
+				{
+					NetMessage const &message = client.hostReceived.getMessage();
+					relay.emplace_back(player, std::vector<uint8_t>(message.rawData().begin(), message.rawData().end()));
+				}
+			}
+		}
+		marker.clear();
+		appendUint32(marker, tick);
+		relay.emplace_back(UINT32_MAX, std::vector<uint8_t>());
+		appendMessage(relay.back().second, NET_PING, marker);
+
+		size_t rawBytesSent = 0;
+		size_t uncompressedBytesSent = 0;
+		size_t packetsSent = 0;
+		for (auto const &message : relay)
+		{
+			const bool shared = broadcastCompressor && clients.size() >= 2 && broadcastCompressor->encodeSharedBlock(message.second.data(), message.second.size(), broadcastBlock).has_value();
+			for (unsigned i = 0; i < clients.size(); ++i)
+			{
+				if (i == message.first)
+				{
+					continue;  // Players don't get their own orders back, as with NETQUEUE::exclude.
+				}
+				size_t rawBytes = 0;
+				bool usedSharedBlock = false;
+				const auto writeRes = shared
+					? clients[i]->hostConn->writeAllShared(message.second.data(), message.second.size(), broadcastBlock, &rawBytes, &usedSharedBlock)
+					: clients[i]->hostConn->writeAll(message.second.data(), message.second.size(), &rawBytes);
+				clients[i]->failed = clients[i]->failed || !writeRes.has_value();
+				rawBytesSent += rawBytes;
+				uncompressedBytesSent += message.second.size();
+				++packetsSent;
+			}
+		}
+		for (auto &client : clients)
+		{
+			size_t rawBytes = 0;
+			client->failed = client->failed || !client->hostConn->flush(&rawBytes).has_value();
+			rawBytesSent += rawBytes;
+		}
+
+		const double tickMillis = millisecondsSince(tickStart);
+		const PendingWritesManager::QueueDepth depth = pwm.queueDepth();
+		for (Statistics *stats : {&total, &second})
+		{
+			stats->tickMillis.push_back(tickMillis);
+			stats->queueBytes.push_back(depth.bytes);
+			stats->queueConnections.push_back(depth.connections);
+			stats->rawBytesSent += rawBytesSent;
+			stats->uncompressedBytesSent += uncompressedBytesSent;
+			stats->packetsSent += packetsSent;
+			stats->rawBytesReceived += rawBytesReceived;
+			stats->ticksOverrun += tickMillis > TickInterval.count() ? 1 : 0;
+		}
+	};
+
+	// Clients read what the host sent until `until`, timing the markers.
+	auto clientsRead = [&](Clock::time_point until) {
+		do
+		{
+			const auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(until - Clock::now());
+			if (clientPollGroup->checkConnectionsReadable(std::max(timeout, std::chrono::milliseconds(0))).value_or(0) <= 0)
+			{
+				continue;
+			}
+			for (auto &client : clients)
+			{
+				size_t rawBytes = 0;
+				client->failed = client->failed || !readConnection(client->conn, client->received, readBuffer, rawBytes);
+				for (; client->received.haveMessage(); client->received.popMessage())
+				{
+					NetMessage const &message = client->received.getMessage();
+					if (message.type() != NET_PING || message.payloadSize() != 4)
+					{
+						continue;
+					}
+					const uint8_t *payload = message.payload();
+					const uint32_t tick = (uint32_t(payload[0]) << 24) | (uint32_t(payload[1]) << 16) | (uint32_t(payload[2]) << 8) | payload[3];
+					if (tick != client->nextTick || tick >= tickStarts.size())
+					{
+						fprintf(stdout, "Client got the marker of tick %u, expected %u\n", static_cast<unsigned>(tick), static_cast<unsigned>(client->nextTick));
+						client->failed = true;
+						continue;
+					}
+					client->nextTick = tick + 1;
+					const double latencyMillis = millisecondsSince(tickStarts[tick]);
+					total.latencyMillis.push_back(latencyMillis);
+					second.latencyMillis.push_back(latencyMillis);
+				}
+			}
+		} while (Clock::now() < until);
+	};
+
+	for (uint32_t tick = 0; tick < ticks && success; ++tick)
+	{
+		hostTick(tick);
+
+		// The players' orders arrive at the host in time for its next tick.
+		TickOrders const &tickOrders = orders[tick % orders.size()];
+		for (unsigned player = 0; player < players; ++player)
+		{
+			if (tickOrders[player].empty())
+			{
+				continue;
+			}
+			size_t rawBytes = 0;
+			IClientConnection *conn = clients[player]->conn;
+			clients[player]->failed = clients[player]->failed || !conn->writeAll(tickOrders[player].data(), tickOrders[player].size(), &rawBytes).has_value() || !conn->flush(&rawBytes).has_value();
+		}
+
+		nextTickTime += TickInterval;
+		clientsRead(nextTickTime);
+
+		if (Clock::now() - secondStart >= std::chrono::seconds(1))
+		{
+			char label[32];
+			snprintf(label, sizeof(label), "%4llds", static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - testStart).count()));
+			printStatistics(label, second, std::chrono::duration<double>(Clock::now() - secondStart).count());
+			second = Statistics();
+			secondStart = Clock::now();
+		}
+
+		success = std::none_of(clients.begin(), clients.end(), [](std::unique_ptr<Client> const &client) { return client->failed; });
+	}
+	const double testSeconds = std::chrono::duration<double>(Clock::now() - testStart).count();
+
+	// Let the last markers arrive.
+	const auto drainUntil = Clock::now() + std::chrono::seconds(1);
+	while (Clock::now() < drainUntil && std::any_of(clients.begin(), clients.end(), [&](std::unique_ptr<Client> const &client) { return client->nextTick < tickStarts.size(); }))
+	{
+		clientsRead(std::min(drainUntil, Clock::now() + TickInterval));
+	}
+
+	size_t missing = 0;
+	for (auto const &client : clients)
+	{
+		missing += tickStarts.size() - client->nextTick;
+		success = success && !client->failed;
+	}
+	printStatistics("total", total, testSeconds);
+	if (missing > 0)
+	{
+		fprintf(stdout, "%zu tick markers didn't arrive\n", missing);
+		success = false;
+	}
+
+	// Wait for the writes to finish, so that closing doesn't leave the connections to the pending writes thread.
+	const auto flushUntil = Clock::now() + std::chrono::seconds(1);
+	while (pwm.queueDepth().connections > 0 && Clock::now() < flushUntil)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	for (unsigned i = 0; i < clients.size(); ++i)
+	{
+		if (clients[i]->conn)
+		{
+			clientPollGroup->remove(clients[i]->conn);
+			clients[i]->conn->close();
+		}
+		if (clients[i]->hostConn)
+		{
+			if (i < players)
+			{
+				hostPollGroup->remove(clients[i]->hostConn);
+			}
+			clients[i]->hostConn->close();
+		}
+	}
+	clientPollGroup.reset();
+	hostPollGroup.reset();
+	listenSocket.reset();
+	PendingWritesManagerMap::instance().Shutdown();
+	ConnectionProviderRegistry::Instance().Shutdown();
+
+	fprintf(stdout, "%s\n", success ? "PASS" : "FAIL");
+	return success;
+}
@@ -0,0 +1,52 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file netplay_loadtest.h
+ * Headless load test of the transport layer the host sends through: a host and synthetic clients in one process,
+ * connected over localhost TCP.
+ *
+ * The host here is a relay written on top of the transport (connections, `NetQueue`, compression and
+ * `PendingWritesManager`, used as `NETsend()` and `NETflush()` use them), not the game's own host in netplay.cpp.
+ * NetPlay's state is global to the process, so the clients can't be real players joining it. So what's measured
+ * is the transport: the host's lobby and game message handling, such as `NETrecvNet()` and message dispatch, isn't
+ * included.
+ */
+
+#pragma once
+
+#include <string>
+
+struct NetLoadTestOptions
+{
+	unsigned clients = 10;   ///< Connections to the host, players included.
+	unsigned players = 2;    ///< How many of the clients send orders, the others only watch.
+	unsigned seconds = 30;
+	std::string replayDir;   ///< PhysFS directory with replays (`.wzrp`) to take the orders from. Scripted orders if empty.
+};
+
+/// Connects `clients` clients to a host over localhost, with the best compression this build supports. Every game
+/// tick the players send their orders to the host, which sends them on to every client, as in a game (but through
+/// the relay described above, not the real host).
+///
+/// Prints, every second and for the whole run: the time the host spends on each tick (reading, compressing and
+/// queuing, which doesn't block, so is about the CPU time), the `PendingWritesManager` queue depth after each tick,
+/// the bytes and packets (`writeAll()` calls) per second the host sends, and the latency from the start of a host
+/// tick until each client has received that tick's messages.
+///
+/// Returns false if the clients couldn't connect, a connection failed, or messages went missing.
+bool NETloopbackLoadTest(NetLoadTestOptions const &options);
@@ -23,6 +23,7 @@
 #include "lib/framework/frame.h"
 #include "lib/framework/physfs_ext.h"
 #include "lib/framework/wzapp.h"
+#include "lib/framework/task_scheduler.h"
 #include "lib/gamelib/gtime.h"
 
 #if defined(__clang__)
@@ -41,9 +42,12 @@
 #  pragma GCC diagnostic pop
 #endif
 
+#include <algorithm>
 #include <ctime>
 #include <memory>
 
+#include <zlib.h>
+
 #include "netreplay.h"
 #include "netplay.h"
 
@@ -51,38 +55,94 @@ static PHYSFS_file *replaySaveHandle = nullptr;
 static PHYSFS_file *replayLoadHandle = nullptr;
 
 static const uint32_t magicReplayNumber = 0x575A7270;  // "WZrp"
-static const uint32_t currentReplayFormatVer = 3;
+static const uint32_t currentReplayFormatVer = 4;  // v4: GameState keyframes in the message stream, and their index in the end of game info
 static const uint32_t minReplayFormatVerSupported = 3;
 static const size_t DefaultReplayBufferSize = 32768;
 static const size_t MaxReplayBufferSize = 2 * 1024 * 1024;
+static const uint32_t ReplayKeyframeInterval = 2 * 60 * GAME_TICKS_PER_SEC;
+static const uint32_t MaxReplayKeyframeSize = 256 * 1024 * 1024;
+static const uint8_t ReplayKeyframeMarker = 0xFF;  // Written instead of a player index before a keyframe record.
+
+// A keyframe record is ReplayKeyframeMarker, then the game time, the size of the GameState and the size of the
+// compressed GameState (all big endian uint32_t), then the GameState compressed with zlib.
+struct ReplayKeyframeIndexEntry
+{
+	uint32_t gameTime;
+	uint64_t offset;  ///< Of the keyframe record, from the start of the message stream.
+};
 
 typedef std::vector<uint8_t> SerializedNetMessagesBuffer;
-static moodycamel::BlockingReaderWriterQueue<SerializedNetMessagesBuffer> serializedBufferWriteQueue(256);
+struct ReplayWriteItem
+{
+	SerializedNetMessagesBuffer buffer;
+	std::string keyframe;  ///< If not empty, a GameState to write as a keyframe instead of the buffer.
+	uint32_t keyframeGameTime = 0;
+};
+static moodycamel::BlockingReaderWriterQueue<ReplayWriteItem> serializedBufferWriteQueue(256);
 static nlohmann::json queuedSaveSettings;
 static SerializedNetMessagesBuffer latestWriteBuffer;
 static size_t minBufferSizeToQueue = DefaultReplayBufferSize;
-static WZ_THREAD *saveThread = nullptr;
-
-// This function is run in its own thread! Do not call any non-threadsafe functions!
-static int replaySaveThreadFunc(void *data)
+static TaskStrand replaySaveStrand(TaskPriority::Low);  ///< Writes queued buffers in the background, one task at a time.
+static bool replaySaveInBackground = false;
+static bool replaySaveKeyframes = false;
+static uint32_t replayNextKeyframeTime = 0;
+// Only used by whoever is writing the queued buffers, or after waiting for them to be written.
+static uint64_t replayStreamBytesWritten = 0;
+static std::vector<ReplayKeyframeIndexEntry> replaySaveKeyframeIndex;
+
+static uint32_t replayLoadFormatVer = 0;
+static PHYSFS_sint64 replayLoadStreamStart = 0;
+static std::vector<ReplayKeyframeIndexEntry> replayLoadKeyframeIndex;
+
+static void replayWriteKeyframe(uint32_t keyframeGameTime, std::string const &keyframe)
 {
-	PHYSFS_file *pSaveHandle = (PHYSFS_file *)data;
-	if (pSaveHandle == nullptr)
+	uLongf compressedSize = compressBound(static_cast<uLong>(keyframe.size()));
+	std::vector<uint8_t> compressed(compressedSize);
+	if (compress2(compressed.data(), &compressedSize, reinterpret_cast<Bytef const *>(keyframe.data()), static_cast<uLong>(keyframe.size()), Z_BEST_SPEED) != Z_OK)
 	{
-		return 1;
+		debug(LOG_ERROR, "Failed to compress replay keyframe at gameTime %u", keyframeGameTime);
+		return;
 	}
-	SerializedNetMessagesBuffer item;
-	while (true)
+
+	replaySaveKeyframeIndex.push_back({keyframeGameTime, replayStreamBytesWritten});
+	WZ_PHYSFS_writeBytes(replaySaveHandle, &ReplayKeyframeMarker, 1);
+	PHYSFS_writeUBE32(replaySaveHandle, keyframeGameTime);
+	PHYSFS_writeUBE32(replaySaveHandle, static_cast<uint32_t>(keyframe.size()));
+	PHYSFS_writeUBE32(replaySaveHandle, static_cast<uint32_t>(compressedSize));
+	WZ_PHYSFS_writeBytes(replaySaveHandle, compressed.data(), static_cast<PHYSFS_uint32>(compressedSize));
+	replayStreamBytesWritten += 1 + 3 * sizeof(uint32_t) + compressedSize;
+}
+
+// This function is run as a task on any thread (one at a time)! Do not call any non-threadsafe functions!
+static void replayWriteQueuedBuffers()
+{
+	ReplayWriteItem item;
+	while (serializedBufferWriteQueue.try_dequeue(item))
 	{
-		serializedBufferWriteQueue.wait_dequeue(item);
-		if (item.empty())
+		if (!item.keyframe.empty())
 		{
-			// end chunk - we're done
-			break;
+			replayWriteKeyframe(item.keyframeGameTime, item.keyframe);
+			continue;
 		}
-		WZ_PHYSFS_writeBytes(pSaveHandle, item.data(), item.size());
+		WZ_PHYSFS_writeBytes(replaySaveHandle, item.buffer.data(), item.buffer.size());
+		replayStreamBytesWritten += item.buffer.size();
 	}
-	return 0;
+}
+
+static void replayQueueItem(ReplayWriteItem &&item)
+{
+	serializedBufferWriteQueue.enqueue(std::move(item));
+	if (replaySaveInBackground)
+	{
+		replaySaveStrand.submit(replayWriteQueuedBuffers);
+	}
+}
+
+static void replayQueueBuffer(SerializedNetMessagesBuffer &&buffer)
+{
+	ReplayWriteItem item;
+	item.buffer = std::move(buffer);
+	replayQueueItem(std::move(item));
 }
 
 static bool NETreplaySaveWritePreamble(const nlohmann::json& settings, ReplayOptionsHandler const &optionsHandler)
@@ -116,7 +176,7 @@ static bool NETreplaySaveWritePreamble(const nlohmann::json& settings, ReplayOpt
 	return true;
 }
 
-std::string NETreplaySaveStart(std::string const& subdir, ReplayOptionsHandler const &optionsHandler, int maxReplaysSaved, bool appendPlayerToFilename)
+std::string NETreplaySaveStart(std::string const& subdir, ReplayOptionsHandler const &optionsHandler, int maxReplaysSaved, bool appendPlayerToFilename, bool saveKeyframes)
 {
 	if (NETisReplay())
 	{
@@ -198,25 +258,28 @@ std::string NETreplaySaveStart(std::string const& subdir, ReplayOptionsHandler c
 
 	debug(LOG_INFO, "Started writing replay file \"%s\".", filename.c_str());
 
-	// Create a background thread and hand off all responsibility for writing to the file handle to it
-	ASSERT(saveThread == nullptr, "Failed to release prior thread");
+	// Hand off all responsibility for writing to the file handle to background tasks
+	ASSERT(replaySaveStrand.pending() == 0, "Failed to finish prior replay");
 	latestWriteBuffer.reserve(minBufferSizeToQueue);
+	replaySaveKeyframes = saveKeyframes;
+	replayNextKeyframeTime = ReplayKeyframeInterval;
+	replayStreamBytesWritten = 0;
+	replaySaveKeyframeIndex.clear();
 	if (desiredBufferSize != std::numeric_limits<size_t>::max())
 	{
 		// Write the preamble immediately (settings, etc)
 		NETreplaySaveWritePreamble(settings, optionsHandler);
 
-		// use a background thread
-		saveThread = wzThreadCreate(replaySaveThreadFunc, replaySaveHandle, "replaySaveThread");
-		wzThreadStart(saveThread);
+		// write in the background
+		replaySaveInBackground = true;
 	}
 	else
 	{
 		// Do not immediately write settings out - instead, queue them for later writing
 		queuedSaveSettings = std::move(settings);
 
-		// don't use a background thread
-		saveThread = nullptr;
+		// don't write in the background
+		replaySaveInBackground = false;
 	}
 
 	return filename;
@@ -237,18 +300,15 @@ bool NETreplaySaveStop(ReplayOptionsHandler const &optionsHandler)
 	// Queue the last chunk for writing
 	if (!latestWriteBuffer.empty())
 	{
-		serializedBufferWriteQueue.enqueue(std::move(latestWriteBuffer));
+		replayQueueBuffer(std::move(latestWriteBuffer));
 	}
+	latestWriteBuffer = SerializedNetMessagesBuffer();
 
-	// Then push one empty chunk to signify "we're done!"
-	latestWriteBuffer.resize(0);
-	serializedBufferWriteQueue.enqueue(std::move(latestWriteBuffer));
-
-	// Wait for writing thread to finish
-	if (saveThread)
+	// Wait for the background writing to finish
+	if (replaySaveInBackground)
 	{
-		wzThreadJoin(saveThread);
-		saveThread = nullptr;
+		replaySaveStrand.wait();
+		replaySaveInBackground = false;
 	}
 	else
 	{
@@ -259,13 +319,21 @@ bool NETreplaySaveStop(ReplayOptionsHandler const &optionsHandler)
 		NETreplaySaveWritePreamble(queuedSaveSettings, optionsHandler);
 
 		// do the writing now on the main thread
-		replaySaveThreadFunc(replaySaveHandle);
+		replayWriteQueuedBuffers();
 	}
 
 	// v2: Write the "end of game info" chunk
 	// (this is JSON that is preceded *and* followed by its size - so it should be possible to seek to the end of the file, read the last uint32_t, and then back up and grab the JSON without processing the whole file)
 	nlohmann::json endOfGameInfo = nlohmann::json::object();
 	endOfGameInfo["gameTimeElapsed"] = gameTime;
+	// v4: Where the keyframes are, so a seek doesn't have to read the whole message stream
+	nlohmann::json keyframes = nlohmann::json::array();
+	for (auto const &entry : replaySaveKeyframeIndex)
+	{
+		keyframes.push_back(nlohmann::json::array({entry.gameTime, entry.offset}));
+	}
+	endOfGameInfo["keyframes"] = std::move(keyframes);
+	replaySaveKeyframeIndex.clear();
 	// FUTURE TODO: Could save things like the game results / winners + losers
 
 	auto data = endOfGameInfo.dump();
@@ -297,13 +365,119 @@ void NETreplaySaveNetMessage(NetMessage const *message, uint8_t player)
 
 		if (latestWriteBuffer.size() >= minBufferSizeToQueue)
 		{
-			serializedBufferWriteQueue.enqueue(std::move(latestWriteBuffer));
+			replayQueueBuffer(std::move(latestWriteBuffer));
 			latestWriteBuffer = std::vector<uint8_t>();
 			latestWriteBuffer.reserve(minBufferSizeToQueue);
 		}
 	}
 }
 
+bool NETreplaySaveWantsKeyframe(uint32_t currentGameTime)
+{
+	return replaySaveHandle != nullptr && replaySaveKeyframes && currentGameTime >= replayNextKeyframeTime;
+}
+
+void NETreplaySaveKeyframe(uint32_t keyframeGameTime, std::string &&keyframe)
+{
+	if (!replaySaveHandle || keyframe.empty())
+	{
+		return;
+	}
+	ASSERT_OR_RETURN(, keyframe.size() <= MaxReplayKeyframeSize, "Replay keyframe is way too big");
+	replayNextKeyframeTime = keyframeGameTime + ReplayKeyframeInterval;
+
+	// The keyframe goes after every message saved so far
+	if (!latestWriteBuffer.empty())
+	{
+		replayQueueBuffer(std::move(latestWriteBuffer));
+		latestWriteBuffer = SerializedNetMessagesBuffer();
+		latestWriteBuffer.reserve(minBufferSizeToQueue);
+	}
+
+	ReplayWriteItem item;
+	item.keyframe = std::move(keyframe);
+	item.keyframeGameTime = keyframeGameTime;
+	replayQueueItem(std::move(item));
+}
+
+// Reads the keyframe index from the end of game info, which ends the file. Replays without one (such as
+// incomplete ones) just can't seek.
+static std::vector<ReplayKeyframeIndexEntry> replayReadKeyframeIndex()
+{
+	std::vector<ReplayKeyframeIndexEntry> index;
+	PHYSFS_sint64 fileLength = PHYSFS_fileLength(replayLoadHandle);
+	if (fileLength < replayLoadStreamStart + static_cast<PHYSFS_sint64>(2 * sizeof(uint32_t)))
+	{
+		return index;
+	}
+	uint32_t dataSize = 0;
+	if (PHYSFS_seek(replayLoadHandle, fileLength - sizeof(uint32_t)) == 0 || !PHYSFS_readUBE32(replayLoadHandle, &dataSize))
+	{
+		return index;
+	}
+	PHYSFS_sint64 dataStart = fileLength - sizeof(uint32_t) - static_cast<PHYSFS_sint64>(dataSize);
+	if (dataStart - static_cast<PHYSFS_sint64>(sizeof(uint32_t)) < replayLoadStreamStart || PHYSFS_seek(replayLoadHandle, dataStart) == 0)
+	{
+		return index;
+	}
+	std::string data;
+	data.resize(dataSize);
+	if (WZ_PHYSFS_readBytes(replayLoadHandle, &data[0], dataSize) != dataSize)
+	{
+		return index;
+	}
+
+	try
+	{
+		nlohmann::json endOfGameInfo = nlohmann::json::parse(data);
+		for (auto const &entry : endOfGameInfo.at("keyframes"))
+		{
+			index.push_back({entry.at(0).get<uint32_t>(), entry.at(1).get<uint64_t>()});
+		}
+	}
+	catch (const std::exception& e)
+	{
+		debug(LOG_INFO, "No replay keyframe index: %s", e.what());
+		index.clear();
+		return index;
+	}
+	if (!std::is_sorted(index.begin(), index.end(), [](ReplayKeyframeIndexEntry const &a, ReplayKeyframeIndexEntry const &b) { return a.gameTime < b.gameTime; }))
+	{
+		debug(LOG_ERROR, "Replay keyframe index is not in order");
+		index.clear();
+	}
+	return index;
+}
+
+// Reads the rest of a keyframe record, after ReplayKeyframeMarker. Skips the GameState if state is nullptr.
+static bool replayReadKeyframe(uint32_t &keyframeGameTime, std::string *state)
+{
+	uint32_t stateSize = 0;
+	uint32_t compressedSize = 0;
+	if (!PHYSFS_readUBE32(replayLoadHandle, &keyframeGameTime) || !PHYSFS_readUBE32(replayLoadHandle, &stateSize) || !PHYSFS_readUBE32(replayLoadHandle, &compressedSize))
+	{
+		return false;
+	}
+	if (state == nullptr)
+	{
+		PHYSFS_sint64 filePos = PHYSFS_tell(replayLoadHandle);
+		return filePos >= 0 && PHYSFS_seek(replayLoadHandle, filePos + compressedSize) != 0;
+	}
+	if (stateSize > MaxReplayKeyframeSize || compressedSize > compressBound(stateSize))
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> compressed(compressedSize);
+	if (WZ_PHYSFS_readBytes(replayLoadHandle, compressed.data(), compressedSize) != compressedSize)
+	{
+		return false;
+	}
+	state->resize(stateSize);
+	uLongf uncompressedSize = stateSize;
+	return uncompress(reinterpret_cast<Bytef *>(&(*state)[0]), &uncompressedSize, compressed.data(), compressedSize) == Z_OK && uncompressedSize == stateSize;
+}
+
 bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optionsHandler, uint32_t& output_replayFormatVer)
 {
 	auto onFail = [&](char const *reason) {
@@ -346,6 +520,7 @@ bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optio
 
 		uint32_t replayFormatVer = settings.at("replayFormatVer").get<uint32_t>();
 		output_replayFormatVer = replayFormatVer;
+		replayLoadFormatVer = replayFormatVer;
 		if (replayFormatVer > currentReplayFormatVer)
 		{
 			std::string mismatchVersionDescription = _("The replay file format is newer than this version of Warzone 2100 can support.");
@@ -411,6 +586,21 @@ bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optio
 			}
 		}
 
+		replayLoadKeyframeIndex.clear();
+		if (replayFormatVer >= 4)
+		{
+			replayLoadStreamStart = PHYSFS_tell(replayLoadHandle);
+			if (replayLoadStreamStart < 0)
+			{
+				return onFail("error getting current file position");
+			}
+			replayLoadKeyframeIndex = replayReadKeyframeIndex();
+			if (PHYSFS_seek(replayLoadHandle, replayLoadStreamStart) == 0)
+			{
+				return onFail("failed to seek to the start of the messages");
+			}
+		}
+
 		// Load game options using optionsHandler
 		if (!optionsHandler.restoreOptions(settings.at("gameOptions"), std::move(embeddedMapData), replay_netcodeMajor, replay_netcodeMinor))
 		{
@@ -436,6 +626,16 @@ bool NETreplayLoadNetMessage(std::unique_ptr<NetMessage> &message, uint8_t &play
 	}
 
 	WZ_PHYSFS_readBytes(replayLoadHandle, &player, 1);
+	while (player == ReplayKeyframeMarker && replayLoadFormatVer >= 4)
+	{
+		// Only needed when seeking
+		uint32_t keyframeGameTime = 0;
+		if (!replayReadKeyframe(keyframeGameTime, nullptr))
+		{
+			return false;
+		}
+		WZ_PHYSFS_readBytes(replayLoadHandle, &player, 1);
+	}
 
 	uint8_t type;
 	WZ_PHYSFS_readBytes(replayLoadHandle, &type, 1);
@@ -466,6 +666,43 @@ bool NETreplayLoadNetMessage(std::unique_ptr<NetMessage> &message, uint8_t &play
 	return (message->type() > GAME_MIN_TYPE && message->type() < GAME_MAX_TYPE) || message->type() == REPLAY_ENDED;
 }
 
+bool NETreplayLoadSeek(uint32_t targetGameTime, uint32_t &keyframeGameTime, std::string &state)
+{
+	if (!replayLoadHandle)
+	{
+		return false;
+	}
+
+	auto it = std::upper_bound(replayLoadKeyframeIndex.begin(), replayLoadKeyframeIndex.end(), targetGameTime, [](uint32_t time, ReplayKeyframeIndexEntry const &entry) {
+		return time < entry.gameTime;
+	});
+	if (it == replayLoadKeyframeIndex.begin())
+	{
+		return false;  // No keyframe early enough.
+	}
+	--it;
+
+	PHYSFS_sint64 filePos = PHYSFS_tell(replayLoadHandle);
+	uint8_t marker = 0;
+	if (filePos >= 0
+		&& PHYSFS_seek(replayLoadHandle, replayLoadStreamStart + it->offset) != 0
+		&& WZ_PHYSFS_readBytes(replayLoadHandle, &marker, 1) == 1 && marker == ReplayKeyframeMarker
+		&& replayReadKeyframe(keyframeGameTime, &state) && keyframeGameTime == it->gameTime)
+	{
+		return true;
+	}
+
+	debug(LOG_ERROR, "Could not read replay keyframe at gameTime %u", it->gameTime);
+	state.clear();
+	if (filePos < 0 || PHYSFS_seek(replayLoadHandle, filePos) == 0)
+	{
+		// Can't even play from the start
+		PHYSFS_close(replayLoadHandle);
+		replayLoadHandle = nullptr;
+	}
+	return false;
+}
+
 bool NETreplayLoadStop()
 {
 	if (!replayLoadHandle)
@@ -479,6 +716,107 @@ bool NETreplayLoadStop()
 		return false;
 	}
 	replayLoadHandle = nullptr;
+	replayLoadKeyframeIndex.clear();
 
 	return true;
 }
+
+bool NETreplayReadNetMessages(std::string const &filename, std::function<void (uint8_t player, NetMessage const &message)> const &handler)
+{
+	PHYSFS_file *handle = PHYSFS_openRead(filename.c_str());
+	if (handle == nullptr)
+	{
+		debug(LOG_ERROR, "Could not open replay file %s: %s", filename.c_str(), WZ_PHYSFS_getLastError());
+		return false;
+	}
+	auto closeHandle = [handle](bool result) {
+		PHYSFS_close(handle);
+		return result;
+	};
+
+	int32_t replayNumber = 0;
+	uint32_t dataSize = 0;
+	if (!PHYSFS_readSBE32(handle, &replayNumber) || (uint32_t)replayNumber != magicReplayNumber || !PHYSFS_readUBE32(handle, &dataSize))
+	{
+		debug(LOG_ERROR, "%s: bad header", filename.c_str());
+		return closeHandle(false);
+	}
+	std::string data;
+	data.resize(dataSize);
+	if (WZ_PHYSFS_readBytes(handle, &data[0], dataSize) != dataSize)
+	{
+		debug(LOG_ERROR, "%s: truncated header", filename.c_str());
+		return closeHandle(false);
+	}
+	uint32_t replayFormatVer = 0;
+	try
+	{
+		replayFormatVer = nlohmann::json::parse(data).at("replayFormatVer").get<uint32_t>();
+	}
+	catch (const std::exception& e)
+	{
+		debug(LOG_ERROR, "%s: bad header: %s", filename.c_str(), e.what());
+		return closeHandle(false);
+	}
+	if (replayFormatVer < minReplayFormatVerSupported || replayFormatVer > currentReplayFormatVer)
+	{
+		debug(LOG_ERROR, "%s: unsupported replay format version %" PRIu32, filename.c_str(), replayFormatVer);
+		return closeHandle(false);
+	}
+	if (replayFormatVer >= 2)
+	{
+		// Skip the embedded map data
+		uint32_t mapDataVersion = 0;
+		uint32_t mapDataSize = 0;
+		PHYSFS_sint64 filePos = -1;
+		if (!PHYSFS_readUBE32(handle, &mapDataVersion) || !PHYSFS_readUBE32(handle, &mapDataSize)
+			|| (filePos = PHYSFS_tell(handle)) < 0 || PHYSFS_seek(handle, filePos + mapDataSize) == 0)
+		{
+			debug(LOG_ERROR, "%s: truncated map data", filename.c_str());
+			return closeHandle(false);
+		}
+	}
+
+	std::vector<uint8_t> payload;
+	uint8_t player = 0;
+	while (WZ_PHYSFS_readBytes(handle, &player, 1) == 1)
+	{
+		if (player == ReplayKeyframeMarker && replayFormatVer >= 4)
+		{
+			uint32_t keyframeGameTime = 0;
+			uint32_t stateSize = 0;
+			uint32_t compressedSize = 0;
+			PHYSFS_sint64 filePos = -1;
+			if (!PHYSFS_readUBE32(handle, &keyframeGameTime) || !PHYSFS_readUBE32(handle, &stateSize) || !PHYSFS_readUBE32(handle, &compressedSize)
+				|| (filePos = PHYSFS_tell(handle)) < 0 || PHYSFS_seek(handle, filePos + compressedSize) == 0)
+			{
+				break;
+			}
+			continue;
+		}
+
+		uint8_t header[3];  // Type, then the payload length (network byte order).
+		if (WZ_PHYSFS_readBytes(handle, header, sizeof(header)) != sizeof(header))
+		{
+			break;
+		}
+		uint16_t len = 0;
+		wz_ntohs_load_unaligned(len, header + 1);
+		payload.resize(len);
+		if (WZ_PHYSFS_readBytes(handle, payload.data(), len) != len)
+		{
+			break;
+		}
+
+		NetMessageBuilder msgBuilder(header[0], len);
+		msgBuilder.append(payload.data(), len);
+		const NetMessage message = msgBuilder.build();
+		if (message.type() == REPLAY_ENDED)
+		{
+			break;
+		}
+		handler(player, message);
+	}
+
+	return closeHandle(true);
+}
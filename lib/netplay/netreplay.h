@@ -25,12 +25,24 @@
 #include "netplay.h"
 
 
-std::string NETreplaySaveStart(std::string const& subdir, ReplayOptionsHandler const &optionsHandler, int maxReplaysSaved, bool appendPlayerToFilename = false);
+/// Keyframes cost a full GameState serialization on the game thread every few minutes, so they are only saved if saveKeyframes is set.
+std::string NETreplaySaveStart(std::string const& subdir, ReplayOptionsHandler const &optionsHandler, int maxReplaysSaved, bool appendPlayerToFilename = false, bool saveKeyframes = false);
 bool NETreplaySaveStop(ReplayOptionsHandler const &optionsHandler);
 void NETreplaySaveNetMessage(NetMessage const *message, uint8_t player);
+/// Whether it's time to save a GameState keyframe, so viewers can seek to about this point without re-simulating everything before it.
+bool NETreplaySaveWantsKeyframe(uint32_t currentGameTime);
+/// Saves a serialized GameState, as of the end of the game tick at keyframeGameTime, after all messages saved so far.
+void NETreplaySaveKeyframe(uint32_t keyframeGameTime, std::string &&keyframe);
 
 bool NETreplayLoadStart(std::string const &filename, ReplayOptionsHandler& optionsHandler, uint32_t& output_replayFormatVer);
 bool NETreplayLoadNetMessage(std::unique_ptr<NetMessage> &message, uint8_t &player);
+/// Call right after NETreplayLoadStart(). Reads the last keyframe at or before targetGameTime, and continues loading messages from there.
+/// Returns false, and keeps loading from the start, if there is no such keyframe.
+bool NETreplayLoadSeek(uint32_t targetGameTime, uint32_t &keyframeGameTime, std::string &state);
 bool NETreplayLoadStop();
 
+/// Reads the net messages of a replay, from the start up to the end of the game (or of the file), without loading it:
+/// for tools which just want the messages. Returns false if the file is not a replay which can be read.
+bool NETreplayReadNetMessages(std::string const &filename, std::function<void (uint8_t player, NetMessage const &message)> const &handler);
+
 #endif // _NETREPLAY_H
@@ -65,6 +65,7 @@ static NetQueue *broadcastQueue = nullptr;
 static std::array<std::unique_ptr<SessionKeys>, MAX_CONNECTED_PLAYERS> netSessionKeys;
 
 static bool bIsReplay = false;
+static ReplaySeek replaySeek;  ///< Waiting for NETreplayTakeSeek(), if targetGameTime isn't 0.
 
 static size_t numInvalidMessageReads = 0;
 
@@ -627,13 +628,27 @@ void NETbytesOutputToVector(const std::vector<uint8_t> &data, std::vector<uint8_
 ReplayOptionsHandler::~ReplayOptionsHandler() { }
 
 // TODO Call this function somewhere.
-bool NETloadReplay(std::string const &filename, ReplayOptionsHandler& optionsHandler)
+bool NETloadReplay(std::string const &filename, ReplayOptionsHandler& optionsHandler, uint32_t seekGameTime)
 {
 	uint32_t replayFormatVer = 0;
 	if (!NETreplayLoadStart(filename, optionsHandler, replayFormatVer))
 	{
 		return false;
 	}
+	replaySeek = ReplaySeek();
+	if (seekGameTime > 0)
+	{
+		// Messages before the keyframe are never needed, so don't even load them
+		replaySeek.targetGameTime = seekGameTime;
+		if (NETreplayLoadSeek(seekGameTime, replaySeek.keyframeGameTime, replaySeek.keyframe))
+		{
+			debug(LOG_INFO, "Seeking replay to gameTime %u from the keyframe at %u", seekGameTime, replaySeek.keyframeGameTime);
+		}
+		else
+		{
+			debug(LOG_INFO, "No replay keyframe before gameTime %u, seeking from the start", seekGameTime);
+		}
+	}
 	std::unique_ptr<NetMessage> newMessage;
 	uint8_t player;
 	bool gotReplayEnded = false;
@@ -670,6 +685,17 @@ bool NETisReplay()
 	return bIsReplay;
 }
 
+bool NETreplayTakeSeek(ReplaySeek &seek)
+{
+	if (replaySeek.targetGameTime == 0)
+	{
+		return false;
+	}
+	seek = std::move(replaySeek);
+	replaySeek = ReplaySeek();
+	return true;
+}
+
 void NETshutdownReplay()
 {
 	if (bIsReplay)
@@ -680,6 +706,7 @@ void NETshutdownReplay()
 	}
 
 	bIsReplay = false;
+	replaySeek = ReplaySeek();
 }
 
 // New overloads implementation
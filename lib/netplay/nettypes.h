@@ -216,8 +216,19 @@ public:
 	virtual size_t maximumEmbeddedMapBufferSize() const = 0;
 };
 
-bool NETloadReplay(std::string const &filename, ReplayOptionsHandler& optionsHandler);
+struct ReplaySeek
+{
+	uint32_t targetGameTime = 0;    ///< Game time to fast-forward the replay to.
+	uint32_t keyframeGameTime = 0;
+	std::string keyframe;           ///< Serialized GameState to restore before fast-forwarding, or empty to fast-forward from the start.
+};
+
+/// If seekGameTime isn't 0, only loads the messages after the last keyframe before it. The caller must then restore that
+/// keyframe (see NETreplayTakeSeek()) before processing any of them.
+bool NETloadReplay(std::string const &filename, ReplayOptionsHandler& optionsHandler, uint32_t seekGameTime = 0);
 bool NETisReplay();
+/// Gets the seek requested when loading the replay, if any. Only returns it once.
+bool NETreplayTakeSeek(ReplaySeek &seek);
 void NETshutdownReplay();
 
 bool NETgameIsBehindPlayersByAtLeast(size_t numGameTimeUpdates = 2);
@@ -234,6 +234,20 @@ void PendingWritesManager::threadImplFunction()
 	wzMutexUnlock(mtx_);
 }
 
+PendingWritesManager::QueueDepth PendingWritesManager::queueDepth() const
+{
+	QueueDepth depth;
+	executeUnderLock([this, &depth]
+	{
+		depth.connections = pendingWrites_.size();
+		for (const auto& pendingConnWrite : pendingWrites_)
+		{
+			depth.bytes += pendingConnWrite.second.size();
+		}
+	});
+	return depth;
+}
+
 void PendingWritesManager::safeDispose(IClientConnection* conn)
 {
 	executeUnderLock([this, conn]
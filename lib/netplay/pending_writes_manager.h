@@ -123,6 +123,21 @@ public:
 		});
 	}
 
+	/// <summary>
+	/// How much data is waiting to be sent.
+	/// </summary>
+	struct QueueDepth
+	{
+		size_t connections = 0; ///< Connections with a non-empty write queue.
+		size_t bytes = 0;       ///< Total size of their write queues.
+	};
+
+	/// <summary>
+	/// Take a (thread-safe) snapshot of the submission queue size, e.g. to see whether
+	/// the network keeps up with what's being written.
+	/// </summary>
+	QueueDepth queueDepth() const;
+
 	/// <summary>
 	/// Safely (in a thread-safe manner) dispose of a connection, which may have a registered pending write attached:
 	///
@@ -0,0 +1,181 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "lib/netplay/tcp/epoll_connection_poll_group.h"
+#include "lib/netplay/tcp/tcp_client_connection.h"
+#include "lib/netplay/tcp/netsocket.h"
+#include "lib/netplay/tcp/sock_error.h"
+#include "lib/netplay/error_categories.h"
+#include "lib/framework/frame.h" // for ASSERT, debug
+
+#include <algorithm>
+
+namespace tcp
+{
+
+// Initial size of the `epoll_wait()` output buffer, grown when filled.
+static constexpr size_t InitialEventCount = 64;
+
+// Whether the next `recv()` won't block: there is data, the end of the stream, or an error to report.
+static bool socketHasInput(const IClientConnection* conn)
+{
+	const auto fd = static_cast<const TCPClientConnection*>(conn)->getRawSocketFd();
+	char byte;
+	ssize_t ret;
+	do
+	{
+		ret = ::recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+	} while (ret == SOCKET_ERROR && getSockErr() == EINTR);
+	if (ret != SOCKET_ERROR)
+	{
+		return true;
+	}
+	const int err = getSockErr();
+	return err != EAGAIN && err != EWOULDBLOCK;
+}
+
+std::unique_ptr<EpollConnectionPollGroup> EpollConnectionPollGroup::create()
+{
+	const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (epollFd == SOCKET_ERROR)
+	{
+		const auto msg = make_network_error_code(getSockErr()).message();
+		debug(LOG_WARNING, "Failed to create epoll instance, falling back to poll(): %s", msg.c_str());
+		return nullptr;
+	}
+	return std::unique_ptr<EpollConnectionPollGroup>(new EpollConnectionPollGroup(epollFd));
+}
+
+EpollConnectionPollGroup::EpollConnectionPollGroup(int epollFd)
+	: epollFd_(epollFd),
+	events_(InitialEventCount)
+{}
+
+EpollConnectionPollGroup::~EpollConnectionPollGroup()
+{
+	close(epollFd_);
+}
+
+net::result<int> EpollConnectionPollGroup::checkConnectionsReadable(std::chrono::milliseconds timeout)
+{
+	for (auto* conn : ready_)
+	{
+		conn->setReadReady(false);
+	}
+	ready_.clear();
+
+	// A connection already has some decompressed data. Don't really poll the sockets (as `::checkConnectionsReadable()`).
+	for (auto* conn : hot_)
+	{
+		if (conn->isCompressed() && !conn->compressionAdapter().decompressionNeedInput())
+		{
+			ready_.emplace_back(conn);
+		}
+	}
+
+	if (ready_.empty())
+	{
+		for (auto* conn : hot_)
+		{
+			if (socketHasInput(conn))
+			{
+				ready_.emplace_back(conn);
+			}
+		}
+
+		// Pick up the new edges, without waiting if some connections are ready already.
+		int waitTimeout = ready_.empty() ? static_cast<int>(timeout.count()) : 0;
+		while (true)
+		{
+			int ret;
+			do
+			{
+				ret = epoll_wait(epollFd_, events_.data(), static_cast<int>(events_.size()), waitTimeout);
+			} while (ret == SOCKET_ERROR && getSockErr() == EINTR);
+
+			if (ret == SOCKET_ERROR)
+			{
+				const auto ec = make_network_error_code(getSockErr());
+				const auto msg = ec.message();
+				debug(LOG_ERROR, "epoll_wait failed: %s", msg.c_str());
+				return tl::make_unexpected(ec);
+			}
+			for (int i = 0; i < ret; ++i)
+			{
+				// Errors and hang-ups are left to the connection's next read or write, as with `poll()`.
+				if (events_[i].events & EPOLLIN)
+				{
+					ready_.emplace_back(static_cast<IClientConnection*>(events_[i].data.ptr));
+				}
+			}
+			if (static_cast<size_t>(ret) < events_.size())
+			{
+				break;
+			}
+			// There may be more.
+			events_.resize(events_.size() * 2);
+			waitTimeout = 0;
+		}
+
+		// A hot connection may have got a new edge too.
+		std::sort(ready_.begin(), ready_.end());
+		ready_.erase(std::unique(ready_.begin(), ready_.end()), ready_.end());
+		hot_ = ready_;
+	}
+
+	for (auto* conn : ready_)
+	{
+		conn->setReadReady(true);
+	}
+	return static_cast<int>(ready_.size());
+}
+
+void EpollConnectionPollGroup::add(IClientConnection* conn)
+{
+	auto* tcpConn = dynamic_cast<TCPClientConnection*>(conn);
+	ASSERT_OR_RETURN(, tcpConn != nullptr, "Expected to have TCPClientConnection instance");
+
+	epoll_event event = {};
+	event.events = EPOLLIN | EPOLLET;
+	event.data.ptr = conn;
+	if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, tcpConn->getRawSocketFd(), &event) == SOCKET_ERROR)
+	{
+		const auto msg = make_network_error_code(getSockErr()).message();
+		ASSERT(false, "Failed to add connection to epoll instance: %s", msg.c_str());
+		return;
+	}
+	// Whatever arrived before it was added won't make an edge.
+	hot_.emplace_back(conn);
+}
+
+void EpollConnectionPollGroup::remove(IClientConnection* conn)
+{
+	auto* tcpConn = dynamic_cast<TCPClientConnection*>(conn);
+	ASSERT_OR_RETURN(, tcpConn != nullptr, "Expected to have TCPClientConnection instance");
+
+	if (epoll_ctl(epollFd_, EPOLL_CTL_DEL, tcpConn->getRawSocketFd(), nullptr) == SOCKET_ERROR)
+	{
+		const auto msg = make_network_error_code(getSockErr()).message();
+		ASSERT(false, "Failed to remove connection from epoll instance: %s", msg.c_str());
+	}
+	hot_.erase(std::remove(hot_.begin(), hot_.end(), conn), hot_.end());
+	ready_.erase(std::remove(ready_.begin(), ready_.end(), conn), ready_.end());
+}
+
+} // namespace tcp
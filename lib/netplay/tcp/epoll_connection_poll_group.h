@@ -0,0 +1,74 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "lib/netplay/connection_poll_group.h"
+
+#include <vector>
+#include <memory>
+
+#include <sys/epoll.h>
+
+class IClientConnection;
+
+namespace tcp
+{
+
+/// <summary>
+/// Linux-specific poll group, which keeps the connections registered with an
+/// edge-triggered `epoll` instance, instead of rebuilding a descriptor set and
+/// polling every connection on each `checkConnectionsReadable()` call.
+///
+/// The cost of a check depends on how many connections are ready, not on how many
+/// there are, which matters for hosts with lots of spectators and joining players.
+///
+/// An edge is only reported once, when new data arrives, but the reader may leave some
+/// of it in the socket. So connections which were ready stay "hot" (are checked again,
+/// without blocking) until they are found to be drained, from which point a new edge
+/// is guaranteed to be reported.
+/// </summary>
+class EpollConnectionPollGroup : public IConnectionPollGroup
+{
+public:
+
+	/// Returns nullptr if an `epoll` instance can't be created.
+	static std::unique_ptr<EpollConnectionPollGroup> create();
+
+	virtual ~EpollConnectionPollGroup() override;
+
+	virtual net::result<int> checkConnectionsReadable(std::chrono::milliseconds timeout) override;
+	virtual void add(IClientConnection* conn) override;
+	virtual void remove(IClientConnection* conn) override;
+
+private:
+
+	explicit EpollConnectionPollGroup(int epollFd);
+
+	int epollFd_ = -1;
+	// Connections which may be readable without a new edge: the ones that were
+	// ready after the previous check, and the ones just added.
+	std::vector<IClientConnection*> hot_;
+	// Connections marked as read-ready by the previous check.
+	std::vector<IClientConnection*> ready_;
+	// Pre-allocated output buffer for `epoll_wait()`.
+	std::vector<epoll_event> events_;
+};
+
+} // namespace tcp
@@ -21,7 +21,31 @@
 
 #include "wz_compression_provider.h"
 
+#include "lib/framework/frame.h"
+#include "lib/framework/file.h"
 #include "lib/netplay/zlib_compression_adapter.h"
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+# include "lib/netplay/zstd_compression_adapter.h"
+#endif
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+# include "lib/netplay/lz4_compression_adapter.h"
+#endif
+
+#include <physfs.h>
+
+// Most preferred first. Dictionary compression wins on the many tiny, repetitive game messages, and
+// zstd compresses better than LZ4 at a speed which is plenty for game traffic.
+static const CompressionAlgorithm algorithmPreference[] = {
+	CompressionAlgorithm::ZstdDictionary,
+	CompressionAlgorithm::Zstd,
+	CompressionAlgorithm::Lz4,
+	CompressionAlgorithm::Zlib,
+};
+
+static constexpr uint8_t algorithmBit(CompressionAlgorithm algorithm)
+{
+	return static_cast<uint8_t>(1u << static_cast<uint8_t>(algorithm));
+}
 
 WzCompressionProvider& WzCompressionProvider::Instance()
 {
@@ -29,11 +53,105 @@ WzCompressionProvider& WzCompressionProvider::Instance()
 	return instance;
 }
 
-std::unique_ptr<ICompressionAdapter> WzCompressionProvider::newCompressionAdapter()
+void WzCompressionProvider::loadDictionary()
+{
+	std::call_once(dictionaryLoaded_, [this]
+	{
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+		if (!PHYSFS_exists(DictionaryPath))
+		{
+			debug(LOG_NET, "No net message dictionary, zstd will be used without one");
+			return;
+		}
+		std::vector<char> data;
+		if (!loadFileToBufferVector(DictionaryPath, data, false, false))
+		{
+			return;
+		}
+		dictionary_ = ZstdDictionary::create(data.data(), data.size(), ZstdCompressionAdapter::CompressionLevel);
+		if (!dictionary_)
+		{
+			debug(LOG_ERROR, "%s is not a zstd dictionary", DictionaryPath);
+			return;
+		}
+		debug(LOG_NET, "Loaded net message dictionary %" PRIu32, dictionary_->id());
+#endif
+	});
+}
+
+std::unique_ptr<ICompressionAdapter> WzCompressionProvider::newCompressionAdapter(CompressionAlgorithm algorithm)
+{
+	switch (algorithm)
+	{
+	case CompressionAlgorithm::Zlib:
+		return std::make_unique<ZlibCompressionAdapter>();
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+	case CompressionAlgorithm::Zstd:
+		return std::make_unique<ZstdCompressionAdapter>(nullptr);
+	case CompressionAlgorithm::ZstdDictionary:
+		loadDictionary();
+		if (!dictionary_)
+		{
+			return nullptr;
+		}
+		return std::make_unique<ZstdCompressionAdapter>(dictionary_);
+#endif
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+	case CompressionAlgorithm::Lz4:
+		return std::make_unique<Lz4CompressionAdapter>();
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+uint8_t WzCompressionProvider::supportedAlgorithms()
+{
+	uint8_t algorithms = algorithmBit(CompressionAlgorithm::Zlib);
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+	algorithms |= algorithmBit(CompressionAlgorithm::Zstd);
+	if (dictionaryId() != 0)
+	{
+		algorithms |= algorithmBit(CompressionAlgorithm::ZstdDictionary);
+	}
+#endif
+#ifdef WZ_NETPLAY_LZ4_ENABLED
+	algorithms |= algorithmBit(CompressionAlgorithm::Lz4);
+#endif
+	return algorithms;
+}
+
+bool WzCompressionProvider::supportsAlgorithm(CompressionAlgorithm algorithm)
+{
+	return static_cast<uint8_t>(algorithm) < 8 && (supportedAlgorithms() & algorithmBit(algorithm)) != 0;
+}
+
+uint32_t WzCompressionProvider::dictionaryId()
+{
+#ifdef WZ_NETPLAY_ZSTD_ENABLED
+	loadDictionary();
+	if (dictionary_)
+	{
+		return dictionary_->id();
+	}
+#endif
+	return 0;
+}
+
+CompressionAlgorithm WzCompressionProvider::chooseAlgorithm(uint8_t peerAlgorithms, uint32_t peerDictionaryId)
 {
-	// Only support Zlib for the time being.
-	// TODO: in the future, we might want to support more compression algorithms, e.g. Zstd.
-	// In this case, we would need to somehow configure `WzCompressionAdapter` from
-	// the global WZ config to specify compression algorithm to use.
-	return std::make_unique<ZlibCompressionAdapter>();
+	const uint8_t common = supportedAlgorithms() & peerAlgorithms;
+	for (CompressionAlgorithm algorithm : algorithmPreference)
+	{
+		if ((common & algorithmBit(algorithm)) == 0)
+		{
+			continue;
+		}
+		if (algorithm == CompressionAlgorithm::ZstdDictionary && peerDictionaryId != dictionaryId())
+		{
+			continue;  // Different dictionaries, most likely from different game data.
+		}
+		return algorithm;
+	}
+	return CompressionAlgorithm::Zlib;
 }
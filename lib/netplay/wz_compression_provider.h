@@ -21,26 +21,52 @@
 
 #pragma once
 
+#include "lib/netplay/compression_adapter.h"
+
 #include <memory>
+#include <mutex>
 
-class ICompressionAdapter;
+class ZstdDictionary;
 
 /// <summary>
 /// This class provides is responsible for creating `ICompressionAdapter:s`,
 /// which are thin wrappers over some compression algorithm, intended for
 /// use in `IClientConnection` to provide compression over raw net messages.
+///
+/// Which algorithm a connection uses is agreed on in the connection handshake:
+/// the client offers `supportedAlgorithms()` and its `dictionaryId()`, and the
+/// host picks one with `chooseAlgorithm()`.
 /// </summary>
 class WzCompressionProvider
 {
 public:
 
+	/// Zstd dictionary trained on game messages, looked up in the game data.
+	static constexpr const char* DictionaryPath = "netplay/gamemessages.dict";
+
 	static WzCompressionProvider& Instance();
 
-	std::unique_ptr<ICompressionAdapter> newCompressionAdapter();
+	/// Returns nullptr if `algorithm` isn't supported by this build.
+	std::unique_ptr<ICompressionAdapter> newCompressionAdapter(CompressionAlgorithm algorithm = CompressionAlgorithm::Zlib);
+
+	/// Bit mask of the algorithms this build supports (bit `1 << algorithm` for each).
+	uint8_t supportedAlgorithms();
+	bool supportsAlgorithm(CompressionAlgorithm algorithm);
+	/// ID of the zstd dictionary, or 0 if there isn't one.
+	uint32_t dictionaryId();
+	/// The preferred algorithm out of those supported here and by the other end of a connection,
+	/// given as in `supportedAlgorithms()` and `dictionaryId()`. Zlib is always supported.
+	CompressionAlgorithm chooseAlgorithm(uint8_t peerAlgorithms, uint32_t peerDictionaryId);
 
 private:
 
 	WzCompressionProvider() = default;
 	WzCompressionProvider(const WzCompressionProvider&) = delete;
 	WzCompressionProvider(WzCompressionProvider&&) = delete;
+
+	/// Loads the dictionary, the first time it's called.
+	void loadDictionary();
+
+	std::once_flag dictionaryLoaded_;
+	std::shared_ptr<const ZstdDictionary> dictionary_;
 };
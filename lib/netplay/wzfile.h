@@ -31,6 +31,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include <stdint.h>
 
 void physfs_file_safe_close(PHYSFS_file* f);
@@ -40,6 +41,8 @@ struct WZFile
 public:
 
 	WZFile(PHYSFS_file* handle, const std::string& filename, Sha256 hash, uint32_t size = 0) : handle_(handle, physfs_file_safe_close), filename(filename), hash(hash), size(size), pos(0) {}
+	// A file to send, from contents that may be shared with other downloads of it (see `NETloadFileToSend()`).
+	WZFile(std::shared_ptr<const std::vector<uint8_t>> contents, const std::string& filename, Sha256 hash) : handle_(nullptr, physfs_file_safe_close), contents_(std::move(contents)), filename(filename), hash(hash), size(static_cast<uint32_t>(contents_->size())), pos(0) {}
 
 	~WZFile();
 
@@ -57,12 +60,18 @@ public:
 	{
 		return handle_.get();
 	}
+	inline const std::shared_ptr<const std::vector<uint8_t>>& contents() const
+	{
+		return contents_;
+	}
 
 private:
 	std::unique_ptr<PHYSFS_file, void(*)(PHYSFS_file*)> handle_;
+	std::shared_ptr<const std::vector<uint8_t>> contents_;
 public:
 	std::string filename;
 	Sha256 hash;
 	uint32_t size = 0;
 	uint32_t pos = 0;  // Current position, the range [0; currPos[ has been sent or received already.
+	uint32_t acked = 0;  // The range [0; acked[ has been acknowledged by the receiver, see `NETrequestFile()`.
 };
@@ -42,12 +42,17 @@ net::result<void> ZlibCompressionAdapter::initialize()
 	deflateStream_.zalloc = Z_NULL;
 	deflateStream_.zfree = Z_NULL;
 	deflateStream_.opaque = Z_NULL;
-	int ret = deflateInit(&deflateStream_, 6);
+	// Raw deflate, with the zlib stream header (what `deflateInit(&deflateStream_, 6)` would emit) written
+	// by hand: the receiving side still sees a zlib stream, but raw streams allow `deflateSetDictionary()`
+	// between blocks, which `appendSharedBlock()` needs. The stream is never finished, so the missing
+	// adler32 trailer is never checked.
+	int ret = deflateInit2(&deflateStream_, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
 	ASSERT(ret == Z_OK, "deflateInit failed! Sockets won't work.");
 	if (ret != Z_OK)
 	{
 		return tl::make_unexpected(make_zlib_error_code(ret));
 	}
+	deflateOutBuf_.assign({0x78, 0x9C});
 
 	// Init inflate stream
 	inflateStream_.zalloc = Z_NULL;
@@ -97,47 +102,83 @@ void ZlibCompressionAdapter::resetCompressionStreamInput(const void* src, size_t
 	deflateStream_.avail_in = size;
 }
 
-net::result<void> ZlibCompressionAdapter::compress(const void* src, size_t size)
+net::result<void> ZlibCompressionAdapter::runDeflate(std::vector<uint8_t>& out, size_t sizeHint, int flush)
 {
-	resetCompressionStreamInput(src, size);
 	do
 	{
-		const size_t alreadyHave = deflateOutBuf_.size();
-		deflateOutBuf_.resize(alreadyHave + size + 20);  // A bit more than size should be enough to always do everything in one go.
-		deflateStream_.next_out = (Bytef*)&deflateOutBuf_[alreadyHave];
-		deflateStream_.avail_out = deflateOutBuf_.size() - alreadyHave;
+		const size_t alreadyHave = out.size();
+		out.resize(alreadyHave + sizeHint);
+		deflateStream_.next_out = (Bytef*)&out[alreadyHave];
+		deflateStream_.avail_out = out.size() - alreadyHave;
 
-		int ret = deflate(&deflateStream_, Z_NO_FLUSH);
+		int ret = deflate(&deflateStream_, flush);
 		ASSERT(ret != Z_STREAM_ERROR, "zlib compression failed!");
 
 		// Remove unused part of buffer.
-		deflateOutBuf_.resize(deflateOutBuf_.size() - deflateStream_.avail_out);
+		out.resize(out.size() - deflateStream_.avail_out);
+		if (ret == Z_STREAM_ERROR)
+		{
+			return tl::make_unexpected(make_zlib_error_code(ret));
+		}
 	} while (deflateStream_.avail_out == 0);
 
+	return {};
+}
+
+net::result<void> ZlibCompressionAdapter::compress(const void* src, size_t size)
+{
+	resetCompressionStreamInput(src, size);
+	// A bit more than size should be enough to always do everything in one go.
+	auto res = runDeflate(deflateOutBuf_, size + 20, Z_NO_FLUSH);
+
 	ASSERT(deflateStream_.avail_in == 0, "zlib didn't compress everything!");
 
-	return {};
+	return res;
 }
 
 net::result<void> ZlibCompressionAdapter::flushCompressionStream()
 {
 	// Flush data out of zlib compression state.
-	do
-	{
-		deflateStream_.next_in = (Bytef*)nullptr;
-		deflateStream_.avail_in = 0;
-		const size_t alreadyHave = deflateOutBuf_.size();
-		deflateOutBuf_.resize(alreadyHave + 1000);  // 100 bytes would probably be enough to flush the rest in one go.
-		deflateStream_.next_out = (Bytef*)&deflateOutBuf_[alreadyHave];
-		deflateStream_.avail_out = deflateOutBuf_.size() - alreadyHave;
-
-		int ret = deflate(&deflateStream_, Z_PARTIAL_FLUSH);
-		ASSERT(ret != Z_STREAM_ERROR, "zlib compression failed!");
+	deflateStream_.next_in = (Bytef*)nullptr;
+	deflateStream_.avail_in = 0;
+	// 100 bytes would probably be enough to flush the rest in one go.
+	return runDeflate(deflateOutBuf_, 1000, Z_PARTIAL_FLUSH);
+}
 
-		// Remove unused part of buffer.
-		deflateOutBuf_.resize(deflateOutBuf_.size() - deflateStream_.avail_out);
-	} while (deflateStream_.avail_out == 0);
+net::result<void> ZlibCompressionAdapter::encodeSharedBlock(const void* src, size_t size, std::vector<uint8_t>& out)
+{
+	// Forget everything compressed before, so the block can follow any other stream's output
+	int ret = deflateReset(&deflateStream_);
+	if (ret != Z_OK)
+	{
+		return tl::make_unexpected(make_zlib_error_code(ret));
+	}
+	out.clear();
+	resetCompressionStreamInput(src, size);
+	// Z_SYNC_FLUSH ends the block on a byte boundary, without marking it as the last one
+	auto res = runDeflate(out, size + 20, Z_SYNC_FLUSH);
+	ASSERT(deflateStream_.avail_in == 0, "zlib didn't compress everything!");
+	return res;
+}
 
+net::result<void> ZlibCompressionAdapter::appendSharedBlock(const std::vector<uint8_t>& block, const void* src, size_t size)
+{
+	// Finish our pending output on a byte boundary, so the block can be appended as is...
+	deflateStream_.next_in = (Bytef*)nullptr;
+	deflateStream_.avail_in = 0;
+	auto flushRes = runDeflate(deflateOutBuf_, 1000, Z_SYNC_FLUSH);
+	if (!flushRes.has_value())
+	{
+		return flushRes;
+	}
+	// ...and add its data to our history, since it is in the receiver's history too: the receiver's
+	// window is what later back-references from this stream are resolved against.
+	int ret = deflateSetDictionary(&deflateStream_, static_cast<const Bytef*>(src), static_cast<uInt>(size));
+	if (ret != Z_OK)
+	{
+		return tl::make_unexpected(make_zlib_error_code(ret));
+	}
+	deflateOutBuf_.insert(deflateOutBuf_.end(), block.begin(), block.end());
 	return {};
 }
 
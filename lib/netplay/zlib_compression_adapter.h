@@ -39,6 +39,11 @@ public:
 
 	virtual net::result<void> initialize() override;
 
+	virtual CompressionAlgorithm algorithm() const override
+	{
+		return CompressionAlgorithm::Zlib;
+	}
+
 	virtual net::result<void> compress(const void* src, size_t size) override;
 	virtual net::result<void> flushCompressionStream() override;
 
@@ -77,9 +82,19 @@ public:
 
 	virtual void resetDecompressionStreamInputSize(size_t size) override;
 
+	virtual bool supportsSharedBlocks() const override
+	{
+		return true;
+	}
+	virtual net::result<void> encodeSharedBlock(const void* src, size_t size, std::vector<uint8_t>& out) override;
+	virtual net::result<void> appendSharedBlock(const std::vector<uint8_t>& block, const void* src, size_t size) override;
+
 private:
 
 	void resetCompressionStreamInput(const void* src, size_t size);
+	/// Run `deflate()` with the given flush mode until all input is consumed, appending the output to `out`
+	/// (growing it by `sizeHint` bytes at a time).
+	net::result<void> runDeflate(std::vector<uint8_t>& out, size_t sizeHint, int flush);
 	void resetDecompressionStreamOutput(void* dst, size_t size);
 
 	std::vector<uint8_t> deflateOutBuf_;
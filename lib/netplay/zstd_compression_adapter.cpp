@@ -0,0 +1,148 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "zstd_compression_adapter.h"
+#include "error_categories.h"
+
+#include "lib/framework/frame.h" // for `ASSERT`
+
+std::shared_ptr<ZstdDictionary> ZstdDictionary::create(const void* data, size_t size, int compressionLevel)
+{
+	const uint32_t id = ZSTD_getDictID_fromDict(data, size);
+	if (id == 0)
+	{
+		return nullptr;
+	}
+	std::shared_ptr<ZstdDictionary> dictionary(new ZstdDictionary());
+	dictionary->id_ = id;
+	dictionary->cdict_ = ZSTD_createCDict(data, size, compressionLevel);
+	dictionary->ddict_ = ZSTD_createDDict(data, size);
+	if (dictionary->cdict_ == nullptr || dictionary->ddict_ == nullptr)
+	{
+		return nullptr;
+	}
+	return dictionary;
+}
+
+ZstdDictionary::~ZstdDictionary()
+{
+	ZSTD_freeCDict(cdict_);
+	ZSTD_freeDDict(ddict_);
+}
+
+ZstdCompressionAdapter::ZstdCompressionAdapter(std::shared_ptr<const ZstdDictionary> dictionary)
+	: dictionary_(std::move(dictionary))
+{}
+
+ZstdCompressionAdapter::~ZstdCompressionAdapter()
+{
+	ZSTD_freeCCtx(cctx_);
+	ZSTD_freeDCtx(dctx_);
+}
+
+net::result<void> ZstdCompressionAdapter::initialize()
+{
+	cctx_ = ZSTD_createCCtx();
+	dctx_ = ZSTD_createDCtx();
+	ASSERT(cctx_ != nullptr && dctx_ != nullptr, "Failed to create zstd contexts! Sockets won't work.");
+	if (cctx_ == nullptr || dctx_ == nullptr)
+	{
+		return tl::make_unexpected(std::make_error_code(std::errc::not_enough_memory));
+	}
+
+	size_t ret = ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, CompressionLevel);
+	if (!ZSTD_isError(ret) && dictionary_)
+	{
+		ret = ZSTD_CCtx_refCDict(cctx_, dictionary_->compressionDictionary());
+	}
+	if (!ZSTD_isError(ret) && dictionary_)
+	{
+		ret = ZSTD_DCtx_refDDict(dctx_, dictionary_->decompressionDictionary());
+	}
+	if (ZSTD_isError(ret))
+	{
+		debug(LOG_ERROR, "Failed to set up zstd: %s", ZSTD_getErrorName(ret));
+		return tl::make_unexpected(make_zstd_error_code(ret));
+	}
+
+	decompressNeedInput_ = true;
+
+	return {};
+}
+
+net::result<void> ZstdCompressionAdapter::runCompress(ZSTD_inBuffer& input, ZSTD_EndDirective directive)
+{
+	while (true)
+	{
+		const size_t alreadyHave = compressOutBuf_.size();
+		// Enough for the whole input in one go, unless zstd is holding back more than a block.
+		compressOutBuf_.resize(alreadyHave + ZSTD_compressBound(input.size - input.pos));
+		ZSTD_outBuffer output = {&compressOutBuf_[alreadyHave], compressOutBuf_.size() - alreadyHave, 0};
+
+		const size_t remaining = ZSTD_compressStream2(cctx_, &output, &input, directive);
+
+		// Remove unused part of buffer.
+		compressOutBuf_.resize(alreadyHave + output.pos);
+		if (ZSTD_isError(remaining))
+		{
+			ASSERT(false, "zstd compression failed: %s", ZSTD_getErrorName(remaining));
+			return tl::make_unexpected(make_zstd_error_code(remaining));
+		}
+		const bool done = (directive == ZSTD_e_continue) ? input.pos == input.size : remaining == 0;
+		if (done)
+		{
+			return {};
+		}
+	}
+}
+
+net::result<void> ZstdCompressionAdapter::compress(const void* src, size_t size)
+{
+	ZSTD_inBuffer input = {src, size, 0};
+	return runCompress(input, ZSTD_e_continue);
+}
+
+net::result<void> ZstdCompressionAdapter::flushCompressionStream()
+{
+	// Ends the current block, but not the frame, so the next messages can still refer to this one.
+	ZSTD_inBuffer input = {nullptr, 0, 0};
+	return runCompress(input, ZSTD_e_flush);
+}
+
+net::result<void> ZstdCompressionAdapter::decompress(void* dst, size_t size)
+{
+	decompressOut_ = {dst, size, 0};
+
+	// Unlike inflate(), a single call may stop before either buffer runs out.
+	do
+	{
+		const size_t ret = ZSTD_decompressStream(dctx_, &decompressOut_, &decompressIn_);
+		if (ZSTD_isError(ret))
+		{
+			debug(LOG_ERROR, "Couldn't decompress data from socket. zstd error %s", ZSTD_getErrorName(ret));
+			return tl::make_unexpected(make_zstd_error_code(ret));
+		}
+	} while (decompressIn_.pos < decompressIn_.size && decompressOut_.pos < decompressOut_.size);
+	return {};
+}
+
+void ZstdCompressionAdapter::resetDecompressionStreamInputSize(size_t size)
+{
+	decompressIn_ = {decompressInBuf_.data(), size, 0};
+}
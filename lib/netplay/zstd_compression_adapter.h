@@ -0,0 +1,157 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2026  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "compression_adapter.h"
+
+#include <memory>
+
+#include <zstd.h>
+
+/// <summary>
+/// A zstd dictionary, digested once for compression and decompression, and shared by
+/// all connections using it.
+/// </summary>
+class ZstdDictionary
+{
+public:
+
+	/// <summary>
+	/// Digest the dictionary in `data`, for compression at `compressionLevel`.
+	/// </summary>
+	/// <returns>
+	/// nullptr if `data` is not a zstd dictionary (dictionaries without an ID, made of raw
+	/// content, aren't accepted either, since connections agree on a dictionary by its ID).
+	/// </returns>
+	static std::shared_ptr<ZstdDictionary> create(const void* data, size_t size, int compressionLevel);
+	~ZstdDictionary();
+
+	ZstdDictionary(const ZstdDictionary&) = delete;
+	ZstdDictionary& operator=(const ZstdDictionary&) = delete;
+
+	uint32_t id() const
+	{
+		return id_;
+	}
+
+	const ZSTD_CDict* compressionDictionary() const
+	{
+		return cdict_;
+	}
+
+	const ZSTD_DDict* decompressionDictionary() const
+	{
+		return ddict_;
+	}
+
+private:
+
+	ZstdDictionary() = default;
+
+	uint32_t id_ = 0;
+	ZSTD_CDict* cdict_ = nullptr;
+	ZSTD_DDict* ddict_ = nullptr;
+};
+
+/// <summary>
+/// Implementation of `ICompressionAdapter` interface, which uses zstd to
+/// compress/decompress the data, optionally with a dictionary.
+///
+/// Everything sent over a connection is one endless zstd frame: each flush ends
+/// a block, so later messages can still refer to the earlier ones.
+/// </summary>
+class ZstdCompressionAdapter : public ICompressionAdapter
+{
+public:
+
+	/// Compression level used for all connections. Net messages are tiny, and higher levels
+	/// mostly cost time on them.
+	static constexpr int CompressionLevel = 3;
+
+	/// `dictionary` may be nullptr, to compress without one.
+	explicit ZstdCompressionAdapter(std::shared_ptr<const ZstdDictionary> dictionary);
+	virtual ~ZstdCompressionAdapter() override;
+
+	virtual net::result<void> initialize() override;
+
+	virtual CompressionAlgorithm algorithm() const override
+	{
+		return dictionary_ ? CompressionAlgorithm::ZstdDictionary : CompressionAlgorithm::Zstd;
+	}
+
+	virtual net::result<void> compress(const void* src, size_t size) override;
+	virtual net::result<void> flushCompressionStream() override;
+
+	virtual std::vector<uint8_t>& compressionOutBuffer() override
+	{
+		return compressOutBuf_;
+	}
+
+	virtual const std::vector<uint8_t>& compressionOutBuffer() const override
+	{
+		return compressOutBuf_;
+	}
+
+	virtual net::result<void> decompress(void* dst, size_t size) override;
+
+	virtual std::vector<uint8_t>& decompressionInBuffer() override
+	{
+		return decompressInBuf_;
+	}
+
+	virtual const std::vector<uint8_t>& decompressionInBuffer() const override
+	{
+		return decompressInBuf_;
+	}
+
+	virtual size_t availableSpaceToDecompress() const override
+	{
+		return decompressOut_.size - decompressOut_.pos;
+	}
+	virtual bool decompressionStreamConsumedAllInput() const override
+	{
+		return decompressIn_.pos == decompressIn_.size;
+	}
+	virtual bool decompressionNeedInput() const override
+	{
+		return decompressNeedInput_;
+	}
+	virtual void setDecompressionNeedInput(bool needInput) override
+	{
+		decompressNeedInput_ = needInput;
+	}
+
+	virtual void resetDecompressionStreamInputSize(size_t size) override;
+
+private:
+
+	/// Run `ZSTD_compressStream2()` with the given directive until all input is consumed (and, unless
+	/// `ZSTD_e_continue`, everything is flushed), appending the output to `compressOutBuf_`.
+	net::result<void> runCompress(ZSTD_inBuffer& input, ZSTD_EndDirective directive);
+
+	std::shared_ptr<const ZstdDictionary> dictionary_;
+	ZSTD_CCtx* cctx_ = nullptr;
+	ZSTD_DCtx* dctx_ = nullptr;
+	std::vector<uint8_t> compressOutBuf_;
+	std::vector<uint8_t> decompressInBuf_;
+	ZSTD_inBuffer decompressIn_ = {nullptr, 0, 0};
+	ZSTD_outBuffer decompressOut_ = {nullptr, 0, 0};
+	bool decompressNeedInput_ = false;
+};
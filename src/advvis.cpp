@@ -40,9 +40,9 @@
 static bool bRevealActive = true;
 
 // For display only (*NOT* for use in game state calculations)
-inline float getTileIllumination(const MAPTILE *psTile)
+inline float getTileIllumination(const MAPTILE_DISPLAY *psDisplay)
 {
-	return psTile->ambientOcclusion; // sunlight is handled by shaders so only AO needed for lightmap
+	return psDisplay->ambientOcclusion; // sunlight is handled by shaders so only AO needed for lightmap
 }
 
 // ------------------------------------------------------------------------------------
@@ -54,6 +54,7 @@ void	avUpdateTiles(WorldMapState& mapState)
 	UDWORD i = 0;
 	float maxLevel, increment = graphicsTimeAdjustedIncrement(FADE_IN_TIME);	// call once per frame
 	MAPTILE *psTile;
+	MAPTILE_DISPLAY *psDisplay;
 
 	PlayerMask playerAllianceBits = (selectedPlayer < MAX_PLAYER_SLOTS) ? alliancebits[selectedPlayer] : 0;
 
@@ -61,22 +62,23 @@ void	avUpdateTiles(WorldMapState& mapState)
 	for (; i < len; i++)
 	{
 		psTile = &mapState.tiles[i];
-		maxLevel = getTileIllumination(psTile);
+		psDisplay = &mapState.display[i];
+		maxLevel = getTileIllumination(psDisplay);
 
-		if (psTile->level > MIN_ILLUM || psTile->tileExploredBits & playermask)	// seen
+		if (psDisplay->level > MIN_ILLUM || psTile->tileExploredBits & playermask)	// seen
 		{
 			// If we are not omniscient, and we are not seeing the tile, and none of our allies see the tile...
 			if (!godMode && !(playerAllianceBits & (satuplinkbits | psTile->sensorBits)))
 			{
 				maxLevel /= 2;
 			}
-			if (psTile->level > maxLevel)
+			if (psDisplay->level > maxLevel)
 			{
-				psTile->level = MAX(psTile->level - increment, maxLevel);
+				psDisplay->level = MAX(psDisplay->level - increment, maxLevel);
 			}
-			else if (psTile->level < maxLevel)
+			else if (psDisplay->level < maxLevel)
 			{
-				psTile->level = MIN(psTile->level + increment, maxLevel);
+				psDisplay->level = MIN(psDisplay->level + increment, maxLevel);
 			}
 		}
 	}
@@ -118,11 +120,12 @@ void	preProcessVisibility(WorldMapState& mapState)
 		for (int j = 0; j < mapState.height; j++)
 		{
 			MAPTILE *psTile = mapTile(mapState, i, j);
-			psTile->level = bRevealActive ? MIN(MIN_ILLUM, getTileIllumination(psTile) / 4.0f) : 0;
+			MAPTILE_DISPLAY *psDisplay = mapTileDisplay(mapState, i, j);
+			psDisplay->level = bRevealActive ? MIN(MIN_ILLUM, getTileIllumination(psDisplay) / 4.0f) : 0;
 
 			if (TEST_TILE_VISIBLE_TO_SELECTEDPLAYER(psTile))
 			{
-				psTile->level = getTileIllumination(psTile);
+				psDisplay->level = getTileIllumination(psDisplay);
 			}
 		}
 	}
@@ -38,6 +38,14 @@
  *  Up to 30 pathfinding maps from A* are cached, in a LRU list. The PathNode heap con-
  *  tains the  priority-heap-sorted  nodes which are to be explored.  The path back  is
  *  stored in the PathExploredTile 2D array of tiles.
+ *
+ *  Long routes are first planned on a coarse cluster graph (see PathClusterGraph): the
+ *  map is cut into PATH_CLUSTER_SIZE² clusters,  each open stretch of cluster border is
+ *  an entrance,  and entrances  in the same  cluster are connected  by the cost of the
+ *  local  route between them.  The  clusters  along the  coarse route  form a corridor,
+ *  and the tile  A* for that  Context is  not allowed to leave it.  The cluster graph is
+ *  derived only from the blocking map, so it is identical on all clients,  and it only
+ *  rebuilds the clusters whose tiles changed since the previously built graph.
  */
 
 #ifndef WZ_TESTING
@@ -53,6 +61,12 @@
 #include <memory>
 #include <iterator>
 #include <cstddef>
+#include <mutex>
+#include <bit>
+#include <atomic>
+#include <deque>
+#include <chrono>
+#include <random>
 
 #include "lib/netplay/sync_debug.h"
 #include "game_world.h"
@@ -103,14 +117,123 @@ struct PathNode
 };
 struct PathExploredTile
 {
-	PathExploredTile() : iteration(0xFFFF), dx(0), dy(0), dist(0), visited(false) {}
+	PathExploredTile() : iteration(0xFFFF), dx(0), dy(0), dist(0), jump(0), visited(false), trail(false) {}
 
 	uint16_t iteration;
 	int8_t   dx, dy;                // Offset from previous point in the route.
 	unsigned dist;                  // Shortest known distance to tile.
+	uint16_t jump;                  // Jump point search only: number of tiles to go back in direction dx, dy before looking at the way back again, or 0 if reached by a step of plain A*, so that all neighbours must be expanded.
 	bool     visited;
+	bool     trail;                 // Jump point search only: tile was only passed over by a jump, dist is an upper bound, and the way back is one tile in direction dx, dy.
 };
 
+/** One bit per tile, packed into 64-bit words.
+ *
+ *  Each row starts on a new word, so rows can be copied, compared and scanned a word at a time.
+ */
+class PathBitMap
+{
+public:
+	void resize(int width, int height)
+	{
+		stride = (width + 63) / 64;
+		words.assign(static_cast<size_t>(stride) * static_cast<size_t>(height), 0);
+	}
+	bool empty() const
+	{
+		return words.empty();
+	}
+	bool get(int x, int y) const
+	{
+		return (words[static_cast<size_t>(y) * stride + x / 64] >> (x % 64)) & 1;
+	}
+	void set(int x, int y, bool value)
+	{
+		uint64_t &word = words[static_cast<size_t>(y) * stride + x / 64];
+		const uint64_t bit = uint64_t(1) << (x % 64);
+		word = value ? word | bit : word & ~bit;
+	}
+	/// Returns the first x in [x0, x1) of row y whose bit is value, or x1 if there is none.
+	int findInRow(int y, int x0, int x1, bool value) const
+	{
+		const uint64_t flip = value ? 0 : ~uint64_t(0);
+		const uint64_t *row = &words[static_cast<size_t>(y) * stride];
+		for (int x = x0; x < x1; x = (x / 64 + 1) * 64)
+		{
+			const uint64_t bits = (row[x / 64] ^ flip) >> (x % 64);
+			if (bits != 0)
+			{
+				return std::min(x + std::countr_zero(bits), x1);
+			}
+		}
+		return x1;
+	}
+	/// Returns the last x in [x0, x1) of row y whose bit is value, or x0 - 1 if there is none.
+	int findLastInRow(int y, int x0, int x1, bool value) const
+	{
+		const uint64_t flip = value ? 0 : ~uint64_t(0);
+		const uint64_t *row = &words[static_cast<size_t>(y) * stride];
+		for (int x = x1 - 1; x >= x0; x = x / 64 * 64 - 1)
+		{
+			const uint64_t bits = (row[x / 64] ^ flip) << (63 - x % 64);
+			if (bits != 0)
+			{
+				return std::max(x - std::countl_zero(bits), x0 - 1);
+			}
+		}
+		return x0 - 1;
+	}
+	/// Calls fn(x, y) for each tile where this map and other differ. Both maps must have the same size.
+	template <typename Fn>
+	void forEachDifference(PathBitMap const &other, Fn &&fn) const
+	{
+		for (size_t i = 0; i < words.size(); ++i)
+		{
+			for (uint64_t diff = words[i] ^ other.words[i]; diff != 0; diff &= diff - 1)
+			{
+				fn(static_cast<int>(i % stride) * 64 + std::countr_zero(diff), static_cast<int>(i / stride));
+			}
+		}
+	}
+	/// Byte order independent checksum, for syncDebug.
+	uint32_t checksum() const
+	{
+		uint32_t checksum = 0, factor = 0;
+		for (uint64_t word : words)
+		{
+			checksum ^= static_cast<uint32_t>(word) * (factor = 3 * factor + 1);
+			checksum ^= static_cast<uint32_t>(word >> 32) * (factor = 3 * factor + 1);
+		}
+		return checksum;
+	}
+
+private:
+	int stride = 0;               ///< Words per row.
+	std::vector<uint64_t> words;
+};
+
+/// Side length, in tiles, of the square clusters of the hierarchical pathfinding graph.
+static constexpr int PATH_CLUSTER_SIZE = 16;
+/// Routes between clusters less than this many clusters apart are planned with plain A*.
+static constexpr int PATH_CLUSTER_MIN_DISTANCE = 2;
+
+static inline int fpathClustersX()
+{
+	return (gameWorld.map.width + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+}
+
+static inline int fpathClustersY()
+{
+	return (gameWorld.map.height + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+}
+
+static inline int fpathClusterIndex(int x, int y)
+{
+	return x / PATH_CLUSTER_SIZE + y / PATH_CLUSTER_SIZE * fpathClustersX();
+}
+
+class PathClusterGraph;
+
 struct PathBlockingType
 {
 	uint32_t gameTime;
@@ -130,8 +253,15 @@ struct PathBlockingMap
 	}
 
 	PathBlockingType type;
-	std::vector<bool> map;
-	std::vector<bool> dangerMap;	// using threatBits
+	PathBitMap map;
+	PathBitMap dangerMap;	// using threatBits
+	std::shared_ptr<PathClusterGraph> clusterGraph;  ///< Coarse graph for long routes, built on first use by a pathfinding thread.
+
+	// State of gameWorld.map this map was generated from, so that the next one can be updated from it.
+	uint32_t journalEpoch = 0;
+	size_t journalPosition = 0;
+	uint32_t dangerGeneration = 0;
+	WorldScrollLimits scroll;
 };
 
 struct PathNonblockingArea
@@ -168,11 +298,27 @@ struct PathfindContext
 			return false;  // The path is actually blocked here by a structure, but ignore it since it's where we want to go (or where we came from).
 		}
 		// Not sure whether the out-of-bounds check is needed, can only happen if pathfinding is started on a blocking tile (or off the map).
-		return x < 0 || y < 0 || x >= gameWorld.map.width || y >= gameWorld.map.height || blockingMap->map[x + y * gameWorld.map.width];
+		if (x < 0 || y < 0 || x >= gameWorld.map.width || y >= gameWorld.map.height)
+		{
+			return true;
+		}
+		if (!corridor.empty() && !corridor[fpathClusterIndex(x, y)])
+		{
+			return true;  // Outside the clusters picked by the coarse route.
+		}
+		return blockingMap->map.get(x, y);
+	}
+	bool isNearDstIgnore(int x, int y) const
+	{
+		return dstIgnore.x1 != dstIgnore.x2 && x >= dstIgnore.x1 - 1 && x <= dstIgnore.x2 && y >= dstIgnore.y1 - 1 && y <= dstIgnore.y2;
+	}
+	bool isInCorridor(PathCoord tile) const
+	{
+		return corridor.empty() || corridor[fpathClusterIndex(tile.x, tile.y)];
 	}
 	bool isDangerous(int x, int y) const
 	{
-		return !blockingMap->dangerMap.empty() && blockingMap->dangerMap[x + y * gameWorld.map.width];
+		return !blockingMap->dangerMap.empty() && blockingMap->dangerMap.get(x, y);
 	}
 	bool matches(const std::shared_ptr<const PathBlockingMap> &blockingMap_, PathCoord tileS_, PathNonblockingArea dstIgnore_) const
 	{
@@ -211,12 +357,21 @@ struct PathfindContext
 	std::vector<PathExploredTile> map;  ///< Map, with paths leading back to tileS.
 	std::shared_ptr<const PathBlockingMap> blockingMap; ///< Map of blocking tiles for the type of object which needs a path.
 	PathNonblockingArea dstIgnore;      ///< Area of structure at destination which should be considered nonblocking.
+	std::vector<bool> corridor;         ///< Clusters the search may enter, or empty if unrestricted. Kept by assign().
+	bool            jumpPoints = false;   ///< Search with jump point search instead of plain A*. Kept by assign().
+	size_t          expandedNodes = 0;    ///< Number of tiles expanded, for fpathAStarBenchmark.
 };
 
 /// Lists of blocking maps from current tick.
 static std::vector<std::shared_ptr<PathBlockingMap>> fpathBlockingMaps;
 /// Game time for all blocking maps in fpathBlockingMaps.
 static uint32_t fpathCurrentGameTime;
+/// Most recently generated blocking map of each blocking type, which newer maps are updated from.
+static std::vector<std::shared_ptr<PathBlockingMap>> fpathBlockingMapCache;
+
+/// Most recently built cluster graph of each blocking type, which newer graphs are updated from.
+static std::vector<std::shared_ptr<PathClusterGraph>> fpathClusterGraphCache;
+static wz::mutex fpathClusterGraphCacheMutex;
 
 // Convert a direction into an offset
 // dir 0 => x = 0, y = -1
@@ -235,6 +390,9 @@ static const Vector2i aDirOffset[] =
 void fpathHardTableReset()
 {
 	fpathBlockingMaps.clear();
+	fpathBlockingMapCache.clear();
+	std::lock_guard<wz::mutex> cacheLock(fpathClusterGraphCacheMutex);
+	fpathClusterGraphCache.clear();
 }
 
 /** Get the nearest entry in the open list
@@ -267,6 +425,449 @@ static inline unsigned WZ_DECL_PURE fpathGoodEstimate(PathCoord s, PathCoord f)
 	return iHypot((s.x - f.x) * 140, (s.y - f.y) * 140);
 }
 
+/// One cluster of the coarse pathfinding graph.
+struct PathCluster
+{
+	std::vector<PathCoord> entrances;  ///< Tiles of this cluster in the middle of an open stretch of border, in scan order.
+	std::vector<PathCoord> partners;   ///< For each entrance, the adjacent tile on the other side of the border.
+	std::vector<unsigned>  costs;      ///< entrances² matrix of route costs inside the cluster, UINT32_MAX if unreachable.
+};
+
+/** Coarse graph of the map used to plan long routes, derived from one PathBlockingMap.
+ *
+ *  Built lazily by the first pathfinding thread which needs it. Once built, it is never modified, so it can be
+ *  read by several threads at once.
+ */
+class PathClusterGraph : public std::enable_shared_from_this<PathClusterGraph>
+{
+public:
+	PathClusterGraph(PathBlockingType const &type_) : type(type_) {}
+
+	/// Sets corridor to the clusters which a route from tileS to tileF should stay within, and returns true.
+	/// Returns false and leaves corridor empty if the route is short, or if there is no coarse route (plain A* will then find the nearest reachable tile).
+	bool findCorridor(const PathBlockingMap &blockingMap, PathCoord tileS, PathCoord tileF, PathNonblockingArea const &dstIgnore, std::vector<bool> &corridor);
+
+private:
+	void ensureBuilt(const PathBlockingMap &blockingMap);
+	void build(const PathBlockingMap &blockingMap, const PathClusterGraph *prev);
+	void rebuildCluster(int cx, int cy);
+	void linkClusters();
+	void localCosts(int cluster, PathCoord from, std::vector<unsigned> &dist) const;
+
+	bool isBlocked(int x, int y) const
+	{
+		return x < 0 || y < 0 || x >= width || y >= height || map.get(x, y);
+	}
+	unsigned costFactor(int x, int y) const
+	{
+		return !dangerMap.empty() && dangerMap.get(x, y) ? 5 : 1;
+	}
+	int clusterOf(PathCoord tile) const
+	{
+		return tile.x / PATH_CLUSTER_SIZE + tile.y / PATH_CLUSTER_SIZE * clustersX;
+	}
+	/// Index of tile in the arrays filled by localCosts.
+	size_t localIndex(int cluster, PathCoord tile) const
+	{
+		const int x0 = cluster % clustersX * PATH_CLUSTER_SIZE;
+		const int y0 = cluster / clustersX * PATH_CLUSTER_SIZE;
+		const int w = std::min(x0 + PATH_CLUSTER_SIZE, width) - x0;
+		return (tile.x - x0) + (tile.y - y0) * w;
+	}
+
+	PathBlockingType type;
+	wz::mutex mutex;                   ///< Protects built while building.
+	bool built = false;
+
+	int width = 0, height = 0;
+	int clustersX = 0, clustersY = 0;
+	PathBitMap map;                    ///< Copy of the blocking map this graph was built from, for incremental rebuilds.
+	PathBitMap dangerMap;
+	std::vector<PathCluster> clusters;
+	std::vector<uint32_t> firstNode;   ///< Node number of the first entrance of each cluster, and the total number of nodes at the end.
+	std::vector<uint32_t> nodeCluster; ///< Cluster of each node.
+	std::vector<uint32_t> partnerNode; ///< Node on the other side of the border of each node.
+};
+
+void PathClusterGraph::ensureBuilt(const PathBlockingMap &blockingMap)
+{
+	std::lock_guard<wz::mutex> lock(mutex);
+	if (built)
+	{
+		return;
+	}
+
+	std::shared_ptr<PathClusterGraph> prev;
+	{
+		std::lock_guard<wz::mutex> cacheLock(fpathClusterGraphCacheMutex);
+		for (auto const &cached : fpathClusterGraphCache)
+		{
+			if (fpathIsEquivalentBlocking(cached->type.propulsion, cached->type.owner, cached->type.moveType,
+			                              type.propulsion,         type.owner,         type.moveType))
+			{
+				prev = cached;
+				break;
+			}
+		}
+	}
+
+	// The result does not depend on prev, only the amount of work needed does, so it does not matter which thread got here first.
+	build(blockingMap, prev.get());
+	built = true;
+
+	std::lock_guard<wz::mutex> cacheLock(fpathClusterGraphCacheMutex);
+	auto i = std::find(fpathClusterGraphCache.begin(), fpathClusterGraphCache.end(), prev);
+	if (prev == nullptr || i == fpathClusterGraphCache.end())
+	{
+		fpathClusterGraphCache.push_back(shared_from_this());
+	}
+	else if ((*i)->type.gameTime <= type.gameTime)
+	{
+		*i = shared_from_this();
+	}
+}
+
+void PathClusterGraph::build(const PathBlockingMap &blockingMap, const PathClusterGraph *prev)
+{
+	width = gameWorld.map.width;
+	height = gameWorld.map.height;
+	clustersX = (width + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+	clustersY = (height + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+	map = blockingMap.map;
+	dangerMap = blockingMap.dangerMap;
+
+	std::vector<bool> dirty(static_cast<size_t>(clustersX) * static_cast<size_t>(clustersY), true);
+	if (prev != nullptr && prev->width == width && prev->height == height && prev->dangerMap.empty() == dangerMap.empty())
+	{
+		// Only clusters containing a changed tile, or bordering one, can have different entrances or costs.
+		clusters = prev->clusters;
+		dirty.assign(dirty.size(), false);
+		auto markDirty = [&](int x, int y) {
+			int cx = x / PATH_CLUSTER_SIZE, cy = y / PATH_CLUSTER_SIZE;
+			dirty[cx + cy * clustersX] = true;
+			if (x % PATH_CLUSTER_SIZE == 0 && cx > 0)
+			{
+				dirty[cx - 1 + cy * clustersX] = true;
+			}
+			if (x % PATH_CLUSTER_SIZE == PATH_CLUSTER_SIZE - 1 && cx + 1 < clustersX)
+			{
+				dirty[cx + 1 + cy * clustersX] = true;
+			}
+			if (y % PATH_CLUSTER_SIZE == 0 && cy > 0)
+			{
+				dirty[cx + (cy - 1) * clustersX] = true;
+			}
+			if (y % PATH_CLUSTER_SIZE == PATH_CLUSTER_SIZE - 1 && cy + 1 < clustersY)
+			{
+				dirty[cx + (cy + 1) * clustersX] = true;
+			}
+		};
+		map.forEachDifference(prev->map, markDirty);
+		if (!dangerMap.empty())
+		{
+			dangerMap.forEachDifference(prev->dangerMap, markDirty);
+		}
+	}
+	else
+	{
+		clusters.assign(dirty.size(), PathCluster());
+	}
+
+	for (int cy = 0; cy < clustersY; ++cy)
+		for (int cx = 0; cx < clustersX; ++cx)
+		{
+			if (dirty[cx + cy * clustersX])
+			{
+				rebuildCluster(cx, cy);
+			}
+		}
+	linkClusters();
+}
+
+void PathClusterGraph::rebuildCluster(int cx, int cy)
+{
+	PathCluster &cluster = clusters[cx + cy * clustersX];
+	cluster.entrances.clear();
+	cluster.partners.clear();
+
+	const int x0 = cx * PATH_CLUSTER_SIZE, x1 = std::min(x0 + PATH_CLUSTER_SIZE, width);
+	const int y0 = cy * PATH_CLUSTER_SIZE, y1 = std::min(y0 + PATH_CLUSTER_SIZE, height);
+
+	// Put an entrance in the middle of each stretch of border where both sides are open. Both clusters sharing
+	// a border scan it in the same direction, so they agree on where the entrances are.
+	auto addBorder = [&](int dx, int dy) {
+		if (cx + dx < 0 || cx + dx >= clustersX || cy + dy < 0 || cy + dy >= clustersY)
+		{
+			return;
+		}
+		const bool vertical = dx != 0;
+		const int length = vertical ? y1 - y0 : x1 - x0;
+		auto tileAt = [&](int i) {
+			return PathCoord(vertical ? (dx < 0 ? x0 : x1 - 1) : x0 + i, vertical ? y0 + i : (dy < 0 ? y0 : y1 - 1));
+		};
+		int runStart = -1;
+		for (int i = 0; i <= length; ++i)
+		{
+			bool open = false;
+			if (i < length)
+			{
+				PathCoord tile = tileAt(i);
+				open = !isBlocked(tile.x, tile.y) && !isBlocked(tile.x + dx, tile.y + dy);
+			}
+			if (open && runStart < 0)
+			{
+				runStart = i;
+			}
+			else if (!open && runStart >= 0)
+			{
+				PathCoord tile = tileAt(runStart + (i - 1 - runStart) / 2);
+				cluster.entrances.push_back(tile);
+				cluster.partners.push_back(PathCoord(tile.x + dx, tile.y + dy));
+				runStart = -1;
+			}
+		}
+	};
+	addBorder(-1, 0);
+	addBorder(1, 0);
+	addBorder(0, -1);
+	addBorder(0, 1);
+
+	const size_t numEntrances = cluster.entrances.size();
+	cluster.costs.assign(numEntrances * numEntrances, UINT32_MAX);
+	std::vector<unsigned> dist;
+	for (size_t a = 0; a < numEntrances; ++a)
+	{
+		localCosts(cx + cy * clustersX, cluster.entrances[a], dist);
+		for (size_t b = 0; b < numEntrances; ++b)
+		{
+			cluster.costs[a * numEntrances + b] = dist[localIndex(cx + cy * clustersX, cluster.entrances[b])];
+		}
+	}
+}
+
+void PathClusterGraph::linkClusters()
+{
+	firstNode.assign(clusters.size() + 1, 0);
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		firstNode[c + 1] = firstNode[c] + clusters[c].entrances.size();
+	}
+	nodeCluster.resize(firstNode.back());
+	partnerNode.assign(firstNode.back(), UINT32_MAX);
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		PathCluster const &cluster = clusters[c];
+		for (size_t e = 0; e < cluster.entrances.size(); ++e)
+		{
+			nodeCluster[firstNode[c] + e] = c;
+			int other = clusterOf(cluster.partners[e]);
+			auto const &otherEntrances = clusters[other].entrances;
+			auto i = std::find(otherEntrances.begin(), otherEntrances.end(), cluster.partners[e]);
+			ASSERT_OR_RETURN(, i != otherEntrances.end(), "Clusters %zu and %d disagree about their border.", c, other);
+			partnerNode[firstNode[c] + e] = firstNode[other] + (i - otherEntrances.begin());
+		}
+	}
+}
+
+/// Cost of the cheapest route from the from tile to every tile of the cluster, without leaving the cluster.
+void PathClusterGraph::localCosts(int cluster, PathCoord from, std::vector<unsigned> &dist) const
+{
+	const int x0 = cluster % clustersX * PATH_CLUSTER_SIZE, x1 = std::min(x0 + PATH_CLUSTER_SIZE, width);
+	const int y0 = cluster / clustersX * PATH_CLUSTER_SIZE, y1 = std::min(y0 + PATH_CLUSTER_SIZE, height);
+	const int w = x1 - x0;
+
+	dist.assign(static_cast<size_t>(w) * (y1 - y0), UINT32_MAX);
+	std::vector<std::pair<unsigned, int>> open;  // Min-heap of (distance, tile), ties broken by tile index.
+	dist[localIndex(cluster, from)] = 0;
+	open.emplace_back(0, static_cast<int>(localIndex(cluster, from)));
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), std::greater<std::pair<unsigned, int>>());
+		const unsigned d = open.back().first;
+		const int i = open.back().second;
+		open.pop_back();
+		if (d != dist[i])
+		{
+			continue;  // Already reached this tile by a shorter route.
+		}
+		const int x = x0 + i % w, y = y0 + i / w;
+		for (unsigned dir = 0; dir < ARRAY_SIZE(aDirOffset); ++dir)
+		{
+			const int nx = x + aDirOffset[dir].x, ny = y + aDirOffset[dir].y;
+			if (nx < x0 || nx >= x1 || ny < y0 || ny >= y1 || isBlocked(nx, ny))
+			{
+				continue;
+			}
+			// Same corner cutting rule as fpathAStarExplore.
+			if (dir % 2 != 0 && (isBlocked(x + aDirOffset[(dir + 1) % 8].x, y + aDirOffset[(dir + 1) % 8].y) ||
+			                     isBlocked(x + aDirOffset[(dir + 7) % 8].x, y + aDirOffset[(dir + 7) % 8].y)))
+			{
+				continue;
+			}
+			const unsigned nd = d + fpathEstimate(PathCoord(x, y), PathCoord(nx, ny)) * costFactor(nx, ny);
+			const int ni = (nx - x0) + (ny - y0) * w;
+			if (nd < dist[ni])
+			{
+				dist[ni] = nd;
+				open.emplace_back(nd, ni);
+				std::push_heap(open.begin(), open.end(), std::greater<std::pair<unsigned, int>>());
+			}
+		}
+	}
+}
+
+bool PathClusterGraph::findCorridor(const PathBlockingMap &blockingMap, PathCoord tileS, PathCoord tileF, PathNonblockingArea const &dstIgnore, std::vector<bool> &corridor)
+{
+	corridor.clear();
+	if (std::max(abs(tileS.x / PATH_CLUSTER_SIZE - tileF.x / PATH_CLUSTER_SIZE), abs(tileS.y / PATH_CLUSTER_SIZE - tileF.y / PATH_CLUSTER_SIZE)) < PATH_CLUSTER_MIN_DISTANCE)
+	{
+		return false;  // Short route, plain A* is fast enough.
+	}
+
+	ensureBuilt(blockingMap);
+
+	if (isBlocked(tileS.x, tileS.y))
+	{
+		return false;
+	}
+	PathCoord goal = tileF;
+	if (isBlocked(goal.x, goal.y))
+	{
+		if (dstIgnore == PathNonblockingArea())
+		{
+			return false;
+		}
+		// Destination is a structure, so aim for the open tile next to it which is nearest to the start.
+		unsigned bestEst = UINT32_MAX;
+		for (int y = dstIgnore.y1 - 1; y <= dstIgnore.y2; ++y)
+			for (int x = dstIgnore.x1 - 1; x <= dstIgnore.x2; ++x)
+			{
+				if (dstIgnore.isNonblocking(x, y) || isBlocked(x, y))
+				{
+					continue;
+				}
+				unsigned est = fpathEstimate(tileS, PathCoord(x, y));
+				if (est < bestEst)
+				{
+					bestEst = est;
+					goal = PathCoord(x, y);
+				}
+			}
+		if (bestEst == UINT32_MAX)
+		{
+			return false;
+		}
+	}
+
+	const int startCluster = clusterOf(tileS);
+	const int goalCluster = clusterOf(goal);
+	std::vector<unsigned> startCosts, goalCosts;
+	localCosts(startCluster, tileS, startCosts);
+	localCosts(goalCluster, goal, goalCosts);
+	auto nodeCoord = [&](uint32_t node) {
+		return clusters[nodeCluster[node]].entrances[node - firstNode[nodeCluster[node]]];
+	};
+
+	// A* over the entrances, with an extra node for the goal. Ties are broken by node number, so all clients pick the same route.
+	const uint32_t goalNode = firstNode.back();
+	std::vector<unsigned> dist(goalNode + 1, UINT32_MAX);
+	std::vector<uint32_t> prevNode(goalNode + 1, UINT32_MAX);
+	struct OpenNode
+	{
+		bool operator <(OpenNode const &z) const
+		{
+			if (est != z.est)
+			{
+				return est > z.est;
+			}
+			return node > z.node;
+		}
+		unsigned est, dist;
+		uint32_t node;
+	};
+	std::vector<OpenNode> open;
+	auto relax = [&](uint32_t node, unsigned d, uint32_t from) {
+		if (d >= dist[node])
+		{
+			return;
+		}
+		dist[node] = d;
+		prevNode[node] = from;
+		open.push_back({d + (node == goalNode ? 0 : fpathGoodEstimate(nodeCoord(node), goal)), d, node});
+		std::push_heap(open.begin(), open.end());
+	};
+
+	for (uint32_t node = firstNode[startCluster]; node < firstNode[startCluster + 1]; ++node)
+	{
+		unsigned d = startCosts[localIndex(startCluster, nodeCoord(node))];
+		if (d != UINT32_MAX)
+		{
+			relax(node, d, UINT32_MAX);
+		}
+	}
+	bool found = false;
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end());
+		OpenNode cur = open.back();
+		open.pop_back();
+		if (cur.dist != dist[cur.node])
+		{
+			continue;
+		}
+		if (cur.node == goalNode)
+		{
+			found = true;
+			break;
+		}
+		const uint32_t c = nodeCluster[cur.node];
+		const uint32_t e = cur.node - firstNode[c];
+		PathCluster const &cluster = clusters[c];
+		if (static_cast<int>(c) == goalCluster)
+		{
+			unsigned d = goalCosts[localIndex(goalCluster, cluster.entrances[e])];
+			if (d != UINT32_MAX)
+			{
+				relax(goalNode, cur.dist + d, cur.node);
+			}
+		}
+		const size_t numEntrances = cluster.entrances.size();
+		for (size_t k = 0; k < numEntrances; ++k)
+		{
+			unsigned d = cluster.costs[e * numEntrances + k];
+			if (k != e && d != UINT32_MAX)
+			{
+				relax(firstNode[c] + k, cur.dist + d, cur.node);
+			}
+		}
+		const uint32_t partner = partnerNode[cur.node];
+		if (partner != UINT32_MAX)
+		{
+			PathCoord p = cluster.partners[e];
+			relax(partner, cur.dist + fpathEstimate(cluster.entrances[e], p) * costFactor(p.x, p.y), cur.node);
+		}
+	}
+	if (!found)
+	{
+		return false;
+	}
+
+	corridor.assign(clusters.size(), false);
+	corridor[startCluster] = true;
+	corridor[goalCluster] = true;
+	corridor[clusterOf(tileF)] = true;
+	for (int y = std::max<int>(dstIgnore.y1, 0); y < std::min<int>(dstIgnore.y2, height); ++y)
+		for (int x = std::max<int>(dstIgnore.x1, 0); x < std::min<int>(dstIgnore.x2, width); ++x)
+		{
+			corridor[clusterOf(PathCoord(x, y))] = true;
+		}
+	for (uint32_t node = prevNode[goalNode]; node != UINT32_MAX; node = prevNode[node])
+	{
+		corridor[nodeCluster[node]] = true;
+	}
+	return true;
+}
+
 /** Generate a new node
  */
 static inline void fpathNewNode(PathfindContext &context, PathCoord dest, PathCoord pos, unsigned prevDist, PathCoord prevPos)
@@ -284,7 +885,14 @@ static inline void fpathNewNode(PathfindContext &context, PathCoord dest, PathCo
 	bool isDiagonal = delta.x && delta.y;
 
 	PathExploredTile &expl = context.map[pos.x + pos.y * gameWorld.map.width];
-	if (expl.iteration == context.iteration)
+	if (expl.iteration == context.iteration && expl.trail && expl.dist <= node.dist)
+	{
+		// Jump point search only: a jump passed over this tile by a shorter way, so keep that way back.
+		node.est -= node.dist - expl.dist;
+		node.dist = expl.dist;
+		delta = Vector2i(expl.dx, expl.dy);
+	}
+	else if (expl.iteration == context.iteration && !expl.trail)
 	{
 		if (expl.visited)
 		{
@@ -306,54 +914,394 @@ static inline void fpathNewNode(PathfindContext &context, PathCoord dest, PathCo
 			unsigned distB = expl.dist - (isDiagonal ? 140 : 198) * costFactor;
 			if (!isDiagonal)
 			{
-				std::swap(distA, distB);
-				std::swap(deltaA, deltaB);
+				std::swap(distA, distB);
+				std::swap(deltaA, deltaB);
+			}
+			int gradientX = int(distB - distA) / costFactor;
+			if (gradientX > 0 && gradientX <= 98)  // 98 = floor(140/√2), so gradientX <= 98 is needed so that gradientX < gradientY.
+			{
+				// The distance gradient is now known to be somewhere between the direction from A to P and the direction from B to P.
+				static const uint8_t gradYLookup[99] = {140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 139, 139, 139, 139, 139, 139, 139, 139, 139, 138, 138, 138, 138, 138, 138, 137, 137, 137, 137, 137, 136, 136, 136, 136, 135, 135, 135, 134, 134, 134, 134, 133, 133, 133, 132, 132, 132, 131, 131, 130, 130, 130, 129, 129, 128, 128, 127, 127, 126, 126, 126, 125, 125, 124, 123, 123, 122, 122, 121, 121, 120, 119, 119, 118, 118, 117, 116, 116, 115, 114, 113, 113, 112, 111, 110, 110, 109, 108, 107, 106, 106, 105, 104, 103, 102, 101, 100};
+				int gradientY = gradYLookup[gradientX];  // = sqrt(140² -  gradientX²), rounded to nearest integer
+				unsigned distP = gradientY * costFactor + distB;
+				node.est -= node.dist - distP;
+				node.dist = distP;
+				delta = (deltaA * gradientX + deltaB * (gradientY - gradientX)) / gradientY;
+			}
+		}
+		if (expl.dist <= node.dist)
+		{
+			return;  // A different path to this tile is shorter.
+		}
+	}
+
+	// Remember where we have been, and remember the way back.
+	expl.iteration = context.iteration;
+	expl.dx = delta.x;
+	expl.dy = delta.y;
+	expl.dist = node.dist;
+	expl.jump = 0;
+	expl.visited = false;
+	expl.trail = false;
+
+	// Add the node to the node heap.
+	context.nodes.push_back(node);                               // Add the new node to nodes.
+	std::push_heap(context.nodes.begin(), context.nodes.end());  // Move the new node to the right place in the heap.
+}
+
+/// Recalculates estimates to new tileF tile.
+static void fpathAStarReestimate(PathfindContext &context, PathCoord tileF)
+{
+	for (auto &node : context.nodes)
+	{
+		node.est = node.dist + fpathGoodEstimate(node.p, tileF);
+	}
+
+	// Changing the estimates breaks the heap ordering. Fix the heap ordering.
+	std::make_heap(context.nodes.begin(), context.nodes.end());
+}
+
+/** Jump point search (Harabor & Grastien), for the variant where diagonal moves may not cut corners.
+ *
+ *  Only used with uniform costs (no danger map). Instead of pushing all 8 neighbours of every expanded tile, each
+ *  expanded tile scans in straight lines and only pushes the tiles where the route might turn (jump points). The
+ *  tiles passed over are marked as trail tiles, so that the nearest reachable tile can still be found. Trail tiles
+ *  remember the shortest way back of the jumps over them, and a jump point takes that way back if it is shorter than
+ *  the jump which found it, so every expanded tile has its shortest distance, as with plain A*, and the context can
+ *  be reused from it. Trail tiles themselves may not have been passed over by their shortest way yet, so routes never
+ *  start from one: fpathAStarRoute searches again instead, with the tile as the target, which makes it a jump point.
+ *  Tiles in or next to dstIgnore are always jump points and have all their neighbours pushed as in fpathAStarExplore,
+ *  since the corner cutting rule does not apply there.
+ */
+struct PathJumpScan
+{
+	PathfindContext &context;
+	PathCoord tileF;
+	PathCoord nearestCoord;
+	unsigned nearestDist;
+
+	bool isOpen(int x, int y) const
+	{
+		return !context.isBlocked(x, y);
+	}
+
+	/// Marks a tile passed over by a jump. Returns true if the tile must be a jump point regardless of its neighbours.
+	bool passOver(int x, int y, int dx, int dy, unsigned dist)
+	{
+		PathExploredTile &expl = context.map[x + y * gameWorld.map.width];
+		if (expl.iteration != context.iteration)
+		{
+			// Remember the way back from the first jump which passed over this tile. Not necessarily the shortest.
+			expl.iteration = context.iteration;
+			expl.dx = dx * 64;
+			expl.dy = dy * 64;
+			expl.dist = dist;
+			expl.jump = 0;
+			expl.visited = false;
+			expl.trail = true;
+
+			unsigned est = fpathGoodEstimate(PathCoord(x, y), tileF);
+			if (est < nearestDist)
+			{
+				nearestCoord = PathCoord(x, y);
+				nearestDist = est;
+			}
+		}
+		else if (expl.trail && dist < expl.dist)
+		{
+			// Remember the shortest way back from the jumps so far, in case the tile becomes a jump point later.
+			expl.dx = dx * 64;
+			expl.dy = dy * 64;
+			expl.dist = dist;
+		}
+		else if (!expl.trail && !expl.visited && dist < expl.dist)
+		{
+			return true;  // A jump point found earlier, but this is a shorter way to it. Push it again, so that it is expanded with its shortest distance.
+		}
+		return PathCoord(x, y) == tileF || context.isNearDstIgnore(x, y);
+	}
+
+	/// Adds a jump point found length tiles from the expanded tile in direction dx, dy.
+	void push(int x, int y, int dx, int dy, unsigned length, unsigned dist)
+	{
+		PathExploredTile &expl = context.map[x + y * gameWorld.map.width];
+		if (expl.iteration == context.iteration && !expl.trail && (expl.visited || expl.dist <= dist))
+		{
+			return;  // Already visited, or a different path to this tile is shorter.
+		}
+		if (expl.iteration == context.iteration && expl.trail && expl.dist < dist)
+		{
+			// An earlier jump passed over this tile by a shorter way. Keep that way back, a single step in the direction that jump went.
+			dist = expl.dist;
+			length = 1;
+		}
+		else
+		{
+			expl.dx = dx * 64;
+			expl.dy = dy * 64;
+			expl.dist = dist;
+		}
+		expl.iteration = context.iteration;
+		expl.jump = length;
+		expl.visited = false;
+		expl.trail = false;
+
+		PathNode node;
+		node.p = PathCoord(x, y);
+		node.dist = dist;
+		node.est = dist + fpathGoodEstimate(node.p, tileF);
+		context.nodes.push_back(node);
+		std::push_heap(context.nodes.begin(), context.nodes.end());
+	}
+
+	enum class ScanStep
+	{
+		Next,       ///< Keep scanning.
+		Blocked,    ///< The tile is blocked, so there is no jump point.
+		JumpPoint,  ///< The tile is a jump point.
+	};
+
+	/// Checks the tile (x, y) of a straight scan in direction dx, dy, length tiles from the expanded tile.
+	ScanStep scanStep(int x, int y, int dx, int dy, unsigned length, unsigned dist)
+	{
+		if (!isOpen(x, y))
+		{
+			return ScanStep::Blocked;
+		}
+		if (passOver(x, y, dx, dy, dist + 140 * length))
+		{
+			return ScanStep::JumpPoint;
+		}
+		// Forced neighbours: an open tile beside us, which was blocked beside the previous tile.
+		if (dx != 0 ? (isOpen(x, y - 1) && !isOpen(x - dx, y - 1)) || (isOpen(x, y + 1) && !isOpen(x - dx, y + 1))
+		            : (isOpen(x - 1, y) && !isOpen(x - 1, y - dy)) || (isOpen(x + 1, y) && !isOpen(x + 1, y - dy)))
+		{
+			return ScanStep::JumpPoint;
+		}
+		return ScanStep::Next;
+	}
+
+	/// Scans from (x, y) in the straight direction dx, dy. Returns the number of tiles to the jump point, or 0 if there is none.
+	unsigned scanStraight(int x, int y, int dx, int dy, unsigned dist)
+	{
+		if (dy == 0 && (context.dstIgnore.x1 == context.dstIgnore.x2 || y + 1 < context.dstIgnore.y1 - 1 || y - 1 > context.dstIgnore.y2))
+		{
+			return scanRow(x, y, dx, dist);
+		}
+		for (unsigned length = 1; ; ++length)
+		{
+			switch (scanStep(x + dx * length, y + dy * length, dx, dy, length, dist))
+			{
+			case ScanStep::Next:      break;
+			case ScanStep::Blocked:   return 0;
+			case ScanStep::JumpPoint: return length;
+			}
+		}
+	}
+
+	/// Same as scanStraight, for scans along row y which do not pass by dstIgnore.
+	/// Looks for the next blocked tile and the next forced neighbour a word of the blocking map at a time.
+	unsigned scanRow(int x, int y, int dx, unsigned dist)
+	{
+		PathBitMap const &map = context.blockingMap->map;
+		unsigned length = 1;
+		int next = x + dx;
+		while (true)
+		{
+			// The first tile of each cluster is checked on its own, since the corridor may differ from the tile behind it.
+			switch (scanStep(next, y, dx, 0, length, dist))
+			{
+			case ScanStep::Next:      break;
+			case ScanStep::Blocked:   return 0;
+			case ScanStep::JumpPoint: return length;
+			}
+
+			// The rest of the cluster, or of the row if there is no corridor, has the same corridor, so only the blocking map needs checking.
+			const int clusterBegin = context.corridor.empty() ? 0 : next / PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE;
+			const int clusterEnd = context.corridor.empty() ? gameWorld.map.width : std::min(clusterBegin + PATH_CLUSTER_SIZE, gameWorld.map.width);
+			const int end = dx > 0 ? clusterEnd : clusterBegin - 1;  // First tile past the cluster.
+			auto findAhead = [&](int row, int from, bool value) {
+				return dx > 0 ? map.findInRow(row, from, clusterEnd, value) : map.findLastInRow(row, clusterBegin, from + 1, value);
+			};
+
+			const int blockedAt = findAhead(y, next + dx, true);
+			int stop = blockedAt;
+			for (int row : {y - 1, y + 1})
+			{
+				if (row < 0 || row >= gameWorld.map.height || !context.isInCorridor(PathCoord(next, row)))
+				{
+					continue;  // Blocked all along, so there are no forced neighbours on this side.
+				}
+				const int wall = findAhead(row, next, true);
+				const int forced = wall != end ? findAhead(row, wall + dx, false) : end;  // First open tile after a blocked one.
+				if ((forced - stop) * dx < 0)
+				{
+					stop = forced;
+				}
+			}
+
+			while ((next += dx) != stop)
+			{
+				++length;
+				if (passOver(next, y, dx, 0, dist + 140 * length))
+				{
+					return length;
+				}
+			}
+			++length;
+			if (stop == end)
+			{
+				continue;  // On to the next cluster.
+			}
+			if (stop == blockedAt)
+			{
+				return 0;
+			}
+			passOver(next, y, dx, 0, dist + 140 * length);
+			return length;  // Forced neighbour.
+		}
+	}
+
+	/// Scans from (x, y) in the diagonal direction dx, dy. Returns the number of tiles to the jump point, or 0 if there is none.
+	unsigned scanDiagonal(int x, int y, int dx, int dy, unsigned dist)
+	{
+		for (unsigned length = 1; ; ++length)
+		{
+			if (!isOpen(x + dx, y) || !isOpen(x, y + dy))
+			{
+				return 0;  // We cannot cut corners.
+			}
+			x += dx;
+			y += dy;
+			if (!isOpen(x, y))
+			{
+				return 0;
+			}
+			const unsigned tileDist = dist + 198 * length;
+			if (passOver(x, y, dx, dy, tileDist))
+			{
+				return length;
+			}
+			if (scanStraight(x, y, dx, 0, tileDist) != 0 || scanStraight(x, y, 0, dy, tileDist) != 0)
+			{
+				return length;
+			}
+		}
+	}
+
+	void jump(PathNode const &node, int dx, int dy)
+	{
+		unsigned length = dx != 0 && dy != 0 ? scanDiagonal(node.p.x, node.p.y, dx, dy, node.dist) : scanStraight(node.p.x, node.p.y, dx, dy, node.dist);
+		if (length != 0)
+		{
+			push(node.p.x + dx * length, node.p.y + dy * length, dx, dy, length, node.dist + (dx != 0 && dy != 0 ? 198 : 140) * length);
+		}
+	}
+
+	void expand(PathNode const &node, PathExploredTile const &expl)
+	{
+		const int x = node.p.x, y = node.p.y;
+		if (context.isNearDstIgnore(x, y))
+		{
+			// Same neighbours as fpathAStarExplore.
+			for (unsigned dir = 0; dir < ARRAY_SIZE(aDirOffset); ++dir)
+			{
+				int nx = x + aDirOffset[dir].x;
+				int ny = y + aDirOffset[dir].y;
+				if (dir % 2 != 0 && !context.dstIgnore.isNonblocking(x, y) && !context.dstIgnore.isNonblocking(nx, ny)
+				    && (!isOpen(x + aDirOffset[(dir + 1) % 8].x, y + aDirOffset[(dir + 1) % 8].y) || !isOpen(x + aDirOffset[(dir + 7) % 8].x, y + aDirOffset[(dir + 7) % 8].y)))
+				{
+					continue;
+				}
+				if (isOpen(nx, ny))
+				{
+					fpathNewNode(context, tileF, PathCoord(nx, ny), node.dist, node.p);
+				}
 			}
-			int gradientX = int(distB - distA) / costFactor;
-			if (gradientX > 0 && gradientX <= 98)  // 98 = floor(140/√2), so gradientX <= 98 is needed so that gradientX < gradientY.
+			return;
+		}
+		if (expl.jump == 0)
+		{
+			// Start tile, or reached by a single step, so we do not know which neighbours can be pruned.
+			for (unsigned dir = 0; dir < ARRAY_SIZE(aDirOffset); ++dir)
 			{
-				// The distance gradient is now known to be somewhere between the direction from A to P and the direction from B to P.
-				static const uint8_t gradYLookup[99] = {140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 139, 139, 139, 139, 139, 139, 139, 139, 139, 138, 138, 138, 138, 138, 138, 137, 137, 137, 137, 137, 136, 136, 136, 136, 135, 135, 135, 134, 134, 134, 134, 133, 133, 133, 132, 132, 132, 131, 131, 130, 130, 130, 129, 129, 128, 128, 127, 127, 126, 126, 126, 125, 125, 124, 123, 123, 122, 122, 121, 121, 120, 119, 119, 118, 118, 117, 116, 116, 115, 114, 113, 113, 112, 111, 110, 110, 109, 108, 107, 106, 106, 105, 104, 103, 102, 101, 100};
-				int gradientY = gradYLookup[gradientX];  // = sqrt(140² -  gradientX²), rounded to nearest integer
-				unsigned distP = gradientY * costFactor + distB;
-				node.est -= node.dist - distP;
-				node.dist = distP;
-				delta = (deltaA * gradientX + deltaB * (gradientY - gradientX)) / gradientY;
+				jump(node, aDirOffset[dir].x, aDirOffset[dir].y);
 			}
+			return;
 		}
-		if (expl.dist <= node.dist)
+
+		const int dx = (expl.dx > 0) - (expl.dx < 0);
+		const int dy = (expl.dy > 0) - (expl.dy < 0);
+		if (dx != 0 && dy != 0)
 		{
-			return;  // A different path to this tile is shorter.
+			jump(node, dx, 0);
+			jump(node, 0, dy);
+			jump(node, dx, dy);
+		}
+		else if (dx != 0)
+		{
+			jump(node, dx, 0);
+			jump(node, dx, 1);
+			jump(node, dx, -1);
+			jump(node, 0, 1);
+			jump(node, 0, -1);
+		}
+		else
+		{
+			jump(node, 0, dy);
+			jump(node, 1, dy);
+			jump(node, -1, dy);
+			jump(node, 1, 0);
+			jump(node, -1, 0);
 		}
 	}
+};
 
-	// Remember where we have been, and remember the way back.
-	expl.iteration = context.iteration;
-	expl.dx = delta.x;
-	expl.dy = delta.y;
-	expl.dist = node.dist;
-	expl.visited = false;
-
-	// Add the node to the node heap.
-	context.nodes.push_back(node);                               // Add the new node to nodes.
-	std::push_heap(context.nodes.begin(), context.nodes.end());  // Move the new node to the right place in the heap.
-}
-
-/// Recalculates estimates to new tileF tile.
-static void fpathAStarReestimate(PathfindContext &context, PathCoord tileF)
+/// Same as fpathAStarExplore, using jump point search.
+static PathCoord fpathJumpPointExplore(PathfindContext &context, PathCoord tileF)
 {
-	for (auto &node : context.nodes)
+	PathJumpScan scan{context, tileF, PathCoord(0, 0), 0xFFFFFFFF};
+
+	// search for a route
+	bool foundIt = false;
+	while (!context.nodes.empty() && !foundIt)
 	{
-		node.est = node.dist + fpathGoodEstimate(node.p, tileF);
+		PathNode node = fpathTakeNode(context.nodes);
+		PathExploredTile &expl = context.map[node.p.x + node.p.y * gameWorld.map.width];
+		if (expl.visited)
+		{
+			continue;  // Already been here.
+		}
+		expl.visited = true;
+		++context.expandedNodes;
+
+		// note the nearest node to the target so far
+		if (node.est - node.dist < scan.nearestDist)
+		{
+			scan.nearestCoord = node.p;
+			scan.nearestDist = node.est - node.dist;
+		}
+
+		if (node.p == tileF)
+		{
+			// reached the target
+			scan.nearestCoord = node.p;
+			foundIt = true;  // Break out of loop, but not before inserting neighbour nodes, since the neighbours may be important if the context gets reused.
+		}
+
+		scan.expand(node, expl);
 	}
 
-	// Changing the estimates breaks the heap ordering. Fix the heap ordering.
-	std::make_heap(context.nodes.begin(), context.nodes.end());
+	return scan.nearestCoord;
 }
 
 /// Returns nearest explored tile to tileF.
 static PathCoord fpathAStarExplore(PathfindContext &context, PathCoord tileF)
 {
+	if (context.jumpPoints)
+	{
+		return fpathJumpPointExplore(context, tileF);
+	}
 	PathCoord       nearestCoord(0, 0);
 	unsigned        nearestDist = 0xFFFFFFFF;
 
@@ -367,6 +1315,7 @@ static PathCoord fpathAStarExplore(PathfindContext &context, PathCoord tileF)
 			continue;  // Already been here.
 		}
 		context.map[node.p.x + node.p.y * gameWorld.map.width].visited = true;
+		++context.expandedNodes;
 
 		// note the nearest node to the target so far
 		if (node.est - node.dist < nearestDist)
@@ -499,38 +1448,45 @@ public:
 
 public:
 
-	Iterator push_back(PathfindContext& ctx);
-	Iterator push_back(PathfindContext&& ctx);
+	/// Adds an empty context at the back, reusing the memory of one forgotten by clear() if there is one.
+	Iterator emplace_back();
 
 	void moveToFront(Iterator it); // invalidates any iterators
 
 	Iterator begin() { return Iterator(*this, 0); }
 	Iterator end() { return Iterator(*this, orderedIndexes.size()); }
 
+	/// Forgets all contexts, but keeps their memory for emplace_back.
 	void clear();
 
-	bool empty() const { return contexts.empty(); }
+	bool empty() const { return orderedIndexes.empty(); }
 	PathfindContext& front() { return contexts[orderedIndexes.front()]; }
 
-	size_t size() const { return contexts.size(); }
+	size_t size() const { return orderedIndexes.size(); }
 
 private:
-	std::vector<PathfindContext> contexts;
+	std::vector<PathfindContext> contexts;  ///< The first size() are in use, in the order given by orderedIndexes.
 	std::vector<size_t> orderedIndexes;
 };
 
-PathfindContextList::Iterator PathfindContextList::push_back(PathfindContext& ctx)
-{
-	contexts.push_back(ctx);
-	orderedIndexes.push_back(contexts.size() - 1);
-	return Iterator(*this, orderedIndexes.size() - 1);
-}
-
-PathfindContextList::Iterator PathfindContextList::push_back(PathfindContext&& ctx)
+PathfindContextList::Iterator PathfindContextList::emplace_back()
 {
-	contexts.push_back(std::move(ctx));
-	orderedIndexes.push_back(contexts.size() - 1);
-	return Iterator(*this, orderedIndexes.size() - 1);
+	const size_t index = orderedIndexes.size();
+	if (index == contexts.size())
+	{
+		contexts.emplace_back();
+	}
+	else
+	{
+		// Keep the allocated map and nodes. The map needs no clearing, since assign() changes the iteration.
+		PathfindContext &ctx = contexts[index];
+		ctx.myGameTime = 0;
+		ctx.corridor.clear();
+		ctx.jumpPoints = false;
+		ctx.expandedNodes = 0;
+	}
+	orderedIndexes.push_back(index);
+	return Iterator(*this, index);
 }
 
 void PathfindContextList::moveToFront(Iterator it)
@@ -541,21 +1497,49 @@ void PathfindContextList::moveToFront(Iterator it)
 
 void PathfindContextList::clear()
 {
-	contexts.clear();
+	for (auto &ctx : contexts)
+	{
+		ctx.blockingMap.reset();  // Let the blocking maps of old ticks go.
+		ctx.nodes.clear();
+	}
 	orderedIndexes.clear();
 }
 
+/// A route found by a search, which later jobs of the same cohort starting nearby can join instead of searching again.
+struct PathRouteCacheEntry
+{
+	std::shared_ptr<const PathBlockingMap> blockingMap;
+	int sourceRegion;                   ///< fpathClusterIndex of the start tile of the route.
+	PathCoord tileDest;
+	PathNonblockingArea dstIgnore;
+	ASR_RETVAL retval;
+	std::vector<Vector2i> path;         ///< Waypoints from start to destination, as returned in MOVE_CONTROL::asPath.
+};
+
+static constexpr size_t PATH_ROUTE_CACHE_MAX_ENTRIES = 16;
+static constexpr size_t PATH_ROUTE_CACHE_MAX_WAYPOINTS = 16384;
+
+static std::atomic<uint64_t> fpathRouteCacheLookups{0};
+static std::atomic<uint64_t> fpathRouteCacheHits{0};
+static std::atomic<uint64_t> fpathRouteCacheStores{0};
+static std::atomic<uint64_t> fpathRouteCacheEvictions{0};
+
 class FPathExecuteContextImpl : public FPathExecuteContext
 {
 public:
 	virtual ~FPathExecuteContextImpl();
 
 	void resetForNewGameTimeIfNeeded(const PATHJOB& job);
+	bool serveFromRouteCache(const PATHJOB& job, PathCoord tileOrig, PathCoord tileDest, PathNonblockingArea const &dstIgnore, MOVE_CONTROL *psMove, ASR_RETVAL &retval);
+	void storeInRouteCache(const PATHJOB& job, PathCoord tileOrig, PathCoord tileDest, PathNonblockingArea const &dstIgnore, MOVE_CONTROL const *psMove, ASR_RETVAL retval);
 public:
 	/// Last recently used list of contexts.
 	PathfindContextList fpathContexts;
 	/// Used to avoid extra allocations in fpathAStarRoute
 	std::vector<Vector2i> pathBuffer;
+	/// Most recently used routes first. Only holds routes of the current game tick, since they are only valid for that tick's blocking maps.
+	std::deque<PathRouteCacheEntry> routeCache;
+	size_t routeCacheWaypoints = 0;
 };
 
 FPathExecuteContext::~FPathExecuteContext()
@@ -570,6 +1554,123 @@ void FPathExecuteContextImpl::resetForNewGameTimeIfNeeded(const PATHJOB& job)
 	{
 		fpathContexts.clear();
 	}
+	if (!routeCache.empty() && job.blockingMap->type.gameTime != routeCache.front().blockingMap->type.gameTime)
+	{
+		routeCache.clear();
+		routeCacheWaypoints = 0;
+	}
+}
+
+/// Returns true if a droid can walk in a straight line from the centre of tile a to the centre of tile b, without cutting corners or entering dangerous tiles.
+static bool fpathStraightLineClear(const PathBlockingMap &blockingMap, PathNonblockingArea const &dstIgnore, PathCoord a, PathCoord b)
+{
+	auto isOpen = [&](int x, int y) {
+		return dstIgnore.isNonblocking(x, y) || (!blockingMap.map.get(x, y) && (blockingMap.dangerMap.empty() || !blockingMap.dangerMap.get(x, y)));
+	};
+
+	// Visit every tile the line passes through. Where it passes exactly through a corner, both tiles beside the corner must be open.
+	const int dx = abs(b.x - a.x), dy = abs(b.y - a.y);
+	const int xInc = b.x > a.x ? 1 : -1, yInc = b.y > a.y ? 1 : -1;
+	int x = a.x, y = a.y;
+	int error = dx - dy;
+	for (int n = dx + dy; n > 0; --n)
+	{
+		if (!isOpen(x, y))
+		{
+			return false;
+		}
+		if (error > 0)
+		{
+			x += xInc;
+			error -= 2 * dy;
+		}
+		else if (error < 0)
+		{
+			y += yInc;
+			error += 2 * dx;
+		}
+		else
+		{
+			if (!isOpen(x + xInc, y) || !isOpen(x, y + yInc))
+			{
+				return false;
+			}
+			x += xInc;
+			y += yInc;
+			error += 2 * dx - 2 * dy;
+			--n;
+		}
+	}
+	return isOpen(x, y);
+}
+
+/// Serves a job from a route found earlier in the same cohort, if the route passes through the cluster the job starts in,
+/// and the droid can walk straight onto it. Joins the route as close to the destination as possible.
+bool FPathExecuteContextImpl::serveFromRouteCache(const PATHJOB& job, PathCoord tileOrig, PathCoord tileDest, PathNonblockingArea const &dstIgnore, MOVE_CONTROL *psMove, ASR_RETVAL &retval)
+{
+	++fpathRouteCacheLookups;
+	const int sourceRegion = fpathClusterIndex(tileOrig.x, tileOrig.y);
+	for (auto entry = routeCache.begin(); entry != routeCache.end(); ++entry)
+	{
+		if (entry->blockingMap != job.blockingMap || entry->sourceRegion != sourceRegion || entry->tileDest != tileDest || entry->dstIgnore != dstIgnore)
+		{
+			continue;
+		}
+
+		for (size_t k = entry->path.size(); k-- > 0; )
+		{
+			const Vector2i tile = map_coord(entry->path[k]);
+			if (fpathClusterIndex(tile.x, tile.y) != sourceRegion || !fpathStraightLineClear(*job.blockingMap, dstIgnore, tileOrig, PathCoord(tile.x, tile.y)))
+			{
+				continue;
+			}
+
+			psMove->asPath.clear();
+			if (tile != Vector2i(tileOrig.x, tileOrig.y))
+			{
+				psMove->asPath.push_back(Vector2i(world_coord(tileOrig.x) + TILE_UNITS / 2, world_coord(tileOrig.y) + TILE_UNITS / 2));
+			}
+			psMove->asPath.insert(psMove->asPath.end(), entry->path.begin() + k, entry->path.end());
+			retval = entry->retval;
+			if (retval == ASR_OK)
+			{
+				psMove->asPath.back() = Vector2i(job.destX, job.destY);  // Same destination tile, but maybe not the same point in it.
+			}
+			psMove->destination = psMove->asPath.back();
+
+			std::rotate(routeCache.begin(), entry, entry + 1);  // Most recently used first.
+			++fpathRouteCacheHits;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FPathExecuteContextImpl::storeInRouteCache(const PATHJOB& job, PathCoord tileOrig, PathCoord tileDest, PathNonblockingArea const &dstIgnore, MOVE_CONTROL const *psMove, ASR_RETVAL retval)
+{
+	if (psMove->asPath.size() > PATH_ROUTE_CACHE_MAX_WAYPOINTS)
+	{
+		return;
+	}
+	routeCache.push_front(PathRouteCacheEntry{job.blockingMap, fpathClusterIndex(tileOrig.x, tileOrig.y), tileDest, dstIgnore, retval, psMove->asPath});
+	routeCacheWaypoints += psMove->asPath.size();
+	++fpathRouteCacheStores;
+	while (routeCache.size() > PATH_ROUTE_CACHE_MAX_ENTRIES || routeCacheWaypoints > PATH_ROUTE_CACHE_MAX_WAYPOINTS)
+	{
+		routeCacheWaypoints -= routeCache.back().path.size();
+		routeCache.pop_back();
+		++fpathRouteCacheEvictions;
+	}
+}
+
+PathRouteCacheStats fpathRouteCacheStats()
+{
+	PathRouteCacheStats stats;
+	stats.lookups = fpathRouteCacheLookups;
+	stats.hits = fpathRouteCacheHits;
+	stats.stores = fpathRouteCacheStores;
+	stats.evictions = fpathRouteCacheEvictions;
+	return stats;
 }
 
 std::shared_ptr<FPathExecuteContext> makeFPathExecuteContext()
@@ -577,6 +1678,14 @@ std::shared_ptr<FPathExecuteContext> makeFPathExecuteContext()
 	return std::make_shared<FPathExecuteContextImpl>();
 }
 
+void fpathClearExecuteContext(const std::shared_ptr<FPathExecuteContext>& ctx)
+{
+	auto ctxImpl = std::static_pointer_cast<FPathExecuteContextImpl>(ctx);
+	ctxImpl->fpathContexts.clear();
+	ctxImpl->routeCache.clear();
+	ctxImpl->routeCacheWaypoints = 0;
+}
+
 ASR_RETVAL fpathAStarRoute(const std::shared_ptr<FPathExecuteContext>& ctx, MOVE_CONTROL *psMove, PATHJOB *psJob)
 {
 	ASR_RETVAL      retval = ASR_OK;
@@ -591,6 +1700,11 @@ ASR_RETVAL fpathAStarRoute(const std::shared_ptr<FPathExecuteContext>& ctx, MOVE
 	const PathCoord tileDest(map_coord(psJob->destX), map_coord(psJob->destY));
 	const PathNonblockingArea dstIgnore(psJob->dstStructure);
 
+	if (ctxImpl->serveFromRouteCache(*psJob, tileOrig, tileDest, dstIgnore, psMove, retval))
+	{
+		return retval;
+	}
+
 	PathCoord endCoord;  // Either nearest coord (mustReverse = true) or orig (mustReverse = false).
 
 	auto contextIterator = fpathContexts.begin();
@@ -601,15 +1715,25 @@ ASR_RETVAL fpathAStarRoute(const std::shared_ptr<FPathExecuteContext>& ctx, MOVE
 			// This context is not for the same droid type and same destination.
 			continue;
 		}
+		if (!contextIterator->isInCorridor(tileOrig))
+		{
+			// This context is restricted to a coarse route which does not pass by orig.
+			continue;
+		}
 
 		// We have tried going to tileDest before.
 
-		if (contextIterator->map[tileOrig.x + tileOrig.y * gameWorld.map.width].iteration == contextIterator->iteration
-		    && contextIterator->map[tileOrig.x + tileOrig.y * gameWorld.map.width].visited)
+		PathExploredTile const &origExpl = contextIterator->map[tileOrig.x + tileOrig.y * gameWorld.map.width];
+		if (origExpl.iteration == contextIterator->iteration && origExpl.visited)
 		{
 			// Already know the path from orig to dest.
 			endCoord = tileOrig;
 		}
+		else if (origExpl.iteration == contextIterator->iteration && origExpl.trail)
+		{
+			// Jump point search only: orig was passed over by a jump, so the way back from it is not necessarily the shortest, and no jump will stop at it now.
+			continue;
+		}
 		else
 		{
 			// Need to find the path from orig to dest, continue previous exploration.
@@ -630,12 +1754,25 @@ ASR_RETVAL fpathAStarRoute(const std::shared_ptr<FPathExecuteContext>& ctx, MOVE
 	if (contextIterator == fpathContexts.end())
 	{
 		// We did not find an appropriate context. Make one.
-		contextIterator = fpathContexts.push_back(PathfindContext());
+		contextIterator = fpathContexts.emplace_back();
 
 		// Init a new context, overwriting the oldest one if we are caching too many.
 		// We will be searching from orig to dest, since we don't know where the nearest reachable tile to dest is.
+		contextIterator->jumpPoints = fpathUseJumpPointSearch(psJob->propulsion) && psJob->blockingMap->dangerMap.empty();
 		fpathInitContext(*contextIterator, psJob->blockingMap, tileOrig, tileOrig, tileDest, dstIgnore);
+		if (psJob->blockingMap->clusterGraph)
+		{
+			// For long routes, only search the clusters along the coarse route.
+			psJob->blockingMap->clusterGraph->findCorridor(*psJob->blockingMap, tileOrig, tileDest, dstIgnore, contextIterator->corridor);
+		}
 		endCoord = fpathAStarExplore(*contextIterator, tileDest);
+		if (contextIterator->map[endCoord.x + endCoord.y * gameWorld.map.width].trail)
+		{
+			// Jump point search only: dest is unreachable, and the nearest reachable tile was only passed over by a jump. Search again with it as
+			// the target, so that a jump stops at it and the way back from it is the shortest.
+			fpathInitContext(*contextIterator, psJob->blockingMap, tileOrig, tileOrig, endCoord, dstIgnore);
+			endCoord = fpathAStarExplore(*contextIterator, endCoord);
+		}
 		contextIterator->nearestCoord = endCoord;
 	}
 
@@ -652,6 +1789,8 @@ ASR_RETVAL fpathAStarRoute(const std::shared_ptr<FPathExecuteContext>& ctx, MOVE
 	path.clear();
 
 	Vector2i newP(0, 0);
+	Vector2i step(0, 0);
+	unsigned stepsLeft = 0;  // Jump point search routes go straight back to the previous jump point, one tile at a time, whatever the tiles in between point at.
 	for (Vector2i p(world_coord(endCoord.x) + TILE_UNITS / 2, world_coord(endCoord.y) + TILE_UNITS / 2); true; p = newP)
 	{
 		ASSERT_OR_RETURN(ASR_FAILED, worldOnMap(gameWorld.map, p.x, p.y), "Assigned XY coordinates (%d, %d) not on map!", (int)p.x, (int)p.y);
@@ -659,8 +1798,14 @@ ASR_RETVAL fpathAStarRoute(const std::shared_ptr<FPathExecuteContext>& ctx, MOVE
 
 		path.push_back(p);
 
-		PathExploredTile &tile = context.map[map_coord(p.x) + map_coord(p.y) * gameWorld.map.width];
-		newP = p - Vector2i(tile.dx, tile.dy) * (TILE_UNITS / 64);
+		if (stepsLeft == 0)
+		{
+			PathExploredTile &tile = context.map[map_coord(p.x) + map_coord(p.y) * gameWorld.map.width];
+			step = Vector2i(tile.dx, tile.dy) * (TILE_UNITS / 64);
+			stepsLeft = std::max<unsigned>(tile.jump, 1);
+		}
+		--stepsLeft;
+		newP = p - step;
 		Vector2i mapP = map_coord(newP);
 		int xSide = newP.x - world_coord(mapP.x) > TILE_UNITS / 2 ? 1 : -1; // 1 if newP is on right-hand side of the tile, or -1 if newP is on the left-hand side of the tile.
 		int ySide = newP.y - world_coord(mapP.y) > TILE_UNITS / 2 ? 1 : -1; // 1 if newP is on bottom side of the tile, or -1 if newP is on the top side of the tile.
@@ -730,9 +1875,68 @@ ASR_RETVAL fpathAStarRoute(const std::shared_ptr<FPathExecuteContext>& ctx, MOVE
 
 	psMove->destination = psMove->asPath[path.size() - 1];
 
+	ctxImpl->storeInRouteCache(*psJob, tileOrig, tileDest, dstIgnore, psMove, retval);
+
 	return retval;
 }
 
+/// Fills blockMap, reusing prev (an older map of an equivalent type) for the tiles which did not change since it was generated.
+static void fpathFillBlockingMap(PathBlockingMap &blockMap, const PathBlockingMap *prev)
+{
+	const WorldMapState &mapState = gameWorld.map;
+	const WorldBlockingJournal &journal = mapState.blockingJournal;
+	PathBlockingType const &type = blockMap.type;
+
+	const bool reusable = prev != nullptr && journal.epoch != 0 && prev->journalEpoch == journal.epoch && prev->journalPosition <= journal.tiles.size()
+	                      && prev->scroll.minX == mapState.scroll.minX && prev->scroll.minY == mapState.scroll.minY
+	                      && prev->scroll.maxX == mapState.scroll.maxX && prev->scroll.maxY == mapState.scroll.maxY;
+	if (reusable)
+	{
+		blockMap.map = prev->map;
+		for (size_t i = prev->journalPosition; i < journal.tiles.size(); ++i)
+		{
+			const int x = journal.tiles[i] % mapState.width, y = journal.tiles[i] / mapState.width;
+			blockMap.map.set(x, y, fpathBaseBlockingTile(mapState, x, y, type.propulsion, type.owner, type.moveType));
+		}
+	}
+	else
+	{
+		blockMap.map.resize(mapState.width, mapState.height);
+		for (int y = 0; y < mapState.height; ++y)
+			for (int x = 0; x < mapState.width; ++x)
+			{
+				blockMap.map.set(x, y, fpathBaseBlockingTile(mapState, x, y, type.propulsion, type.owner, type.moveType));
+			}
+	}
+
+	if (!isHumanPlayer(type.owner) && type.moveType == FMT_MOVE)
+	{
+		blockMap.dangerGeneration = journal.dangerGeneration[type.owner];
+		if (reusable && !prev->dangerMap.empty() && prev->type.owner == type.owner && prev->dangerGeneration == blockMap.dangerGeneration)
+		{
+			blockMap.dangerMap = prev->dangerMap;
+			for (size_t i = prev->journalPosition; i < journal.tiles.size(); ++i)
+			{
+				const int x = journal.tiles[i] % mapState.width, y = journal.tiles[i] / mapState.width;
+				blockMap.dangerMap.set(x, y, auxTile(mapState, x, y, type.owner) & AUXBITS_THREAT);
+			}
+		}
+		else
+		{
+			blockMap.dangerMap.resize(mapState.width, mapState.height);
+			for (int y = 0; y < mapState.height; ++y)
+				for (int x = 0; x < mapState.width; ++x)
+				{
+					blockMap.dangerMap.set(x, y, auxTile(mapState, x, y, type.owner) & AUXBITS_THREAT);
+				}
+		}
+	}
+
+	blockMap.journalEpoch = journal.epoch;
+	blockMap.journalPosition = journal.tiles.size();
+	blockMap.scroll = mapState.scroll;
+}
+
 void fpathSetBlockingMap(PATHJOB *psJob)
 {
 	if (fpathCurrentGameTime != gameTime)
@@ -759,29 +1963,24 @@ void fpathSetBlockingMap(PATHJOB *psJob)
 		auto blockMap = std::make_shared<PathBlockingMap>();
 		fpathBlockingMaps.push_back(blockMap);
 
+		// Find the last map generated for this type in an earlier tick, if any.
+		auto prev = std::find_if(fpathBlockingMapCache.begin(), fpathBlockingMapCache.end(), [&](std::shared_ptr<PathBlockingMap> const &ptr) {
+			return fpathIsEquivalentBlocking(ptr->type.propulsion, ptr->type.owner, ptr->type.moveType, type.propulsion, type.owner, type.moveType);
+		});
+
 		// blockMap now points to an empty map with no data. Fill the map.
 		blockMap->type = type;
-		std::vector<bool> &map = blockMap->map;
-		map.resize(static_cast<size_t>(gameWorld.map.width) * static_cast<size_t>(gameWorld.map.height));
-		uint32_t checksumMap = 0, checksumDangerMap = 0, factor = 0;
-		for (int y = 0; y < gameWorld.map.height; ++y)
-			for (int x = 0; x < gameWorld.map.width; ++x)
-			{
-				map[x + y * gameWorld.map.width] = fpathBaseBlockingTile(gameWorld.map, x, y, type.propulsion, type.owner, type.moveType);
-				checksumMap ^= map[x + y * gameWorld.map.width] * (factor = 3 * factor + 1);
-			}
-		if (!isHumanPlayer(type.owner) && type.moveType == FMT_MOVE)
+		blockMap->clusterGraph = std::make_shared<PathClusterGraph>(type);
+		fpathFillBlockingMap(*blockMap, prev != fpathBlockingMapCache.end() ? prev->get() : nullptr);
+		if (prev != fpathBlockingMapCache.end())
 		{
-			std::vector<bool> &dangerMap = blockMap->dangerMap;
-			dangerMap.resize(static_cast<size_t>(gameWorld.map.width) * static_cast<size_t>(gameWorld.map.height));
-			for (int y = 0; y < gameWorld.map.height; ++y)
-				for (int x = 0; x < gameWorld.map.width; ++x)
-				{
-					dangerMap[x + y * gameWorld.map.width] = auxTile(gameWorld.map, x, y, type.owner) & AUXBITS_THREAT;
-					checksumDangerMap ^= dangerMap[x + y * gameWorld.map.width] * (factor = 3 * factor + 1);
-				}
+			*prev = blockMap;
+		}
+		else
+		{
+			fpathBlockingMapCache.push_back(blockMap);
 		}
-		syncDebug("blockingMap(%d,%d,%d,%d) = %08X %08X", gameTime, psJob->propulsion, psJob->owner, psJob->moveType, checksumMap, checksumDangerMap);
+		syncDebug("blockingMap(%d,%d,%d,%d) = %08X %08X", gameTime, psJob->propulsion, psJob->owner, psJob->moveType, blockMap->map.checksum(), blockMap->dangerMap.checksum());
 
 		psJob->blockingMap = blockMap;
 	}
@@ -792,3 +1991,244 @@ void fpathSetBlockingMap(PATHJOB *psJob)
 		psJob->blockingMap = *i;
 	}
 }
+
+PathBenchmarkResult fpathAStarBenchmark(PROPULSION_TYPE propulsion, bool jumpPoints, unsigned routes, uint32_t seed)
+{
+	PathBenchmarkResult result;
+	if (gameWorld.map.width <= 0 || gameWorld.map.height <= 0)
+	{
+		return result;
+	}
+
+	// Not added to fpathBlockingMaps, so that running the benchmark cannot change which maps the game's own jobs get.
+	auto blockMap = std::make_shared<PathBlockingMap>();
+	blockMap->type.gameTime = gameTime;
+	blockMap->type.propulsion = propulsion;
+	blockMap->type.owner = 0;
+	blockMap->type.moveType = FMT_BLOCK;
+	fpathFillBlockingMap(*blockMap, nullptr);
+	const std::shared_ptr<const PathBlockingMap> blockingMap = blockMap;
+
+	std::minstd_rand rng(seed);  // Same pairs of tiles on every platform.
+	auto randomOpenTile = [&](PathCoord &tile) {
+		for (unsigned attempt = 0; attempt < 1000; ++attempt)
+		{
+			tile = PathCoord(rng() % gameWorld.map.width, rng() % gameWorld.map.height);
+			if (!blockMap->map.get(tile.x, tile.y))
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	PathfindContext context;
+	for (unsigned i = 0; i < routes; ++i)
+	{
+		PathCoord tileS, tileF;
+		if (!randomOpenTile(tileS) || !randomOpenTile(tileF))
+		{
+			break;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		context.jumpPoints = jumpPoints;
+		context.expandedNodes = 0;
+		fpathInitContext(context, blockingMap, tileS, tileS, tileF, PathNonblockingArea());
+		PathCoord endCoord = fpathAStarExplore(context, tileF);
+		result.microseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		result.expandedNodes += context.expandedNodes;
+		if (endCoord == tileF)
+		{
+			++result.routes;
+			result.totalCost += context.map[tileF.x + tileF.y * gameWorld.map.width].dist;
+		}
+	}
+	return result;
+}
+
+bool fpathRunSelfTest()
+{
+	bool ok = true;
+	const auto check = [&ok](bool cond, const char *msg)
+	{
+		if (!cond)
+		{
+			fprintf(stderr, "[pathfinding-selftest] FAIL: %s\n", msg);
+			ok = false;
+		}
+	};
+
+	// The test maps replace the map size for the duration of the test, no map tiles are needed since the blocking maps are made up directly.
+	const int savedWidth = gameWorld.map.width, savedHeight = gameWorld.map.height;
+	const int width = 96, height = 96;
+	gameWorld.map.width = width;
+	gameWorld.map.height = height;
+
+	std::minstd_rand rng(2100);  // Same maps on every platform.
+	unsigned routes = 0, nearestRoutes = 0, comparedRoutes = 0;
+	uint64_t jumpPointCost = 0, aStarCost = 0;
+	for (unsigned mapIndex = 0; mapIndex < 20 && ok; ++mapIndex)
+	{
+		auto blockMap = std::make_shared<PathBlockingMap>();
+		blockMap->type.gameTime = mapIndex + 1;
+		blockMap->type.propulsion = PROPULSION_TYPE_LIFT;
+		blockMap->type.owner = 0;
+		blockMap->type.moveType = FMT_BLOCK;
+		blockMap->map.resize(width, height);
+		// Random walls, some of them closed into rooms, and scattered single tiles, so that some routes are unreachable.
+		const unsigned walls = 20 + mapIndex * 4;
+		for (unsigned i = 0; i < walls; ++i)
+		{
+			const int x = rng() % width, y = rng() % height, length = rng() % 40;
+			const bool vertical = rng() % 2 != 0;
+			for (int k = 0; k < length && (vertical ? y + k : x + k) < (vertical ? height : width); ++k)
+			{
+				blockMap->map.set(vertical ? x : x + k, vertical ? y + k : y, true);
+			}
+		}
+		for (unsigned i = 0; i < 150; ++i)
+		{
+			blockMap->map.set(rng() % width, rng() % height, true);
+		}
+		const std::shared_ptr<const PathBlockingMap> blockingMap = blockMap;
+		auto isBlocked = [&](int x, int y) {
+			return x < 0 || y < 0 || x >= width || y >= height || blockMap->map.get(x, y);
+		};
+		auto randomOpenTile = [&]() {
+			PathCoord tile;
+			do
+			{
+				tile = PathCoord(rng() % width, rng() % height);
+			} while (isBlocked(tile.x, tile.y));
+			return tile;
+		};
+
+		// Reference costs: Dijkstra with the same moves as the tile search, diagonals may not cut corners.
+		std::vector<unsigned> reference;
+		auto fillReference = [&](PathCoord from) {
+			reference.assign(static_cast<size_t>(width) * height, UINT_MAX);
+			std::vector<PathNode> open;
+			reference[from.x + from.y * width] = 0;
+			open.push_back(PathNode{from, 0, 0});
+			while (!open.empty())
+			{
+				std::pop_heap(open.begin(), open.end());
+				const PathNode node = open.back();
+				open.pop_back();
+				if (node.dist != reference[node.p.x + node.p.y * width])
+				{
+					continue;
+				}
+				for (unsigned dir = 0; dir < ARRAY_SIZE(aDirOffset); ++dir)
+				{
+					const int x = node.p.x + aDirOffset[dir].x, y = node.p.y + aDirOffset[dir].y;
+					if (isBlocked(x, y) || (dir % 2 != 0 && (isBlocked(node.p.x + aDirOffset[dir].x, node.p.y) || isBlocked(node.p.x, node.p.y + aDirOffset[dir].y))))
+					{
+						continue;
+					}
+					const unsigned dist = node.dist + (dir % 2 != 0 ? 198 : 140);
+					if (dist < reference[x + y * width])
+					{
+						reference[x + y * width] = dist;
+						open.push_back(PathNode{PathCoord(x, y), dist, dist});
+						std::push_heap(open.begin(), open.end());
+					}
+				}
+			}
+		};
+		// Octile cost of the route through the tiles of the waypoints, or UINT_MAX if it is not a chain of allowed moves between open tiles.
+		auto routeCost = [&](std::vector<Vector2i> const &path) {
+			unsigned cost = 0;
+			for (size_t i = 1; i < path.size(); ++i)
+			{
+				const Vector2i a = map_coord(path[i - 1]), b = map_coord(path[i]);
+				const int dx = b.x - a.x, dy = b.y - a.y;
+				if (abs(dx) > 1 || abs(dy) > 1 || isBlocked(b.x, b.y) || (dx != 0 && dy != 0 && (isBlocked(a.x + dx, a.y) || isBlocked(a.x, a.y + dy))))
+				{
+					return UINT_MAX;
+				}
+				cost += fpathEstimate(PathCoord(a.x, a.y), PathCoord(b.x, b.y));
+			}
+			return cost;
+		};
+
+		// Several droids per destination, so that the contexts get reused, both from the same and from other islands.
+		auto jumpPointContext = makeFPathExecuteContext(), aStarContext = makeFPathExecuteContext();
+		for (unsigned destIndex = 0; destIndex < 6 && ok; ++destIndex)
+		{
+			const PathCoord tileF = randomOpenTile();
+			for (unsigned origIndex = 0; origIndex < 10 && ok; ++origIndex)
+			{
+				const PathCoord tileS = randomOpenTile();
+				PATHJOB job{};
+				job.propulsion = PROPULSION_TYPE_LIFT;
+				job.moveType = FMT_BLOCK;
+				job.owner = 0;
+				job.origX = world_coord(tileS.x) + TILE_UNITS / 2;
+				job.origY = world_coord(tileS.y) + TILE_UNITS / 2;
+				job.destX = world_coord(tileF.x) + TILE_UNITS / 2;
+				job.destY = world_coord(tileF.y) + TILE_UNITS / 2;
+				job.blockingMap = blockingMap;
+				check(fpathUseJumpPointSearch(job.propulsion), "air routes do not use jump point search");
+
+				MOVE_CONTROL jumpPointMove, aStarMove;
+				const uint64_t hits = fpathRouteCacheStats().hits;
+				const ASR_RETVAL jumpPointRet = fpathAStarRoute(jumpPointContext, &jumpPointMove, &job);
+				job.propulsion = PROPULSION_TYPE_WHEELED;  // Same blocking map, but searched with plain A*.
+				const ASR_RETVAL aStarRet = fpathAStarRoute(aStarContext, &aStarMove, &job);
+				if (fpathRouteCacheStats().hits != hits)
+				{
+					continue;  // Joined a route found earlier, instead of searching.
+				}
+
+				fillReference(tileS);
+				const bool reachable = reference[tileF.x + tileF.y * width] != UINT_MAX;
+				check(jumpPointRet == (reachable ? ASR_OK : ASR_NEAREST), "jump point search disagrees about whether the destination is reachable");
+				check(aStarRet == (reachable ? ASR_OK : ASR_NEAREST), "A* disagrees about whether the destination is reachable");
+				check(map_coord(jumpPointMove.asPath.front()) == Vector2i(tileS.x, tileS.y), "jump point route does not start at the origin");
+				const Vector2i end = map_coord(jumpPointMove.asPath.back());
+				check(!reachable || end == Vector2i(tileF.x, tileF.y), "jump point route does not end at the destination");
+				if (!reachable)
+				{
+					// Must end as close to the destination as the nearest tile reachable from the origin.
+					unsigned nearest = UINT_MAX;
+					for (int y = 0; y < height; ++y)
+						for (int x = 0; x < width; ++x)
+						{
+							if (reference[x + y * width] != UINT_MAX)
+							{
+								nearest = std::min(nearest, fpathGoodEstimate(PathCoord(x, y), tileF));
+							}
+						}
+					check(fpathGoodEstimate(PathCoord(end.x, end.y), tileF) == nearest, "jump point route does not end at the nearest reachable tile");
+					++nearestRoutes;
+				}
+
+				const unsigned cost = routeCost(jumpPointMove.asPath);
+				check(cost != UINT_MAX, "jump point route is not a chain of single moves between open tiles");
+				check(cost == reference[end.x + end.y * width], "jump point route is longer than the shortest route");
+				const unsigned aStar = routeCost(aStarMove.asPath);
+				if (reachable && aStar != UINT_MAX)  // Otherwise the routes may end at different tiles, equally near the destination.
+				{
+					check(cost <= aStar, "jump point route is longer than the A* route");
+					jumpPointCost += cost;
+					aStarCost += aStar;
+					++comparedRoutes;
+				}
+				++routes;
+			}
+		}
+	}
+
+	gameWorld.map.width = savedWidth;
+	gameWorld.map.height = savedHeight;
+
+	if (ok)
+	{
+		fprintf(stderr, "[pathfinding-selftest] PASS (%u routes, %u to the nearest tile; %u compared, total cost %llu with jump point search, %llu with A*)\n",
+		        routes, nearestRoutes, comparedRoutes, (unsigned long long)jumpPointCost, (unsigned long long)aStarCost);
+	}
+	return ok;
+}
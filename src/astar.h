@@ -43,6 +43,8 @@ public:
 	virtual ~FPathExecuteContext();
 };
 std::shared_ptr<FPathExecuteContext> makeFPathExecuteContext();
+/// Forgets the routes found with ctx, but keeps its memory, so that ctx can be used again for other jobs without allocating its maps again.
+void fpathClearExecuteContext(const std::shared_ptr<FPathExecuteContext>& ctx);
 
 /** Use the A* algorithm to find a path
  *
@@ -62,4 +64,33 @@ void fpathSetBlockingMap(PATHJOB *psJob);
  */
 void fpathHardTableReset();
 
+struct PathRouteCacheStats
+{
+	uint64_t lookups = 0;           ///< Jobs which looked for a route found earlier in their cohort.
+	uint64_t hits = 0;              ///< Jobs served by joining such a route, without searching.
+	uint64_t stores = 0;            ///< Routes added to a cache.
+	uint64_t evictions = 0;         ///< Routes dropped to keep caches within their bounds.
+};
+
+/// Totals since startup, for all path threads. Thread-safe.
+PathRouteCacheStats fpathRouteCacheStats();
+
+struct PathBenchmarkResult
+{
+	unsigned routes = 0;            ///< Number of routes which reached their destination.
+	uint64_t expandedNodes = 0;     ///< Tiles expanded, summed over all routes.
+	uint64_t microseconds = 0;      ///< Wall time spent searching, summed over all routes.
+	uint64_t totalCost = 0;         ///< Sum of the route costs of the routes which reached their destination.
+};
+
+/// Call from main thread, with a map loaded.
+/// Searches for routes between pseudo-random pairs of open tiles, chosen by seed, using plain A* or jump point search.
+/// Each route gets a fresh context and no coarse route, so only the tile search itself is measured.
+PathBenchmarkResult fpathAStarBenchmark(PROPULSION_TYPE propulsion, bool jumpPoints, unsigned routes, uint32_t seed);
+
+/// Call from main thread, with no game running.
+/// Routes droids on randomized blocking maps with jump point search and with plain A*, and checks that the jump point
+/// routes cost exactly as much as the shortest route, and no more than the A* routes. Returns true on success.
+bool fpathRunSelfTest();
+
 #endif // __INCLUDED_SRC_ASTART_H__
@@ -36,8 +36,10 @@
 #include "miscimd.h"
 #include "profiling.h"
 #include "droid.h"
+#include "console.h"
 
 #include <algorithm>
+#include <chrono>
 
 #define CLIP_LEFT	((SDWORD)0)
 #define CLIP_RIGHT	((SDWORD)pie_GetVideoBufferWidth())
@@ -49,17 +51,115 @@
 
 struct BUCKET_TAG
 {
-	bool operator <(BUCKET_TAG const &b) const
-	{
-		return actualZ > b.actualZ;    // Sort in reverse z order.
-	}
-
+	uint64_t        sortKey;    //see bucketSortKey()
 	RENDER_TYPE     objectType; //type of object held
 	void           *pObject;    //pointer to the object
-	int32_t         actualZ;
 };
 
+// Both kept between frames, so that filling and sorting the list doesn't allocate once it has grown big enough.
 static std::vector<BUCKET_TAG> bucketArray;
+static std::vector<BUCKET_TAG> bucketSortScratch;
+
+// Set by the "bucketbench" cheat: the next list rendered is also sorted BUCKET_BENCHMARK_ROUNDS times each way, and timed.
+static bool bucketBenchmarkRequested = false;
+static constexpr unsigned BUCKET_BENCHMARK_ROUNDS = 200;
+
+/// Tags are rendered in increasing key order: in reverse z order, and tags with the same z (such as all structures
+/// sharing a texture page) by object type and then by shape, so that consecutive pie_Draw3DShape calls mostly share
+/// their state. The shape bits only need to tell shapes apart, so where they come from doesn't matter.
+static uint64_t bucketSortKey(int32_t z, RENDER_TYPE objectType, const iIMDShape *shape)
+{
+	const uint64_t depth = static_cast<uint32_t>(INT32_MAX - z);  // z >= 0
+	const uint64_t shapeBits = (reinterpret_cast<uintptr_t>(shape) >> 4) & 0xFFFFFF;
+	return depth << 32 | static_cast<uint64_t>(objectType) << 24 | shapeBits;
+}
+
+/// Least significant byte first radix sort of tags by sortKey, which keeps tags with equal keys in the order they
+/// were added. Bytes which are the same in every key (in most frames, most of the depth bytes) are skipped.
+static void bucketRadixSort(std::vector<BUCKET_TAG> &tags, std::vector<BUCKET_TAG> &scratch)
+{
+	const size_t count = tags.size();
+	if (count < 2)
+	{
+		return;
+	}
+
+	size_t histograms[8][256] = {};
+	for (const BUCKET_TAG &tag : tags)
+	{
+		for (unsigned byte = 0; byte < 8; ++byte)
+		{
+			++histograms[byte][(tag.sortKey >> (byte * 8)) & 0xFF];
+		}
+	}
+
+	scratch.resize(count);
+	for (unsigned byte = 0; byte < 8; ++byte)
+	{
+		size_t *histogram = histograms[byte];
+		const unsigned shift = byte * 8;
+		if (histogram[(tags[0].sortKey >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+		size_t offset = 0;
+		for (unsigned digit = 0; digit < 256; ++digit)
+		{
+			const size_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+		for (const BUCKET_TAG &tag : tags)
+		{
+			scratch[histogram[(tag.sortKey >> shift) & 0xFF]++] = tag;
+		}
+		tags.swap(scratch);
+	}
+}
+
+/// Number of times consecutive tags differ in object type or shape.
+static size_t bucketCountStateChanges(const std::vector<BUCKET_TAG> &tags)
+{
+	size_t changes = 0;
+	for (size_t i = 1; i < tags.size(); ++i)
+	{
+		changes += static_cast<uint32_t>(tags[i].sortKey) != static_cast<uint32_t>(tags[i - 1].sortKey);
+	}
+	return changes;
+}
+
+/// Times sorting tags the way the list used to be sorted (std::sort by depth alone) against bucketRadixSort(),
+/// on copies. Only the sort is timed, so the results don't depend on the graphics backend.
+static void bucketRunBenchmark(const std::vector<BUCKET_TAG> &tags)
+{
+	using Clock = std::chrono::steady_clock;
+	using Microseconds = std::chrono::duration<double, std::micro>;
+	std::vector<BUCKET_TAG> sorted, scratch;
+	sorted.reserve(tags.size());
+
+	Clock::duration comparisonSortTime{};
+	for (unsigned round = 0; round < BUCKET_BENCHMARK_ROUNDS; ++round)
+	{
+		sorted = tags;
+		const auto start = Clock::now();
+		std::sort(sorted.begin(), sorted.end(), [](BUCKET_TAG const &a, BUCKET_TAG const &b) { return (a.sortKey >> 32) < (b.sortKey >> 32); });
+		comparisonSortTime += Clock::now() - start;
+	}
+	const size_t comparisonSortStateChanges = bucketCountStateChanges(sorted);
+
+	Clock::duration radixSortTime{};
+	for (unsigned round = 0; round < BUCKET_BENCHMARK_ROUNDS; ++round)
+	{
+		sorted = tags;
+		const auto start = Clock::now();
+		bucketRadixSort(sorted, scratch);
+		radixSortTime += Clock::now() - start;
+	}
+
+	CONPRINTF("bucketbench: %zu objects, std::sort by depth %.1f us (%zu state changes), radix sort by key %.1f us (%zu state changes)", tags.size(),
+	          Microseconds(comparisonSortTime).count() / BUCKET_BENCHMARK_ROUNDS, comparisonSortStateChanges,
+	          Microseconds(radixSortTime).count() / BUCKET_BENCHMARK_ROUNDS, bucketCountStateChanges(sorted));
+}
 
 static SDWORD bucketCalculateZ(RENDER_TYPE objectType, void *pObject, const glm::mat4 &perspectiveViewMatrix)
 {
@@ -311,7 +411,7 @@ static SDWORD bucketCalculateZ(RENDER_TYPE objectType, void *pObject, const glm:
 /* add an object to the current render list */
 void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4 &perspectiveViewMatrix)
 {
-	const iIMDShape *pie;
+	const iIMDShape *pie = nullptr;
 	BUCKET_TAG	newTag;
 	int32_t		z = bucketCalculateZ(objectType, pObject, perspectiveViewMatrix);
 
@@ -330,6 +430,7 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 	switch (objectType)
 	{
 	case RENDER_EFFECT:
+		pie = ((EFFECT *)pObject)->imd;
 		switch (((EFFECT *)pObject)->group)
 		{
 		case EFFECT_EXPLOSION:
@@ -340,7 +441,6 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 			break;
 
 		case EFFECT_WAYPOINT:
-			pie = ((EFFECT *)pObject)->imd;
 			z = INT32_MAX - pie->getTextures().texpage;
 			break;
 
@@ -367,17 +467,21 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 		z = INT32_MAX - pie->getTextures().texpage;
 		break;
 	case RENDER_PARTICLE:
+		pie = ((ATPART *)pObject)->imd != nullptr ? ((ATPART *)pObject)->imd->displayModel() : nullptr;
 		z = 0;
 		break;
+	case RENDER_PROJECTILE:
+		pie = ((PROJECTILE *)pObject)->psWStats->pInFlightGraphic != nullptr ? ((PROJECTILE *)pObject)->psWStats->pInFlightGraphic->displayModel() : nullptr;
+		break;
 	default:
 		// Use calculated Z
 		break;
 	}
 
 	//put the object data into the tag
+	newTag.sortKey = bucketSortKey(z, objectType, pie);
 	newTag.objectType = objectType;
 	newTag.pObject = pObject;
-	newTag.actualZ = z;
 
 	//add tag to bucketArray
 	bucketArray.push_back(newTag);
@@ -387,7 +491,12 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *pObject, const glm::mat4
 void bucketRenderCurrentList(const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix)
 {
 	WZ_PROFILE_SCOPE(bucketRenderCurrentList);
-	std::sort(bucketArray.begin(), bucketArray.end());
+	if (bucketBenchmarkRequested)
+	{
+		bucketBenchmarkRequested = false;
+		bucketRunBenchmark(bucketArray);
+	}
+	bucketRadixSort(bucketArray, bucketSortScratch);
 
 	for (auto thisTag = bucketArray.cbegin(); thisTag != bucketArray.cend(); ++thisTag)
 	{
@@ -423,3 +532,9 @@ void bucketRenderCurrentList(const glm::mat4 &viewMatrix, const glm::mat4 &persp
 	//reset the bucket array as we go
 	bucketArray.resize(0);
 }
+
+void bucketBenchmark()
+{
+	bucketBenchmarkRequested = true;
+	CONPRINTF("bucketbench: timing how long it takes to sort the objects in the next frame, %u times", BUCKET_BENCHMARK_ROUNDS);
+}
@@ -41,4 +41,7 @@ void bucketAddTypeToList(RENDER_TYPE objectType, void *object, const glm::mat4 &
 /* render Objects in list */
 void bucketRenderCurrentList(const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix);
 
+/* time sorting the next frame's render list, for the "bucketbench" cheat */
+void bucketBenchmark();
+
 #endif // __INCLUDED_SRC_BUCKET3D_H__
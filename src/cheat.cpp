@@ -40,6 +40,9 @@
 #include "multiint.h"
 #include "multiplay.h"
 #include "gamestate_serialize.h"
+#include "fpath.h"
+#include "loop.h"
+#include "bucket3d.h"
 
 struct CHEAT_ENTRY
 {
@@ -98,6 +101,9 @@ static CHEAT_ENTRY cheatCodes[] =
 	{"autogame off", kf_AutoGame},
 	{"shakey", kf_ToggleShakeStatus}, //shakey
 	{"list droids", kf_ListDroids},
+	{"pathbench", fpathBenchmark}, // compare pathfinding search strategies on this map
+	{"updatebench", loopBenchmarkGameStateUpdate}, // time game state updates with 2000+ droids
+	{"bucketbench", bucketBenchmark}, // time sorting the objects drawn in the next frame
 
 };
 
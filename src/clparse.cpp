@@ -28,11 +28,16 @@
 #include "lib/framework/string_ext.h"
 #include "lib/ivis_opengl/screen.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/compression_benchmark.h"
+#include "lib/netplay/netplay_loadtest.h"
 #include "lib/netplay/sync_debug.h"
+#include "lib/gamelib/gtime.h"
 #include "lib/ivis_opengl/pieclip.h"
 #include "lib/ivis_opengl/png_util.h"
+#include "lib/ivis_opengl/gfx_api_null.h"
 
 #include "levels.h"
+#include "astar.h"
 #include "clparse.h"
 #include "display3d.h"
 #include "frontend.h"
@@ -94,6 +99,8 @@ static bool wz_streamer_spectator_mode = false;
 static bool wz_lobby_slashcommands = false;
 static bool wz_lobby_slashcommands_hostexit = false;
 static int wz_min_autostart_players = -1;
+static int wz_task_threads = 0;
+static uint32_t wz_replay_seek_time = 0;
 static std::string wz_lobby_game_to_connect_str;
 
 #if defined(WZ_OS_WIN)
@@ -323,10 +330,13 @@ typedef enum
 	CLI_WINDOW,
 	CLI_VERSION,
 	CLI_GAMESTATE_SELFTEST,
+	CLI_RENDERGRAPH_SELFTEST,
+	CLI_PATHFINDING_SELFTEST,
 	CLI_GAMESTATE_ROUNDTRIP,
 	CLI_GAMESTATE_CRCTRACE,
 	CLI_GAMESTATE_CRCDETAIL,
 	CLI_GAMESTATE_CRCDETAIL_ONSAVE,
+	CLI_GAMESTATE_JSON,
 	CLI_TMP_PREFER_OLD_SAVE,
 	CLI_RESOLUTION,
 	CLI_SHADOWS,
@@ -372,6 +382,9 @@ typedef enum
 	CLI_GAMELOG_FRAMEINTERVAL,
 	CLI_GAMETIMELIMITMINUTES,
 	CLI_CONVERT_SPECULAR_MAP,
+	CLI_NETCOMPRESSION_BENCH,
+	CLI_NETCOMPRESSION_TRAINDICT,
+	CLI_NETPLAY_LOADTEST,
 	CLI_DEBUG_VERBOSE_SYNCLOG_OUTPUT,
 	CLI_ALLOW_VULKAN_IMPLICIT_LAYERS,
 	CLI_HOST_CHAT_CONFIG,
@@ -381,6 +394,8 @@ typedef enum
 	CLI_VIDEOURL,
 #endif
 	CLI_HOST_CONNECTION_PROVIDER,
+	CLI_TASK_THREADS,
+	CLI_REPLAY_SEEK,
 } CLI_OPTIONS;
 
 // Separate table that avoids *any* translated strings, to avoid any risk of gettext / libintl function calls
@@ -413,13 +428,17 @@ static const struct poptOption *getOptionsTable()
 		{ "loadskirmish", POPT_ARG_STRING, CLI_LOADSKIRMISH, N_("Load a saved skirmish game"),     N_("savegame") },
 		{ "loadcampaign", POPT_ARG_STRING, CLI_LOADCAMPAIGN, N_("Load a saved campaign game"),     N_("savegame") },
 		{ "loadreplay", POPT_ARG_STRING, CLI_LOADREPLAY, N_("Load a replay"),     N_("replay file") },
+		{ "replay-seek", POPT_ARG_STRING, CLI_REPLAY_SEEK, N_("Start the replay loaded with --loadreplay at the given game time"), N_("seconds") },
 		{ "window", POPT_ARG_NONE, CLI_WINDOW,     N_("Play in windowed mode"),             nullptr },
 		{ "version", POPT_ARG_NONE, CLI_VERSION,    N_("Show version information and exit"), nullptr },
 		{ "gamestate-selftest", POPT_ARG_NONE, CLI_GAMESTATE_SELFTEST, N_("Run the GameState serialization determinism self-test and exit"), nullptr },
+		{ "render-graph-selftest", POPT_ARG_NONE, CLI_RENDERGRAPH_SELFTEST, N_("Run the render graph parallel pass recording self-test against the null backend and exit"), nullptr },
+		{ "pathfinding-selftest", POPT_ARG_NONE, CLI_PATHFINDING_SELFTEST, N_("Run the jump point search route cost self-test on random maps and exit"), nullptr },
 		{ "gamestate-roundtrip", POPT_ARG_STRING, CLI_GAMESTATE_ROUNDTRIP, N_("Run the GameState reconstruct round-trip test at the given game tick and exit"), N_("game tick") },
 		{ "gamestate-crc-trace", POPT_ARG_STRING, CLI_GAMESTATE_CRCTRACE, N_("Write a per-tick sync-CRC trace to the given file (for the load sync test)"), N_("file") },
 		{ "gamestate-crc-detail-tick", POPT_ARG_STRING, CLI_GAMESTATE_CRCDETAIL, N_("At this game tick, dump the full sync-debug log to <crc-trace-file>.detail.txt (diff original vs loaded run to pinpoint a divergence)"), N_("game tick") },
 		{ "gamestate-crc-detail-on-save", POPT_ARG_NONE, CLI_GAMESTATE_CRCDETAIL_ONSAVE, N_("Auto-dump a window of full sync-debug logs to <crc-trace-file>.detail.txt around each GameState save/load (no need to know the save tick)"), nullptr },
+		{ "gamestate-json", POPT_ARG_NONE, CLI_GAMESTATE_JSON, N_("Write GameState savegames and replay keyframes as JSON text instead of the binary encoding (for debugging)"), nullptr },
 		{ "tmp-prefer-old-save", POPT_ARG_NONE, CLI_TMP_PREFER_OLD_SAVE, N_("Prefer the legacy load path for a save folder that has both the old and new-format data (temporary)"), nullptr },
 		{ "resolution", POPT_ARG_STRING, CLI_RESOLUTION, N_("Set the resolution to use"),         N_("WIDTHxHEIGHT") },
 		{ "shadows", POPT_ARG_NONE, CLI_SHADOWS,    N_("Enable shadows"),                    nullptr },
@@ -476,6 +495,9 @@ static const struct poptOption *getOptionsTable()
 		{ "gamelog-frameinterval", POPT_ARG_STRING, CLI_GAMELOG_FRAMEINTERVAL, N_("Game history log frame interval"), N_("interval in seconds")},
 		{ "gametimelimit", POPT_ARG_STRING, CLI_GAMETIMELIMITMINUTES, N_("Multiplayer game time limit (in minutes)"), N_("number of minutes")},
 		{ "convert-specular-map", POPT_ARG_STRING, CLI_CONVERT_SPECULAR_MAP, N_("Convert a specular-map .png to a luma, single-channel, grayscale .png (and exit)"), "inputpath/filename.png:outputpath/filename.png" },
+		{ "netcompression-bench", POPT_ARG_STRING, CLI_NETCOMPRESSION_BENCH, N_("Compress the net messages of the replays in a directory with each supported algorithm, report ratio and throughput (and exit)"), "replaypath[:dictionarypath/filename.dict]" },
+		{ "netcompression-train-dict", POPT_ARG_STRING, CLI_NETCOMPRESSION_TRAINDICT, N_("Train a net message compression dictionary on the replays in a directory (and exit)"), "replaypath:outputpath/filename.dict" },
+		{ "netplay-loadtest", POPT_ARG_STRING, CLI_NETPLAY_LOADTEST, N_("Run a relay host and synthetic clients over localhost, report host tick time, write queue depth, bandwidth and latency of the network transport layer only (and exit)"), "clients[:players[:seconds[:replaypath]]]" },
 		{ "debug-verbose-sync-logs-until", POPT_ARG_STRING, CLI_DEBUG_VERBOSE_SYNCLOG_OUTPUT, nullptr, nullptr },
 		{ "allow-vulkan-implicit-layers", POPT_ARG_NONE, CLI_ALLOW_VULKAN_IMPLICIT_LAYERS, N_("Allow Vulkan implicit layers (that may be default-disabled due to potential crashes or bugs)"), nullptr },
 		{ "host-chat-config", POPT_ARG_STRING, CLI_HOST_CHAT_CONFIG, N_("Set the default hosting chat configuration / permissions"), "[allow,quickchat]" },
@@ -485,6 +507,7 @@ static const struct poptOption *getOptionsTable()
 		{ "videourl", POPT_ARG_STRING, CLI_VIDEOURL,   N_("Base URL for on-demand video downloads"), N_("Base video URL") },
 #endif
 		{ "host-connection-provider", POPT_ARG_STRING, CLI_HOST_CONNECTION_PROVIDER, N_("Specify connection provider type to use when hosting game sessions"), "[tcp]" },
+		{ "task-threads", POPT_ARG_STRING, CLI_TASK_THREADS, N_("Number of worker threads (0 for one per CPU core, up to a limit)"), N_("count") },
 
 		// Terminating entry
 		{ nullptr, 0, 0,              nullptr,                                    nullptr },
@@ -605,6 +628,20 @@ static std::string specialGetBaseDir(const std::string& platformSpecificPath, st
 	}
 }
 
+// Where self-tests may write scratch files, as the write dir isn't set up during early parsing
+static std::string selfTestScratchDir()
+{
+	for (const char *name : {"TMPDIR", "TEMP", "TMP"})
+	{
+		const char *dir = getenv(name);
+		if (dir != nullptr && *dir != '\0')
+		{
+			return dir;
+		}
+	}
+	return "/tmp";
+}
+
 //! Early parsing of the commandline
 /**
  * First half of the command line parsing. Also see ParseCommandLine()
@@ -656,6 +693,11 @@ ParseCLIEarlyResult ParseCommandLineEarly(int argc, const char * const *argv)
 			return ParseCLIEarlyResult::HANDLED_QUIT_EARLY_COMMAND;
 
 		case CLI_GAMESTATE_SELFTEST:
+			// The replay keyframe checks save a replay and read it back
+			if (PHYSFS_setWriteDir(selfTestScratchDir().c_str()))
+			{
+				PHYSFS_mount(PHYSFS_getWriteDir(), "", PHYSFS_PREPEND);
+			}
 			if (!gamestate::runGameStateSelfTest())
 			{
 				exit(EXIT_FAILURE);
@@ -670,6 +712,20 @@ ParseCLIEarlyResult ParseCommandLineEarly(int argc, const char * const *argv)
 			}
 			return ParseCLIEarlyResult::HANDLED_QUIT_EARLY_COMMAND;
 
+		case CLI_RENDERGRAPH_SELFTEST:
+			if (!gfx_api::runParallelPassRecordingSelfTest())
+			{
+				exit(EXIT_FAILURE);
+			}
+			return ParseCLIEarlyResult::HANDLED_QUIT_EARLY_COMMAND;
+
+		case CLI_PATHFINDING_SELFTEST:
+			if (!fpathRunSelfTest())
+			{
+				exit(EXIT_FAILURE);
+			}
+			return ParseCLIEarlyResult::HANDLED_QUIT_EARLY_COMMAND;
+
 #if defined(WZ_OS_WIN)
 		case CLI_WIN_ENABLE_CONSOLE:
 			SetStdOutToConsole_Win();
@@ -737,6 +793,108 @@ ParseCLIEarlyResult ParseCommandLineEarly(int argc, const char * const *argv)
 				exit(0);
 			}
 			break;
+		case CLI_NETCOMPRESSION_BENCH:
+		case CLI_NETCOMPRESSION_TRAINDICT:
+			{
+				const char *optionName = (option == CLI_NETCOMPRESSION_BENCH) ? "netcompression-bench" : "netcompression-train-dict";
+				token = poptGetOptArg(poptCon);
+				if (token == nullptr || strlen(token) == 0)
+				{
+					qFatal("Missing %s value", optionName);
+				}
+				// Should be the replay directory, then (optional for the benchmark) the dictionary file:
+				// replaypath:dictionarypath/filename.dict
+				std::string fullArg = token;
+				size_t delimiter = fullArg.find(":");
+				std::string replayDir = fullArg.substr(0, delimiter);
+				std::string dictionaryPath = (delimiter != std::string::npos) ? fullArg.substr(delimiter + 1) : std::string();
+				if (option == CLI_NETCOMPRESSION_TRAINDICT && dictionaryPath.empty())
+				{
+					std::string expectedOutputPathExample = std::string("outputpath") + PHYSFS_getDirSeparator() + "filename.dict";
+					qFatal("Invalid %s value - expecting format: replaypath:%s", optionName, expectedOutputPathExample.c_str());
+				}
+
+				if (!PHYSFS_mount(replayDir.c_str(), "replays", PHYSFS_APPEND))
+				{
+					qFatal("%s - unable to read replay directory: %s", optionName, replayDir.c_str());
+				}
+
+				std::string dictionaryFilename;
+				if (!dictionaryPath.empty())
+				{
+					std::string dictionaryDir = specialGetBaseDir(dictionaryPath, dictionaryFilename);
+					if (option == CLI_NETCOMPRESSION_TRAINDICT)
+					{
+						if (!PHYSFS_setWriteDir(dictionaryDir.c_str()))
+						{
+							qFatal("%s - unable to configure output directory to: %s", optionName, dictionaryDir.c_str());
+						}
+					}
+					else if (!PHYSFS_mount(dictionaryDir.c_str(), "dictionary", PHYSFS_APPEND))
+					{
+						qFatal("%s - unable to read dictionary directory: %s", optionName, dictionaryDir.c_str());
+					}
+				}
+
+				bool success;
+				if (option == CLI_NETCOMPRESSION_BENCH)
+				{
+					success = NETcompressionBenchmark("replays", dictionaryPath.empty() ? std::string() : "dictionary/" + dictionaryFilename);
+				}
+				else
+				{
+					success = NETtrainCompressionDictionary("replays", dictionaryFilename);
+				}
+
+				PHYSFS_deinit();
+				exit(success ? 0 : EXIT_FAILURE);
+			}
+			break;
+		case CLI_NETPLAY_LOADTEST:
+			{
+				token = poptGetOptArg(poptCon);
+				if (token == nullptr || strlen(token) == 0)
+				{
+					qFatal("Missing netplay-loadtest value");
+				}
+				// Should be the number of clients, then (optional) how many of them are players, how many seconds
+				// to run for, and the replay directory to take the orders from: clients:players:seconds:replaypath
+				NetLoadTestOptions loadTestOptions;
+				std::string fullArg = token;
+				unsigned *counts[] = {&loadTestOptions.clients, &loadTestOptions.players, &loadTestOptions.seconds};
+				size_t position = 0;
+				for (unsigned *count : counts)
+				{
+					const size_t delimiter = fullArg.find(":", position);
+					const std::string value = fullArg.substr(position, delimiter - position);
+					if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos)
+					{
+						qFatal("Invalid netplay-loadtest value - expecting format: clients[:players[:seconds[:replaypath]]]");
+					}
+					*count = static_cast<unsigned>(std::stoul(value));
+					if (delimiter == std::string::npos)
+					{
+						position = std::string::npos;
+						break;
+					}
+					position = delimiter + 1;
+				}
+				if (position != std::string::npos)
+				{
+					const std::string replayDir = fullArg.substr(position);
+					if (!PHYSFS_mount(replayDir.c_str(), "replays", PHYSFS_APPEND))
+					{
+						qFatal("netplay-loadtest - unable to read replay directory: %s", replayDir.c_str());
+					}
+					loadTestOptions.replayDir = "replays";
+				}
+
+				const bool success = NETloopbackLoadTest(loadTestOptions);
+
+				PHYSFS_deinit();
+				exit(success ? 0 : EXIT_FAILURE);
+			}
+			break;
 		default:
 			break;
 		};
@@ -790,12 +948,17 @@ bool ParseCommandLine(int argc, const char * const *argv)
 		case CLI_HELP:
 		case CLI_VERSION:
 		case CLI_GAMESTATE_SELFTEST:
+		case CLI_RENDERGRAPH_SELFTEST:
+		case CLI_PATHFINDING_SELFTEST:
 #if defined(WZ_OS_WIN)
 		case CLI_WIN_ENABLE_CONSOLE:
 #endif
 		case CLI_WZ_CRASH_RPT:
 		case CLI_WZ_DEBUG_CRASH_HANDLER:
 		case CLI_CONVERT_SPECULAR_MAP:
+		case CLI_NETCOMPRESSION_BENCH:
+		case CLI_NETCOMPRESSION_TRAINDICT:
+		case CLI_NETPLAY_LOADTEST:
 			// These options are parsed in ParseCommandLineEarly() already, so ignore them
 			break;
 
@@ -879,6 +1042,9 @@ bool ParseCommandLine(int argc, const char * const *argv)
 		case CLI_GAMESTATE_CRCDETAIL_ONSAVE:
 			setSyncCrcDetailOnSave(20); // dump a 20-tick window around each save/load (overlaps saving vs loaded run, with headroom for debugging divergences a few ticks past resume)
 			break;
+		case CLI_GAMESTATE_JSON:
+			gamestate::setDefaultSnapshotEncoding(gamestate::SnapshotEncoding::Json);
+			break;
 		case CLI_TMP_PREFER_OLD_SAVE:
 			gamestate::savegame::setPreferLegacyLoadOverride(true);
 			break;
@@ -1478,6 +1644,40 @@ bool ParseCommandLine(int argc, const char * const *argv)
 			war_setHostConnectionProvider(pt);
 			break;
 
+		case CLI_TASK_THREADS:
+			token = poptGetOptArg(poptCon);
+			if (token == nullptr)
+			{
+				qFatal("Bad task threads count");
+			}
+			wz_task_threads = atoi(token);
+			if (wz_task_threads < 0)
+			{
+				qFatal("Invalid task threads count");
+			}
+			break;
+
+		case CLI_REPLAY_SEEK:
+		{
+			token = poptGetOptArg(poptCon);
+			if (token == nullptr)
+			{
+				qFatal("Missing game time for --replay-seek");
+			}
+			const std::string value = token;
+			if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos)
+			{
+				qFatal("Invalid game time for --replay-seek - expecting a number of seconds");
+			}
+			const unsigned long seconds = std::stoul(value);
+			if (seconds > 100 * 60 * 60)
+			{
+				qFatal("Invalid game time for --replay-seek");
+			}
+			wz_replay_seek_time = static_cast<uint32_t>(seconds) * GAME_TICKS_PER_SEC;
+			break;
+		}
+
 		} // switch (option)
 	} // while
 
@@ -1519,6 +1719,16 @@ int min_autostart_player_count()
 	return wz_min_autostart_players;
 }
 
+int task_thread_count()
+{
+	return wz_task_threads;
+}
+
+uint32_t replay_seek_time()
+{
+	return wz_replay_seek_time;
+}
+
 const std::string& cli_lobby_game_to_connect_str()
 {
 	return wz_lobby_game_to_connect_str;
@@ -44,5 +44,7 @@ bool lobby_slashcommands_hostexit_enabled();
 const std::string& cli_lobby_game_to_connect_str();
 
 int min_autostart_player_count();
+int task_thread_count();  ///< Worker threads asked for on the command line, or 0 to decide automatically.
+uint32_t replay_seek_time();  ///< Game time to start the --loadreplay replay at, or 0 for the start.
 
 #endif // __INCLUDED_SRC_CLPARSE_H__
@@ -2371,6 +2371,8 @@ void	dealWithLMB()
 	if (dbgInputManager.debugMappingsAllowed() && tileOnMap(gameWorld.map, mouseTileX, mouseTileY))
 	{
 		MAPTILE *psTile = mapTile(gameWorld.map, mouseTileX, mouseTileY);
+		const MAPTILE_DISPLAY *psDisplay = mapTileDisplay(gameWorld.map, psTile);
+		const size_t tileIndex = mapTileIndex(gameWorld.map, psTile);
 		uint8_t aux = auxTile(gameWorld.map, mouseTileX, mouseTileY, selectedPlayer);
 
 		int flipVal = 0;
@@ -2386,12 +2388,12 @@ void	dealWithLMB()
 		console("%s tile %d, %d [%d, %d] continent(l%d, h%d) level %g illum %d ao %d col %x %s %s w=%d s=%d j=%d tile#%d (decal=%s, ground [#%d, size=%.3f], f%d r%d)",
 		        tileIsExplored(psTile) ? "Explored" : "Unexplored",
 		        mouseTileX, mouseTileY, world_coord(mouseTileX), world_coord(mouseTileY),
-		        (int)psTile->limitedContinent, (int)psTile->hoverContinent, psTile->level, (int)psTile->illumination,
-				(int)psTile->ambientOcclusion, getCurrentLightmapData()(mouseTileX, mouseTileY).rgba(),
+		        (int)psTile->limitedContinent, (int)psTile->hoverContinent, psDisplay->level, (int)psDisplay->illumination,
+				(int)psDisplay->ambientOcclusion, getCurrentLightmapData()(mouseTileX, mouseTileY).rgba(),
 		        aux & AUXBITS_DANGER ? "danger" : "", aux & AUXBITS_THREAT ? "threat" : "",
-		        (int)psTile->watchers[selectedPlayer], (int)psTile->sensors[selectedPlayer], (int)psTile->jammers[selectedPlayer],
+		        (int)gameWorld.map.watchers[selectedPlayer][tileIndex], (int)gameWorld.map.sensors[selectedPlayer][tileIndex], (int)gameWorld.map.jammers[selectedPlayer][tileIndex],
 				TileNumber_tile(psTile->texture), (TILE_HAS_DECAL(psTile)) ? "y" : "n",
-				psTile->ground, getGroundType(psTile->ground).textureSize,
+				psDisplay->ground, getGroundType(psDisplay->ground).textureSize,
 				flipVal, (TileNumber_texture(psTile->texture) & TILE_ROTMASK) >> TILE_ROTSHIFT);
 	}
 }
@@ -41,6 +41,7 @@
 #include "lib/ivis_opengl/smaa_luts.h"
 #include "lib/ivis_opengl/imd.h"
 #include "lib/ivis_opengl/pieclip.h"
+#include "lib/ivis_opengl/culling.h"
 
 #include "lib/gamelib/gtime.h"
 #include "lib/sound/audio.h"
@@ -603,7 +604,7 @@ float interpolateAngleDegrees(int a, int b, float t)
 	return a + d * t;
 }
 
-bool drawShape(const iIMDShape *strImd, UDWORD timeAnimationStarted, int colour, PIELIGHT buildingBrightness, int pieFlag, int pieFlagData, const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, float stretchDepth)
+bool drawShape(const iIMDShape *strImd, UDWORD timeAnimationStarted, int colour, PIELIGHT buildingBrightness, int pieFlag, int pieFlagData, const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, float stretchDepth, const void *retainedOwner, uint32_t retainedPart)
 {
 	glm::mat4 modifiedModelMatrix = modelMatrix;
 	int animFrame = 0; // for texture animation
@@ -652,6 +653,10 @@ bool drawShape(const iIMDShape *strImd, UDWORD timeAnimationStarted, int colour,
 		}
 	}
 
+	if (retainedOwner != nullptr)
+	{
+		return pie_Draw3DShapeRetained(retainedOwner, retainedPart, strImd, animFrame, colour, buildingBrightness, pieFlag, pieFlagData, modifiedModelMatrix, viewMatrix, stretchDepth, true);
+	}
 	return pie_Draw3DShape(strImd, animFrame, colour, buildingBrightness, pieFlag, pieFlagData, modifiedModelMatrix, viewMatrix, stretchDepth, true);
 }
 
@@ -1358,7 +1363,12 @@ static void drawTiles(iView *player, LightingData& lightData, LightMap& lightmap
 	/* ---------------------------------------------------------------- */
 
 	pie_UpdateLightmap(getTerrainLightmapTexture(), getModelUVLightmapMatrix());
-	pie_FinalizeMeshes(currentGameFrame);
+	std::vector<glm::mat4> shadowCascadeViewProjections;
+	for (size_t i = 0; i < shadowCascades.size() && i < WZ_MAX_SHADOW_CASCADES; ++i)
+	{
+		shadowCascadeViewProjections.push_back(shadowCascades[i].projectionMatrix * shadowCascades[i].viewMatrix);
+	}
+	pie_FinalizeMeshes(currentGameFrame, shadowCascadeViewProjections);
 
 
 	ShadowCascadesInfo shadowCascadesInfo;
@@ -2225,9 +2235,28 @@ static void displayProximityMsgs(const glm::mat4& viewMatrix, const glm::mat4 &p
 }
 
 /// Draw the droids
+/// Queues a droid for displayDynamicObjects() to test against the view frustum, together with the others.
+/// The sphere is generous (clipDroidOnScreen() makes the exact check afterwards): it allows for shadows, flying
+/// units' shadows on the ground below, and the droid having moved since its last game tick.
+static void addDynamicObjectCandidate(DROID *psDroid, std::vector<DROID *> &candidates, BoundingSphereList &spheres)
+{
+	const BODY_STATS *psBStats = psDroid->getBodyStats();
+	const iIMDShape *pIMD = (psBStats != nullptr && psBStats->pIMD != nullptr) ? psBStats->pIMD->displayModel() : nullptr;
+	const float radius = (pIMD != nullptr ? pIMD->sradius : TILE_UNITS) + 2 * TILE_UNITS + 2 * std::max(psDroid->heightAboveMap, 0);
+
+	candidates.push_back(psDroid);
+	spheres.push_back(glm::vec3(psDroid->pos.x, psDroid->pos.z, -psDroid->pos.y), radius);
+}
+
 static void displayDynamicObjects(const glm::mat4 &viewMatrix, const glm::mat4 &perspectiveViewMatrix)
 {
 	WZ_PROFILE_SCOPE(displayDynamicObjects);
+	static std::vector<DROID *> candidates;
+	static BoundingSphereList candidateSpheres;
+	static std::vector<uint8_t> candidateVisible;
+	candidates.clear();
+	candidateSpheres.clear();
+
 	/* Need to go through all the droid lists */
 	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
 	{
@@ -2242,7 +2271,7 @@ static void displayDynamicObjects(const glm::mat4 &viewMatrix, const glm::mat4 &
 			/* No point in adding it if you can't see it? */
 			if (psDroid->visibleForLocalDisplay())
 			{
-				displayComponentObject(psDroid, viewMatrix, perspectiveViewMatrix);
+				addDynamicObjectCandidate(psDroid, candidates, candidateSpheres);
 			}
 		}
 	}
@@ -2260,7 +2289,18 @@ static void displayDynamicObjects(const glm::mat4 &viewMatrix, const glm::mat4 &
 		/* No point in adding it if you can't see it? */
 		if (psDroid->visibleForLocalDisplay())
 		{
-			displayComponentObject(psDroid, viewMatrix, perspectiveViewMatrix);
+			addDynamicObjectCandidate(psDroid, candidates, candidateSpheres);
+		}
+	}
+
+	// Drop the droids which are certainly off screen all at once, before working out how to draw the rest
+	candidateVisible.resize(candidates.size());
+	cullBoundingSpheres(extractViewFrustum(perspectiveViewMatrix), candidateSpheres, candidateVisible.data());
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		if (candidateVisible[i])
+		{
+			displayComponentObject(candidates[i], viewMatrix, perspectiveViewMatrix);
 		}
 	}
 }
@@ -2401,7 +2441,7 @@ void	renderFeature(FEATURE *psFeature, const glm::mat4 &viewMatrix, const glm::m
 
 		/* Translate the feature  - N.B. We can also do rotations here should we require
 		buildings to face different ways - Don't know if this is necessary - should be IMO */
-		pie_Draw3DShape(strImd, 0, 0, brightness, pieFlags, 0, modelMatrix, viewMatrix, stretchDepth);
+		pie_Draw3DShapeRetained(psFeature, 0, strImd, 0, 0, brightness, pieFlags, 0, modelMatrix, viewMatrix, stretchDepth);
 	}
 
 	setScreenDispWithPerspective(&psFeature->sDisplay, perspectiveViewMatrix * modelMatrix);
@@ -2856,14 +2896,14 @@ void renderStructure(STRUCTURE *psStructure, const glm::mat4 &viewMatrix, const
 		strImd = strImd->objanimpie[psStructure->animationEvent]->displayModel();
 	}
 
-	while (strImd)
+	for (uint32_t level = 0; strImd; ++level)
 	{
 		float stretch = 0.f;
 		if (defensive && !psStructure->isBlueprint() && !(strImd->flags & iV_IMD_NOSTRETCH))
 		{
 			stretch = psStructure->pos.z - psStructure->foundationDepth;
 		}
-		drawShape(strImd, psStructure->timeAnimationStarted, colour, buildingBrightness, pieFlag, pieFlagData, modelMatrix, viewMatrix, stretch);
+		drawShape(strImd, psStructure->timeAnimationStarted, colour, buildingBrightness, pieFlag, pieFlagData, modelMatrix, viewMatrix, stretch, psStructure, level);
 		if (strImd->connectors.size() > 0)
 		{
 			renderStructureTurrets(psStructure, strImd, buildingBrightness, pieFlag, pieFlagData, ecmFlag, modelMatrix, viewMatrix);
@@ -2981,7 +3021,7 @@ static bool renderWallSection(STRUCTURE *psStructure, const glm::mat4 &viewMatri
 		iIMDBaseShape *imd = psStructure->sDisplay.imd;
 		if (imd)
 		{
-			pie_Draw3DShape(getFactionDisplayIMD(faction, imd->displayModel()), 0, getPlayerColour(psStructure->player), brightness, pieFlag | ecmFlag, pieFlagData, modelMatrix, viewMatrix, stretch);
+			pie_Draw3DShapeRetained(psStructure, 0, getFactionDisplayIMD(faction, imd->displayModel()), 0, getPlayerColour(psStructure->player), brightness, pieFlag | ecmFlag, pieFlagData, modelMatrix, viewMatrix, stretch);
 		}
 	}
 	setScreenDispWithPerspective(&psStructure->sDisplay, perspectiveViewMatrix * modelMatrix);
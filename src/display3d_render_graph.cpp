@@ -153,7 +153,7 @@ static void recordShadowCascade(const gfx_api::RenderPassContext& passCtx)
 		drawTerrainDepthOnly(fc.cascadeProj[cascadeIndex] * fc.cascadeView[cascadeIndex], fc.perspectiveViewMatrix);
 	}
 	pie_DrawAllMeshes(fc.currentGameFrame, fc.cascadeProj[cascadeIndex], fc.cascadeView[cascadeIndex],
-		cameraPos, fc.shadowCascadesInfo, nullptr, true);
+		cameraPos, fc.shadowCascadesInfo, nullptr, true, static_cast<int>(cascadeIndex));
 }
 
 static void recordSceneBlit(const gfx_api::RenderPassContext& passCtx)
@@ -239,8 +239,9 @@ void registerInGame3DRecordFuncs(gfx_api::RecordFuncTable& table)
 	table.set(gfx_api::PassId::SceneOverlays, display3d_recordSceneOverlays);
 	table.set(gfx_api::PassId::SceneDebugOverlays, display3d_recordSceneDebugOverlays);
 
+	// Cascades only read the frame context and the finalized mesh lists, so they may be recorded in parallel
 	for (uint32_t i = 0; i < WZ_MAX_SHADOW_CASCADES; ++i)
 	{
-		table.set(gfx_api::shadowCascadePassId(i), recordShadowCascade);
+		table.set(gfx_api::shadowCascadePassId(i), recordShadowCascade, true);
 	}
 }
@@ -709,8 +709,9 @@ bool destroyDroid(DROID *psDel, unsigned impactTime, GameWorld& world)
 				psTile = mapTile(world.map, width, breadth);
 				if (TEST_TILE_VISIBLE_TO_SELECTEDPLAYER(psTile))
 				{
-					psTile->illumination /= 2;
-					psTile->ambientOcclusion /= 2;
+					MAPTILE_DISPLAY *psDisplay = mapTileDisplay(world.map, psTile);
+					psDisplay->illumination /= 2;
+					psDisplay->ambientOcclusion /= 2;
 				}
 			}
 		}
@@ -24,7 +24,11 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <future>
+#include <string>
 #include <unordered_map>
 
 #include "lib/framework/frame.h"
@@ -33,6 +37,7 @@
 #include "lib/netplay/sync_debug.h"
 
 #include "lib/framework/wzapp.h"
+#include "lib/framework/task_scheduler.h"
 
 #include "objects.h"
 #include "map.h"
@@ -42,9 +47,7 @@
 #include "fpath.h"
 #include "profiling.h"
 #include "game_world.h"
-
-// If the path finding system is shutdown or not
-static volatile bool fpathQuit = false;
+#include "console.h"
 
 /* Beware: Enabling this will cause significant slow-down. */
 #undef DEBUG_MAP
@@ -61,123 +64,89 @@ struct PATHRESULT
 // threading stuff
 using packagedPathJob = wz::packaged_task<PATHRESULT(const std::shared_ptr<FPathExecuteContext>& ctx)>;
 
-struct FpathThreadInfo
+/** Jobs whose results may depend on each other, and which therefore must run in order on the same FPathExecuteContext.
+ *
+ *  The result of fpathAStarRoute depends on whether an earlier job left a PathfindContext it can reuse, so every job
+ *  which could match that context (see PathfindContext::matches) goes into the same cohort: same game tick, same
+ *  blocking map (see fpathIsEquivalentBlocking) and same destination tile. Each cohort runs its jobs through its own
+ *  TaskStrand, so any thread may run a cohort, but only one at a time, and the results do not depend on which thread
+ *  ran it or on how many threads there are.
+ */
+struct FpathCohort
+{
+	TaskStrand strand{TaskPriority::Normal};
+	std::shared_ptr<FPathExecuteContext> ctx;       ///< Only used by the job currently running. Lent from fpathSpareContexts if possible.
+};
+
+struct FpathCohortKey
 {
-public:
-	FpathThreadInfo()
+	uint32_t gameTime;
+	size_t domain;
+	int owner;
+	FPATH_MOVETYPE moveType;
+	Vector2i tileDest;
+
+	bool operator ==(FpathCohortKey const &b) const
 	{
-		mutex = wzMutexCreate();
-		semaphore = wzSemaphoreCreate(0);
+		return gameTime == b.gameTime && domain == b.domain && owner == b.owner && moveType == b.moveType && tileDest == b.tileDest;
 	}
+};
 
-	~FpathThreadInfo()
+struct FpathCohortKeyHash
+{
+	std::size_t operator()(FpathCohortKey const &k) const
 	{
-		wzMutexDestroy(mutex);
-		mutex = nullptr;
-		wzSemaphoreDestroy(semaphore);
-		semaphore = nullptr;
+		std::size_t h = 0;
+		hash_combine(h, k.gameTime, k.domain, k.owner, k.moveType, k.tileDest.x, k.tileDest.y);
+		return h;
 	}
-
-	FpathThreadInfo(FpathThreadInfo&&) = delete;
-	FpathThreadInfo& operator=(FpathThreadInfo&&) = delete;
-	FpathThreadInfo(const FpathThreadInfo&) = delete;
-	FpathThreadInfo& operator=(const FpathThreadInfo&) = delete;
-public:
-	WZ_SEMAPHORE *semaphore;
-	WZ_MUTEX *mutex;
-	std::list<packagedPathJob> pathJobs;
 };
 
-static std::vector<WZ_THREAD *> fpathThreads;
-static std::vector<std::unique_ptr<FpathThreadInfo>> fpathThreadsInfo;
+static std::unordered_map<FpathCohortKey, std::unique_ptr<FpathCohort>, FpathCohortKeyHash> fpathCohorts;  ///< Cohorts of the current tick. Main thread only.
+static std::vector<std::unique_ptr<FpathCohort>> fpathOldCohorts;  ///< Cohorts of earlier ticks which still had jobs left. Main thread only.
+static uint32_t fpathCohortsGameTime = 0;
+/// Contexts of cohorts which ran all their jobs, cleared and lent to new cohorts, so that their maps do not need allocating and
+/// zeroing for every cohort. Main thread only.
+static std::vector<std::shared_ptr<FPathExecuteContext>> fpathSpareContexts;
+static constexpr size_t FPATH_MAX_SPARE_CONTEXTS = 16;  ///< More would only be needed for ticks with unusually many cohorts.
+static std::atomic<size_t> fpathQueuedJobs{0};            ///< Jobs not yet started, in all cohorts.
+static std::atomic<uint64_t> fpathBusyMicroseconds{0};    ///< Total time spent running jobs.
+static std::atomic<uint32_t> fpathJobsRun{0};             ///< Total number of jobs run.
+static uint64_t fpathLastBusyMicroseconds = 0;            ///< Main thread only, for fpathUpdate.
+static uint32_t fpathLastJobsRun = 0;                     ///< Main thread only, for fpathUpdate.
+static std::vector<uint64_t> fpathLastTaskBusyMicroseconds;        ///< Per task thread. Main thread only, for fpathUpdate.
+static std::vector<std::string> fpathTaskUtilizationCounterNames;  ///< Per task thread. Main thread only, for fpathUpdate.
 static std::unordered_map<uint32_t, wz::future<PATHRESULT>> pathResults;
-
-#ifdef DEBUG
-static std::vector<size_t> numJobsPerThreadThisTick;
-static uint32_t currentFpathTick = 0;
-#endif
-
-constexpr size_t MAX_FPATH_THREADS = 2;
+static std::chrono::steady_clock::time_point fpathLastUpdateTime;
 
 static PATHRESULT fpathExecute(const std::shared_ptr<FPathExecuteContext>& ctx, PATHJOB psJob);
 
 
-/** This runs in a separate thread */
-static int fpathThreadFunc(void *data)
+/// Forgets the cohorts of earlier ticks, once they have run all their jobs, and keeps their contexts for new cohorts.
+static void fpathRetireCohorts()
 {
-	FpathThreadInfo* threadInfo = static_cast<FpathThreadInfo*>(data);
-	WZ_SEMAPHORE *fpathSemaphore = threadInfo->semaphore;
-	WZ_MUTEX *fpathMutex = threadInfo->mutex;
-	std::list<packagedPathJob>& pathJobs = threadInfo->pathJobs;
-
-	// create an fpath astar job context
-	auto ctx = makeFPathExecuteContext();
-
-	while (true)
+	for (auto &cohort : fpathCohorts)
 	{
-		wzSemaphoreWait(fpathSemaphore);  // Wait until needed.
-		wzMutexLock(fpathMutex);
-
-		if (fpathQuit)
-		{
-			wzMutexUnlock(fpathMutex);
-			break;
-		}
-
-		if (pathJobs.empty())
-		{
-			// should not happen - semaphore was signaled!
-			ASSERT(!pathJobs.empty(), "Received a signal but no job to consume!");
-			wzMutexUnlock(fpathMutex);
-			continue;
-
-		}
-
-		WZ_PROFILE_SCOPE(fpathJob);
-		// Copy the first job from the queue.
-		packagedPathJob job = std::move(pathJobs.front());
-		pathJobs.pop_front();
-
-		wzMutexUnlock(fpathMutex);
-
-		job(ctx);
+		fpathOldCohorts.push_back(std::move(cohort.second));
 	}
-	return 0;
-}
-
-static size_t fpathDetermineNumberOfThreads()
-{
-	auto logicalCPUCount = wzGetLogicalCPUCount();
-	if (logicalCPUCount <= 1)
+	fpathCohorts.clear();
+	for (auto &cohort : fpathOldCohorts)
 	{
-		return 1;
+		if (cohort->strand.pending() == 0 && cohort->ctx != nullptr && fpathSpareContexts.size() < FPATH_MAX_SPARE_CONTEXTS)
+		{
+			fpathClearExecuteContext(cohort->ctx);  // So that the results of the next cohort do not depend on which context it gets.
+			fpathSpareContexts.push_back(std::move(cohort->ctx));
+		}
 	}
-	// subtract one for the main thread
-	return std::min<size_t>(logicalCPUCount - 1, MAX_FPATH_THREADS);
+	fpathOldCohorts.erase(std::remove_if(fpathOldCohorts.begin(), fpathOldCohorts.end(), [](std::unique_ptr<FpathCohort> const &cohort) {
+		return cohort->strand.pending() == 0;
+	}), fpathOldCohorts.end());
 }
 
 // initialise the findpath module
 bool fpathInitialise()
 {
-	// The path system is up
-	fpathQuit = false;
-
-	if (fpathThreads.empty())
-	{
-		auto numThreads = fpathDetermineNumberOfThreads();
-		debug(LOG_INFO, "Using threads: %zu", numThreads);
-		fpathThreads.resize(numThreads, nullptr);
-		fpathThreadsInfo.resize(numThreads);
-#ifdef DEBUG
-		numJobsPerThreadThisTick.resize(numThreads);
-#endif
-		for (size_t i = 0; i < fpathThreads.size(); ++i)
-		{
-			fpathThreadsInfo[i] = std::make_unique<FpathThreadInfo>();
-			fpathThreads[i] = wzThreadCreate(fpathThreadFunc, fpathThreadsInfo[i].get(), "wzPath");
-			wzThreadStart(fpathThreads[i]);
-		}
-	}
+	fpathLastUpdateTime = std::chrono::steady_clock::now();
 
 	return true;
 }
@@ -185,26 +154,14 @@ bool fpathInitialise()
 
 void fpathShutdown()
 {
-	if (!fpathThreads.empty())
+	// Let the jobs already queued finish, since they use the cohorts.
+	fpathRetireCohorts();
+	for (auto &cohort : fpathOldCohorts)
 	{
-		// Signal the path finding thread(s) to quit
-		fpathQuit = true;
-		for (size_t i = 0; i < fpathThreadsInfo.size(); ++i)
-		{
-			wzSemaphorePost(fpathThreadsInfo[i]->semaphore);  // Wake up a thread
-		}
-		for (size_t i = 0; i < fpathThreads.size(); ++i)
-		{
-			wzThreadJoin(fpathThreads[i]);
-		}
-		fpathThreads.clear();
-		fpathThreadsInfo.clear();
-
-#ifdef DEBUG
-		numJobsPerThreadThisTick.clear();
-		currentFpathTick = 0;
-#endif
+		cohort->strand.wait();
 	}
+	fpathOldCohorts.clear();
+	fpathSpareContexts.clear();
 	fpathHardTableReset();
 }
 
@@ -215,7 +172,45 @@ void fpathShutdown()
  */
 void fpathUpdate()
 {
-	// Nothing now
+	// Report how busy the path jobs kept the task threads since the last update.
+	auto now = std::chrono::steady_clock::now();
+	const uint64_t wallMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(now - fpathLastUpdateTime).count();
+	fpathLastUpdateTime = now;
+
+	const uint64_t busy = fpathBusyMicroseconds;
+	const uint32_t jobs = fpathJobsRun;
+	const double busyThreads = wallMicroseconds != 0 ? double(busy - fpathLastBusyMicroseconds) / wallMicroseconds : 0.0;
+	WZ_PROFILE_COUNTER("fpath busy threads", busyThreads);
+	debug(LOG_NEVER, "fpath jobs since last update: %u (%d%% of a thread)", jobs - fpathLastJobsRun, int(busyThreads * 100));
+	fpathLastBusyMicroseconds = busy;
+	fpathLastJobsRun = jobs;
+
+	// And how busy all tasks together kept each task thread.
+	const size_t taskThreadCount = wzTaskSchedulerThreadCount();
+	if (fpathTaskUtilizationCounterNames.size() != taskThreadCount)
+	{
+		fpathLastTaskBusyMicroseconds.resize(taskThreadCount, 0);
+		fpathTaskUtilizationCounterNames.resize(taskThreadCount);
+		for (size_t i = 0; i < taskThreadCount; ++i)
+		{
+			fpathLastTaskBusyMicroseconds[i] = wzTaskSchedulerBusyMicroseconds(i);
+			fpathTaskUtilizationCounterNames[i] = "wzTask" + std::to_string(i) + " utilization";
+		}
+	}
+	std::string utilizationPerThread;
+	for (size_t i = 0; i < taskThreadCount; ++i)
+	{
+		const uint64_t taskBusy = wzTaskSchedulerBusyMicroseconds(i);
+		const double utilization = wallMicroseconds != 0 ? double(taskBusy - fpathLastTaskBusyMicroseconds[i]) / wallMicroseconds : 0.0;
+		WZ_PROFILE_COUNTER(fpathTaskUtilizationCounterNames[i].c_str(), utilization);
+		utilizationPerThread += " " + std::to_string(int(utilization * 100)) + "%,";
+		fpathLastTaskBusyMicroseconds[i] = taskBusy;
+	}
+	debug(LOG_NEVER, "task thread utilization since last update:%s", utilizationPerThread.c_str());
+
+	const PathRouteCacheStats cacheStats = fpathRouteCacheStats();
+	WZ_PROFILE_COUNTER("fpath route cache hit rate", cacheStats.lookups != 0 ? double(cacheStats.hits) / cacheStats.lookups : 0.0);
+	debug(LOG_NEVER, "fpath route cache: %" PRIu64 "/%" PRIu64 " hits, %" PRIu64 " stored, %" PRIu64 " evicted", cacheStats.hits, cacheStats.lookups, cacheStats.stores, cacheStats.evictions);
 }
 
 static constexpr size_t fpathPropulsionDomain(PROPULSION_TYPE propulsion)
@@ -230,34 +225,19 @@ static constexpr size_t fpathPropulsionDomain(PROPULSION_TYPE propulsion)
 	return 0; // silence compiler warning
 }
 
-static inline size_t fpathJobDispatchThreadId(const PATHJOB& job, size_t numThreads)
+/// Propulsion domains which use jump point search instead of plain A*, indexed by fpathPropulsionDomain.
+/// Jump point search gives octile-optimal routes, and does best on large open areas. Must be the same on all clients.
+static constexpr bool fpathDomainUsesJumpPoints[] =
 {
-	if (numThreads == 1) { return 0; }
-
-	// Every job that matches a PathfindContext must be processed by the same thread, as the result of fpathAStarRoute is dependent upon jobs
-	// within each matching "cohort" having access to the same PathfindContext (and PathfindContexts are not shared between threads).
-	//
-	// (In other words, the results may slightly differ depending on whether an existing PathfindContext is reused versus starting from scratch.)
-
-	std::size_t h = 0;
-	auto domain = fpathPropulsionDomain(job.propulsion);
-	const Vector2i tileDest(map_coord(job.destX), map_coord(job.destY));
+	false,  // Land
+	true,   // Air
+	false,  // Water
+	false,  // Land and water
+};
 
-	// Note: We use part of the behavior of PathfindContext::matches() (which is called by fpathAStarRoute)
-	// Specifically, we match using the same logic as fpathIsEquivalentBlocking, plus tileDest
-	if (domain == fpathPropulsionDomain(PROPULSION_TYPE_LIFT))
-	{
-		// Air units ignore move type and player (see: fpathIsEquivalentBlocking)
-		// So just use the domain + tileDest
-		hash_combine(h, domain, tileDest.x, tileDest.y);
-	}
-	else
-	{
-		// All other unit types care about domain + player + moveType (see: fpathIsEquivalentBlocking)
-		// So use those + tileDest
-		hash_combine(h, domain, job.owner, job.moveType, tileDest.x, tileDest.y);
-	}
-	return h % numThreads;
+bool fpathUseJumpPointSearch(PROPULSION_TYPE propulsion)
+{
+	return fpathDomainUsesJumpPoints[fpathPropulsionDomain(propulsion)];
 }
 
 bool fpathIsEquivalentBlocking(PROPULSION_TYPE propulsion1, int player1, FPATH_MOVETYPE moveType1,
@@ -454,27 +434,6 @@ static FPATH_RETVAL fpathRoute(const WorldMapState& mapState, MOVE_CONTROL *psMo
 {
 	objTrace(id, "called(*,id=%d,sx=%d,sy=%d,ex=%d,ey=%d,prop=%d,type=%d,move=%d,owner=%d)", id, startX, startY, tX, tY, (int)propulsionType, (int)droidType, (int)moveType, owner);
 
-#ifdef DEBUG
-	if (gameTime != currentFpathTick)
-	{
-		if (enabled_debug[currentFpathTick])
-		{
-			static std::string tmpDgbStr;
-			tmpDgbStr = "Last tick fpath jobs per thread:";
-			for (const auto& c : numJobsPerThreadThisTick)
-			{
-				tmpDgbStr += " " + std::to_string(c) + ",";
-			}
-			debug(LOG_MOVEMENT, "%s", tmpDgbStr.c_str());
-		}
-		currentFpathTick = gameTime;
-		for (auto& c : numJobsPerThreadThisTick)
-		{
-			c = 0;
-		}
-	}
-#endif
-
 	if (!worldOnMap(mapState, startX, startY) || !worldOnMap(mapState, tX, tY))
 	{
 		debug(LOG_ERROR, "Droid trying to find path to/from invalid location (%d %d) -> (%d %d).", startX, startY, tX, tY);
@@ -547,24 +506,43 @@ queuePathfinding:
 	// job or result for each droid in the system at any time.
 	fpathRemoveDroidData(id);
 
-	packagedPathJob task([job](const std::shared_ptr<FPathExecuteContext>& ctx) { return fpathExecute(ctx, job); });
-	pathResults[id] = task.get_future();
+	auto task = std::make_shared<packagedPathJob>([job](const std::shared_ptr<FPathExecuteContext>& ctx) { return fpathExecute(ctx, job); });
+	pathResults[id] = task->get_future();
 
-	// Get target thread for job
-	auto targetThreadId = fpathJobDispatchThreadId(job, fpathThreads.size());
-	auto& threadInfo = *fpathThreadsInfo[targetThreadId];
-
-	// Add to end of appropriate list
-	wzMutexLock(threadInfo.mutex);
-	bool isFirstJob = threadInfo.pathJobs.empty();
-	threadInfo.pathJobs.push_back(std::move(task));
-	wzMutexUnlock(threadInfo.mutex);
-
-	wzSemaphorePost(threadInfo.semaphore);  // Increment semaphore
+	// Add to the end of the cohort of the job.
+	if (fpathCohortsGameTime != gameTime)
+	{
+		fpathCohortsGameTime = gameTime;
+		fpathRetireCohorts();
+	}
+	const size_t domain = fpathPropulsionDomain(job.propulsion);
+	const bool air = domain == fpathPropulsionDomain(PROPULSION_TYPE_LIFT);  // Air units ignore move type and player (see: fpathIsEquivalentBlocking)
+	const FpathCohortKey key{gameTime, domain, air ? 0 : job.owner, air ? FMT_MOVE : job.moveType, Vector2i(map_coord(job.destX), map_coord(job.destY))};
+	auto &cohort = fpathCohorts[key];
+	if (cohort == nullptr)
+	{
+		cohort = std::make_unique<FpathCohort>();
+		if (!fpathSpareContexts.empty())
+		{
+			cohort->ctx = std::move(fpathSpareContexts.back());
+			fpathSpareContexts.pop_back();
+		}
+		else
+		{
+			cohort->ctx = makeFPathExecuteContext();
+		}
+	}
 
-#ifdef DEBUG
-	numJobsPerThreadThisTick[targetThreadId]++;
-#endif
+	bool isFirstJob = fpathQueuedJobs++ == 0;
+	FpathCohort *psCohort = cohort.get();  // Outlives its jobs, see fpathRetireCohorts.
+	psCohort->strand.submit([psCohort, task]() {
+		--fpathQueuedJobs;
+		WZ_PROFILE_SCOPE(fpathJob);
+		auto start = std::chrono::steady_clock::now();
+		(*task)(psCohort->ctx);
+		fpathBusyMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		++fpathJobsRun;
+	});
 
 	objTrace(id, "Queued up a path-finding request to (%d, %d), at least %d items earlier in queue", tX, tY, isFirstJob);
 	syncDebug("fpathRoute(..., %d, %d, %d, %d, %d, %d, %d, %d, %d) = FPR_WAIT", id, startX, startY, tX, tY, propulsionType, droidType, moveType, owner);
@@ -667,15 +645,7 @@ PATHRESULT fpathExecute(const std::shared_ptr<FPathExecuteContext>& ctx, PATHJOB
 /** Find the length of the job queue. Function is thread-safe. */
 static size_t fpathJobQueueLength()
 {
-	size_t count = 0;
-
-	for (const auto& threadInfo : fpathThreadsInfo)
-	{
-		wzMutexLock(threadInfo->mutex);
-		count += threadInfo->pathJobs.size(); // O(N) function call for std::list. .empty() is faster, but this function isn't used except in tests.
-		wzMutexUnlock(threadInfo->mutex);
-	}
-	return count;
+	return fpathQueuedJobs;
 }
 
 
@@ -705,12 +675,6 @@ void fpathTest(int x, int y, int x2, int y2)
 	(void)fpathJobQueueLength();
 
 	/* Check initial state */
-	assert(!fpathThreads.empty());
-	for (const auto& threadInfo : fpathThreadsInfo)
-	{
-		ASSERT(threadInfo->mutex != nullptr, "Failed to initialize mutex?");
-		ASSERT(threadInfo->semaphore != nullptr, "Failed to initialize semaphore?");
-	}
 	assert(fpathJobQueueLength() == 0);
 	assert(pathResults.empty());
 	fpathRemoveDroidData(0);	// should not crash
@@ -782,6 +746,23 @@ void fpathTest(int x, int y, int x2, int y2)
 	(void)r;  // Squelch unused-but-set warning.
 }
 
+void fpathBenchmark()
+{
+	static const PROPULSION_TYPE propulsions[] = {PROPULSION_TYPE_WHEELED, PROPULSION_TYPE_LIFT, PROPULSION_TYPE_PROPELLOR, PROPULSION_TYPE_HOVER};
+	static const char *const domainNames[] = {"land", "air", "water", "hover"};
+	const unsigned routes = 500;
+
+	for (unsigned domain = 0; domain < ARRAY_SIZE(propulsions); ++domain)
+	{
+		for (bool jumpPoints : {false, true})
+		{
+			PathBenchmarkResult r = fpathAStarBenchmark(propulsions[domain], jumpPoints, routes, 12345);
+			CONPRINTF("pathbench %s %s: %u/%u routes, %llu nodes expanded, %llu us, total cost %llu", domainNames[domain], jumpPoints ? "jps" : "a*",
+			          r.routes, routes, (unsigned long long)r.expandedNodes, (unsigned long long)r.microseconds, (unsigned long long)r.totalCost);
+		}
+	}
+}
+
 bool fpathCheck(WorldMapState& mapState, Position orig, Position dest, PROPULSION_TYPE propulsion)
 {
 	// We have to be careful with this check because it is called on
@@ -127,6 +127,9 @@ static inline bool fpathBlockingTile(const WorldMapState& mapState, Vector2i til
 	return fpathBlockingTile(mapState, tile.x, tile.y, propulsion);
 }
 
+/// Returns true if routes for this propulsion use jump point search instead of plain A*. Same on all clients.
+bool fpathUseJumpPointSearch(PROPULSION_TYPE propulsion);
+
 /** Set a direct path to position.
  *
  *  Plan a path from @c psDroid's current position to given position without
@@ -146,6 +149,9 @@ bool fpathCheck(WorldMapState& mapState, Position orig, Position dest, PROPULSIO
 /** Unit testing. */
 void fpathTest(int x, int y, int x2, int y2);
 
+/** Compares plain A* and jump point search on the current map for each propulsion domain, printing the results to the console. */
+void fpathBenchmark();
+
 /** @} */
 
 #endif // __INCLUDED_SRC_FPATH_H__
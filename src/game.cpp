@@ -89,6 +89,7 @@
 #include "multistat.h"
 #include "multiint.h"
 #include "wrappers.h"
+#include "clparse.h"
 #include "challenge.h"
 #include "gamestate_savegame.h"
 #include "combat.h"
@@ -2359,7 +2360,8 @@ LoadingTask<> loadGameInit(ResourceLoadingController& controller, const GameLoad
 
 		// if it ends in .wzrp, try to load the replay!
 		WZGameReplayOptionsHandler optionsHandler;
-		if (!NETloadReplay(gameToLoad.filePath, optionsHandler))
+		uint32_t seekGameTime = (getHostLaunch() == HostLaunch::LoadReplay) ? replay_seek_time() : 0;
+		if (!NETloadReplay(gameToLoad.filePath, optionsHandler, seekGameTime))
 		{
 			co_return load_fail();
 		}
@@ -3891,14 +3893,23 @@ bool saveGame(const char *aFileName, GAME_TYPE saveType, bool isAutoSave)
 		{
 			sgType = gamestate::savegame::SaveType::Challenge;
 		}
-		if (!gamestate::savegame::writeGameStateBlobToFolder(CurrentFileName, sgType))
+		// Encoding, compression and the write happen in the background, so big saves don't hitch the game.
+		// Non-fatal if it fails: the legacy save above already succeeded.
+		std::string blobFolder = CurrentFileName;
+		auto onBlobWritten = [blobFolder](bool success) {
+			if (!success)
+			{
+				debug(LOG_ERROR, "Failed to write GameState savegame blob for %s", blobFolder.c_str());
+			}
+		};
+		if (!gamestate::savegame::writeGameStateBlobToFolderAsync(CurrentFileName, sgType, onBlobWritten))
 		{
 			debug(LOG_ERROR, "Failed to write GameState savegame blob for %s", CurrentFileName);
-			// Non-fatal: the legacy save above already succeeded.
 		}
 	}
 
 #if defined(__EMSCRIPTEN__)
+	gamestate::savegame::waitForSavegameWrites(); // the sync below must include the blob
 	WZ_EmscriptenSyncPersistFSChanges(!isAutoSave); // NOTE: Will block main loop iterations until it finishes (asynchronously)
 #endif
 
@@ -53,11 +53,14 @@
 #include "lib/gamelib/gtime.h"      // gameTime, setGameTime
 #include "lib/ivis_opengl/piepalette.h" // pal_Init
 #include "lib/framework/file.h"     // saveFile, loadFileToBufferVector
+#include "lib/framework/task_scheduler.h" // TaskStrand, wzTaskSubmitMainThread (background savegame writes)
+#include "profiling.h"
 
 #include <physfs.h>
 #include "ZipIOProvider.h"  // WzMapZipIO - libzip-backed .wz zip container
 
 #include <ctime>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -589,7 +592,8 @@ bool runSavegameHeaderSelfTest()
 // MARK: - Container: zip wrapper (setup header + GameState document)
 //
 // The wrapper document is { format, version, saveType, setup, gameState, localState, pendingResume }, stored as a
-// single "gamestate.json" entry inside a standard zip archive (the on-disk file keeps its .wz name).
+// single entry inside a standard zip archive (the on-disk file keeps its .wz name): "gamestate.cbor" in the binary
+// encoding, or "gamestate.json" as JSON text.
 
 constexpr uint32_t SAVEGAME_CONTAINER_VERSION = 1;
 constexpr const char *SAVEGAME_FORMAT_TAG = "wz-savegame";
@@ -599,7 +603,8 @@ static const char *kStateBlobFileName = "gamestate.wz";   // the on-disk zip arc
 // New-format metadata sidecar. A distinct name from the legacy "save-info.json" the load menu still
 // enumerates, so both can coexist in a dual-written folder without clobbering each other.
 static const char *kSidecarFileName = "gamestate-info.json";
-static const char *kContainerJsonName = "gamestate.json"; // the single entry inside the zip
+static const char *kContainerJsonName = "gamestate.json"; // the single entry inside the zip (SnapshotEncoding::Json)
+static const char *kContainerCborName = "gamestate.cbor"; // the single entry inside the zip (SnapshotEncoding::Binary)
 
 // Upper bound on the decompressed container document. Real saves are far smaller; this caps a crafted
 // archive that declares an enormous uncompressed size (zip-bomb / memory-exhaustion defence).
@@ -770,7 +775,8 @@ static void applyPendingResume(const nlohmann::ordered_json &j)
 	}
 }
 
-std::vector<uint8_t> serializeSavegameContainer(SaveType saveType)
+// Builds the container document from the live game, so main thread only.
+static nlohmann::ordered_json buildSavegameContainerDoc(SaveType saveType)
 {
 	nlohmann::ordered_json doc = nlohmann::ordered_json::object();
 	doc["format"] = SAVEGAME_FORMAT_TAG;
@@ -783,10 +789,21 @@ std::vector<uint8_t> serializeSavegameContainer(SaveType saveType)
 	doc["gameState"] = gameStateToJson();
 	doc["localState"] = writeLocalState();
 	doc["pendingResume"] = writePendingResume();
+	return doc;
+}
 
-	const std::string json = doc.dump();
+// Encodes and zips a container document. Touches no game state, so it may run on any thread.
+// onStage (if set) is told when compression starts.
+static std::vector<uint8_t> packSavegameContainer(const nlohmann::ordered_json &doc, SnapshotEncoding encoding, const std::function<void (SavegameWriteStage)> &onStage = nullptr)
+{
+	const std::string encoded = encodeSnapshot(doc, encoding);
+	const char *entryName = (encoding == SnapshotEncoding::Binary) ? kContainerCborName : kContainerJsonName;
+	if (onStage)
+	{
+		onStage(SavegameWriteStage::Compressing);
+	}
 
-	// Store the container document as a single "gamestate.json" entry inside an in-memory zip archive.
+	// Store the container document as a single entry inside an in-memory zip archive.
 	// createZipArchiveMemory hands back the finished archive bytes through the on-close closure, which
 	// runs when the writer's last reference is released (end of the block below). fixedLastMod keeps the
 	// archive deterministic (no wall-clock mtime), so identical state produces identical bytes.
@@ -799,7 +816,7 @@ std::vector<uint8_t> serializeSavegameContainer(SaveType saveType)
 		{
 			throw StateError("failed to create in-memory savegame zip");
 		}
-		if (!zip->writeFullFile(kContainerJsonName, json.data(), static_cast<uint32_t>(json.size())))
+		if (!zip->writeFullFile(entryName, encoded.data(), static_cast<uint32_t>(encoded.size())))
 		{
 			throw StateError("failed to write savegame container document into zip");
 		}
@@ -812,6 +829,11 @@ std::vector<uint8_t> serializeSavegameContainer(SaveType saveType)
 	return std::move(*zipBytes);
 }
 
+std::vector<uint8_t> serializeSavegameContainer(SaveType saveType, SnapshotEncoding encoding)
+{
+	return packSavegameContainer(buildSavegameContainerDoc(saveType), encoding);
+}
+
 SetupHeaderInfo parseSavegameContainer(const uint8_t *data, size_t len, nlohmann::ordered_json &outGameStateDoc, nlohmann::ordered_json *outLocalStateDoc, nlohmann::ordered_json *outPendingResumeDoc)
 {
 	if (data == nullptr || len == 0)
@@ -829,16 +851,17 @@ SetupHeaderInfo parseSavegameContainer(const uint8_t *data, size_t len, nlohmann
 		throw StateError("not a savegame container (failed to open as zip)");
 	}
 
-	std::vector<char> jsonBuf;
+	const char *entryName = zip->fileExists(kContainerCborName) ? kContainerCborName : kContainerJsonName;
+	std::vector<char> docBuf;
 	const WzMap::IOProvider::LoadFullFileResult rc =
-		zip->loadFullFile(kContainerJsonName, jsonBuf, SAVEGAME_MAX_UNCOMPRESSED, /*appendNullCharacter=*/false);
+		zip->loadFullFile(entryName, docBuf, SAVEGAME_MAX_UNCOMPRESSED, /*appendNullCharacter=*/false);
 	if (rc == WzMap::IOProvider::LoadFullFileResult::FAILURE_EXCEEDS_MAXFILESIZE)
 	{
 		throw StateError("savegame container document exceeds maximum allowed size");
 	}
 	if (rc != WzMap::IOProvider::LoadFullFileResult::SUCCESS)
 	{
-		throw StateError(std::string("savegame container missing/unreadable entry '") + kContainerJsonName + "'");
+		throw StateError(std::string("savegame container missing/unreadable entry '") + entryName + "'");
 	}
 
 	nlohmann::ordered_json doc;
@@ -846,11 +869,11 @@ SetupHeaderInfo parseSavegameContainer(const uint8_t *data, size_t len, nlohmann
 	{
 		// Depth-bound the whole container document (including the nested gameState/scripting sections) at
 		// this single ingress parse, so downstream restore cannot be driven into unbounded native recursion.
-		doc = parseJsonBounded(jsonBuf.data(), jsonBuf.data() + jsonBuf.size());
+		doc = parseSnapshotBounded(docBuf.data(), docBuf.data() + docBuf.size());
 	}
 	catch (const nlohmann::ordered_json::exception &e)
 	{
-		throw StateError(std::string("failed to parse savegame container JSON: ") + e.what());
+		throw StateError(std::string("failed to parse savegame container document: ") + e.what());
 	}
 	if (!doc.is_object() || doc.value("format", std::string()) != SAVEGAME_FORMAT_TAG)
 	{
@@ -973,6 +996,7 @@ bool writeSavegameFolder(const std::string &folderPath, SaveType saveType, const
 bool readSavegameFolder(const std::string &folderPath, SetupHeaderInfo &outHeader,
                         nlohmann::ordered_json &outGameStateDoc, SavegameMetadata &outMeta)
 {
+	waitForSavegameWrites();
 	// Metadata sidecar (plain JSON) first - cheap, and lets a caller bail before opening the state zip.
 	std::vector<char> infoBuf;
 	const std::string infoPath = folderPath + "/" + kSidecarFileName;
@@ -1092,63 +1116,72 @@ bool runSavegameContainerSelfTest()
 		NetPlay.players.resize(MAX_PLAYERS);
 	}
 
-	// Arrange a known setup + a known determinism clock (carried by the embedded GameState).
-	selectedPlayer = 5;
-	sstrcpy(aLevelName, "Sk-ContainerLevel");
-	game.type = LEVEL_TYPE::SKIRMISH;
-	game.maxPlayers = 4;
-	setGameTime(777777u);
-
-	std::vector<uint8_t> blob1;
-	try
+	// Both encodings must round-trip, and carry the same document.
+	std::vector<uint8_t> blobs[2];
+	nlohmann::ordered_json gsDocs[2];
+	for (size_t encodingIdx = 0; encodingIdx < 2; ++encodingIdx)
 	{
-		blob1 = serializeSavegameContainer(SaveType::Skirmish);
-	}
-	catch (const std::exception &e)
-	{
-		check(false, e.what());
-		return ok;
-	}
+		const SnapshotEncoding encoding = (encodingIdx == 0) ? SnapshotEncoding::Json : SnapshotEncoding::Binary;
 
-	// Byte-stability: same live state must produce the same blob.
-	std::vector<uint8_t> blob2 = serializeSavegameContainer(SaveType::Skirmish);
-	check(blob1 == blob2, "byte-stability: re-serialized container blob differs");
+		// Arrange a known setup + a known determinism clock (carried by the embedded GameState).
+		selectedPlayer = 5;
+		sstrcpy(aLevelName, "Sk-ContainerLevel");
+		game.type = LEVEL_TYPE::SKIRMISH;
+		game.maxPlayers = 4;
+		setGameTime(777777u);
 
-	// Perturb both the setup globals and the determinism clock.
-	selectedPlayer = 0;
-	sstrcpy(aLevelName, "wrong");
-	game.maxPlayers = 0;
-	setGameTime(1u);
+		std::vector<uint8_t> &blob1 = blobs[encodingIdx];
+		try
+		{
+			blob1 = serializeSavegameContainer(SaveType::Skirmish, encoding);
+		}
+		catch (const std::exception &e)
+		{
+			check(false, e.what());
+			return ok;
+		}
 
-	// Stage 1: parse restores setup globals but NOT the GameState (no level load needed here).
-	nlohmann::ordered_json gsDoc;
-	SetupHeaderInfo info;
-	try
-	{
-		info = parseSavegameContainer(blob1.data(), blob1.size(), gsDoc);
-	}
-	catch (const std::exception &e)
-	{
-		check(false, e.what());
-		return ok;
-	}
-	check(selectedPlayer == 5u, "container: setup selectedPlayer not restored");
-	check(std::string(aLevelName) == "Sk-ContainerLevel", "container: setup levelName not restored");
-	check(info.levelName == "Sk-ContainerLevel", "container: info.levelName wrong");
-	check(info.saveType == SaveType::Skirmish, "container: info.saveType wrong");
-	check(gameTime == 1u, "container: GameState must not be applied during parse");
+		// Byte-stability: same live state must produce the same blob.
+		std::vector<uint8_t> blob2 = serializeSavegameContainer(SaveType::Skirmish, encoding);
+		check(blob1 == blob2, "byte-stability: re-serialized container blob differs");
 
-	// Stage 2: applying the embedded GameState restores the determinism clock.
-	try
-	{
-		gameStateFromJson(gsDoc);
-	}
-	catch (const std::exception &e)
-	{
-		check(false, e.what());
-		return ok;
+		// Perturb both the setup globals and the determinism clock.
+		selectedPlayer = 0;
+		sstrcpy(aLevelName, "wrong");
+		game.maxPlayers = 0;
+		setGameTime(1u);
+
+		// Stage 1: parse restores setup globals but NOT the GameState (no level load needed here).
+		nlohmann::ordered_json &gsDoc = gsDocs[encodingIdx];
+		SetupHeaderInfo info;
+		try
+		{
+			info = parseSavegameContainer(blob1.data(), blob1.size(), gsDoc);
+		}
+		catch (const std::exception &e)
+		{
+			check(false, e.what());
+			return ok;
+		}
+		check(selectedPlayer == 5u, "container: setup selectedPlayer not restored");
+		check(std::string(aLevelName) == "Sk-ContainerLevel", "container: setup levelName not restored");
+		check(info.levelName == "Sk-ContainerLevel", "container: info.levelName wrong");
+		check(info.saveType == SaveType::Skirmish, "container: info.saveType wrong");
+		check(gameTime == 1u, "container: GameState must not be applied during parse");
+
+		// Stage 2: applying the embedded GameState restores the determinism clock.
+		try
+		{
+			gameStateFromJson(gsDoc);
+		}
+		catch (const std::exception &e)
+		{
+			check(false, e.what());
+			return ok;
+		}
+		check(gameTime == 777777u, "container: GameState clock not restored after apply");
 	}
-	check(gameTime == 777777u, "container: GameState clock not restored after apply");
+	check(gsDocs[0] == gsDocs[1], "container: JSON and binary encodings carry different GameState documents");
 
 	// Metadata sidecar round-trip.
 	SavegameMetadata meta;
@@ -1182,7 +1215,7 @@ bool runSavegameContainerSelfTest()
 
 	if (ok)
 	{
-		fprintf(stderr, "[savegame-container-selftest] PASS (%zu-byte container blob)\n", blob1.size());
+		fprintf(stderr, "[savegame-container-selftest] PASS (%zu-byte JSON / %zu-byte binary container blob)\n", blobs[0].size(), blobs[1].size());
 	}
 	return ok;
 }
@@ -1234,37 +1267,85 @@ static std::string saveFolderPathFromName(const std::string &name)
 	return name;
 }
 
-bool writeGameStateBlobToFolder(const std::string &folderPath, SaveType saveType)
+/// A savegame captured on the main thread, ready to be encoded, compressed and written from any thread.
+struct CapturedGameStateBlob
 {
-	const std::string dir = saveFolderPathFromName(folderPath);
+	std::string dir;
+	nlohmann::ordered_json doc;
+	SnapshotEncoding encoding = SnapshotEncoding::Binary;
+	std::string infoStr;
+};
+
+// Capture the container document and metadata sidecar from the live game. Main thread only; throws on failure.
+static std::shared_ptr<CapturedGameStateBlob> captureGameStateBlob(const std::string &folderPath, SaveType saveType)
+{
+	WZ_PROFILE_SCOPE(captureGameStateBlob);
+	auto captured = std::make_shared<CapturedGameStateBlob>();
+	captured->dir = saveFolderPathFromName(folderPath);
+	captured->doc = buildSavegameContainerDoc(saveType);
+	captured->encoding = defaultSnapshotEncoding();
+	// Also write the new-format metadata sidecar under its own filename (so it coexists with the legacy
+	// save-info.json). Nothing reads it yet - it back-fills the richer metadata (mods, save type, level,
+	// game time) onto new saves for a later load menu that prefers it. saveName is the folder's base name.
+	const std::string saveName = captured->dir.substr(captured->dir.find_last_of('/') + 1);
+	captured->infoStr = buildMetadataSidecar(buildLiveSavegameMetadata(saveName, saveType)).dump(4);
+	return captured;
+}
+
+// Encode, compress and write a captured savegame. Touches no game state, so it may run on any thread.
+static bool writeCapturedGameStateBlob(const CapturedGameStateBlob &captured, const std::function<void (SavegameWriteStage)> &onStage = nullptr)
+{
+	WZ_PROFILE_SCOPE(writeCapturedGameStateBlob);
+	if (onStage)
+	{
+		onStage(SavegameWriteStage::Encoding);
+	}
 	std::vector<uint8_t> blob;
 	try
 	{
-		blob = serializeSavegameContainer(saveType);
+		blob = packSavegameContainer(captured.doc, captured.encoding, onStage);
 	}
 	catch (const std::exception &e)
 	{
 		debug(LOG_ERROR, "Failed to serialize GameState savegame blob: %s", e.what());
 		return false;
 	}
-	const std::string blobPath = dir + "/" + kStateBlobFileName;
+	if (onStage)
+	{
+		onStage(SavegameWriteStage::Writing);
+	}
+	const std::string blobPath = captured.dir + "/" + kStateBlobFileName;
 	if (!saveFile(blobPath.c_str(), reinterpret_cast<const char *>(blob.data()), static_cast<UDWORD>(blob.size())))
 	{
 		debug(LOG_ERROR, "Failed to write GameState savegame blob %s", blobPath.c_str());
 		return false;
 	}
 
-	// Also write the new-format metadata sidecar under its own filename (so it coexists with the legacy
-	// save-info.json). Nothing reads it yet - it back-fills the richer metadata (mods, save type, level,
-	// game time) onto new saves for a later load menu that prefers it. Non-fatal: the blob is what a
-	// cold-load needs. saveName is the folder's base name.
-	const std::string saveName = dir.substr(dir.find_last_of('/') + 1);
-	const std::string infoStr = buildMetadataSidecar(buildLiveSavegameMetadata(saveName, saveType)).dump(4);
-	const std::string infoPath = dir + "/" + kSidecarFileName;
-	if (!saveFile(infoPath.c_str(), infoStr.c_str(), static_cast<UDWORD>(infoStr.size())))
+	// Non-fatal: the blob is what a cold-load needs.
+	const std::string infoPath = captured.dir + "/" + kSidecarFileName;
+	if (!saveFile(infoPath.c_str(), captured.infoStr.c_str(), static_cast<UDWORD>(captured.infoStr.size())))
 	{
 		debug(LOG_ERROR, "Failed to write GameState savegame metadata %s (non-fatal)", infoPath.c_str());
 	}
+	return true;
+}
+
+bool writeGameStateBlobToFolder(const std::string &folderPath, SaveType saveType)
+{
+	std::shared_ptr<CapturedGameStateBlob> captured;
+	try
+	{
+		captured = captureGameStateBlob(folderPath, saveType);
+	}
+	catch (const std::exception &e)
+	{
+		debug(LOG_ERROR, "Failed to serialize GameState savegame blob: %s", e.what());
+		return false;
+	}
+	if (!writeCapturedGameStateBlob(*captured))
+	{
+		return false;
+	}
 
 	// Arm the CRC-trace detail auto-dump (no-op unless --gamestate-crc-detail-on-save): captures the
 	// next few ticks' full sync logs on the saving run, to diff against the loaded run (see below).
@@ -1272,12 +1353,58 @@ bool writeGameStateBlobToFolder(const std::string &folderPath, SaveType saveType
 	return true;
 }
 
+// Background savegame writes, one at a time in the order they were started, so a later save of the same
+// folder can't be overtaken by an earlier one.
+static TaskStrand savegameWriteStrand(TaskPriority::Low);
+
+bool writeGameStateBlobToFolderAsync(const std::string &folderPath, SaveType saveType, SavegameWriteCompletionFunc onComplete, SavegameWriteProgressFunc onProgress)
+{
+	std::shared_ptr<CapturedGameStateBlob> captured;
+	try
+	{
+		captured = captureGameStateBlob(folderPath, saveType);
+	}
+	catch (const std::exception &e)
+	{
+		debug(LOG_ERROR, "Failed to serialize GameState savegame blob: %s", e.what());
+		return false;
+	}
+	// Armed at capture time, since the ticks to trace are the ones right after the captured state.
+	syncCrcDetailArmOnSaveOrLoad();
+
+	savegameWriteStrand.submit([captured, onComplete = std::move(onComplete), onProgress = std::move(onProgress)]() {
+		std::function<void (SavegameWriteStage)> onStage;
+		if (onProgress)
+		{
+			onStage = [&onProgress](SavegameWriteStage stage) {
+				wzTaskSubmitMainThread([onProgress, stage]() { onProgress(stage); });
+			};
+		}
+		const bool success = writeCapturedGameStateBlob(*captured, onStage);
+		if (onComplete)
+		{
+			wzTaskSubmitMainThread([onComplete, success]() { onComplete(success); });
+		}
+	});
+	return true;
+}
+
+void waitForSavegameWrites()
+{
+	if (savegameWriteStrand.pending() != 0)
+	{
+		WZ_PROFILE_SCOPE(waitForSavegameWrites);
+		savegameWriteStrand.wait();
+	}
+}
+
 /// Read just the GameState blob (gamestate.wz) from a save folder, restoring the setup globals and
 /// yielding the embedded GameState document. The folder's own (legacy) save-info.json is not read.
 static bool readGameStateBlobFromFolder(const std::string &folderPath, SetupHeaderInfo &outHeader,
                                         nlohmann::ordered_json &outGameStateDoc, nlohmann::ordered_json *outLocalStateDoc = nullptr,
                                         nlohmann::ordered_json *outPendingResumeDoc = nullptr)
 {
+	waitForSavegameWrites();
 	const std::string dir = saveFolderPathFromName(folderPath);
 	std::vector<char> blobBuf;
 	const std::string blobPath = dir + "/" + kStateBlobFileName;
@@ -1303,6 +1430,7 @@ static bool g_coldLoadReconstruct = false; // set at end of coldLoadRestoreWorld
 
 bool isNewFormatSaveFolder(const std::string &folderPath)
 {
+	waitForSavegameWrites(); // the blob may still be on its way to disk
 	const std::string blobPath = saveFolderPathFromName(folderPath) + "/" + kStateBlobFileName;
 	return PHYSFS_exists(blobPath.c_str()) != 0;
 }
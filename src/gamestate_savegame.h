@@ -35,6 +35,7 @@
 
 #include <cstdint>
 #include <array>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -42,6 +43,7 @@
 
 #include "lib/framework/crc.h" // Sha256
 #include "lib/framework/resource_loading_controller.h" // LoadingTask, ResourceLoadingController
+#include "gamestate_serialize.h" // SnapshotEncoding
 
 namespace gamestate
 {
@@ -108,7 +110,8 @@ bool runSavegameHeaderSelfTest();
 // applied only *after* the level is loaded (see parseSavegameContainer).
 
 /// Serialize the current live match to the .wz container archive bytes (setup header + GameState).
-std::vector<uint8_t> serializeSavegameContainer(SaveType saveType);
+/// parseSavegameContainer reads either encoding.
+std::vector<uint8_t> serializeSavegameContainer(SaveType saveType, SnapshotEncoding encoding = defaultSnapshotEncoding());
 
 /// Parse a container archive: restores the setup/identity globals and returns the
 /// orchestration info, while handing back the embedded GameState document via outGameStateDoc
@@ -184,6 +187,26 @@ bool writeCurrentGameToFolder(const std::string &folderPath, const std::string &
 /// files. Does not touch the folder's save-info.json. Returns false on I/O error.
 bool writeGameStateBlobToFolder(const std::string &folderPath, SaveType saveType);
 
+/// Stages of a background savegame write, as reported to a SavegameWriteProgressFunc.
+enum class SavegameWriteStage : uint8_t
+{
+	Encoding,
+	Compressing,
+	Writing,
+};
+typedef std::function<void (SavegameWriteStage stage)> SavegameWriteProgressFunc;
+typedef std::function<void (bool success)> SavegameWriteCompletionFunc;
+
+/// Like writeGameStateBlobToFolder, but only captures the state on the calling (main) thread; encoding,
+/// compression and the write run on a background task, so saving doesn't stall the game. Writes finish in the
+/// order they were started. onProgress and onComplete are called on the main thread (from wzTaskRunMainThreadTasks).
+/// Returns false (without calling onComplete) if the state couldn't be captured.
+bool writeGameStateBlobToFolderAsync(const std::string &folderPath, SaveType saveType, SavegameWriteCompletionFunc onComplete = nullptr, SavegameWriteProgressFunc onProgress = nullptr);
+
+/// Blocks until every background savegame write started so far is on disk. The read functions here call it
+/// themselves; anything else touching save folders (deleting them, shutting down PhysFS) must call it first.
+void waitForSavegameWrites();
+
 // MARK: - Cold-load (level load + game start) wiring
 
 /// True if folderPath looks like a new-format savegame folder (contains the state blob). Used by
@@ -29,6 +29,7 @@
 #include "lib/gamelib/gtime.h"
 #include "lib/netplay/sync_debug.h" // syncDebugGetCrc / setResumeSyncDebugCrc (resume sync-CRC continuity)
 #include "lib/netplay/netplay.h"   // NetPlay.scriptSetPlayerDataStrings (scriptPlayerData section)
+#include "lib/netplay/netreplay.h" // NETreplaySaveKeyframe (replay keyframes)
 
 #include "random.h"
 #include "objmem.h"
@@ -72,6 +73,7 @@
 #include "multiplay.h" // CreateBeaconViewData
 #include "multistat.h" // PLAYERSTATS, get/setMultiStats
 #include "scores.h"    // missionData
+#include "profiling.h"
 #include "wrappers.h"  // testPlayerHasWon/Lost
 #include "lighting.h"  // getTheSun/setTheSun (presentation section)
 #include "atmos.h"     // atmosGet/SetWeatherType (presentation section)
@@ -183,7 +185,7 @@ static std::vector<uint8_t> decodeBase64Field(const nlohmann::ordered_json &j, s
 
 // MARK: - Section: determinism core
 
-constexpr uint32_t DETERMINISM_CORE_VERSION = 1;
+constexpr uint32_t DETERMINISM_CORE_VERSION = 2;
 
 nlohmann::ordered_json writeDeterminismCore()
 {
@@ -202,10 +204,9 @@ nlohmann::ordered_json writeDeterminismCore()
 	j["synchObjID"] = ids.synchObjID;
 	j["unsynchObjID"] = ids.unsynchObjID;
 
-	// SKIRMISH danger-map (AI threat) recompute schedule - file-statics in map.cpp that gate the 2s
-	// round-robin in mapUpdate(). Not advanced by reconstruction, so applied with the clock (early).
+	// SKIRMISH danger-map (AI threat) recompute schedule - file-static in map.cpp that gates the 2s
+	// refresh in mapUpdate(). Not advanced by reconstruction, so applied with the clock (early).
 	j["lastDangerUpdate"] = static_cast<uint32_t>(getLastDangerUpdate());
-	j["lastDangerPlayer"] = getLastDangerPlayer();
 
 	// Lockstep network-timing state (latency negotiation + per-queue command scheduling), so a resumed
 	// client keeps the same latency instead of renegotiating from defaults (see GameTimeNetState).
@@ -255,7 +256,6 @@ static void applyDeterminismClock(const nlohmann::ordered_json &j, uint32_t vers
 
 	// Danger-map recompute schedule (see writeDeterminismCore).
 	setLastDangerUpdate(j.at("lastDangerUpdate").get<uint32_t>());
-	setLastDangerPlayer(reqRange(j.at("lastDangerPlayer").get<int>(), -1, MAX_PLAYERS - 1));
 
 	// Lockstep network-timing state.
 	// Restored so the resumed client continues the same latency negotiation / command scheduling.
@@ -1125,12 +1125,12 @@ static void clearWorldObjects(GameWorld &world)
 			// authoritatively reapplied by readMapDynamic - so it is left untouched.
 			t.sensorBits = 0;
 			t.jammerBits = 0;
-			for (unsigned p = 0; p < MAX_PLAYERS; ++p)
-			{
-				t.sensors[p] = 0;
-				t.watchers[p] = 0;
-				t.jammers[p] = 0;
-			}
+		}
+		for (unsigned p = 0; p < MAX_PLAYERS; ++p)
+		{
+			std::fill_n(world.map.sensors[p].get(), n, 0);
+			std::fill_n(world.map.watchers[p].get(), n, 0);
+			std::fill_n(world.map.jammers[p].get(), n, 0);
 		}
 	}
 }
@@ -2556,30 +2556,30 @@ static void readMapDynamic(GameWorld &world, const nlohmann::ordered_json &j)
 
 // MARK: - Danger maps (Skirmish/MP AI threat/danger overlay)
 //
-// The skirmish danger system (map.cpp) refreshes one player's threat/danger overlay per
-// GAME_TICKS_FOR_DANGER in a round-robin, so a running client holds STAGGERED per-player maps (each up
-// to maxPlayers*2s stale). The schedule (lastDangerUpdate / lastDangerPlayer) round-trips in the
-// determinism core, but the staggered CONTENT is otherwise recomputed all-fresh-at-tick-T by mapInit on
-// cold load and would diverge for any player whose threat footprint changed since its last slot. astar
-// reads AUXBITS_THREAT for AI ground moves and safeDest() reads AUXBITS_DANGER, so a single diverged AI
-// path cascades into a permanent desync. Campaign is exempt (no danger thread).
+// The skirmish danger system (map.cpp) refreshes every player's threat/danger overlay per
+// GAME_TICKS_FOR_DANGER: mapUpdate() harvests the flood fills started one interval earlier, then takes new
+// threats into per-player working maps and floods them in the background. The schedule (lastDangerUpdate)
+// round-trips in the determinism core, but the harvested and in-flight CONTENT is otherwise recomputed
+// all-fresh-at-tick-T by mapInit on cold load and would diverge for any player whose threat footprint changed
+// since the last harvest. astar reads AUXBITS_THREAT for AI ground moves and safeDest() reads AUXBITS_DANGER,
+// so a single diverged AI path cascades into a permanent desync. Campaign is exempt (no danger updates).
 // We serialize:
 //   - Per-player auxMap[p] DANGER|THREAT|AATHREAT bits, p in [0, MAX_PLAYERS) - the harvested overlays
 //     (the full range mapInit() initializes. Players in [game.maxPlayers, MAX_PLAYERS) are never refreshed
-//     by the round-robin but keep init-time danger that fpath still reads, so they must be saved too).
-//   - The in-flight working buffer auxMap[MAX_PLAYERS+AUX_DANGERMAP] (verbatim) + blockMap[AUX_DANGERMAP],
-//     i.e. the inputs dangerFloodFill() reads for lastDangerPlayer (its DANGER/TEMPORARY scratch bits are
-//     recomputed by the worker on restart, so they ride along harmlessly).
-// The worker's DANGER output for the in-flight player is NOT stored: on restore the restarted thread
-// re-floods it deterministically from the restored working THREAT/NONPASSABLE + blockMap + start pos.
-constexpr uint32_t DANGER_SECTION_VERSION = 1;
+//     by mapUpdate but keep init-time danger that fpath still reads, so they must be saved too).
+//   - The in-flight per-player working maps dangerWork[p] (verbatim) + blockMap[AUX_DANGERMAP], i.e. the
+//     inputs dangerFloodFill() reads (its DANGER/TEMPORARY scratch bits are recomputed on restart, so they
+//     ride along harmlessly).
+// The flood fill output is NOT needed: on restore every player is re-flooded deterministically from the
+// restored working THREAT/NONPASSABLE bits + blockMap + start position.
+constexpr uint32_t DANGER_SECTION_VERSION = 2;
 constexpr uint8_t DANGER_OVERLAY_BITS = AUXBITS_DANGER | AUXBITS_THREAT | AUXBITS_AATHREAT;
 
 static nlohmann::ordered_json writeDangerMaps(const GameWorld &world)
 {
 	nlohmann::ordered_json j = nlohmann::ordered_json::object();
 	j["version"] = DANGER_SECTION_VERSION;
-	// Only SKIRMISH runs the danger thread/overlay (campaign is exempt) - nothing to store otherwise.
+	// Only SKIRMISH runs the danger updates/overlay (campaign is exempt) - nothing to store otherwise.
 	if (game.type != LEVEL_TYPE::SKIRMISH || !world.map.tiles || !world.map.auxMap[0])
 	{
 		j["present"] = false;
@@ -2588,19 +2588,18 @@ static nlohmann::ordered_json writeDangerMaps(const GameWorld &world)
 	j["present"] = true;
 	j["width"] = world.map.width;
 	j["height"] = world.map.height;
-	// mapInit() initializes the danger overlay for ALL MAX_PLAYERS players, but mapUpdate's round-robin
-	// only REFRESHES game.maxPlayers of them (% game.maxPlayers). Players in [maxPlayers, MAX_PLAYERS) thus
-	// keep static init-time danger that fpath still reads for any droids they own (astar AUXBITS_THREAT).
-	// On cold-load the snapshot-aware mapInit skips the re-init, so we must serialize the FULL MAX_PLAYERS
-	// range - storing only game.maxPlayers loses those players' overlay and desyncs their AI pathfinding.
+	// mapInit() initializes the danger overlay for ALL MAX_PLAYERS players, but mapUpdate only REFRESHES
+	// game.maxPlayers of them. Players in [maxPlayers, MAX_PLAYERS) thus keep static init-time danger that
+	// fpath still reads for any droids they own (astar AUXBITS_THREAT). On cold-load the snapshot-aware
+	// mapInit skips the re-init, so we must serialize the FULL MAX_PLAYERS range - storing only
+	// game.maxPlayers loses those players' overlay and desyncs their AI pathfinding.
 	j["maxPlayers"] = game.maxPlayers; // informational (not used to size the overlay array on read)
 	const int numOverlays = MAX_PLAYERS;
 	j["numPlayerOverlays"] = numOverlays;
 	const size_t n = static_cast<size_t>(world.map.width) * static_cast<size_t>(world.map.height);
 
-	// Per-player harvested overlay bits. auxMap[p] (p < MAX_PLAYERS) is only written by the main thread
-	// (mapUpdate's auxMapRestore), so these reads do not race the worker.
-	// Per-player harvested overlay bits, one base64 byte blob per player.
+	// Per-player harvested overlay bits, one base64 byte blob per player. auxMap[p] (p < MAX_PLAYERS) is
+	// only written by the main thread (mapUpdate's harvest), so these reads do not race the flood fills.
 	nlohmann::ordered_json players = nlohmann::ordered_json::array();
 	for (int p = 0; p < numOverlays; ++p)
 	{
@@ -2614,20 +2613,19 @@ static nlohmann::ordered_json writeDangerMaps(const GameWorld &world)
 	}
 	j["players"] = std::move(players);
 
-	// In-flight working buffer + danger blocking snapshot. The worker WRITES the working buffer, so park
-	// it for the duration of this read (no-op when no worker is running, i.e. the headless self-test).
+	// In-flight working maps + danger blocking snapshot. The flood fills WRITE the working maps, so finish
+	// them before this read (no-op when no danger updates are running, i.e. the headless self-test).
 	const bool parked = mapDangerSerializeBegin();
-	std::vector<uint8_t> work(n);
-	std::vector<uint8_t> blockDanger(n);
-	const uint8_t *wb = world.map.auxMap[MAX_PLAYERS + AUX_DANGERMAP].get();
-	const uint8_t *bd = world.map.blockMap[AUX_DANGERMAP].get();
-	for (size_t i = 0; i < n; ++i)
+	nlohmann::ordered_json work = nlohmann::ordered_json::array();
+	for (int p = 0; p < numOverlays; ++p)
 	{
-		work[i] = wb[i];
-		blockDanger[i] = bd[i];
+		const uint8_t *wb = world.map.dangerWork[p].get();
+		work.push_back(base64Encode(std::vector<uint8_t>(wb, wb + n)));
 	}
+	const uint8_t *bd = world.map.blockMap[AUX_DANGERMAP].get();
+	std::vector<uint8_t> blockDanger(bd, bd + n);
 	mapDangerSerializeEnd(parked);
-	j["work"] = base64Encode(work);
+	j["work"] = std::move(work);
 	j["blockDanger"] = base64Encode(blockDanger);
 	return j;
 }
@@ -2652,7 +2650,7 @@ static void readDangerMaps(GameWorld &world, const nlohmann::ordered_json &j, ui
 	{
 		throw StateError("dangerMaps dimensions mismatch");
 	}
-	// Number of per-player overlays stored.
+	// Number of per-player overlays (and working maps) stored.
 	const int numOverlays = j.at("numPlayerOverlays").get<int>();
 	if (numOverlays < 0 || numOverlays > MAX_PLAYERS)
 	{
@@ -2679,18 +2677,24 @@ static void readDangerMaps(GameWorld &world, const nlohmann::ordered_json &j, ui
 		}
 	}
 
-	// In-flight working buffer (verbatim) + danger blocking snapshot. The danger thread is stopped during
-	// reconstruct (mapStopDangerThreadForReconstruct), so these writes do not race it - mapInit restarts
-	// the worker, which re-floods lastDangerPlayer from exactly these inputs.
-	const std::vector<uint8_t> work = decodeBase64Field(j.at("work"), n, "dangerMaps work buffer");
-	const std::vector<uint8_t> blockDanger = decodeBase64Field(j.at("blockDanger"), n, "dangerMaps blockDanger");
-	uint8_t *wb = world.map.auxMap[MAX_PLAYERS + AUX_DANGERMAP].get();
-	uint8_t *bd = world.map.blockMap[AUX_DANGERMAP].get();
-	for (size_t i = 0; i < n; ++i)
+	// In-flight working maps (verbatim) + danger blocking snapshot. The danger updates are stopped during
+	// reconstruct (mapStopDangerThreadForReconstruct), so these writes do not race them - mapInit restarts
+	// the flood fills, which re-flood every player from exactly these inputs.
+	const nlohmann::ordered_json &work = j.at("work");
+	if (!work.is_array() || static_cast<int>(work.size()) != numOverlays)
+	{
+		throw StateError("dangerMaps work array size mismatch");
+	}
+	for (int p = 0; p < numOverlays; ++p)
 	{
-		wb[i] = work[i];
-		bd[i] = blockDanger[i];
+		const std::vector<uint8_t> bytes = decodeBase64Field(work[p], n, "dangerMaps work buffer");
+		std::copy(bytes.begin(), bytes.end(), world.map.dangerWork[p].get());
 	}
+	const std::vector<uint8_t> blockDanger = decodeBase64Field(j.at("blockDanger"), n, "dangerMaps blockDanger");
+	std::copy(blockDanger.begin(), blockDanger.end(), world.map.blockMap[AUX_DANGERMAP].get());
+
+	// The per-player overlays were written directly, so pathfinding must not trust its cached blocking maps.
+	world.map.blockingJournal.reset();
 
 	// Tell the next mapInit() to preserve this restored content (and the schedule) instead of recomputing.
 	mapNoteDangerRestoredFromSnapshot();
@@ -3168,9 +3172,7 @@ static void readMapTerrain(WorldMapState &map, const nlohmann::ordered_json &j,
 	// readMapDynamic and is untouched here.
 	if (!map.tiles || map.width != w || map.height != h)
 	{
-		map.tiles = std::make_unique<MAPTILE[]>(n);
-		map.width = w;
-		map.height = h;
+		map.allocateTiles(w, h);
 	}
 	for (size_t i = 0; i < n; ++i)
 	{
@@ -4310,8 +4312,8 @@ void gameStateFromJson(const nlohmann::ordered_json &j, ScriptScope scriptScope,
 	// Unknown sections are ignored.
 
 	// Stop the SKIRMISH danger worker (if one is running) BEFORE the world is torn down and the aux/block
-	// maps are reallocated by readMapTerrain - the worker writes auxMap[MAX_PLAYERS+AUX_DANGERMAP] /
-	// reads blockMap[AUX_DANGERMAP], so reallocating those underneath it would race / use-after-free.
+	// maps are reallocated by readMapTerrain - the flood fills write dangerWork / read
+	// blockMap[AUX_DANGERMAP], so reallocating those underneath them would race / use-after-free.
 	// No-op on the disk cold-load path (mapInit has not started a worker yet) - the in-process round-trip
 	// and in-place resume are the cases with a live worker here. The danger overlay is re-applied by the
 	// dangerMaps post-pass below and the worker is (re)started by the next mapInit.
@@ -4581,11 +4583,36 @@ void gameStateFromJson(const nlohmann::ordered_json &j, ScriptScope scriptScope,
 	debug(LOG_GAMESTATE_SERIAL, "gameStateFromJson complete");
 }
 
-std::string serializeGameState(ScriptScope scriptScope)
+static SnapshotEncoding g_defaultSnapshotEncoding = SnapshotEncoding::Binary;
+
+SnapshotEncoding defaultSnapshotEncoding()
 {
+	return g_defaultSnapshotEncoding;
+}
+
+void setDefaultSnapshotEncoding(SnapshotEncoding encoding)
+{
+	g_defaultSnapshotEncoding = encoding;
+}
+
+std::string encodeSnapshot(const nlohmann::ordered_json &j, SnapshotEncoding encoding)
+{
+	if (encoding == SnapshotEncoding::Binary)
+	{
+		// CBOR writes an object's keys in iteration (= insertion) order, and every number in its shortest exact
+		// form, so it is exactly as byte-stable as the JSON dump.
+		std::string out;
+		nlohmann::ordered_json::to_cbor(j, out);
+		return out;
+	}
 	// Compact dump - ordered_json keeps insertion order, and every writer inserts in a fixed order, so
 	// output is deterministic/byte-stable (and a JS object's property order round-trips).
-	return gameStateToJson(scriptScope).dump();
+	return j.dump();
+}
+
+std::string serializeGameState(ScriptScope scriptScope, SnapshotEncoding encoding)
+{
+	return encodeSnapshot(gameStateToJson(scriptScope), encoding);
 }
 
 // Hard cap on JSON nesting depth accepted at the ingress parse. nlohmann's parser and DOM destructor are
@@ -4611,16 +4638,66 @@ nlohmann::ordered_json parseJsonBounded(const char *begin, const char *end)
 	return nlohmann::ordered_json::parse(begin, end, depthGuard);
 }
 
-void deserializeGameState(const std::string &jsonText, ScriptScope scriptScope)
+// The binary readers take no parser callback, so the CBOR ingress builds the DOM through a SAX handler which
+// applies the same depth cap as parseJsonBounded.
+class BoundedSnapshotSax
+{
+public:
+	using json = nlohmann::ordered_json;
+
+	explicit BoundedSnapshotSax(json &root) : dom(root) {}
+
+	bool null() { return dom.null(); }
+	bool boolean(bool val) { return dom.boolean(val); }
+	bool number_integer(json::number_integer_t val) { return dom.number_integer(val); }
+	bool number_unsigned(json::number_unsigned_t val) { return dom.number_unsigned(val); }
+	bool number_float(json::number_float_t val, const json::string_t &s) { return dom.number_float(val, s); }
+	bool string(json::string_t &val) { return dom.string(val); }
+	bool binary(json::binary_t &val) { return dom.binary(val); }
+	bool key(json::string_t &val) { return dom.key(val); }
+	bool start_object(std::size_t len) { enter(); return dom.start_object(len); }
+	bool end_object() { --depth; return dom.end_object(); }
+	bool start_array(std::size_t len) { enter(); return dom.start_array(len); }
+	bool end_array() { --depth; return dom.end_array(); }
+	template<class Exception>
+	bool parse_error(std::size_t position, const std::string &lastToken, const Exception &ex) { return dom.parse_error(position, lastToken, ex); }
+
+private:
+	void enter()
+	{
+		if (depth > GAMESTATE_MAX_JSON_DEPTH)
+		{
+			throw StateError("JSON nesting depth exceeds maximum allowed");
+		}
+		++depth;
+	}
+
+	nlohmann::detail::json_sax_dom_parser<json> dom;
+	int depth = 0;
+};
+
+nlohmann::ordered_json parseSnapshotBounded(const char *begin, const char *end)
+{
+	if (begin == end || *begin == '{')
+	{
+		return parseJsonBounded(begin, end);
+	}
+	nlohmann::ordered_json j;
+	BoundedSnapshotSax sax(j);
+	nlohmann::ordered_json::sax_parse(reinterpret_cast<const uint8_t *>(begin), reinterpret_cast<const uint8_t *>(end), &sax, nlohmann::ordered_json::input_format_t::cbor);
+	return j;
+}
+
+void deserializeGameState(const std::string &data, ScriptScope scriptScope)
 {
 	nlohmann::ordered_json j;
 	try
 	{
-		j = parseJsonBounded(jsonText.data(), jsonText.data() + jsonText.size());
+		j = parseSnapshotBounded(data.data(), data.data() + data.size());
 	}
 	catch (const nlohmann::ordered_json::exception &e)
 	{
-		throw StateError(std::string("failed to parse GameState JSON: ") + e.what());
+		throw StateError(std::string("failed to parse GameState document: ") + e.what());
 	}
 
 	try
@@ -4688,6 +4765,13 @@ bool runGameStateRoundTripTest()
 	try
 	{
 		buf1 = serializeGameState();
+		// The binary encoding of the same real-data document must decode back to it exactly.
+		const std::string bin = serializeGameState(ScriptScope::AllInstances, SnapshotEncoding::Binary);
+		if (parseSnapshotBounded(bin.data(), bin.data() + bin.size()).dump() != buf1)
+		{
+			CONPRINTF("GameState round-trip FAILED: the binary encoding does not decode to the JSON document");
+			return false;
+		}
 		deserializeGameState(buf1);
 		// Mirror ALL of what the real restore paths do after reconstruction (cold-load in init.cpp, etc):
 		// discard the syncDebug accumulated while REBUILDING the world, re-seed the accumulator with the
@@ -4750,8 +4834,150 @@ void gamestateMaybeRunRoundTripTest()
 	wzQuit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
+// MARK: - Replay keyframes
+//
+// Taken at the same point of the tick as the round-trip test: every message saved in the replay so far has
+// been processed, and none after it. Only the local rules/global script is included, since replay viewers
+// don't run AI bots - their orders are in the replay. The capture is synchronous, so it only happens when
+// keyframes were asked for in NETreplaySaveStart() (autohosts, or the replayKeyframes option).
+
+void gamestateMaybeSaveReplayKeyframe()
+{
+	if (!NETreplaySaveWantsKeyframe(gameTime))
+	{
+		return;
+	}
+	WZ_PROFILE_SCOPE(gamestateMaybeSaveReplayKeyframe);
+	try
+	{
+		NETreplaySaveKeyframe(gameTime, serializeGameState(ScriptScope::LocalPlayerOnly, defaultSnapshotEncoding()));
+	}
+	catch (const std::exception &e)
+	{
+		debug(LOG_ERROR, "Replay keyframe at gameTime %u failed: %s", gameTime, e.what());
+	}
+}
+
+bool restoreReplayKeyframe(const std::string &keyframe)
+{
+	try
+	{
+		deserializeGameState(keyframe, ScriptScope::LocalPlayerOnly);
+	}
+	catch (const std::exception &e)
+	{
+		debug(LOG_ERROR, "Replay keyframe restore failed: %s", e.what());
+		return false;
+	}
+	// As for any other resume from a snapshot (see stageThreeInitialise)
+	resetSyncDebug();
+	applyResumeSyncDebugCrc();
+	setSyncCheckFloorTime(gameTime);
+	gameTimeRebaseRealTimeBase();
+	return true;
+}
+
 // MARK: - Self-test (determinism harness scaffold)
 
+namespace
+{
+// Just enough of a game for a replay file: no options, no map
+class SelfTestReplayOptions : public ReplayOptionsHandler
+{
+public:
+	bool saveOptions(nlohmann::json& object) const override { object = nlohmann::json::object(); return true; }
+	bool saveMap(EmbeddedMapData&) const override { return false; }
+	bool optionsUpdatePlayerInfo(nlohmann::json&) const override { return true; }
+	bool restoreOptions(const nlohmann::json&, EmbeddedMapData&&, uint32_t, uint32_t) override { return true; }
+	size_t desiredBufferSize() const override { return std::numeric_limits<size_t>::max(); }  // Written on this thread
+	size_t maximumEmbeddedMapBufferSize() const override { return 0; }
+};
+
+NetMessage selfTestReplayMessage(uint8_t tag)
+{
+	NetMessageBuilder builder(GAME_GAME_TIME);
+	builder.append(tag);
+	return builder.build();
+}
+}
+
+// Saves a replay with keyframes between its messages, then seeks it through the keyframe index at its end. Needs a
+// PhysFS write dir, which is also mounted for reading.
+static void runReplayKeyframeSelfTest(const std::function<void (bool, const char *)> &check)
+{
+	const std::string keyframe1 = serializeGameState(ScriptScope::LocalPlayerOnly, SnapshotEncoding::Binary);
+	const uint32_t savedGameTime = gameTime;
+	setGameTime(savedGameTime + 1000);
+	const std::string keyframe2 = serializeGameState(ScriptScope::LocalPlayerOnly, SnapshotEncoding::Binary);
+	setGameTime(savedGameTime);
+
+	SelfTestReplayOptions options;
+	const std::string filename = NETreplaySaveStart("selftest", options, 0, false, true);
+	check(!filename.empty(), "replay: could not start saving");
+	if (filename.empty())
+	{
+		return;
+	}
+	for (uint8_t tag = 0; tag < 3; ++tag)
+	{
+		NetMessage message = selfTestReplayMessage(tag);
+		NETreplaySaveNetMessage(&message, 0);
+		NETreplaySaveKeyframe(1000 * (tag + 1), std::string(tag == 1 ? keyframe2 : keyframe1));
+	}
+	check(NETreplaySaveStop(options), "replay: could not finish saving");
+
+	// The last keyframe at or before the target, then the messages saved after it
+	const struct { uint32_t target; uint32_t keyframeTime; uint8_t nextTag; const std::string *state; } seeks[] = {
+		{2500, 2000, 2, &keyframe2},
+		{3000, 3000, 3, &keyframe1},
+		{1000, 1000, 1, &keyframe1},
+	};
+	for (const auto &seek : seeks)
+	{
+		uint32_t formatVer = 0;
+		if (!NETreplayLoadStart(filename, options, formatVer))
+		{
+			check(false, "replay: could not load");
+			break;
+		}
+		uint32_t keyframeTime = 0;
+		std::string state;
+		check(NETreplayLoadSeek(seek.target, keyframeTime, state), "replay: seek found no keyframe");
+		check(keyframeTime == seek.keyframeTime, "replay: seek found the wrong keyframe");
+		check(state == *seek.state, "replay: keyframe changed on its way through the file");
+		std::unique_ptr<NetMessage> message;
+		uint8_t player = 0;
+		const bool gotMessage = NETreplayLoadNetMessage(message, player);
+		if (seek.nextTag < 3)
+		{
+			check(gotMessage && message->type() == GAME_GAME_TIME && message->payloadSize() == 1 && message->payload()[0] == seek.nextTag, "replay: wrong message after the keyframe");
+		}
+		else
+		{
+			check(gotMessage && message->type() == REPLAY_ENDED, "replay: messages after the last keyframe");
+		}
+		NETreplayLoadStop();
+	}
+
+	{
+		uint32_t formatVer = 0;
+		uint32_t keyframeTime = 0;
+		std::string state;
+		check(NETreplayLoadStart(filename, options, formatVer) && !NETreplayLoadSeek(500, keyframeTime, state), "replay: seek before the first keyframe found one");
+		NETreplayLoadStop();
+	}
+
+	// Restoring the keyframe must give back the state it was taken from
+	check(restoreReplayKeyframe(keyframe2), "replay: keyframe restore failed");
+	check(gameTime == savedGameTime + 1000, "replay: keyframe gameTime not restored");
+	check(serializeGameState(ScriptScope::LocalPlayerOnly, SnapshotEncoding::Binary) == keyframe2, "replay: restored keyframe re-serializes differently");
+	check(restoreReplayKeyframe(keyframe1), "replay: keyframe restore failed");
+
+	PHYSFS_delete(filename.c_str());
+	PHYSFS_delete("replay/selftest");
+	PHYSFS_delete("replay");
+}
+
 bool runGameStateSelfTest()
 {
 	bool ok = true;
@@ -4911,14 +5137,53 @@ bool runGameStateSelfTest()
 	const std::string buf3 = serializeGameState();
 	check(buf1 == buf3, "round-trip: deserialize->serialize JSON differs");
 
+	// --- Assert: the binary encoding round-trips the same document, and is byte-stable too ---
+	const std::string bin1 = serializeGameState(ScriptScope::AllInstances, SnapshotEncoding::Binary);
+	check(!bin1.empty() && bin1[0] != '{', "binary encoding must not look like JSON");
+	check(bin1.size() < buf1.size(), "binary encoding is not smaller than JSON");
+	try
+	{
+		deserializeGameState(bin1);
+	}
+	catch (const StateError &e)
+	{
+		check(false, e.what());
+		return ok;
+	}
+	check(serializeGameState() == buf1, "round-trip: binary deserialize->serialize JSON differs");
+	check(serializeGameState(ScriptScope::AllInstances, SnapshotEncoding::Binary) == bin1, "round-trip: binary deserialize->serialize binary differs");
+
+	// --- Assert: the nesting-depth cap applies to both encodings ---
+	{
+		nlohmann::ordered_json deep = nlohmann::ordered_json::object();
+		for (int i = 0; i < GAMESTATE_MAX_JSON_DEPTH + 8; ++i)
+		{
+			nlohmann::ordered_json outer = nlohmann::ordered_json::object();
+			outer["d"] = std::move(deep);
+			deep = std::move(outer);
+		}
+		for (SnapshotEncoding encoding : {SnapshotEncoding::Json, SnapshotEncoding::Binary})
+		{
+			const std::string deepBuf = encodeSnapshot(deep, encoding);
+			bool rejected = false;
+			try
+			{
+				(void)parseSnapshotBounded(deepBuf.data(), deepBuf.data() + deepBuf.size());
+			}
+			catch (const StateError &)
+			{
+				rejected = true;
+			}
+			check(rejected, "over-deep document was not rejected");
+		}
+	}
+
 	// --- Assert: map terrain write/read round-trip on a synthetic map ---
 	// The rest of the self-test runs with no map loaded, so writeMapTerrain/readMapTerrain (and the
 	// "height" geometry vs per-tile-array key separation) are otherwise never exercised headlessly.
 	{
 		WorldMapState tm;
-		tm.tiles = std::make_unique<MAPTILE[]>(16);
-		tm.width = 4;
-		tm.height = 4;
+		tm.allocateTiles(4, 4);
 		tm.scroll.minX = 0; tm.scroll.minY = 0; tm.scroll.maxX = 4; tm.scroll.maxY = 4;
 		for (size_t i = 0; i < 16; ++i)
 		{
@@ -4966,9 +5231,19 @@ bool runGameStateSelfTest()
 		std::copy(std::begin(savedTtypes), std::end(savedTtypes), terrainTypes);
 	}
 
+	// --- Assert: replay keyframes are saved, indexed and seeked to ---
+	if (PHYSFS_getWriteDir() != nullptr)
+	{
+		runReplayKeyframeSelfTest(check);
+	}
+	else
+	{
+		fprintf(stderr, "[gamestate-selftest] SKIP: replay keyframes (no write directory)\n");
+	}
+
 	if (ok)
 	{
-		fprintf(stderr, "[gamestate-selftest] PASS (%zu-byte JSON)\n", buf1.size());
+		fprintf(stderr, "[gamestate-selftest] PASS (%zu-byte JSON, %zu-byte binary)\n", buf1.size(), bin1.size());
 	}
 	return ok;
 }
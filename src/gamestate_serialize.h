@@ -31,6 +31,7 @@
  *    property order round-trips through save/restore
  *  - Output is byte-stable because every writer inserts keys in a fixed order (C++ code order / JS enumeration order)
  *  - All sim-authoritative numbers are encoded as integers
+ *  - The same document can be stored as JSON text or as CBOR (see SnapshotEncoding)
  */
 
 #pragma once
@@ -52,6 +53,19 @@ constexpr uint32_t GAMESTATE_FORMAT_VERSION = 1u;
 /// Tag stored in the snapshot to identify it as a GameState document.
 constexpr const char *GAMESTATE_FORMAT_TAG = "wz-gamestate";
 
+/// How a GameState document is stored. Both encode the same document, and both are byte-stable.
+enum class SnapshotEncoding
+{
+	/// Compact JSON text. Human-readable, for debugging.
+	Json,
+	/// CBOR (RFC 8949) - smaller, and much cheaper to write and to parse (no number formatting / parsing, no escaping).
+	Binary,
+};
+
+/// Encoding for savegames and replay keyframes: Binary, unless --gamestate-json was given.
+SnapshotEncoding defaultSnapshotEncoding();
+void setDefaultSnapshotEncoding(SnapshotEncoding encoding);
+
 /// Thrown on malformed/unsupported snapshot data
 class StateError : public std::runtime_error
 {
@@ -80,16 +94,22 @@ nlohmann::ordered_json gameStateToJson(ScriptScope scriptScope = ScriptScope::Al
 /// VIEWDATA is not yet loaded when this runs. The caller replays it later via applyGameStateMessages().
 void gameStateFromJson(const nlohmann::ordered_json &j, ScriptScope scriptScope = ScriptScope::AllInstances, bool deferMessages = false);
 
-/// Serialize the current live match state to a (canonical, compact) JSON string.
-std::string serializeGameState(ScriptScope scriptScope = ScriptScope::AllInstances);
+/// Serialize the current live match state to a (canonical, compact) JSON string, or its CBOR equivalent.
+std::string serializeGameState(ScriptScope scriptScope = ScriptScope::AllInstances, SnapshotEncoding encoding = SnapshotEncoding::Json);
 
-/// Restore live match state from a JSON string. Throws StateError on bad data.
-void deserializeGameState(const std::string &jsonText, ScriptScope scriptScope = ScriptScope::AllInstances);
+/// Restore live match state from a string written by serializeGameState (in either encoding). Throws StateError on bad data.
+void deserializeGameState(const std::string &data, ScriptScope scriptScope = ScriptScope::AllInstances);
+
+/// Encode a document. A JSON document always starts with '{', a CBOR one never does.
+std::string encodeSnapshot(const nlohmann::ordered_json &j, SnapshotEncoding encoding);
 
 /// Parse a JSON document with a hard nesting-depth cap, throwing StateError past the limit.
 /// Used at the untrusted-input ingress parses.
 nlohmann::ordered_json parseJsonBounded(const char *begin, const char *end);
 
+/// Parse a document in either encoding (told apart by its first byte), with the same nesting-depth cap as parseJsonBounded.
+nlohmann::ordered_json parseSnapshotBounded(const char *begin, const char *end);
+
 // --- Per-section read/write helpers (operate on live globals via accessors) ---
 nlohmann::ordered_json writeDeterminismCore();
 void readDeterminismCore(const nlohmann::ordered_json &j, uint32_t version);
@@ -125,4 +145,10 @@ void gamestateSetRoundTripTestTick(uint32_t tick);
 /// Per-tick hook: runs the round-trip test and exits when the configured tick is reached.
 void gamestateMaybeRunRoundTripTest();
 
+/// Per-tick hook: embeds a keyframe in the replay being saved, when one is due (see NETreplaySaveWantsKeyframe).
+void gamestateMaybeSaveReplayKeyframe();
+
+/// Restore a replay keyframe over the running replay, before its first game tick. Returns false on bad data.
+bool restoreReplayKeyframe(const std::string &keyframe);
+
 } // namespace gamestate
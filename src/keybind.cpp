@@ -98,8 +98,8 @@ bool	bMovePause = false;
 bool		bAllowOtherKeyPresses = true;
 char	beaconMsg[MAX_PLAYERS][MAX_CONSOLE_STRING_LENGTH];		//beacon msg for each player
 
-using ExtractorListIter = optional<ExtractorList::const_iterator>;
-static ExtractorListIter psOldRE = {};
+// Remembered by pointer rather than by iterator, since the extractor list may be compacted between jumps.
+static const STRUCTURE *psOldRE = nullptr;
 static char	sCurrentConsoleText[MAX_CONSOLE_STRING_LENGTH];			//remember what user types in console for beacon msg
 
 #define QUICKSAVE_CAM_FOLDER "savegames/campaign/QuickSave"
@@ -717,6 +717,12 @@ void	kf_FrameRate()
 		                          NETgetStatistic(NetStatisticUncompressedBytes, false),
 		                          NETgetStatistic(NetStatisticPackets, true),
 		                          NETgetStatistic(NetStatisticPackets, false));
+		if (NetPlay.isHost)
+		{
+			CONPRINTF("NETWORK:  Broadcasts compressed once: %zu bytes, %zu us saved",
+			                          NETgetStatistic(NetStatisticSharedCompressionBytes, true),
+			                          NETgetStatistic(NetStatisticSharedCompressionMicros, true));
+		}
 	}
 	gameStats = !gameStats;
 	CONPRINTF("Built: %s %s", getCompileDate(), __TIME__);
@@ -860,7 +866,7 @@ void	kf_TileInfo()
 
 	debug(LOG_ERROR, "Tile position=(%d, %d) Terrain=%d Texture=%u Height=%d Illumination=%u",
 	      mouseTileX, mouseTileY, (int)terrainType(psTile), TileNumber_tile(psTile->texture), psTile->height,
-	      psTile->illumination);
+	      mapTileDisplay(gameWorld.map, psTile)->illumination);
 	addConsoleMessage(_("Tile info dumped into log"), DEFAULT_JUSTIFY, SYSTEM_MESSAGE);
 }
 
@@ -1705,20 +1711,23 @@ void	kf_JumpToResourceExtractor()
 		return;
 	}
 
-	if (!psOldRE.has_value() || std::next(*psOldRE) == gameWorld.objects.extractors[selectedPlayer].end())
+	const auto& extractors = gameWorld.objects.extractors[selectedPlayer];
+	auto it = std::find(extractors.begin(), extractors.end(), psOldRE);
+	if (it == extractors.end() || std::next(it) == extractors.end())
 	{
-		// Reset the pointer if `psOldRE` is either not initialized yet or points to the last element.
-		psOldRE.emplace(gameWorld.objects.extractors[selectedPlayer].begin());
+		// Start over if `psOldRE` is either not initialized yet or is the last element.
+		it = extractors.begin();
 	}
 	else
 	{
-		++(*psOldRE);
+		++it;
 	}
+	psOldRE = *it;
 
-	if (**psOldRE != nullptr)
+	if (psOldRE != nullptr)
 	{
 		playerPos.r.y = 0; // face north
-		setViewPos(map_coord((**psOldRE)->pos.x), map_coord((**psOldRE)->pos.y), true);
+		setViewPos(map_coord(psOldRE->pos.x), map_coord(psOldRE->pos.y), true);
 	}
 	else
 	{
@@ -1730,7 +1739,7 @@ void keybindInformResourceExtractorRemoved(const STRUCTURE* psResourceExtractor,
 {
 	if (selectedPlayer >= MAX_PLAYERS)
 	{
-		psOldRE.reset();
+		psOldRE = nullptr;
 		return;
 	}
 
@@ -1741,9 +1750,9 @@ void keybindInformResourceExtractorRemoved(const STRUCTURE* psResourceExtractor,
 		return;
 	}
 
-	if (psOldRE.has_value() && *psOldRE != activeExtractors.end() && **psOldRE == psResourceExtractor)
+	if (psOldRE == psResourceExtractor)
 	{
-		psOldRE.reset();
+		psOldRE = nullptr;
 	}
 }
 
@@ -2723,5 +2732,5 @@ void kf_ToggleSpecOverlays()
 
 void keybindShutdown()
 {
-	psOldRE.reset();
+	psOldRE = nullptr;
 }
@@ -94,13 +94,13 @@ void initLighting(WorldMapState& mapState, UDWORD x1, UDWORD y1, UDWORD x2, UDWO
 	{
 		for (unsigned i = x1; i < x2; i++)
 		{
-			MAPTILE	*psTile = mapTile(mapState, i, j);
+			MAPTILE_DISPLAY *psDisplay = mapTileDisplay(mapState, i, j);
 
 			// always make the edge tiles dark
 			if (i == 0 || j == 0 || i >= mapState.width - 1 || j >= mapState.height - 1)
 			{
-				psTile->illumination = 16;
-				psTile->ambientOcclusion = 16.0;
+				psDisplay->illumination = 16;
+				psDisplay->ambientOcclusion = 16.0;
 			}
 			else
 			{
@@ -111,8 +111,8 @@ void initLighting(WorldMapState& mapState, UDWORD x1, UDWORD y1, UDWORD x2, UDWO
 			if ((SDWORD)i < mapState.scroll.minX + 4 || (SDWORD)i > mapState.scroll.maxX - 4
 			    || (SDWORD)j < mapState.scroll.minY + 4 || (SDWORD)j > mapState.scroll.maxY - 4)
 			{
-				psTile->illumination /= 3;
-				psTile->ambientOcclusion /= 3;
+				psDisplay->illumination /= 3;
+				psDisplay->ambientOcclusion /= 3;
 			}
 		}
 	}
@@ -236,7 +236,7 @@ static void calcTileIllum(UDWORD tileX, UDWORD tileY)
 	ao *= 1.f/Dirs;
 	ao = clip<float>(ao, 0.25f, 1.f);
 
-	MAPTILE *tile = mapTile(gameWorld.map, tileX, tileY);
+	MAPTILE_DISPLAY *tile = mapTileDisplay(gameWorld.map, tileX, tileY);
 	tile->illumination = static_cast<uint8_t>(clip<int>(static_cast<int>(abs(dotProduct*ao)), 24, 254));
 	tile->ambientOcclusion = static_cast<uint8_t>(clip<float>(254.f*ao, 60.f, 254.f));
 }
@@ -359,16 +359,16 @@ void calcDroidIllumination(DROID *psDroid)
 	}
 	else if (tileX <= 1 || tileX >= gameWorld.map.width - 2 || tileY <= 1 || tileY >= gameWorld.map.height - 2)
 	{
-		lightVal = mapTile(gameWorld.map, tileX, tileY)->illumination;
+		lightVal = mapTileDisplay(gameWorld.map, tileX, tileY)->illumination;
 		lightVal += MIN_DROID_LIGHT_LEVEL;
 	}
 	else
 	{
-		lightVal = mapTile(gameWorld.map, tileX, tileY)->illumination +		 //
-		           mapTile(gameWorld.map, tileX - 1, tileY)->illumination +	 //		 *
-		           mapTile(gameWorld.map, tileX, tileY - 1)->illumination +	 //		***		pattern
-		           mapTile(gameWorld.map, tileX + 1, tileY)->illumination +	 //		 *
-		           mapTile(gameWorld.map, tileX + 1, tileY + 1)->illumination;	 //
+		lightVal = mapTileDisplay(gameWorld.map, tileX, tileY)->illumination +		 //
+		           mapTileDisplay(gameWorld.map, tileX - 1, tileY)->illumination +	 //		 *
+		           mapTileDisplay(gameWorld.map, tileX, tileY - 1)->illumination +	 //		***		pattern
+		           mapTileDisplay(gameWorld.map, tileX + 1, tileY)->illumination +	 //		 *
+		           mapTileDisplay(gameWorld.map, tileX + 1, tileY + 1)->illumination;	 //
 		lightVal /= 5;
 		lightVal += MIN_DROID_LIGHT_LEVEL;
 	}
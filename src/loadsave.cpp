@@ -62,6 +62,7 @@
 #include "game.h"
 #include "campaigninfo.h"
 #include "version.h"
+#include "gamestate_savegame.h"
 #define totalslots 36			// saves slots
 #define slotsInColumn 12		// # of slots in a column
 #define totalslotspace 64		// guessing 64 max chars for filename.
@@ -556,6 +557,8 @@ void deleteSaveGame_classic(const char *gamFileName)
 
 void deleteSaveGame(std::string saveGameFolderPath)
 {
+	gamestate::savegame::waitForSavegameWrites(); // don't delete files from under a background write
+
 	// Remove any trailing path separators (/)
 	while (!saveGameFolderPath.empty() && (saveGameFolderPath.rfind("/", std::string::npos) == (saveGameFolderPath.length() - 1)))
 	{
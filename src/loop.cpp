@@ -133,6 +133,9 @@ static PAUSE_STATE pauseState;
 static VIDEO_TIME_SKIP_STATE videoTimeSkipState;
 static size_t maxFastForwardTicks = WZ_DEFAULT_MAX_FASTFORWARD_TICKS;
 static bool fastForwardTicksFixedToNormalTickRate = true; // can be set to false to "catch-up" as quickly as possible (but this may result in more jerky behavior)
+static uint32_t replaySeekTargetTime = 0;  ///< Fast-forwarding a replay up to this gameTime, if not 0.
+static size_t replaySeekPrevMaxFastForwardTicks = WZ_DEFAULT_MAX_FASTFORWARD_TICKS;
+static bool replaySeekPrevFixedToNormalTickRate = true;
 static std::chrono::milliseconds sequenceMinSkipTime = std::chrono::milliseconds(800);
 
 static unsigned numDroids[MAX_PLAYERS];
@@ -144,6 +147,19 @@ static unsigned numConstructorDroids[MAX_PLAYERS];
 static SDWORD videoMode = 0;
 static bool backdropWasActiveBeforeVideo = false;
 
+// Timing of the next few game state updates, requested by the "updatebench" cheat.
+struct UPDATE_BENCHMARK_STATE
+{
+	unsigned ticksLeft = 0;
+	unsigned ticks = 0;
+	size_t droids = 0;
+	std::chrono::steady_clock::duration total = {};
+	std::chrono::steady_clock::duration worst = {};
+};
+static UPDATE_BENCHMARK_STATE updateBenchmark;
+static constexpr unsigned UPDATE_BENCHMARK_TICKS = 100;
+static constexpr size_t UPDATE_BENCHMARK_MIN_DROIDS = 2000;
+
 LOOP_MISSION_STATE		loopMissionState = LMS_NORMAL;
 
 // this is set by scrStartMission to say what type of new level is to be started
@@ -618,10 +634,59 @@ static void gameStateUpdate()
 	// Must be at the end of gameStateUpdate, since countUpdate is also called randomly (unsynchronised) between gameStateUpdate calls, but should have no effect if we already called it, and recvMessage requires consistent counts on all clients.
 	countUpdate(true);
 
+	gamestate::gamestateMaybeSaveReplayKeyframe();
+
 	// Optional GameState reconstruct-fidelity test (no-op unless --gamestate-roundtrip was set).
 	gamestate::gamestateMaybeRunRoundTripTest();
 }
 
+static size_t countWorldDroids()
+{
+	size_t droids = 0;
+	for (const auto& list : gameWorld.objects.droids)
+	{
+		droids += list.size();
+	}
+	return droids;
+}
+
+static void benchmarkGameStateUpdate()
+{
+	const auto start = std::chrono::steady_clock::now();
+	gameStateUpdate();
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+
+	updateBenchmark.total += elapsed;
+	updateBenchmark.worst = std::max(updateBenchmark.worst, elapsed);
+	updateBenchmark.droids = std::max(updateBenchmark.droids, countWorldDroids());
+	++updateBenchmark.ticks;
+	if (--updateBenchmark.ticksLeft == 0)
+	{
+		using Microseconds = std::chrono::duration<double, std::micro>;
+		CONPRINTF("updatebench: %u ticks with up to %zu droids, mean %.0f us, worst %.0f us", updateBenchmark.ticks, updateBenchmark.droids,
+		          Microseconds(updateBenchmark.total).count() / updateBenchmark.ticks, Microseconds(updateBenchmark.worst).count());
+	}
+}
+
+void loopBenchmarkGameStateUpdate()
+{
+	size_t droids = countWorldDroids();
+	if (droids < UPDATE_BENCHMARK_MIN_DROIDS)
+	{
+		// Top up the world by cloning the selected unit, so that runs on different maps are comparable.
+		kf_CloneSelected(static_cast<int>(UPDATE_BENCHMARK_MIN_DROIDS - droids));
+		droids = countWorldDroids();
+	}
+	if (droids < UPDATE_BENCHMARK_MIN_DROIDS)
+	{
+		CONPRINTF("updatebench: only %zu droids, select a unit to clone up to %zu first", droids, UPDATE_BENCHMARK_MIN_DROIDS);
+	}
+
+	updateBenchmark = UPDATE_BENCHMARK_STATE();
+	updateBenchmark.ticksLeft = UPDATE_BENCHMARK_TICKS;
+	CONPRINTF("updatebench: timing the next %u game state updates with %zu droids", UPDATE_BENCHMARK_TICKS, droids);
+}
+
 size_t getMaxFastForwardTicks()
 {
 	return maxFastForwardTicks;
@@ -631,6 +696,43 @@ void setMaxFastForwardTicks(optional<size_t> value, bool fixedToNormalTickRate)
 {
 	maxFastForwardTicks = value.value_or(WZ_DEFAULT_MAX_FASTFORWARD_TICKS);
 	fastForwardTicksFixedToNormalTickRate = fixedToNormalTickRate;
+	replaySeekTargetTime = 0;  // Whoever set this knows better than a replay seek still in progress.
+}
+
+static constexpr size_t REPLAY_SEEK_FASTFORWARD_TICKS = 50;
+
+// Restores the keyframe the replay was loaded with, if seeking, and fast-forwards the rest of the way.
+// Must run before any of the replay's messages are processed, since those start after the keyframe.
+// Returns false if the keyframe can't be restored: the messages before it were never loaded, and the
+// restore may have been left half done, so the replay can't be played at all.
+static bool replayStartSeek()
+{
+	ReplaySeek seek;
+	if (!NETreplayTakeSeek(seek))
+	{
+		return true;
+	}
+	if (!seek.keyframe.empty() && !gamestate::restoreReplayKeyframe(seek.keyframe))
+	{
+		debug(LOG_POPUP, _("Unable to seek in the replay: The replay file is corrupted."));
+		return false;
+	}
+	if (gameTime < seek.targetGameTime)
+	{
+		replaySeekPrevMaxFastForwardTicks = maxFastForwardTicks;
+		replaySeekPrevFixedToNormalTickRate = fastForwardTicksFixedToNormalTickRate;
+		setMaxFastForwardTicks(REPLAY_SEEK_FASTFORWARD_TICKS, false);
+		replaySeekTargetTime = seek.targetGameTime;
+	}
+	return true;
+}
+
+static void replayUpdateSeek()
+{
+	if (replaySeekTargetTime != 0 && gameTime >= replaySeekTargetTime)
+	{
+		setMaxFastForwardTicks(replaySeekPrevMaxFastForwardTicks, replaySeekPrevFixedToNormalTickRate);
+	}
 }
 
 static int renderBudget = 0;  // Scaled time spent rendering minus scaled time spent updating.
@@ -660,6 +762,11 @@ GAMECODE gameLoop()
 	static size_t numForcedUpdatesLastCall = 0;
 	static bool previousUpdateWasRender = false;
 
+	if (NETisReplay() && !replayStartSeek())
+	{
+		return GAMECODE_QUITGAME;
+	}
+
 	size_t numRegularUpdatesTicks = 0;
 	size_t numFastForwardTicks = 0;
 	gameTimeUpdateBegin();
@@ -702,7 +809,14 @@ GAMECODE gameLoop()
 
 		unsigned before = wzGetTicks();
 		syncDebug("Begin game state update, gameTime = %d", gameTime);
-		gameStateUpdate();
+		if (updateBenchmark.ticksLeft > 0)
+		{
+			benchmarkGameStateUpdate();
+		}
+		else
+		{
+			gameStateUpdate();
+		}
 		syncDebug("End game state update, gameTime = %d", gameTime);
 		unsigned after = wzGetTicks();
 
@@ -713,6 +827,7 @@ GAMECODE gameLoop()
 		ASSERT(deltaGraphicsTime == 0, "Shouldn't update graphics and game state at once.");
 	}
 	numForcedUpdatesLastCall = numFastForwardTicks;
+	replayUpdateSeek();
 
 	if (realTime - lastFlushTime >= 400u)
 	{
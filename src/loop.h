@@ -103,4 +103,7 @@ void droidCountsInTransporter(DROID *droid, int player);
 
 void countUpdate(bool synch = false);
 
+/// Times the next game state updates, after topping the world up to a couple of thousand droids, and prints the result.
+void loopBenchmarkGameStateUpdate();
+
 #endif // __INCLUDED_SRC_LOOP_H__
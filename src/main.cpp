@@ -61,6 +61,7 @@
 #include "lib/framework/physfs_ext.h"
 #include "lib/framework/wzpaths.h"
 #include "lib/framework/wztime.h"
+#include "lib/framework/task_scheduler.h"
 #include "lib/exceptionhandler/exceptionhandler.h"
 #include "lib/exceptionhandler/dumpinfo.h"
 
@@ -903,7 +904,8 @@ bool startGameAfterLevelLoad()
 			if (!war_getDisableReplayRecording())
 			{
 				WZGameReplayOptionsHandler replayOptions;
-				auto replayFilename = NETreplaySaveStart((currentGameMode == ActivitySink::GameMode::MULTIPLAYER) ? "multiplay" : "skirmish", replayOptions, war_getMaxReplaysSaved(), (currentGameMode == ActivitySink::GameMode::MULTIPLAYER));
+				bool saveKeyframes = war_getReplayKeyframes() || headlessGameMode() || getHostLaunch() == HostLaunch::Autohost;
+				auto replayFilename = NETreplaySaveStart((currentGameMode == ActivitySink::GameMode::MULTIPLAYER) ? "multiplay" : "skirmish", replayOptions, war_getMaxReplaysSaved(), (currentGameMode == ActivitySink::GameMode::MULTIPLAYER), saveKeyframes);
 				if (!replayFilename.empty()) {
 					wz_command_interface_output("WZEVENT: replaySaveStarted: %s\n", replayFilename.c_str());
 				}
@@ -1295,6 +1297,7 @@ struct ScreenFrameScope
 void mainLoop()
 {
 	frameUpdate(); // General housekeeping
+	wzTaskRunMainThreadTasks();
 
 	ScreenFrameScope frameScope;
 	pie_ScreenFrameRenderBegin();
@@ -1888,8 +1891,11 @@ void mainShutdown()
 #endif
 	wzCmdInterfaceShutdown();
 	cleanupOldLogFiles();
+	// Finish any savegame still being written in the background (e.g. --saveandquit) before PhysFS goes away
+	gamestate::savegame::waitForSavegameWrites();
 	// NOTE: urlRequestShutdown is called inside systemShutdown, as it must happen after certain other calls
 	systemShutdown();
+	wzTaskSchedulerShutdown();
 #ifdef WZ_OS_WIN	// clean up the memory allocated for the command line conversion
 	for (int i = 0; i < utfargc; i++)
 	{
@@ -2246,6 +2252,8 @@ int realmain(int argc, char *argv[])
 
 	pie_ScreenFrameRenderEnd();
 
+	wzTaskSchedulerInitialise(task_thread_count());
+
 	if (!systemInitialise(horizScaleFactor, vertScaleFactor))
 	{
 		return EXIT_FAILURE;
@@ -56,65 +56,59 @@
 #include "fpath.h"
 #include "levels.h"
 #include "lib/framework/wzapp.h"
+#include "lib/framework/task_scheduler.h"
 #include "lib/framework/load_result.h"
 #include "lib/ivis_opengl/pielighting.h"
 
 #define GAME_TICKS_FOR_DANGER (GAME_TICKS_PER_SEC * 2)
-
-static WZ_THREAD *dangerThread = nullptr;
-static WZ_SEMAPHORE *dangerSemaphore = nullptr;
-static WZ_SEMAPHORE *dangerDoneSemaphore = nullptr;
+#define DANGER_FLOOD_INPUT_BITS (AUXBITS_NONPASSABLE | AUXBITS_THREAT)  ///< The aux bits dangerFloodFill() reads.
+#define DANGER_OVERLAY_BITS (AUXBITS_DANGER | AUXBITS_THREAT | AUXBITS_AATHREAT)  ///< The aux bits the danger maps own.
+
+static TaskGroup dangerFloods(TaskPriority::Low);  ///< Flood fills of the players' working danger maps, running in the background.
+static bool dangerRunning = false;                ///< Whether danger maps are being updated (skirmish only).
+/// Whether dangerWork[player] holds the flood fill of its current inputs, from dangerFloodStart[player]. Only used to
+/// skip flood fills which wouldn't change anything, so it isn't saved; restoring clears it, forcing new flood fills.
+static std::array<bool, MAX_PLAYERS> dangerFloodValid = {};
+static std::array<Vector2i, MAX_PLAYERS> dangerFloodStart;
+static std::array<std::vector<uint8_t>, MAX_PLAYERS> dangerThreat;  ///< Scratch space for the threat bits of each player.
 struct floodtile
 {
 	uint8_t x;
 	uint8_t y;
 };
-static struct floodtile *floodbucket = nullptr;
-static int bucketcounter;
 static UDWORD lastDangerUpdate = 0;
-static int lastDangerPlayer = -1;
-// Set by the GameState restore pass (mapRestoreDangerMaps) to tell the next mapInit() that the
+// Set by the GameState restore pass (readDangerMaps) to tell the next mapInit() that the
 // danger-map content + schedule were already restored from a snapshot, so it must NOT recompute them
-// fresh (which would overwrite the staggered round-robin state with an all-fresh tick-T recompute and
+// fresh (which would overwrite the restored in-flight working maps with an all-fresh tick-T recompute and
 // reset the schedule). Consumed (and cleared) by mapInit(). (See gamestate_serialize.cpp.)
 static bool dangerRestoredFromSnapshot = false;
 
-// GameState (de)serialization accessors for the danger-map recompute schedule. mapUpdate() runs the
-// SKIRMISH AI threat-map round-robin gated on these file-statics; restoring them lets a loaded game
-// recompute the same player's danger map at the same tick as the original (else the schedule is
-// phase-shifted - a "Do danger maps." sync divergence on the first post-load tick).
+// GameState (de)serialization accessors for the danger-map recompute schedule. mapUpdate() refreshes the
+// SKIRMISH AI threat maps gated on this file-static; restoring it lets a loaded game harvest and recompute
+// the danger maps at the same tick as the original (else the schedule is phase-shifted - a
+// "Do danger maps." sync divergence on the first post-load tick).
 UDWORD getLastDangerUpdate() { return lastDangerUpdate; }
 void setLastDangerUpdate(UDWORD value) { lastDangerUpdate = value; }
-int getLastDangerPlayer() { return lastDangerPlayer; }
-void setLastDangerPlayer(int value) { lastDangerPlayer = value; }
 
-// Cleanly stop and tear down the danger worker thread (if running). Wakes it from its wait, lets it
-// observe lastDangerPlayer == -1 to exit its loop, joins it, and destroys the semaphores. Shared by
+// Stop updating danger maps (if running), after waiting for the flood fills in flight. Shared by
 // mapShutdown() and the GameState restore path.
-static void stopDangerThread()
+static void stopDangerUpdates()
 {
-	if (dangerThread)
+	if (dangerRunning)
 	{
-		wzSemaphoreWait(dangerDoneSemaphore);
-		lastDangerPlayer = -1;
-		wzSemaphorePost(dangerSemaphore);
-		wzThreadJoin(dangerThread);
-		wzSemaphoreDestroy(dangerSemaphore);
-		wzSemaphoreDestroy(dangerDoneSemaphore);
-		dangerThread = nullptr;
-		dangerSemaphore = nullptr;
-		dangerDoneSemaphore = nullptr;
+		dangerFloods.wait();
+		dangerFloodValid.fill(false);
+		dangerRunning = false;
 	}
 }
 
-// GameState reconstruct: stop the danger thread before the world is torn down and the aux/block maps
-// are reallocated (readMapTerrain). Only the in-process round-trip / in-place resume has a live thread
-// here; the disk cold-load runs before mapInit ever started one, so this is then a no-op. Eliminates a
-// realloc-vs-flood race on auxMap[MAX_PLAYERS+AUX_DANGERMAP] / blockMap[AUX_DANGERMAP]. NB this sets
-// lastDangerPlayer = -1; the snapshot's value is reapplied afterwards by the determinism-core restore.
+// GameState reconstruct: stop the danger updates before the world is torn down and the aux/block maps
+// are reallocated (readMapTerrain). Only the in-process round-trip / in-place resume has floods in
+// flight here; the disk cold-load runs before mapInit ever started one, so this is then a no-op. Eliminates a
+// realloc-vs-flood race on dangerWork / blockMap[AUX_DANGERMAP].
 void mapStopDangerThreadForReconstruct()
 {
-	stopDangerThread();
+	stopDangerUpdates();
 }
 
 // GameState reconstruct: note that the danger-map content was restored from the snapshot, so the next
@@ -124,29 +118,25 @@ void mapNoteDangerRestoredFromSnapshot()
 	dangerRestoredFromSnapshot = true;
 }
 
-// GameState serialize: temporarily park the danger worker so the in-flight working buffer
-// (auxMap[MAX_PLAYERS+AUX_DANGERMAP], which dangerThreadFunc writes) can be read without a data race.
-// Borrows the worker's "done" token: after this returns the worker has finished its current flood and is
-// blocked on dangerSemaphore, so it will not touch the buffer until mapDangerSerializeEnd() / the next
-// mapUpdate. Returns true if it parked a live worker (pair with End); false if none was running (no-op).
+// GameState serialize: finish the in-flight flood fills so the working buffers (dangerWork, which
+// dangerFloodFill writes) can be read without a data race.
+// No new flood starts until the next mapUpdate. Returns true if danger maps are being updated (pair with
+// End); false if not (no-op).
 bool mapDangerSerializeBegin()
 {
-	if (!dangerThread)
+	if (!dangerRunning)
 	{
 		return false;
 	}
-	wzSemaphoreWait(dangerDoneSemaphore);
+	dangerFloods.wait();
 	return true;
 }
 
-// GameState serialize: give the worker's "done" token back, restoring the mapUpdate semaphore accounting
-// (the worker stays blocked on dangerSemaphore; it was never woken). Pairs with mapDangerSerializeBegin().
+// GameState serialize: pairs with mapDangerSerializeBegin(). Nothing to undo, since finishing the flood
+// fills early doesn't change their result.
 void mapDangerSerializeEnd(bool parked)
 {
-	if (parked)
-	{
-		wzSemaphorePost(dangerDoneSemaphore);
-	}
+	(void)parked;
 }
 
 //For saves to determine if loading the terrain type override should occur
@@ -785,7 +775,7 @@ static bool mapSetGroundTypes(WorldMapState& mapState)
 		{
 			MAPTILE *psTile = mapTile(mapState, i, j);
 
-			psTile->ground = determineGroundType(mapState, i, j, tilesetDir);
+			mapTileDisplay(mapState, i, j)->ground = determineGroundType(mapState, i, j, tilesetDir);
 
 			if (hasDecals(mapState, i, j))
 			{
@@ -1155,12 +1145,9 @@ LoadingTask<> mapLoadFromWzMapData(ResourceLoadingController& controller, std::s
 	ASSERT(mapState.tiles == nullptr, "Map has not been cleared before calling mapLoad()!");
 
 	/* Allocate the memory for the map */
-	mapState.tiles = std::make_unique<MAPTILE[]>(static_cast<size_t>(width) * height);
+	mapState.allocateTiles(width, height);
 	ASSERT(mapState.tiles != nullptr, "Out of memory");
 
-	mapState.width = width;
-	mapState.height = height;
-
 	// FIXME: the map preview code loads the map without setting the tileset
 	if (!tilesetDir)
 	{
@@ -1196,10 +1183,7 @@ LoadingTask<> mapLoadFromWzMapData(ResourceLoadingController& controller, std::s
 		mapState.tiles[i].texture = loadedMap->mMapTiles[i].texture;
 		mapState.tiles[i].height = loadedMap->mMapTiles[i].height;
 
-		// Visibility stuff
-		memset(mapState.tiles[i].watchers, 0, sizeof(mapState.tiles[i].watchers));
-		memset(mapState.tiles[i].sensors, 0, sizeof(mapState.tiles[i].sensors));
-		memset(mapState.tiles[i].jammers, 0, sizeof(mapState.tiles[i].jammers));
+		// Visibility stuff (the per-player watcher, sensor and jammer planes start zeroed)
 		mapState.tiles[i].sensorBits = 0;
 		mapState.tiles[i].jammerBits = 0;
 		mapState.tiles[i].tileExploredBits = 0;
@@ -1267,6 +1251,10 @@ static bool afterMapLoad(WorldMapState& mapState)
 	{
 		mapState.auxMap[x] = std::make_unique<uint8_t[]> (mapSize);
 	}
+	for (int player = 0; player < MAX_PLAYERS; ++player)
+	{
+		mapState.dangerWork[player] = std::make_unique<uint8_t[]>(mapSize);
+	}
 
 	// Set our blocking bits
 	for (int y = 0; y < mapState.height; ++y)
@@ -1301,6 +1289,9 @@ static bool afterMapLoad(WorldMapState& mapState)
 	/* Set continents. This should ideally be done in advance by the map editor. */
 	mapFloodFillContinents(mapState);
 
+	// Every tile changed, so pathfinding must regenerate its blocking maps from scratch.
+	mapState.blockingJournal.reset();
+
 	return true;
 }
 
@@ -1322,6 +1313,10 @@ bool mapReinitGameStateAfterTerrainRestore(WorldMapState& mapState)
 	{
 		mapState.auxMap[x] = std::make_unique<uint8_t[]>(mapSize);
 	}
+	for (int player = 0; player < MAX_PLAYERS; ++player)
+	{
+		mapState.dangerWork[player] = std::make_unique<uint8_t[]>(mapSize);
+	}
 
 	for (int y = 0; y < mapState.height; ++y)
 	{
@@ -1352,6 +1347,7 @@ bool mapReinitGameStateAfterTerrainRestore(WorldMapState& mapState)
 	}
 
 	mapFloodFillContinents(mapState);
+	mapState.blockingJournal.reset();
 	return true;
 }
 
@@ -1403,15 +1399,17 @@ bool mapSaveToWzMapData(WzMap::MapData& output, const WorldMapState& mapState)
 /* Shutdown the map module */
 bool mapShutdown()
 {
-	stopDangerThread();
+	stopDangerUpdates();
 
 	mapDecals = nullptr;
-	free(floodbucket);
 	gwShutDown(gameWorld.map);
 	gameWorld.map = {};
+	for (auto &threat : dangerThreat)
+	{
+		threat = {};
+	}
 
 	map = nullptr;
-	floodbucket = nullptr;
 	groundTypes.clear();
 	mapDecals = nullptr;
 	numTile_names = 0;
@@ -2142,34 +2140,31 @@ bool fireOnLocation(WorldMapState& mapState, unsigned int x, unsigned int y)
 	return psTile != nullptr && TileIsBurning(psTile);
 }
 
-// This function runs in a separate thread!
-static int dangerFloodFill(WorldMapState& mapState, int player)
+// This function runs in a separate thread! Several at once, one per player; each only writes dangerWork[player].
+static void dangerFloodFill(WorldMapState& mapState, int player)
 {
-	int i;
+	uint8_t *work = mapState.dangerWork[player].get();
+	const uint8_t *block = mapState.blockMap[AUX_DANGERMAP].get();
+	const size_t mapSize = static_cast<size_t>(mapState.width) * static_cast<size_t>(mapState.height);
 	Vector2i pos = getPlayerStartPosition(player);
 	Vector2i npos(0, 0);
-	uint8_t aux, block;
-	int x, y;
 	bool start = true;	// hack to disregard the blocking status of any building exactly on the starting position
+	std::vector<floodtile> floodbucket;
+	floodbucket.reserve(mapSize);
 
 	// Set our danger bits
-	for (y = 0; y < mapState.height; y++)
+	for (size_t i = 0; i < mapSize; i++)
 	{
-		for (x = 0; x < mapState.width; x++)
-		{
-			auxSet(mapState, x, y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_DANGER);
-			auxClear(mapState, x, y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_TEMPORARY);
-		}
+		work[i] = (work[i] | AUXBITS_DANGER) & ~AUXBITS_TEMPORARY;
 	}
 
 	pos.x = map_coord(pos.x);
 	pos.y = map_coord(pos.y);
-	bucketcounter = 0;
 
 	do
 	{
 		// Add accessible neighbouring tiles to the open list
-		for (i = 0; i < NUM_DIR; i++)
+		for (int i = 0; i < NUM_DIR; i++)
 		{
 			npos.x = pos.x + aDirOffset[i].x;
 			npos.y = pos.y + aDirOffset[i].y;
@@ -2177,16 +2172,14 @@ static int dangerFloodFill(WorldMapState& mapState, int player)
 			{
 				continue;
 			}
-			aux = auxTile(mapState, npos.x, npos.y, MAX_PLAYERS + AUX_DANGERMAP);
-			block = blockTile(mapState, pos.x, pos.y, AUX_DANGERMAP);
+			uint8_t &aux = work[npos.x + npos.y * mapState.width];
+			const uint8_t blockBits = block[pos.x + pos.y * mapState.width];
 			if (!(aux & AUXBITS_TEMPORARY) && !(aux & AUXBITS_THREAT) && (aux & AUXBITS_DANGER))
 			{
 				// Note that we do not consider water to be a blocker here. This may or may not be a feature...
-				if (!(block & FEATURE_BLOCKED) && (!(aux & AUXBITS_NONPASSABLE) || start))
+				if (!(blockBits & FEATURE_BLOCKED) && (!(aux & AUXBITS_NONPASSABLE) || start))
 				{
-					floodbucket[bucketcounter].x = npos.x;
-					floodbucket[bucketcounter].y = npos.y;
-					bucketcounter++;
+					floodbucket.push_back({static_cast<uint8_t>(npos.x), static_cast<uint8_t>(npos.y)});
 					if (start && !(aux & AUXBITS_NONPASSABLE))
 					{
 						start = false;
@@ -2194,40 +2187,37 @@ static int dangerFloodFill(WorldMapState& mapState, int player)
 				}
 				else
 				{
-					auxClear(mapState, npos.x, npos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_DANGER);
+					aux &= ~AUXBITS_DANGER;
 				}
-				auxSet(mapState, npos.x, npos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_TEMPORARY); // make sure we do not process it more than once
+				aux |= AUXBITS_TEMPORARY; // make sure we do not process it more than once
 			}
 		}
 
 		// Clear danger
-		auxClear(mapState, pos.x, pos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_DANGER);
+		work[pos.x + pos.y * mapState.width] &= ~AUXBITS_DANGER;
 
 		// Pop the last open node off the bucket list for the next iteration
-		if (bucketcounter)
+		if (!floodbucket.empty())
 		{
-			bucketcounter--;
-			pos.x = floodbucket[bucketcounter].x;
-			pos.y = floodbucket[bucketcounter].y;
+			pos.x = floodbucket.back().x;
+			pos.y = floodbucket.back().y;
+			floodbucket.pop_back();
 		}
 	}
-	while (bucketcounter);
-	return 0;
+	while (!floodbucket.empty());
 }
 
-// This function runs in a separate thread!
-static int dangerThreadFunc(WZ_DECL_UNUSED void *data)
+// Start a background flood fill of the working danger map of player.
+static void startDangerFlood(WorldMapState& mapState, int player)
 {
-	while (lastDangerPlayer != -1)
-	{
-		dangerFloodFill(gameWorld.map, lastDangerPlayer);	// Do the actual work
-		wzSemaphorePost(dangerDoneSemaphore);   // Signal that we are done
-		wzSemaphoreWait(dangerSemaphore);	// Go to sleep until needed.
-	}
-	return 0;
+	dangerFloodValid[player] = true;
+	dangerFloodStart[player] = getPlayerStartPosition(player);
+	dangerFloods.run([&mapState, player]() {
+		dangerFloodFill(mapState, player);
+	});
 }
 
-static inline void threatUpdateTarget(int player, BASE_OBJECT *psObj, bool ground, bool air)
+static inline void threatUpdateTarget(const WorldMapState& mapState, uint8_t *threat, int player, BASE_OBJECT *psObj, bool ground, bool air)
 {
 	if (psObj->visible[player] || psObj->born == 2)
 	{
@@ -2235,30 +2225,21 @@ static inline void threatUpdateTarget(int player, BASE_OBJECT *psObj, bool groun
 		{
 			if (ground)
 			{
-				auxSet(gameWorld.map, pos.x, pos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_THREAT);	// set ground threat for this tile
+				threat[pos.x + pos.y * mapState.width] |= AUXBITS_THREAT;	// set ground threat for this tile
 			}
 			if (air)
 			{
-				auxSet(gameWorld.map, pos.x, pos.y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_AATHREAT);	// set air threat for this tile
+				threat[pos.x + pos.y * mapState.width] |= AUXBITS_AATHREAT;	// set air threat for this tile
 			}
 		}
 	}
 }
 
-static void threatUpdate(GameWorld& world, int player)
+// Set the threat bits of player in threat, a zeroed plane parallel to the map. Only reads the world.
+static void threatUpdate(const GameWorld& world, int player, uint8_t *threat)
 {
-	int i, weapon, x, y;
-
-	// Step 1: Clear our threat bits
-	for (y = 0; y < world.map.height; y++)
-	{
-		for (x = 0; x < world.map.width; x++)
-		{
-			auxClear(world.map, x, y, MAX_PLAYERS + AUX_DANGERMAP, AUXBITS_THREAT | AUXBITS_AATHREAT);
-		}
-	}
+	int i, weapon;
 
-	// Step 2: Set threat bits
 	for (i = 0; i < MAX_PLAYERS; i++)
 	{
 		if (aiCheckAlliances(player, i))
@@ -2286,7 +2267,7 @@ static void threatUpdate(GameWorld& world, int player)
 			}
 			if (mode > 0)
 			{
-				threatUpdateTarget(player, (BASE_OBJECT *)psDroid, mode & SHOOT_ON_GROUND, mode & SHOOT_IN_AIR);
+				threatUpdateTarget(world.map, threat, player, (BASE_OBJECT *)psDroid, mode & SHOOT_ON_GROUND, mode & SHOOT_IN_AIR);
 			}
 		}
 
@@ -2304,52 +2285,125 @@ static void threatUpdate(GameWorld& world, int player)
 			}
 			if (mode > 0)
 			{
-				threatUpdateTarget(player, (BASE_OBJECT *)psStruct, mode & SHOOT_ON_GROUND, mode & SHOOT_IN_AIR);
+				threatUpdateTarget(world.map, threat, player, (BASE_OBJECT *)psStruct, mode & SHOOT_ON_GROUND, mode & SHOOT_IN_AIR);
 			}
 		}
 	}
 }
 
-void mapInit(GameWorld& world)
+// Take the current aux bits and threats of player into its working danger map, keeping the danger bits of the
+// last flood fill. Returns whether anything the flood fill reads changed since then, so it has to be redone.
+// Runs on several threads at once, one per player; only reads the world.
+static bool dangerUpdateInputs(const GameWorld& world, int player, bool blockingChanged)
 {
-	int player;
+	const WorldMapState &mapState = world.map;
+	const size_t mapSize = static_cast<size_t>(mapState.width) * static_cast<size_t>(mapState.height);
+	std::vector<uint8_t> &threat = dangerThreat[player];
+	threat.assign(mapSize, 0);
+	threatUpdate(world, player, threat.data());
+
+	const uint8_t *aux = mapState.auxMap[player].get();
+	uint8_t *work = mapState.dangerWork[player].get();
+	bool changed = blockingChanged || !dangerFloodValid[player] || dangerFloodStart[player] != getPlayerStartPosition(player);
+	for (size_t i = 0; i < mapSize; i++)
+	{
+		const uint8_t input = (aux[i] & ~(DANGER_OVERLAY_BITS | AUXBITS_TEMPORARY)) | threat[i];
+		changed |= ((input ^ work[i]) & DANGER_FLOOD_INPUT_BITS) != 0;
+		work[i] = input | (work[i] & AUXBITS_DANGER);
+	}
+	return changed;
+}
 
-	free(floodbucket);
-	floodbucket = (struct floodtile *)malloc(world.map.width * world.map.height * sizeof(*floodbucket));
+// Refresh the working danger maps of the first numPlayers players: take their threats (in parallel), and
+// start background flood fills for those whose flood fill inputs changed. No flood fills may be running.
+static void startDangerUpdates(GameWorld& world, int numPlayers)
+{
+	WorldMapState &mapState = world.map;
+	const size_t mapSize = static_cast<size_t>(mapState.width) * static_cast<size_t>(mapState.height);
 
+	// The flood fills read this copy of the blocking map, so they don't race the game changing the real one.
+	const uint8_t *block = mapState.blockMap[AUX_MAP].get();
+	uint8_t *blockDanger = mapState.blockMap[AUX_DANGERMAP].get();
+	bool blockingChanged = false;
+	for (size_t i = 0; i < mapSize && !blockingChanged; i++)
+	{
+		blockingChanged = ((block[i] ^ blockDanger[i]) & FEATURE_BLOCKED) != 0;
+	}
+	memcpy(blockDanger, block, mapSize);
+
+	std::array<bool, MAX_PLAYERS> flood = {};
+	wzTaskParallelFor(numPlayers, [&](size_t player) {
+		flood[player] = dangerUpdateInputs(world, static_cast<int>(player), blockingChanged);
+	});
+	for (int player = 0; player < numPlayers; player++)
+	{
+		if (flood[player])
+		{
+			startDangerFlood(mapState, player);
+		}
+	}
+}
+
+// Copy the danger bits of player's finished working danger map into its aux map. Pathfinding only has to
+// regenerate its danger maps if this changed anything, so leave everything alone if it wouldn't.
+static void dangerHarvest(WorldMapState& mapState, int player)
+{
+	const size_t mapSize = static_cast<size_t>(mapState.width) * static_cast<size_t>(mapState.height);
+	uint8_t *aux = mapState.auxMap[player].get();
+	const uint8_t *work = mapState.dangerWork[player].get();
+	size_t i = 0;
+	while (i < mapSize && ((aux[i] ^ work[i]) & DANGER_OVERLAY_BITS) == 0)
+	{
+		i++;
+	}
+	if (i == mapSize)
+	{
+		return;
+	}
+	for (; i < mapSize; i++)
+	{
+		aux[i] ^= (aux[i] ^ work[i]) & DANGER_OVERLAY_BITS;
+	}
+	++mapState.blockingJournal.dangerGeneration[player];
+}
+
+void mapInit(GameWorld& world)
+{
 	// When restoring from a GameState snapshot the danger-map content + schedule were already applied
-	// (mapRestoreDangerMaps, run during the world reconstruction that precedes this call on the cold-load
+	// (readDangerMaps, run during the world reconstruction that precedes this call on the cold-load
 	// path). Preserve them: skip the all-fresh per-player recompute and the schedule reset, but still
-	// (re)start the worker thread. On start the thread re-floods lastDangerPlayer from the restored
-	// working THREAT bits + blockMap[AUX_DANGERMAP], reproducing the in-flight DANGER deterministically.
+	// (re)start the updates. On start this re-floods every player from the restored working maps
+	// (THREAT bits + blockMap[AUX_DANGERMAP]), reproducing the in-flight DANGER deterministically.
 	const bool fromSnapshot = dangerRestoredFromSnapshot;
 	dangerRestoredFromSnapshot = false; // consume
 
 	if (!fromSnapshot)
 	{
 		lastDangerUpdate = 0;
-		lastDangerPlayer = -1;
 	}
 
-	// Start danger thread (not used for campaign for now - mission map swaps too icky)
-	ASSERT(dangerSemaphore == nullptr && dangerThread == nullptr, "Map data not cleaned up before starting!");
+	// Start danger map updates (not used for campaign for now - mission map swaps too icky)
+	ASSERT(!dangerRunning, "Map data not cleaned up before starting!");
+	dangerFloodValid.fill(false);
 	if (game.type == LEVEL_TYPE::SKIRMISH)
 	{
 		if (!fromSnapshot)
 		{
-			for (player = 0; player < MAX_PLAYERS; player++)
+			startDangerUpdates(world, MAX_PLAYERS);
+			dangerFloods.wait();
+			for (int player = 0; player < MAX_PLAYERS; player++)
 			{
-				auxMapStore(world.map, player, AUX_DANGERMAP);
-				threatUpdate(world, player);
-				dangerFloodFill(world.map, player);
-				auxMapRestore(world.map, player, AUX_DANGERMAP, AUXBITS_DANGER | AUXBITS_THREAT | AUXBITS_AATHREAT);
+				dangerHarvest(world.map, player);
 			}
-			lastDangerPlayer = 0;
 		}
-		dangerSemaphore = wzSemaphoreCreate(0);
-		dangerDoneSemaphore = wzSemaphoreCreate(0);
-		dangerThread = wzThreadCreate(dangerThreadFunc, nullptr, "wzDanger");
-		wzThreadStart(dangerThread);
+		else
+		{
+			for (int player = 0; player < game.maxPlayers; player++)
+			{
+				startDangerFlood(world.map, player);
+			}
+		}
+		dangerRunning = true;
 	}
 }
 
@@ -2377,13 +2431,13 @@ void mapUpdate(GameWorld& world)
 		syncDebug("Do danger maps.");
 		lastDangerUpdate = gameTime;
 
-		// Lock if previous job not done yet
-		wzSemaphoreWait(dangerDoneSemaphore);
-
-		auxMapRestore(world.map, lastDangerPlayer, AUX_DANGERMAP, AUXBITS_THREAT | AUXBITS_AATHREAT | AUXBITS_DANGER);
-		lastDangerPlayer = (lastDangerPlayer + 1) % game.maxPlayers;
-		auxMapStore(world.map, lastDangerPlayer, AUX_DANGERMAP);
-		threatUpdate(world, lastDangerPlayer);
-		wzSemaphorePost(dangerSemaphore);
+		// Wait if the previous flood fills are not done yet, then hand their results to the AI and start
+		// on the next ones. Every player's danger map is thus at most one interval old.
+		dangerFloods.wait();
+		for (int player = 0; player < game.maxPlayers; player++)
+		{
+			dangerHarvest(world.map, player);
+		}
+		startDangerUpdates(world, game.maxPlayers);
 	}
 }
@@ -99,31 +99,20 @@ WZ_DECL_ALWAYS_INLINE static inline uint8_t blockTile(const WorldMapState& mapSt
 	return mapState.blockMap[slot][x + y * mapState.width];
 }
 
-/// Store a shadow copy of a player's aux map for use in threaded calculations
-static inline void auxMapStore(WorldMapState& mapState, int player, int slot)
+/// Record that the aux or blocking bits of a tile changed, for fpathSetBlockingMap
+WZ_DECL_ALWAYS_INLINE static inline void auxNoteChange(WorldMapState& mapState, int x, int y)
 {
-	memcpy(mapState.blockMap[slot].get(), mapState.blockMap[0].get(), sizeof(uint8_t) * mapState.width * mapState.height);
-	memcpy(mapState.auxMap[MAX_PLAYERS + slot].get(), mapState.auxMap[player].get(), sizeof(uint8_t) * mapState.width * mapState.height);
-}
-
-/// Restore selected fields from the shadow copy of a player's aux map (ignoring the block map)
-static inline void auxMapRestore(WorldMapState& mapState, int player, int slot, int mask)
-{
-	int i;
-	uint8_t original, cached;
-
-	for (i = 0; i < mapState.height * mapState.width; i++)
-	{
-		original = mapState.auxMap[player][i];
-		cached = mapState.auxMap[MAX_PLAYERS + slot][i];
-		mapState.auxMap[player][i] = original ^ ((original ^ cached) & mask);
-	}
+	mapState.blockingJournal.noteTile(x + y * mapState.width, static_cast<size_t>(mapState.width) * mapState.height);
 }
 
 /// Set aux bits. Always set identically for all players. States not set are retained.
 WZ_DECL_ALWAYS_INLINE static inline void auxSet(WorldMapState& mapState, int x, int y, int player, int state)
 {
 	mapState.auxMap[player][x + y * mapState.width] |= state;
+	if (player < MAX_PLAYERS)  // Not the danger thread's working copy.
+	{
+		auxNoteChange(mapState, x, y);
+	}
 }
 
 /// Set aux bits. Always set identically for all players. States not set are retained.
@@ -135,6 +124,7 @@ WZ_DECL_ALWAYS_INLINE static inline void auxSetAll(WorldMapState& mapState, int
 	{
 		mapState.auxMap[i][x + y * mapState.width] |= state;
 	}
+	auxNoteChange(mapState, x, y);
 }
 
 /// Set aux bits. Always set identically for all players. States not set are retained.
@@ -149,6 +139,7 @@ WZ_DECL_ALWAYS_INLINE static inline void auxSetAllied(WorldMapState& mapState, i
 			mapState.auxMap[i][x + y * mapState.width] |= state;
 		}
 	}
+	auxNoteChange(mapState, x, y);
 }
 
 /// Set aux bits. Always set identically for all players. States not set are retained.
@@ -163,12 +154,17 @@ WZ_DECL_ALWAYS_INLINE static inline void auxSetEnemy(WorldMapState& mapState, in
 			mapState.auxMap[i][x + y * mapState.width] |= state;
 		}
 	}
+	auxNoteChange(mapState, x, y);
 }
 
 /// Clear aux bits. Always set identically for all players. States not cleared are retained.
 WZ_DECL_ALWAYS_INLINE static inline void auxClear(WorldMapState& mapState, int x, int y, int player, int state)
 {
 	mapState.auxMap[player][x + y * mapState.width] &= ~state;
+	if (player < MAX_PLAYERS)  // Not the danger thread's working copy.
+	{
+		auxNoteChange(mapState, x, y);
+	}
 }
 
 /// Clear all aux bits. Always set identically for all players. States not cleared are retained.
@@ -180,18 +176,21 @@ WZ_DECL_ALWAYS_INLINE static inline void auxClearAll(WorldMapState& mapState, in
 	{
 		mapState.auxMap[i][x + y * mapState.width] &= ~state;
 	}
+	auxNoteChange(mapState, x, y);
 }
 
 /// Set blocking bits. Always set identically for all players. States not set are retained.
 WZ_DECL_ALWAYS_INLINE static inline void auxSetBlocking(WorldMapState& mapState, int x, int y, int state)
 {
 	mapState.blockMap[0][x + y * mapState.width] |= state;
+	auxNoteChange(mapState, x, y);
 }
 
 /// Clear blocking bits. Always set identically for all players. States not cleared are retained.
 WZ_DECL_ALWAYS_INLINE static inline void auxClearBlocking(WorldMapState& mapState, int x, int y, int state)
 {
 	mapState.blockMap[0][x + y * mapState.width] &= ~state;
+	auxNoteChange(mapState, x, y);
 }
 
 /**
@@ -456,6 +455,34 @@ static inline WZ_DECL_PURE const MAPTILE* worldTile(const WorldMapState& mapStat
 	return const_cast<const MAPTILE*>(worldTile(const_cast<WorldMapState&>(mapState), v));
 }
 
+/** Return the index of a tile in mapState.tiles, which is also its index in the planes parallel to it */
+static inline WZ_DECL_PURE size_t mapTileIndex(const WorldMapState& mapState, const MAPTILE *psTile)
+{
+	return static_cast<size_t>(psTile - mapState.tiles.get());
+}
+
+/** Return a pointer to the display only values of a tile */
+static inline WZ_DECL_PURE MAPTILE_DISPLAY *mapTileDisplay(WorldMapState& mapState, const MAPTILE *psTile)
+{
+	return &mapState.display[mapTileIndex(mapState, psTile)];
+}
+
+static inline WZ_DECL_PURE const MAPTILE_DISPLAY *mapTileDisplay(const WorldMapState& mapState, const MAPTILE *psTile)
+{
+	return &mapState.display[mapTileIndex(mapState, psTile)];
+}
+
+/** Return a pointer to the display only values of the tile at x,y in map coordinates */
+static inline WZ_DECL_PURE MAPTILE_DISPLAY *mapTileDisplay(WorldMapState& mapState, int32_t x, int32_t y)
+{
+	return mapTileDisplay(mapState, mapTile(mapState, x, y));
+}
+
+static inline WZ_DECL_PURE const MAPTILE_DISPLAY *mapTileDisplay(const WorldMapState& mapState, int32_t x, int32_t y)
+{
+	return mapTileDisplay(mapState, mapTile(mapState, x, y));
+}
+
 /// Return ground height of top-left corner of tile at x,y
 static inline WZ_DECL_PURE int32_t map_TileHeight(const WorldMapState& mapState, int32_t x, int32_t y)
 {
@@ -589,21 +616,19 @@ void mapInit(GameWorld& world);
 void mapUpdate(GameWorld& world);
 
 // GameState (de)serialization: the SKIRMISH danger-map recompute schedule (see mapUpdate). Restored
-// as part of the determinism core so a loaded game stays on the same threat-map round-robin phase.
+// as part of the determinism core so a loaded game refreshes the threat maps on the same ticks.
 UDWORD getLastDangerUpdate();
 void setLastDangerUpdate(UDWORD value);
-int getLastDangerPlayer();
-void setLastDangerPlayer(int value);
 
 // GameState reconstruct (see gamestate_serialize.cpp):
-// - mapStopDangerThreadForReconstruct() tears down the running danger worker thread before the world
-//   is rebuilt and the aux/block maps reallocated (no-op on the cold-load path, where no thread runs).
+// - mapStopDangerThreadForReconstruct() stops the danger map updates (and their background flood fills)
+//   before the world is rebuilt and the aux/block maps reallocated (no-op on the cold-load path).
 // - mapNoteDangerRestoredFromSnapshot() marks that the danger content + schedule were restored, so the
-//   next mapInit() preserves them (and restarts the thread) instead of recomputing fresh.
+//   next mapInit() preserves them (and restarts the updates) instead of recomputing fresh.
 void mapStopDangerThreadForReconstruct();
 void mapNoteDangerRestoredFromSnapshot();
-// Park/unpark the danger worker around a serialize-time read of the in-flight working buffer (see
-// gamestate_serialize.cpp writeDangerMaps). Begin() returns true if it parked a running worker.
+// Finish the background flood fills before a serialize-time read of the in-flight working buffers (see
+// gamestate_serialize.cpp writeDangerMaps). Begin() returns true if danger maps are being updated.
 bool mapDangerSerializeBegin();
 void mapDangerSerializeEnd(bool parked);
 
@@ -34,73 +34,173 @@
 
 
 static PointTree *gridPointTree = nullptr;  // A quad-tree-like object.
-static PointTree::Filter *gridFiltersUnseen;
-static PointTree::Filter *gridFiltersDroidsByPlayer;
-static PointTree::Filter *gridFiltersDroidsRepairCandidates;
 
-// initialise the grid system
-bool gridInitialise()
+/// A filter is only reset the first time it is used after gridReset(), so that ticks which never
+/// use it don't pay for clearing it.
+struct GridFilter
 {
-	ASSERT(gridPointTree == nullptr, "gridInitialise already called, without calling gridShutDown.");
-	gridPointTree = new PointTree;
-	gridFiltersUnseen = new PointTree::Filter[MAX_PLAYERS];
-	gridFiltersDroidsByPlayer = new PointTree::Filter[MAX_PLAYERS];
-	gridFiltersDroidsRepairCandidates = new PointTree::Filter[MAX_PLAYERS];
+	PointTree::Filter filter;
+	unsigned generation = 0;
+};
 
-	return true;  // Yay, nothing failed!
-}
+struct GridQueryContext::Impl
+{
+	PointTree::QueryContext query;
+	GridFilter filtersUnseen[MAX_PLAYERS];
+	GridFilter filtersDroidsByPlayer[MAX_PLAYERS];
+	GridFilter filtersDroidsRepairCandidates[MAX_PLAYERS];
+	GridList results;
+};
 
-// reset the grid system
-void gridReset(GameWorld& world)
+GridQueryContext::GridQueryContext() : impl(std::make_unique<Impl>()) {}
+GridQueryContext::~GridQueryContext() = default;
+
+static GridQueryContext *gridDefaultContext = nullptr;  // Used by the functions which don't take a context.
+static unsigned gridGeneration = 0;
+
+/// An object in the grid, with its place in the order gridReset() visits the object lists, which
+/// breaks ties between objects in exactly the same place. Equivalent to stable sorting by position
+/// after inserting in that order, which is what the grid used to do, so query results (and their
+/// order) are unchanged.
+struct GridEntry
 {
-	gridPointTree->clear();
+	uint64_t position;
+	uint64_t order;
+	BASE_OBJECT *psObj;
 
-	// Put all existing objects into the point tree.
-	for (unsigned player = 0; player < MAX_PLAYERS; player++)
+	bool operator<(GridEntry const &b) const
 	{
-		for (BASE_OBJECT* psObj : world.objects.droids[player])
+		return position < b.position || (position == b.position && order < b.order);
+	}
+};
+
+/// A set of objects kept sorted between ticks. As long as the same objects are in it, in the same
+/// list order, updating it is just refreshing their positions and fixing up the few that moved
+/// past a neighbour.
+struct GridLayer
+{
+	std::vector<BASE_OBJECT *> members;  ///< The objects, in list order, as of the last update.
+	std::vector<GridEntry> sorted;
+
+	void clear()
+	{
+		members.clear();
+		sorted.clear();
+	}
+
+	void update(std::vector<GridEntry> &current)
+	{
+		bool sameMembers = current.size() == members.size();
+		for (size_t n = 0; sameMembers && n < current.size(); ++n)
 		{
-			if (!psObj->died)
+			sameMembers = current[n].psObj == members[n];
+		}
+		if (!sameMembers)
+		{
+			members.resize(current.size());
+			for (size_t n = 0; n < current.size(); ++n)
 			{
-				gridPointTree->insert(psObj, psObj->pos.x, psObj->pos.y);
-				for (unsigned char& viewer : psObj->seenThisTick)
-				{
-					viewer = 0;
-				}
+				members[n] = current[n].psObj;
+				current[n].position = PointTree::positionKey(current[n].psObj->pos.x, current[n].psObj->pos.y);
 			}
+			sorted.swap(current);
+			std::sort(sorted.begin(), sorted.end());
+			return;
+		}
+
+		for (GridEntry &entry : sorted)
+		{
+			entry.position = PointTree::positionKey(entry.psObj->pos.x, entry.psObj->pos.y);
 		}
-		for (BASE_OBJECT* psObj : world.objects.structures[player])
+		// Insertion sort, since nearly everything is still in place. Give up and do a full sort if things moved a lot.
+		size_t budget = 8 * sorted.size() + 64;
+		for (size_t i = 1; i < sorted.size(); ++i)
 		{
-			if (!psObj->died)
+			GridEntry entry = sorted[i];
+			size_t j = i;
+			for (; j > 0 && entry < sorted[j - 1] && budget > 0; --j, --budget)
 			{
-				gridPointTree->insert(psObj, psObj->pos.x, psObj->pos.y);
-				for (unsigned char& viewer : psObj->seenThisTick)
-				{
-					viewer = 0;
-				}
+				sorted[j] = sorted[j - 1];
+			}
+			sorted[j] = entry;
+			if (budget == 0)
+			{
+				std::sort(sorted.begin(), sorted.end());
+				break;
 			}
 		}
 	}
-	for (BASE_OBJECT* psObj : world.objects.features[0])
+};
+static GridLayer gridStatic;  ///< Structures and features, which practically never change.
+static GridLayer gridDroids;
+static std::vector<GridEntry> gridScratch;
+static PointTree::Vector gridMerged;
+
+// initialise the grid system
+bool gridInitialise()
+{
+	ASSERT(gridPointTree == nullptr, "gridInitialise already called, without calling gridShutDown.");
+	gridPointTree = new PointTree;
+	gridDefaultContext = new GridQueryContext;
+
+	return true;  // Yay, nothing failed!
+}
+
+/// Order of an object in gridReset()'s walk over the object lists: each player's droids then structures, then features.
+static uint64_t gridOrder(unsigned group, unsigned kind, size_t index)
+{
+	return (uint64_t)group << 33 | (uint64_t)kind << 32 | index;
+}
+
+template <typename ObjectListType>
+static void gridCollect(ObjectListType const &list, unsigned group, unsigned kind, std::vector<GridEntry> &out)
+{
+	size_t index = 0;
+	for (BASE_OBJECT *psObj : list)
 	{
 		if (!psObj->died)
 		{
-			gridPointTree->insert(psObj, psObj->pos.x, psObj->pos.y);
-			for (unsigned char& viewer : psObj->seenThisTick)
+			out.push_back(GridEntry{0, gridOrder(group, kind, index), psObj});
+			for (unsigned char &viewer : psObj->seenThisTick)
 			{
 				viewer = 0;
 			}
 		}
+		++index;
 	}
+}
 
-	gridPointTree->sort();
+// reset the grid system
+void gridReset(GameWorld& world)
+{
+	gridScratch.clear();
+	for (unsigned player = 0; player < MAX_PLAYERS; player++)
+	{
+		gridCollect(world.objects.droids[player], player, 0, gridScratch);
+	}
+	gridDroids.update(gridScratch);
+
+	gridScratch.clear();
+	for (unsigned player = 0; player < MAX_PLAYERS; player++)
+	{
+		gridCollect(world.objects.structures[player], player, 1, gridScratch);
+	}
+	gridCollect(world.objects.features[0], MAX_PLAYERS, 0, gridScratch);
+	gridStatic.update(gridScratch);
 
-	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+	// Merge the two layers into the point tree.
+	gridMerged.clear();
+	gridMerged.reserve(gridDroids.sorted.size() + gridStatic.sorted.size());
+	auto droid = gridDroids.sorted.cbegin(), droidEnd = gridDroids.sorted.cend();
+	auto other = gridStatic.sorted.cbegin(), otherEnd = gridStatic.sorted.cend();
+	while (droid != droidEnd || other != otherEnd)
 	{
-		gridFiltersUnseen[player].reset(*gridPointTree);
-		gridFiltersDroidsByPlayer[player].reset(*gridPointTree);
-		gridFiltersDroidsRepairCandidates[player].reset(*gridPointTree);
+		GridEntry const &next = other == otherEnd || (droid != droidEnd && *droid < *other) ? *droid++ : *other++;
+		gridMerged.emplace_back(next.position, next.psObj);
 	}
+	gridPointTree->assignSorted(gridMerged);
+
+	++gridGeneration;
 }
 
 // shutdown the grid system
@@ -108,10 +208,10 @@ void gridShutDown()
 {
 	delete gridPointTree;
 	gridPointTree = nullptr;
-	delete[] gridFiltersUnseen;
-	gridFiltersUnseen = nullptr;
-	delete[] gridFiltersDroidsByPlayer;
-	gridFiltersDroidsByPlayer = nullptr;
+	delete gridDefaultContext;
+	gridDefaultContext = nullptr;
+	gridStatic.clear();
+	gridDroids.clear();
 }
 
 static bool isInRadius(int32_t x, int32_t y, uint32_t radius)
@@ -123,23 +223,31 @@ static bool isInRadius(int32_t x, int32_t y, uint32_t radius)
 // initialise the grid system to start iterating through units that
 // could affect a location (x,y in world coords)
 template<class Condition>
-static GridList const &gridStartIterateFiltered(int32_t x, int32_t y, uint32_t radius, PointTree::Filter *filter, Condition const &condition)
+static GridList const &gridStartIterateFiltered(GridQueryContext::Impl &context, int32_t x, int32_t y, uint32_t radius, GridFilter *gridFilter, Condition const &condition)
 {
-	if (filter == nullptr)
+	PointTree::Filter *filter = nullptr;
+	PointTree::ResultVector &results = context.query.results;
+	if (gridFilter == nullptr)
 	{
-		gridPointTree->query(x, y, radius);
+		gridPointTree->query(context.query, x, y, radius);
 	}
 	else
 	{
-		gridPointTree->query(*filter, x, y, radius);
+		filter = &gridFilter->filter;
+		if (gridFilter->generation != gridGeneration)
+		{
+			filter->reset(*gridPointTree);
+			gridFilter->generation = gridGeneration;
+		}
+		gridPointTree->query(context.query, *filter, x, y, radius);
 	}
-	PointTree::ResultVector::iterator w = gridPointTree->lastQueryResults.begin(), i;
-	for (i = w; i != gridPointTree->lastQueryResults.end(); ++i)
+	PointTree::ResultVector::iterator w = results.begin(), i;
+	for (i = w; i != results.end(); ++i)
 	{
 		BASE_OBJECT *obj = static_cast<BASE_OBJECT *>(*i);
 		if (!condition.test(obj))  // Check if we should skip this object.
 		{
-			filter->erase(gridPointTree->lastFilteredQueryIndices[i - gridPointTree->lastQueryResults.begin()]);  // Stop the object from appearing in future searches.
+			filter->erase(context.query.filteredIndices[i - results.begin()]);  // Stop the object from appearing in future searches.
 		}
 		else if (isInRadius(obj->pos.x - x, obj->pos.y - y, radius))  // Check that search result is less than radius (since they can be up to a factor of sqrt(2) more).
 		{
@@ -147,30 +255,30 @@ static GridList const &gridStartIterateFiltered(int32_t x, int32_t y, uint32_t r
 			++w;
 		}
 	}
-	gridPointTree->lastQueryResults.erase(w, i);  // Erase all points that were a bit too far.
+	results.erase(w, i);  // Erase all points that were a bit too far.
 
 	// In case you are curious.
-	//debug(LOG_WARNING, "gridStartIterateFiltered(%d, %d, %u) found %u objects", x, y, radius, (unsigned)gridPointTree->lastQueryResults.size());
+	//debug(LOG_WARNING, "gridStartIterateFiltered(%d, %d, %u) found %u objects", x, y, radius, (unsigned)results.size());
 
-	static GridList gridList;
-	gridList.resize(gridPointTree->lastQueryResults.size());
+	GridList &gridList = context.results;
+	gridList.resize(results.size());
 	for (unsigned n = 0; n < gridList.size(); ++n)
 	{
-		gridList[n] = (BASE_OBJECT *)gridPointTree->lastQueryResults[n];
+		gridList[n] = (BASE_OBJECT *)results[n];
 	}
 	return gridList;
 }
 
 template<class Condition>
-static GridList const &gridStartIterateFilteredArea(int32_t x, int32_t y, int32_t x2, int32_t y2, Condition const &condition)
+static GridList const &gridStartIterateFilteredArea(GridQueryContext::Impl &context, int32_t x, int32_t y, int32_t x2, int32_t y2, Condition const &condition)
 {
-	gridPointTree->query(x, y, x2, y2);
+	PointTree::ResultVector &results = gridPointTree->query(context.query, x, y, x2, y2);
 
-	static GridList gridList;
-	gridList.resize(gridPointTree->lastQueryResults.size());
+	GridList &gridList = context.results;
+	gridList.resize(results.size());
 	for (unsigned n = 0; n < gridList.size(); ++n)
 	{
-		gridList[n] = (BASE_OBJECT *)gridPointTree->lastQueryResults[n];
+		gridList[n] = (BASE_OBJECT *)results[n];
 	}
 	return gridList;
 }
@@ -183,14 +291,24 @@ struct ConditionTrue
 	}
 };
 
+GridList const &gridStartIterate(GridQueryContext &context, int32_t x, int32_t y, uint32_t radius)
+{
+	return gridStartIterateFiltered(*context.impl, x, y, radius, nullptr, ConditionTrue());
+}
+
 GridList const &gridStartIterate(int32_t x, int32_t y, uint32_t radius)
 {
-	return gridStartIterateFiltered(x, y, radius, nullptr, ConditionTrue());
+	return gridStartIterate(*gridDefaultContext, x, y, radius);
+}
+
+GridList const &gridStartIterateArea(GridQueryContext &context, int32_t x, int32_t y, uint32_t x2, uint32_t y2)
+{
+	return gridStartIterateFilteredArea(*context.impl, x, y, x2, y2, ConditionTrue());
 }
 
 GridList const &gridStartIterateArea(int32_t x, int32_t y, uint32_t x2, uint32_t y2)
 {
-	return gridStartIterateFilteredArea(x, y, x2, y2, ConditionTrue());
+	return gridStartIterateArea(*gridDefaultContext, x, y, x2, y2);
 }
 
 struct ConditionDroidsByPlayer
@@ -203,9 +321,14 @@ struct ConditionDroidsByPlayer
 	int player;
 };
 
+GridList const &gridStartIterateDroidsByPlayer(GridQueryContext &context, int32_t x, int32_t y, uint32_t radius, int player)
+{
+	return gridStartIterateFiltered(*context.impl, x, y, radius, &context.impl->filtersDroidsByPlayer[player], ConditionDroidsByPlayer(player));
+}
+
 GridList const &gridStartIterateDroidsByPlayer(int32_t x, int32_t y, uint32_t radius, int player)
 {
-	return gridStartIterateFiltered(x, y, radius, &gridFiltersDroidsByPlayer[player], ConditionDroidsByPlayer(player));
+	return gridStartIterateDroidsByPlayer(*gridDefaultContext, x, y, radius, player);
 }
 
 struct ConditionDroidCandidateForRepair
@@ -225,9 +348,14 @@ struct ConditionDroidCandidateForRepair
 	int player;
 };
 
+GridList const &gridStartIterateRepairCandidates(GridQueryContext &context, int32_t x, int32_t y, uint32_t radius, int player)
+{
+	return gridStartIterateFiltered(*context.impl, x, y, radius, &context.impl->filtersDroidsRepairCandidates[player], ConditionDroidCandidateForRepair(player));
+}
+
 GridList const &gridStartIterateRepairCandidates(int32_t x, int32_t y, uint32_t radius, int player)
 {
-	return gridStartIterateFiltered(x, y, radius, &gridFiltersDroidsRepairCandidates[player], ConditionDroidCandidateForRepair(player));
+	return gridStartIterateRepairCandidates(*gridDefaultContext, x, y, radius, player);
 }
 
 struct ConditionUnseen
@@ -240,15 +368,21 @@ struct ConditionUnseen
 	int player;
 };
 
+GridList const &gridStartIterateUnseen(GridQueryContext &context, int32_t x, int32_t y, uint32_t radius, int player)
+{
+	return gridStartIterateFiltered(*context.impl, x, y, radius, &context.impl->filtersUnseen[player], ConditionUnseen(player));
+}
+
 GridList const &gridStartIterateUnseen(int32_t x, int32_t y, uint32_t radius, int player)
 {
-	return gridStartIterateFiltered(x, y, radius, &gridFiltersUnseen[player], ConditionUnseen(player));
+	return gridStartIterateUnseen(*gridDefaultContext, x, y, radius, player);
 }
 
 BASE_OBJECT **gridIterateDup()
 {
-	size_t bytes = gridPointTree->lastQueryResults.size() * sizeof(void *);
+	PointTree::ResultVector const &results = gridDefaultContext->impl->query.results;
+	size_t bytes = results.size() * sizeof(void *);
 	BASE_OBJECT **ret = (BASE_OBJECT **)malloc(bytes);
-	memcpy(ret, &gridPointTree->lastQueryResults[0], bytes);
+	memcpy(ret, &results[0], bytes);
 	return ret;
 }
@@ -24,11 +24,28 @@
 #ifndef __INCLUDED_SRC_MAPGRID_H__
 #define __INCLUDED_SRC_MAPGRID_H__
 
+#include <memory>
+#include <vector>
+
 typedef std::vector<BASE_OBJECT *> GridList;
 typedef GridList::const_iterator GridIterator;
 
 struct GameWorld;
 
+/// Caller-owned results and filters for grid queries. The grid is only modified by gridReset(), so between
+/// resets any number of threads may query it at once, each through its own context. The functions which don't
+/// take a context all share one, so they must only be used from the main thread.
+struct GridQueryContext
+{
+	GridQueryContext();
+	~GridQueryContext();
+	GridQueryContext(GridQueryContext const &) = delete;
+	GridQueryContext &operator=(GridQueryContext const &) = delete;
+
+	struct Impl;
+	std::unique_ptr<Impl> const impl;
+};
+
 // initialise the grid system
 bool gridInitialise();
 
@@ -55,4 +72,11 @@ GridList const &gridStartIterateRepairCandidates(int32_t x, int32_t y, uint32_t
 /// Find all objects within radius where object->seenThisTick[player] != 255.
 GridList const &gridStartIterateUnseen(int32_t x, int32_t y, uint32_t radius, int player);
 
+/// As above, but with results (valid until the next query through the same context) and filter state in context.
+GridList const &gridStartIterate(GridQueryContext &context, int32_t x, int32_t y, uint32_t radius);
+GridList const &gridStartIterateArea(GridQueryContext &context, int32_t x, int32_t y, uint32_t x2, uint32_t y2);
+GridList const &gridStartIterateDroidsByPlayer(GridQueryContext &context, int32_t x, int32_t y, uint32_t radius, int player);
+GridList const &gridStartIterateRepairCandidates(GridQueryContext &context, int32_t x, int32_t y, uint32_t radius, int player);
+GridList const &gridStartIterateUnseen(GridQueryContext &context, int32_t x, int32_t y, uint32_t radius, int player);
+
 #endif // __INCLUDED_SRC_MAPGRID_H__
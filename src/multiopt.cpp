@@ -350,13 +350,28 @@ bool recvOptions(NETQUEUE queue)
 			return FileRequestResult::DownloadInProgress;  // Downloading the file already
 		}
 
+		// Resume incomplete downloads; the host checks the hash of what we have and starts over if it is not the start of this file, see NETrecvFile()
+		uint32_t offset = 0;
+		Sha256 existingHash;
 		if (!PHYSFS_exists(filename))
 		{
 			debug(LOG_INFO, "Creating new file %s", filename);
 		}
-		else if (findHashOfFile(filename) != hash)
+		else if ((existingHash = findHashOfFile(filename)) != hash)
 		{
-			debug(LOG_INFO, "Overwriting old incomplete or corrupt file %s", filename);
+			const char *realDir = PHYSFS_getRealDir(filename);
+			const char *writeDir = PHYSFS_getWriteDir();
+			PHYSFS_file *pExistingHandle = PHYSFS_openRead(filename);
+			if (realDir != nullptr && writeDir != nullptr && strcmp(realDir, writeDir) == 0 && pExistingHandle != nullptr)
+			{
+				PHYSFS_sint64 existingSize = PHYSFS_fileLength(pExistingHandle);
+				offset = (existingSize > 0 && existingSize <= MAX_NET_TRANSFERRABLE_FILE_SIZE) ? static_cast<uint32_t>(existingSize) : 0;
+			}
+			if (pExistingHandle != nullptr)
+			{
+				PHYSFS_close(pExistingHandle);
+			}
+			debug(LOG_INFO, "Resuming old incomplete or corrupt file %s from byte %" PRIu32, filename, offset);
 		}
 		else
 		{
@@ -364,19 +379,19 @@ bool recvOptions(NETQUEUE queue)
 			return FileRequestResult::FileExists;  // Have the file already.
 		}
 
-		PHYSFS_file *pFileHandle = PHYSFS_openWrite(filename);
+		PHYSFS_file *pFileHandle = offset > 0 ? PHYSFS_openAppend(filename) : PHYSFS_openWrite(filename);
 		if (pFileHandle == nullptr)
 		{
 			debug(LOG_ERROR, "Failed to open %s for writing: %s", filename, WZ_PHYSFS_getLastError());
 			return FileRequestResult::FailedToOpenFileForWriting;
 		}
 
-		NET_addDownloadingWZFile(WZFile(pFileHandle, filename, hash));
+		WZFile file(pFileHandle, filename, hash);
+		file.pos = file.acked = offset;
+		NET_addDownloadingWZFile(std::move(file));
 
 		// Request the map/mod from the host
-		auto w = NETbeginEncode(NETnetQueue(NetPlay.hostPlayer), NET_FILE_REQUESTED);
-		NETbin(w, hash.bytes, hash.Bytes);
-		NETend(w);
+		NETrequestFile(hash, offset, offset > 0 ? existingHash : Sha256());
 
 		return FileRequestResult::StartingDownload;  // Starting download now.
 	};
@@ -2340,15 +2340,22 @@ bool recvMapFileRequested(NETQUEUE queue)
 
 	Sha256 hash;
 	hash.setZero();
+	uint32_t offset = 0;
+	Sha256 prefixHash;
 	auto r = NETbeginDecode(queue, NET_FILE_REQUESTED);
 	NETbin(r, hash.bytes, hash.Bytes);
+	NETuint32_t(r, offset);  // bytes the player has already
+	NETbin(r, prefixHash.bytes, prefixHash.Bytes);  // hash of those bytes
 	NETend(r);
 
 	auto files = NetPlay.players[player].wzFiles;
 	ASSERT_OR_RETURN(false, files != nullptr, "wzFiles is uninitialized?? (Player: %" PRIu32 ")", player);
-	if (std::any_of(files->begin(), files->end(), [&](WZFile const &file) { return file.hash == hash; }))
+	auto sending = std::find_if(files->begin(), files->end(), [&](WZFile const &file) { return file.hash == hash; });
+	if (sending != files->end())
 	{
-		return true;  // Already sending this file, do nothing.
+		// Already sending this file, the player acknowledges what they received.
+		sending->acked = std::max(sending->acked, std::min(offset, sending->pos));
+		return true;
 	}
 
 	netPlayersUpdated = true;  // Show download icon on player.
@@ -2382,10 +2389,9 @@ bool recvMapFileRequested(NETQUEUE queue)
 	}
 
 	// Checking to see if file is available...
-	PHYSFS_file *pFileHandle = PHYSFS_openRead(filename.c_str());
-	if (pFileHandle == nullptr)
+	if (!PHYSFS_exists(filename.c_str()))
 	{
-		debug(LOG_ERROR, "Failed to open %s for reading: %s", filename.c_str(), WZ_PHYSFS_getLastError());
+		debug(LOG_ERROR, "Failed to find %s", filename.c_str());
 		debug(LOG_FATAL, "You have a map (%s) that can't be located.\n\nMake sure it is in the correct directory and or format! (No map packs!)", filename.c_str());
 		// NOTE: if we get here, then the game is basically over, The host can't send the file for whatever reason...
 		// Which also means, that we can't continue.
@@ -2395,15 +2401,29 @@ bool recvMapFileRequested(NETQUEUE queue)
 		abort();
 	}
 
-	PHYSFS_sint64 fileSize_64 = PHYSFS_fileLength(pFileHandle);
-	ASSERT_OR_RETURN(false, fileSize_64 <= 0xFFFFFFFF, "File is too big!");
-	ASSERT_OR_RETURN(false, fileSize_64 >= 0, "Filesize < 0; can't be determined");
-	uint32_t fileSize_u32 = (uint32_t)fileSize_64;
-	ASSERT_OR_RETURN(false, fileSize_u32 <= MAX_NET_TRANSFERRABLE_FILE_SIZE, "Filesize is too large; (size: %" PRIu32")", fileSize_u32);
+	auto contents = NETloadFileToSend(filename, hash);
+	if (contents == nullptr)
+	{
+		return false;
+	}
 
 	// Schedule file to be sent.
 	debug(LOG_INFO, "File is valid, sending [directory: %s] %s to client %u", WZ_PHYSFS_getRealDir_String(filename.c_str()).c_str(), filename.c_str(), player);
-	files->emplace_back(pFileHandle, filename, hash, fileSize_u32);
+	files->emplace_back(std::move(contents), filename, hash);
+	if (offset > 0 && offset < files->back().size)
+	{
+		if (sha256Sum(files->back().contents()->data(), offset) == prefixHash)
+		{
+			// The player has the start of it, from an interrupted download.
+			debug(LOG_INFO, "Resuming from byte %" PRIu32, offset);
+			files->back().pos = files->back().acked = offset;
+		}
+		else
+		{
+			// Whatever the player has under that name isn't the start of this file, so send all of it.
+			debug(LOG_INFO, "Can't resume from byte %" PRIu32 ", the player's partial file doesn't match", offset);
+		}
+	}
 
 	return true;
 }
@@ -2411,22 +2431,6 @@ bool recvMapFileRequested(NETQUEUE queue)
 // Continue sending maps and mods.
 void sendMap()
 {
-	// maximum "budget" in time per call to sendMap
-	// (at 60fps, total frame budget is ~16ms - allocate 4ms max for each call to sendMap)
-	const uint64_t maxMicroSecondsPerSendMapCall = (4 * 1000);
-
-	// calculate the time budget per file
-	uint64_t totalFilesToSend = 0;
-	for (int i = 0; i < MAX_CONNECTED_PLAYERS; ++i)
-	{
-		totalFilesToSend += (NetPlay.players[i].wzFiles) ? NetPlay.players[i].wzFiles->size() : 0;
-	}
-	const uint64_t maxMicroSecondsPerFile = maxMicroSecondsPerSendMapCall / std::max((uint64_t)1, totalFilesToSend);
-
-	using microDuration = std::chrono::duration<uint64_t, std::micro>;
-	auto file_startTime = std::chrono::high_resolution_clock::now();
-	microDuration file_currentDuration;
-
 	for (int i = 0; i < MAX_CONNECTED_PLAYERS; ++i)
 	{
 		auto pFiles = NetPlay.players[i].wzFiles;
@@ -2437,22 +2441,15 @@ void sendMap()
 		auto &files = *pFiles;
 		for (auto &file : files)
 		{
-			int done = 0;
-			file_startTime = std::chrono::high_resolution_clock::now();
-			do
-			{
-				done = NETsendFile(file, i);
-				file_currentDuration = std::chrono::duration_cast<microDuration>(std::chrono::high_resolution_clock::now() - file_startTime);
-			}
-			while (done < 100 && (file_currentDuration.count() < maxMicroSecondsPerFile));
-			if (done == 100)
+			// Only sends what the player has room for, as they acknowledge the previous chunks, so this doesn't take long.
+			if (NETsendFile(file, i) == 100)
 			{
 				netPlayersUpdated = true;  // Remove download icon from player.
 				addConsoleMessage(_("FILE SENT!"), DEFAULT_JUSTIFY, SYSTEM_MESSAGE);
 				debug(LOG_INFO, "=== File has been sent to player %d ===", i);
 			}
 		}
-		files.erase(std::remove_if(files.begin(), files.end(), [](WZFile const &file) { return file.handle() == nullptr; }), files.end());
+		files.erase(std::remove_if(files.begin(), files.end(), [](WZFile const &file) { return file.acked == file.size; }), files.end());
 	}
 }
 
@@ -28,6 +28,7 @@
 #include <list>
 
 #include "lib/framework/frame.h" // MAX_PLAYERS
+#include "lib/framework/object_list.h"
 
 struct BASE_OBJECT;
 struct DROID;
@@ -35,8 +36,9 @@ struct STRUCTURE;
 struct FEATURE;
 struct FLAG_POSITION;
 
+/// Contiguous, stable-iterator lists (see ObjectList), iterated in the same order as the std::list they replaced.
 template <typename ObjectType, unsigned PlayerCount>
-using PerPlayerObjectLists = std::array<std::list<ObjectType*>, PlayerCount>;
+using PerPlayerObjectLists = std::array<ObjectList<ObjectType*>, PlayerCount>;
 
 using PerPlayerDroidLists = PerPlayerObjectLists<DROID, MAX_PLAYERS>;
 using DroidList = typename PerPlayerDroidLists::value_type;
@@ -321,6 +321,29 @@ bool objmemDestroy(BASE_OBJECT *psObj, bool checkRefs)
 }
 
 /* General housekeeping for the object system */
+/* Rewrite any object list whose storage no longer matches its iteration order,
+ * so that the per-tick update passes scan memory linearly. Invalidates iterators! */
+static void compactObjectLists(WorldObjectState& objState)
+{
+	auto compactLists = [](auto& perPlayerLists)
+	{
+		for (auto& list : perPlayerLists)
+		{
+			if (list.fragmented())
+			{
+				list.compact();
+			}
+		}
+	};
+	compactLists(objState.droids);
+	compactLists(objState.structures);
+	compactLists(objState.features);
+	compactLists(objState.flags);
+	compactLists(objState.extractors);
+	compactLists(objState.sensors);
+	compactLists(objState.oils);
+}
+
 void objmemUpdate()
 {
 #ifdef DEBUG
@@ -353,6 +376,10 @@ void objmemUpdate()
 			triggerEventDestroyed(*it++);
 		}
 	}
+
+	// Nothing is iterating the object lists at this point, so restore their memory layout
+	compactObjectLists(gameWorld.objects);
+	compactObjectLists(mission.gameWorld.objects);
 }
 
 uint32_t generateNewObjectId()
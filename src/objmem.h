@@ -117,11 +117,11 @@ void transferFlagPositionToPlayer(WorldObjectState& objState, FLAG_POSITION *psF
 // free all flag positions
 void freeAllFlagPositions(WorldObjectState& objState);
 
-// Find a base object from it's id
-template <typename ObjectType>
-BASE_OBJECT* getBaseObjFromId(const std::list<ObjectType*>& list, unsigned id)
+// Find a base object from it's id, in any list of object pointers (ObjectList, std::list, ...)
+template <typename ListType>
+BASE_OBJECT* getBaseObjFromId(const ListType& list, unsigned id)
 {
-	auto objIt = std::find_if(list.begin(), list.end(), [id](ObjectType* obj)
+	auto objIt = std::find_if(list.begin(), list.end(), [id](const typename ListType::value_type& obj)
 	{
 		return obj->id == id;
 	});
@@ -97,6 +97,16 @@ void PointTree::sort()
 	std::stable_sort(points.begin(), points.end(), pointTreeSortFunction);  // Stable sort to avoid unspecified behaviour when two objects are in exactly the same place.
 }
 
+void PointTree::assignSorted(Vector &sortedPoints)
+{
+	points.swap(sortedPoints);
+}
+
+uint64_t PointTree::positionKey(int32_t x, int32_t y)
+{
+	return interleave(x, y);
+}
+
 //#define DUMP_IMAGE  // All x and y coordinates must be in range -500 to 499, if dumping an image.
 #ifdef DUMP_IMAGE
 #include <math.h>
@@ -129,7 +139,7 @@ static unsigned current(std::vector<unsigned> &filterData, unsigned i)
 }
 
 template<bool IsFiltered>
-PointTree::ResultVector &PointTree::queryMaybeFilter(Filter &filter, int32_t minXo, int32_t minYo, int32_t maxXo, int32_t maxYo)
+PointTree::ResultVector &PointTree::queryMaybeFilter(QueryContext &context, Filter &filter, int32_t minXo, int32_t minYo, int32_t maxXo, int32_t maxYo) const
 {
 	uint64_t minX = expandX(minXo);
 	uint64_t maxX = expandX(maxXo);
@@ -225,10 +235,11 @@ PointTree::ResultVector &PointTree::queryMaybeFilter(Filter &filter, int32_t min
 		--numRanges;
 	}
 
-	lastQueryResults.clear();
+	ResultVector &results = context.results;
+	results.clear();
 	if (IsFiltered)
 	{
-		lastFilteredQueryIndices.clear();
+		context.filteredIndices.clear();
 	}
 	for (int r = 0; r != numRanges; ++r)
 	{
@@ -242,10 +253,10 @@ PointTree::ResultVector &PointTree::queryMaybeFilter(Filter &filter, int32_t min
 			uint64_t py = points[i].first & 0x5555555555555555ULL;
 			if (px >= minX && px <= maxX && py >= minY && py <= maxY)  // Only add point if it's at least in the desired square.
 			{
-				lastQueryResults.push_back(points[i].second);
+				results.push_back(points[i].second);
 				if (IsFiltered)
 				{
-					lastFilteredQueryIndices.push_back(i);
+					context.filteredIndices.push_back(i);
 				}
 #ifdef DUMP_IMAGE
 				if (doDump)
@@ -267,30 +278,45 @@ PointTree::ResultVector &PointTree::queryMaybeFilter(Filter &filter, int32_t min
 	}
 #endif //DUMP_IMAGE
 
-	return lastQueryResults;
+	return results;
 }
 
-PointTree::ResultVector &PointTree::query(int32_t x, int32_t y, uint32_t x2, uint32_t y2)
+PointTree::ResultVector &PointTree::query(QueryContext &context, int32_t x, int32_t y, uint32_t x2, uint32_t y2) const
 {
 	Filter unused;
-	return queryMaybeFilter<false>(unused, x, y, x2, y2);
+	return queryMaybeFilter<false>(context, unused, x, y, x2, y2);
 }
 
-PointTree::ResultVector &PointTree::query(int32_t x, int32_t y, uint32_t radius)
+PointTree::ResultVector &PointTree::query(QueryContext &context, int32_t x, int32_t y, uint32_t radius) const
 {
 	Filter unused;
 	int32_t minXo = x - radius;
 	int32_t maxXo = x + radius;
 	int32_t minYo = y - radius;
 	int32_t maxYo = y + radius;
-	return queryMaybeFilter<false>(unused, minXo, minYo, maxXo, maxYo);
+	return queryMaybeFilter<false>(context, unused, minXo, minYo, maxXo, maxYo);
 }
 
-PointTree::ResultVector &PointTree::query(Filter &filter, int32_t x, int32_t y, uint32_t radius)
+PointTree::ResultVector &PointTree::query(QueryContext &context, Filter &filter, int32_t x, int32_t y, uint32_t radius) const
 {
 	int32_t minXo = x - radius;
 	int32_t maxXo = x + radius;
 	int32_t minYo = y - radius;
 	int32_t maxYo = y + radius;
-	return queryMaybeFilter<true>(filter, minXo, minYo, maxXo, maxYo);
+	return queryMaybeFilter<true>(context, filter, minXo, minYo, maxXo, maxYo);
+}
+
+PointTree::ResultVector &PointTree::query(int32_t x, int32_t y, uint32_t x2, uint32_t y2)
+{
+	return query(lastQuery, x, y, x2, y2);
+}
+
+PointTree::ResultVector &PointTree::query(int32_t x, int32_t y, uint32_t radius)
+{
+	return query(lastQuery, x, y, radius);
+}
+
+PointTree::ResultVector &PointTree::query(Filter &filter, int32_t x, int32_t y, uint32_t radius)
+{
+	return query(lastQuery, filter, x, y, radius);
 }
@@ -30,6 +30,8 @@ class PointTree
 public:
 	typedef std::vector<void *> ResultVector;
 	typedef std::vector<unsigned> IndexVector;
+	typedef std::pair<uint64_t, void *> Point;
+	typedef std::vector<Point> Vector;
 	class Filter  ///< Filters are invalidated when modifying the PointTree.
 	{
 	public:
@@ -55,26 +57,38 @@ public:
 	void insert(void *pointData, int32_t x, int32_t y);                       ///< Inserts a point into the point tree.
 	void clear();                                                             ///< Clears the PointTree.
 	void sort();                                                              ///< Must be done between inserting and querying, to get meaningful results.
+	/// Replaces all points by sortedPoints, which must already be in the order sort() would give, and hands back the old points for reuse.
+	void assignSorted(Vector &sortedPoints);
+	static uint64_t positionKey(int32_t x, int32_t y);                        ///< The value points are sorted by, for a point at (x, y).
+	/// Where query results go. Queries only read the PointTree itself, so any number of threads may query
+	/// it at once, each with its own QueryContext (and Filters), as long as nothing modifies the PointTree.
+	struct QueryContext
+	{
+		ResultVector results;
+		IndexVector filteredIndices;                                          ///< Index of each result, for Filter::erase(). Only set by filtered queries.
+	};
+
 	/// Returns all points less than or equal to radius from (x, y), possibly plus some extra nearby points.
 	/// (More specifically, returns all objects in a square with edge length 2*radius.)
-	/// Note: Not thread safe, because it modifies lastQueryResults.
-	ResultVector &query(int32_t x, int32_t y, uint32_t radius);
+	ResultVector &query(QueryContext &context, int32_t x, int32_t y, uint32_t radius) const;
 	/// Returns all points which have not been filtered away, less than or equal to radius from (x, y), possibly plus some extra nearby points.
 	/// (More specifically, returns objects in a square with edge length 2*radius.)
-	/// Note: Not thread safe, because it modifies lastQueryResults, lastFilteredQueryIndices and the internal filter representation for faster lookups.
+	/// Note: Modifies the filter's internal representation for faster lookups, so a filter must not be shared between threads.
+	ResultVector &query(QueryContext &context, Filter &filter, int32_t x, int32_t y, uint32_t radius) const;
+	/// Returns all points within given rectangle.
+	ResultVector &query(QueryContext &context, int32_t x, int32_t y, uint32_t x2, uint32_t y2) const;
+
+	/// As above, but into lastQuery.
+	/// Note: Not thread safe, because it modifies lastQuery.
+	ResultVector &query(int32_t x, int32_t y, uint32_t radius);
 	ResultVector &query(Filter &filter, int32_t x, int32_t y, uint32_t radius);
-	/// Returns all points which have not been filtered away within given rectangle. See function above on thread safety.
 	ResultVector &query(int32_t x, int32_t y, uint32_t x2, uint32_t y2);
 
-	ResultVector lastQueryResults;
-	IndexVector lastFilteredQueryIndices;
+	QueryContext lastQuery;
 
 private:
-	typedef std::pair<uint64_t, void *> Point;
-	typedef std::vector<Point> Vector;
-
 	template<bool IsFiltered>
-	ResultVector &queryMaybeFilter(Filter &filter, int32_t minXo, int32_t maxXo, int32_t minYo, int32_t maxYo);
+	ResultVector &queryMaybeFilter(QueryContext &context, Filter &filter, int32_t minXo, int32_t maxXo, int32_t minYo, int32_t maxYo) const;
 
 	Vector points;
 };
@@ -198,6 +198,32 @@ void mark(const Domain *domain, const char *object, const char *mark)
 	#endif
 }
 
+void counter(const Domain *domain, const char *name, double value)
+{
+	if (!domain || !name)
+		return;
+
+	#ifdef WZ_PROFILING_NVTX
+	{
+		nvtxEventAttributes_t eventAttrib = {};
+		eventAttrib.version = NVTX_VERSION;
+		eventAttrib.size = NVTX_EVENT_ATTRIB_STRUCT_SIZE;
+		eventAttrib.messageType = NVTX_MESSAGE_TYPE_ASCII;
+		eventAttrib.message.ascii = name;
+		eventAttrib.payloadType = NVTX_PAYLOAD_TYPE_DOUBLE;
+		eventAttrib.payload.dValue = value;
+		auto nvtxDomain = domain ? domain->getInternal()->nvtxDomain : nullptr;
+		nvtxDomainMarkEx(nvtxDomain, &eventAttrib);
+	}
+	#endif
+	#ifdef WZ_PROFILING_VTUNE
+	{
+		__itt_counter counter = __itt_counter_create_typed(name, domain->getInternal()->name.c_str(), __itt_metadata_double);
+		__itt_counter_set_value(counter, &value);
+	}
+	#endif
+}
+
 }
 
 #endif // defined(WZ_PROFILING_INSTRUMENTATION)
@@ -70,15 +70,19 @@ extern Domain wzRootDomain;
 
 void mark(const Domain *domain, const char *mark);
 void mark(const Domain *domain, const char *object, const char *mark);
+/// Record the current value of a named counter, such as the utilization of a worker thread.
+void counter(const Domain *domain, const char *name, double value);
 
 }
 
 #define WZ_PROFILE_SCOPE(name) profiling::Scope mark_##name(&profiling::wzRootDomain, #name);
 #define WZ_PROFILE_SCOPE2(object, name) profiling::Scope mark_##name(&profiling::wzRootDomain, #object, #name);
+#define WZ_PROFILE_COUNTER(name, value) profiling::counter(&profiling::wzRootDomain, name, value);
 
 #else // !defined(WZ_PROFILING_INSTRUMENTATION)
 
 #define WZ_PROFILE_SCOPE(name)
 #define WZ_PROFILE_SCOPE2(object, name)
+#define WZ_PROFILE_COUNTER(name, value)
 
 #endif // defined(WZ_PROFILING_INSTRUMENTATION)
@@ -37,6 +37,7 @@
 #include "lib/netplay/connection_provider_registry.h"
 #include "lib/netplay/error_categories.h"
 #include "lib/netplay/netlobby.h"
+#include "lib/netplay/wz_compression_provider.h"
 
 #include "../hci.h"
 #include "../activity.h"
@@ -903,7 +904,8 @@ private:
 	NetQueuePair *tmpJoiningQueuePair = nullptr;
 	char initialAckBuffer[10] = {'\0'};
 	size_t usedInitialAckBuffer = 0;
-	const size_t expectedInitialAckSize = sizeof(uint32_t);
+	const size_t expectedInitialAckResultSize = sizeof(uint32_t);
+	const size_t expectedInitialAckSize = expectedInitialAckResultSize + sizeof(uint8_t); // result, then (if no error) the compression algorithm
 
 	std::chrono::steady_clock::time_point timeStarted;
 	const std::chrono::milliseconds minimumTimeBeforeAutoClose = std::chrono::milliseconds(300);
@@ -1731,8 +1733,9 @@ void WzJoiningGameScreen_HandlerRoot::processOpenConnectionResult(size_t connect
 		client_transient_socket->useNagleAlgorithm(false);
 	}
 
-	// Send initial connection data: NETCODE_VERSION_MAJOR and NETCODE_VERSION_MINOR
-	char buffer[sizeof(int32_t) * 2] = { 0 };
+	// Send initial connection data: NETCODE_VERSION_MAJOR and NETCODE_VERSION_MINOR, then the compression
+	// algorithms we support and our zstd dictionary ID, for the host to choose one
+	char buffer[sizeof(int32_t) * 2 + sizeof(uint8_t) + sizeof(uint32_t)] = { 0 };
 	char *p_buffer = buffer;
 	auto pushu32 = [&](uint32_t value) {
 		uint32_t swapped = wz_htonl(value);
@@ -1741,6 +1744,8 @@ void WzJoiningGameScreen_HandlerRoot::processOpenConnectionResult(size_t connect
 	};
 	pushu32(NETGetMajorVersion());
 	pushu32(NETGetMinorVersion());
+	*p_buffer++ = static_cast<char>(WzCompressionProvider::Instance().supportedAlgorithms());
+	pushu32(WzCompressionProvider::Instance().dictionaryId());
 
 	const auto writeResult = client_transient_socket->writeAll(buffer, sizeof(buffer), nullptr);
 	if (!writeResult.has_value())
@@ -1968,15 +1973,17 @@ void WzJoiningGameScreen_HandlerRoot::processJoining()
 			}
 
 			char *p_buffer = initialAckBuffer;
+			// Only read past the result once it's known: a host which rejects us sends nothing more.
+			const size_t wantedAckSize = usedInitialAckBuffer < expectedInitialAckResultSize ? expectedInitialAckResultSize : expectedInitialAckSize;
 			const auto readResult = client_transient_socket->readNoInt(p_buffer + usedInitialAckBuffer,
-				expectedInitialAckSize - usedInitialAckBuffer,
+				wantedAckSize - usedInitialAckBuffer,
 				nullptr);
 			if (readResult.has_value())
 			{
 				usedInitialAckBuffer += static_cast<size_t>(readResult.value());
 			}
 
-			if (usedInitialAckBuffer >= expectedInitialAckSize)
+			if (usedInitialAckBuffer >= expectedInitialAckResultSize)
 			{
 				uint32_t result = ERROR_CONNECTION;
 				memcpy(&result, initialAckBuffer, sizeof(result));
@@ -2001,8 +2008,21 @@ void WzJoiningGameScreen_HandlerRoot::processJoining()
 					return;
 				}
 
+				if (usedInitialAckBuffer < expectedInitialAckSize)
+				{
+					return; // wait for the compression algorithm
+				}
+				const auto algorithm = static_cast<CompressionAlgorithm>(initialAckBuffer[expectedInitialAckResultSize]);
+				if (!WzCompressionProvider::Instance().supportsAlgorithm(algorithm))
+				{
+					debug(LOG_ERROR, "Host chose unsupported compression algorithm %u", static_cast<unsigned>(algorithm));
+					closeConnectionAttempt();
+					handleFailure(FailureDetails::makeFromLobbyError(ERROR_CONNECTION));
+					return;
+				}
+
 				// transition to net message mode (enable compression, wait for messages)
-				client_transient_socket->enableCompression();
+				client_transient_socket->enableCompression(algorithm);
 				currentJoiningState = JoiningState::ProcessingJoinMessages;
 				// permit fall-through to currentJoiningState == JoiningState::ProcessingJoinMessage case below
 			}
@@ -4865,8 +4865,9 @@ bool destroyStruct(STRUCTURE *psDel, unsigned impactTime, GameWorld& world)
 				MAPTILE *psTile = mapTile(world.map, b.map.x + width, b.map.y + breadth);
 				if (TEST_TILE_VISIBLE_TO_SELECTEDPLAYER(psTile))
 				{
-					psTile->illumination /= 2;
-					psTile->ambientOcclusion /= 2;
+					MAPTILE_DISPLAY *psDisplay = mapTileDisplay(world.map, psTile);
+					psDisplay->illumination /= 2;
+					psDisplay->ambientOcclusion /= 2;
 				}
 			}
 		}
@@ -38,6 +38,7 @@
 #include "lib/framework/opengl.h"
 #include "lib/framework/physfs_ext.h"
 #include "lib/framework/resource_loading_controller.h"
+#include "lib/framework/task_scheduler.h"
 #include "resource_loading_dispatch.h"
 #include "lib/framework/wzapp.h"
 #include "lib/ivis_opengl/ivisdef.h"
@@ -192,10 +193,11 @@ static std::vector<gfx_api::TerrainDecalVertex> terrainDecalVertexUpdateBuffer;
 #define BUFFER_OFFSET(i) (reinterpret_cast<char *>(i))
 
 /// Helper variables for the draw-elements batching functions
-static GLuint batchedIndexOffset;
-static GLsizei batchedIndexCount;
+/// (per thread, as shadow cascades may be recorded on several threads at once)
+static thread_local GLuint batchedIndexOffset;
+static thread_local GLsizei batchedIndexCount;
 /// Are we accumulating a draw-elements batch?
-static bool drawElementsBatchActive = false;
+static thread_local bool drawElementsBatchActive = false;
 
 TerrainShaderQuality terrainShaderQuality = TerrainShaderQuality::UNINITIALIZED_PICK_DEFAULT;
 bool initializedTerrainShaderType = false;
@@ -507,7 +509,7 @@ static TileDecalInfo getTileDecalInfo(WorldMapState& mapState, int i, int j)
 	static const int dxdy[4][2] = {{0,0}, {0,1}, {1,1}, {1,0}};
 	for (int k = 0; k < 4; k++)
 	{
-		groundsBytes[k] = mapTile(mapState, i + dxdy[k][0], j + dxdy[k][1])->ground;
+		groundsBytes[k] = mapTileDisplay(mapState, i + dxdy[k][0], j + dxdy[k][1])->ground;
 	}
 	PIELIGHT grounds;
 	grounds.fromRGBA(groundsBytes[0], groundsBytes[1], groundsBytes[2], groundsBytes[3]);
@@ -685,64 +687,123 @@ static void setSectorDecalVertex_SinglePass(WorldMapState& mapState, int x, int
 	}
 }
 
+/// Upload the parts of `staging` for a list of sectors, sorted by sector index. A sector's vertices are
+/// `sectorSize(sector)` elements starting at `sectorOffset(sector)` in the VBO, and sectors are laid out in the VBO
+/// by sector index, so each run of consecutive sectors is one contiguous range of both, sent with one update().
+template<typename Vertex, typename OffsetFn, typename SizeFn>
+static void uploadSectorRanges(gfx_api::buffer& vbo, const std::vector<int>& sectorIndices, const std::vector<Vertex>& staging,
+							   OffsetFn sectorOffset, SizeFn sectorSize)
+{
+	size_t stagingPos = 0;
+	for (size_t run = 0; run < sectorIndices.size();)
+	{
+		const int firstSector = sectorIndices[run];
+		size_t runSize = 0;
+		size_t end = run;
+		while (end < sectorIndices.size() && sectorIndices[end] == firstSector + static_cast<int>(end - run))
+		{
+			runSize += sectorSize(sectorIndices[end]);
+			++end;
+		}
+		if (runSize > 0)
+		{
+			vbo.update(sizeof(Vertex) * sectorOffset(firstSector), sizeof(Vertex) * runSize, staging.data() + stagingPos,
+					   gfx_api::buffer::update_flag::non_overlapping_updates_promise);
+		}
+		stagingPos += runSize;
+		run = end;
+	}
+}
+
+/// Staging for updateSectorsGeometry(), reused between frames to avoid repeated allocations
+static std::vector<TerrainVertex> geometryUpdateBuffer;
+static std::vector<WaterVertex> waterUpdateBuffer;
+
 /**
- * Update the sector for when the terrain is changed.
+ * Update the sectors (indices into `sectors`, sorted) for when the terrain is changed.
+ * The vertices of each sector are built in parallel, then uploaded in as few sub-range updates as possible.
  */
-static void updateSectorGeometry(WorldMapState& mapState, int x, int y)
+static void updateSectorsGeometry(WorldMapState& mapState, const std::vector<int>& sectorIndices)
 {
-	TerrainVertex *geometry;
-	WaterVertex *water;
-	int geometrySize = 0;
-	int waterSize = 0;
+	if (sectorIndices.empty())
+	{
+		return;
+	}
+
+	// Where each sector's vertices go in the staging buffers
+	std::vector<size_t> geometryStart(sectorIndices.size() + 1, 0);
+	std::vector<size_t> waterStart(sectorIndices.size() + 1, 0);
+	std::vector<size_t> terrainDecalStart(sectorIndices.size() + 1, 0);
+	for (size_t i = 0; i < sectorIndices.size(); ++i)
+	{
+		const Sector& sector = sectors[sectorIndices[i]];
+		geometryStart[i + 1] = geometryStart[i] + sector.geometrySize;
+		waterStart[i + 1] = waterStart[i] + sector.waterSize;
+		terrainDecalStart[i + 1] = terrainDecalStart[i] + sector.terrainAndDecalSize;
+	}
+	geometryUpdateBuffer.resize(geometryStart.back());
+	waterUpdateBuffer.resize(waterStart.back());
+	terrainDecalVertexUpdateBuffer.resize(terrainDecalStart.back());
 
 	if (terrainSubdivision > 1)
 	{
 		// refresh the per-corner surface caches before re-evaluating the surface:
-		// a corner's cached values depend on its +-1 neighbors, so expand the sector's corner
-		// rect by 1 (markTileDirty's widening guarantees every affected sector gets here)
-		terrainSurface::rebuildSurfaceCachesRegion(mapState, x * sectorSize - 1, y * sectorSize - 1,
-													(x + 1) * sectorSize + 1, (y + 1) * sectorSize + 1);
+		// a corner's cached values depend on its +-1 neighbors, so expand each sector's corner
+		// rect by 1 (markTileDirty's widening guarantees every affected sector gets here).
+		// Done for all sectors first, since neighbouring rects overlap; the caches are only read below.
+		for (int sectorIndex : sectorIndices)
+		{
+			const int x = sectorIndex / ySectors;
+			const int y = sectorIndex % ySectors;
+			terrainSurface::rebuildSurfaceCachesRegion(mapState, x * sectorSize - 1, y * sectorSize - 1,
+														(x + 1) * sectorSize + 1, (y + 1) * sectorSize + 1);
+		}
 	}
 
-	geometry = new TerrainVertex[sectors[x * ySectors + y].geometrySize];
-	water = (WaterVertex *)malloc(sizeof(WaterVertex) * sectors[x * ySectors + y].waterSize);
+	// Each sector only reads the map and the surface caches, and writes its own part of the staging buffers
+	wzTaskParallelFor(sectorIndices.size(), [&](size_t i) {
+		const int x = sectorIndices[i] / ySectors;
+		const int y = sectorIndices[i] % ySectors;
+		const Sector& sector = sectors[sectorIndices[i]];
 
-	setSectorGeometry(mapState, x, y, geometry, water, &geometrySize, &waterSize);
-	ASSERT(geometrySize == sectors[x * ySectors + y].geometrySize, "something went seriously wrong updating the terrain");
-	ASSERT(waterSize    == sectors[x * ySectors + y].waterSize   , "something went seriously wrong updating the terrain");
+		int geometrySize = 0;
+		int waterSize = 0;
+		setSectorGeometry(mapState, x, y, geometryUpdateBuffer.data() + geometryStart[i], waterUpdateBuffer.data() + waterStart[i],
+						  &geometrySize, &waterSize);
+		ASSERT(geometrySize == sector.geometrySize, "something went seriously wrong updating the terrain");
+		ASSERT(waterSize    == sector.waterSize   , "something went seriously wrong updating the terrain");
+
+		int terrainDecalSize = 0;
+		setSectorDecalVertex_SinglePass(mapState, x, y, terrainDecalVertexUpdateBuffer.data() + terrainDecalStart[i], &terrainDecalSize);
+		ASSERT(terrainDecalSize == sector.terrainAndDecalSize, "Sizes don't match!");
+	});
 
 	if (geometryVBO) // absent under HardwareTess (the shadow pass draws tessellated patches and the color pass writes depth)
 	{
-		geometryVBO->update(sizeof(TerrainVertex)*sectors[x * ySectors + y].geometryOffset,
-								sizeof(TerrainVertex)*sectors[x * ySectors + y].geometrySize, geometry,
-								gfx_api::buffer::update_flag::non_overlapping_updates_promise);
+		uploadSectorRanges(*geometryVBO, sectorIndices, geometryUpdateBuffer,
+						   [](int sector) { return sectors[sector].geometryOffset; }, [](int sector) { return sectors[sector].geometrySize; });
 	}
-	waterVBO->update(sizeof(WaterVertex)*sectors[x * ySectors + y].waterOffset,
-					 sizeof(WaterVertex)*sectors[x * ySectors + y].waterSize, water,
-					 gfx_api::buffer::update_flag::non_overlapping_updates_promise);
-
-	delete[] geometry;
-	free(water);
+	uploadSectorRanges(*waterVBO, sectorIndices, waterUpdateBuffer,
+					   [](int sector) { return sectors[sector].waterOffset; }, [](int sector) { return sectors[sector].waterSize; });
+	uploadSectorRanges(*terrainDecalVBO, sectorIndices, terrainDecalVertexUpdateBuffer,
+					   [](int sector) { return sectors[sector].terrainAndDecalOffset; }, [](int sector) { return sectors[sector].terrainAndDecalSize; });
 
 	if (terrainMeshStrategy == TerrainMeshStrategy::HardwareTess)
 	{
 		// the tessellated surface comes from the baked field textures
-		terrainBake::rebakeTileRegion(mapState, x * sectorSize, y * sectorSize,
-									  x * sectorSize + sectorSize - 1, y * sectorSize + sectorSize - 1);
+		for (int sectorIndex : sectorIndices)
+		{
+			const int x = sectorIndex / ySectors;
+			const int y = sectorIndex % ySectors;
+			terrainBake::rebakeTileRegion(mapState, x * sectorSize, y * sectorSize,
+										  x * sectorSize + sectorSize - 1, y * sectorSize + sectorSize - 1);
+		}
 	}
-
-	terrainDecalVertexUpdateBuffer.resize(sectors[x * ySectors + y].terrainAndDecalSize); // reuse a buffer to avoid repeated allocations if possible
-	int terrainDecalSize = 0;
-	setSectorDecalVertex_SinglePass(mapState, x, y, terrainDecalVertexUpdateBuffer.data(), &terrainDecalSize);
-	ASSERT(terrainDecalSize == sectors[x * ySectors + y].terrainAndDecalSize, "Sizes don't match!");
-	terrainDecalVBO->update(sizeof(gfx_api::TerrainDecalVertex)*sectors[x * ySectors + y].terrainAndDecalOffset,
-						 sizeof(gfx_api::TerrainDecalVertex)*sectors[x * ySectors + y].terrainAndDecalSize, terrainDecalVertexUpdateBuffer.data(),
-						 gfx_api::buffer::update_flag::non_overlapping_updates_promise);
 }
 
 /**
  * Mark all tiles that are influenced by this grid point as dirty.
- * Dirty sectors will later get updated by updateSectorGeometry.
+ * Dirty sectors will later get updated by updateSectorsGeometry.
  */
 void markTileDirty(int i, int j)
 {
@@ -1704,7 +1765,7 @@ static void updateLightMap(WorldMapState& mapState, const LightMap& lightmap)
 		{
 			MAPTILE *psTile = mapTile(mapState, i, j);
 			PIELIGHT colour = lightmap(i, j);
-			UBYTE level = static_cast<UBYTE>(psTile->level);
+			UBYTE level = static_cast<UBYTE>(mapTileDisplay(mapState, i, j)->level);
 
 			if (psTile->tileInfoBits & BITS_GATEWAY && showGateways)
 			{
@@ -1777,6 +1838,8 @@ static void cullTerrain(WorldMapState& mapState)
 {
 	const float maxDistance = static_cast<float>(world_coord(terrainDistance));
 	const float maxDistanceSquared = maxDistance * maxDistance;
+	static std::vector<int> dirtySectors;  // reused between frames
+	dirtySectors.clear();
 
 	for (int x = 0; x < xSectors; x++)
 	{
@@ -1797,12 +1860,13 @@ static void cullTerrain(WorldMapState& mapState)
 				sectors[x * ySectors + y].draw = true;
 				if (sectors[x * ySectors + y].dirty)
 				{
-					updateSectorGeometry(mapState, x, y);
+					dirtySectors.push_back(x * ySectors + y);
 					sectors[x * ySectors + y].dirty = false;
 				}
 			}
 		}
 	}
+	updateSectorsGeometry(mapState, dirtySectors);
 }
 
 /// Near-camera tessellation level for the Terrain Detail setting
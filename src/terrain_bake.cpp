@@ -37,6 +37,7 @@
 #include "lib/framework/frame.h"
 #include "lib/framework/math_ext.h"
 #include "lib/framework/wzapp.h"
+#include "lib/framework/task_scheduler.h"
 #include "lib/ivis_opengl/gfx_api.h"
 #include "lib/ivis_opengl/pietypes.h"
 
@@ -212,36 +213,19 @@ bool terrainBake::bakeFields(WorldMapState& mapState)
 	// identical results to a single-threaded bake (see bakeTexelRect).
 	// Keep bands a few times taller than the normal-sampling radius so the
 	// band-border fallback path stays a small fraction of the work.
-	const size_t numBands = std::max<size_t>(1, std::min<size_t>({ wzGetLogicalCPUCount(), 16, static_cast<size_t>(bakedTexHeight / 64) }));
+	const size_t numBands = std::max<size_t>(1, std::min<size_t>({ wzTaskSchedulerThreadCount() + 1, 16, static_cast<size_t>(bakedTexHeight / 64) }));
 	uint16_t* heightOut = reinterpret_cast<uint16_t*>(heightImg.dataWritable());
 	uint16_t* offsetOut = reinterpret_cast<uint16_t*>(offsetImg.dataWritable());
 	unsigned char* normalOut = normalImg.dataWritable();
-	std::vector<wz::thread> workers;
-	workers.reserve(numBands - 1);
-	int bandY0 = 0;
-	for (size_t band = 0; band < numBands; band++)
-	{
-		const int bandY1 = (band + 1 == numBands) ? (bakedTexHeight - 1) : static_cast<int>(static_cast<size_t>(bakedTexHeight) * (band + 1) / numBands - 1);
-		uint16_t* bandHeight = &heightOut[static_cast<size_t>(bandY0) * bakedTexWidth];
-		uint16_t* bandOffset = &offsetOut[static_cast<size_t>(bandY0) * bakedTexWidth * 2];
-		unsigned char* bandNormal = &normalOut[static_cast<size_t>(bandY0) * bakedTexWidth * 2];
-		if (band + 1 == numBands)
-		{
-			// the main thread bakes the last band itself
-			bakeTexelRect(mapState, bandHeight, bandOffset, bandNormal, bakedTexWidth, 0, bandY0, bakedTexWidth - 1, bandY1);
-		}
-		else
-		{
-			workers.emplace_back([&mapState, bandHeight, bandOffset, bandNormal, bandY0, bandY1]() {
-				bakeTexelRect(mapState, bandHeight, bandOffset, bandNormal, static_cast<size_t>(bakedTexWidth), 0, bandY0, bakedTexWidth - 1, bandY1);
-			});
-		}
-		bandY0 = bandY1 + 1;
-	}
-	for (auto& worker : workers)
-	{
-		worker.join();
-	}
+	auto bandStart = [&](size_t band) {
+		return static_cast<int>(static_cast<size_t>(bakedTexHeight) * band / numBands);
+	};
+	wzTaskParallelFor(numBands, [&](size_t band) {
+		const int bandY0 = bandStart(band);
+		const int bandY1 = (band + 1 == numBands) ? (bakedTexHeight - 1) : bandStart(band + 1) - 1;
+		bakeTexelRect(mapState, &heightOut[static_cast<size_t>(bandY0) * bakedTexWidth], &offsetOut[static_cast<size_t>(bandY0) * bakedTexWidth * 2],
+		              &normalOut[static_cast<size_t>(bandY0) * bakedTexWidth * 2], static_cast<size_t>(bakedTexWidth), 0, bandY0, bakedTexWidth - 1, bandY1);
+	});
 
 	delete heightTex;
 	delete offsetTex;
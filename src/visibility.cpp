@@ -24,12 +24,14 @@
  */
 #include "lib/framework/frame.h"
 #include "lib/framework/fixedpoint.h"
+#include "lib/framework/task_scheduler.h"
 
 #include "lib/gamelib/gtime.h"
 #include "lib/sound/audio.h"
 #include "lib/sound/audio_id.h"
 #include "lib/ivis_opengl/ivisdef.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "visibility.h"
@@ -49,6 +51,7 @@
 #include "qtscript.h"
 #include "wavecast.h"
 #include "profiling.h"
+#include "pointtree.h"
 
 // accuracy for the height gradient
 #define GRAD_MUL 10000
@@ -60,6 +63,9 @@ static const int VIS_LEVEL_DEC = 50;
 // integer amount to change visibility this turn
 static SDWORD			visLevelInc, visLevelDec;
 
+// objects per task in the self and level passes
+#define VIS_CHUNK_SIZE 256
+
 class SPOTTER
 {
 public:
@@ -118,10 +124,10 @@ void visUpdateLevel()
 	visLevelDec = gameTimeAdjustedAverage(VIS_LEVEL_DEC);
 }
 
-static inline void updateTileVis(MAPTILE *psTile, int player)
+static inline void updateTileVis(WorldMapState& mapState, MAPTILE *psTile, size_t tileIndex, int player)
 {
 	/// The definition of whether a player can see something on a given tile or not
-	if (psTile->watchers[player] > 0 || (psTile->sensors[player] > 0 && !(psTile->jammerBits & ~alliancebits[player])))
+	if (mapState.watchers[player][tileIndex] > 0 || (mapState.sensors[player][tileIndex] > 0 && !(psTile->jammerBits & ~alliancebits[player])))
 	{
 		psTile->sensorBits |= (1 << player);         // mark it as being seen
 	}
@@ -147,13 +153,14 @@ static void spotterWatchAndRegister(SPOTTER *psSpot, WorldMapState& mapState, in
 			continue;
 		}
 		MAPTILE *psTile = mapTile(mapState, mapX, mapY);
+		const size_t tileIndex = mapTileIndex(mapState, psTile);
 		psTile->tileExploredBits |= alliancebits[player];
-		uint16_t *visionType = (!radar) ? psTile->watchers : psTile->sensors;
-		if (visionType[player] < UINT16_MAX)
+		uint16_t *visionType = (!radar) ? mapState.watchers[player].get() : mapState.sensors[player].get();
+		if (visionType[tileIndex] < UINT16_MAX)
 		{
 			TILEPOS tilePos = {uint8_t(mapX), uint8_t(mapY), uint8_t(radar)};
-			visionType[player]++;          // we observe this tile
-			updateTileVis(psTile, player);
+			visionType[tileIndex]++;          // we observe this tile
+			updateTileVis(mapState, psTile, tileIndex, player);
 			psSpot->watchedTiles[psSpot->numWatchedTiles++] = tilePos;    // record having seen it
 		}
 	}
@@ -243,10 +250,11 @@ SPOTTER::~SPOTTER()
 	{
 		const TILEPOS tilePos = watchedTiles[i];
 		MAPTILE *psTile = mapTile(mapState, tilePos.x, tilePos.y);
-		uint16_t *visionType = (tilePos.type == 0) ? psTile->watchers : psTile->sensors;
-		ASSERT(visionType[player] > 0, "Not watching watched tile (%d, %d)", (int)tilePos.x, (int)tilePos.y);
-		visionType[player]--;
-		updateTileVis(psTile, player);
+		const size_t tileIndex = mapTileIndex(mapState, psTile);
+		uint16_t *visionType = (tilePos.type == 0) ? mapState.watchers[player].get() : mapState.sensors[player].get();
+		ASSERT(visionType[tileIndex] > 0, "Not watching watched tile (%d, %d)", (int)tilePos.x, (int)tilePos.y);
+		visionType[tileIndex]--;
+		updateTileVis(mapState, psTile, tileIndex, player);
 	}
 	free(watchedTiles);
 }
@@ -254,26 +262,27 @@ SPOTTER::~SPOTTER()
 /* Record all tiles that some object confers visibility to. Only record each tile
  * once. Note that there is both a limit to how many objects can watch any given
  * tile. Strange but non fatal things will happen if these limits are exceeded. */
-static inline void visMarkTile(const BASE_OBJECT *psObj, int mapX, int mapY, MAPTILE *psTile, std::vector<TILEPOS> &watchedTiles)
+static inline void visMarkTile(WorldMapState& mapState, const BASE_OBJECT *psObj, int mapX, int mapY, MAPTILE *psTile, std::vector<TILEPOS> &watchedTiles)
 {
 	const int rayPlayer = psObj->player;
 	const int xdiff = map_coord(psObj->pos.x) - mapX;
 	const int ydiff = map_coord(psObj->pos.y) - mapY;
 	const int distSq = xdiff * xdiff + ydiff * ydiff;
 	const bool inRange = (distSq < 16);
-	uint16_t *visionType = inRange ? psTile->watchers : psTile->sensors;
+	const size_t tileIndex = mapTileIndex(mapState, psTile);
+	uint16_t *visionType = inRange ? mapState.watchers[rayPlayer].get() : mapState.sensors[rayPlayer].get();
 
-	if (visionType[rayPlayer] < UINT16_MAX)
+	if (visionType[tileIndex] < UINT16_MAX)
 	{
 		TILEPOS tilePos = {uint8_t(mapX), uint8_t(mapY), uint8_t(inRange)};
 
-		visionType[rayPlayer]++;                        // we observe this tile
+		visionType[tileIndex]++;                        // we observe this tile
 		if (psObj->flags.test(OBJECT_FLAG_JAMMED_TILES))   // we are a jammer object
 		{
-			psTile->jammers[rayPlayer]++;
+			mapState.jammers[rayPlayer][tileIndex]++;
 			psTile->jammerBits |= (1 << rayPlayer); // mark it as being jammed
 		}
-		updateTileVis(psTile, rayPlayer);
+		updateTileVis(mapState, psTile, tileIndex, rayPlayer);
 		watchedTiles.push_back(tilePos);  // record having seen it
 	}
 }
@@ -362,7 +371,7 @@ static void doWaveTerrain(BASE_OBJECT *psObj, WorldMapState& mapState)
 		{
 			// Can see this tile.
 			psTile->tileExploredBits |= alliancebits[rayPlayer];                        // Share exploration with allies too
-			visMarkTile(psObj, mapX, mapY, psTile, psObj->watchedTiles);   // Mark this tile as seen by our sensor
+			visMarkTile(mapState, psObj, mapX, mapY, psTile, psObj->watchedTiles);   // Mark this tile as seen by our sensor
 		}
 	}
 }
@@ -424,26 +433,28 @@ void visRemoveVisibility(BASE_OBJECT *psObj, WorldMapState& mapState)
 		for (TILEPOS pos : psObj->watchedTiles)
 		{
 			MAPTILE *psTile = mapTile(mapState, pos.x, pos.y);
+			const size_t tileIndex = mapTileIndex(mapState, psTile);
 
 			ASSERT(pos.type < 2, "Invalid visibility type %d", (int)pos.type);
-			uint16_t *visionType = (pos.type == 0) ? psTile->sensors : psTile->watchers;
-			if (visionType[psObj->player] == 0 && game.type == LEVEL_TYPE::CAMPAIGN)	// hack
+			uint16_t *visionType = (pos.type == 0) ? mapState.sensors[psObj->player].get() : mapState.watchers[psObj->player].get();
+			if (visionType[tileIndex] == 0 && game.type == LEVEL_TYPE::CAMPAIGN)	// hack
 			{
 				continue;
 			}
-			ASSERT(visionType[psObj->player] > 0, "No %s on watched tile (%d, %d)", pos.type ? "radar" : "vision", (int)pos.x, (int)pos.y);
-			visionType[psObj->player]--;
+			ASSERT(visionType[tileIndex] > 0, "No %s on watched tile (%d, %d)", pos.type ? "radar" : "vision", (int)pos.x, (int)pos.y);
+			visionType[tileIndex]--;
 			if (psObj->flags.test(OBJECT_FLAG_JAMMED_TILES))  // we are a jammer object — we cannot check objJammerPower(psObj) > 0 directly here, we may be in the BASE_OBJECT destructor).
 			{
 				// No jammers in campaign, no need for special hack
-				ASSERT(psTile->jammers[psObj->player] > 0, "Not jamming watched tile (%d, %d)", (int)pos.x, (int)pos.y);
-				psTile->jammers[psObj->player]--;
-				if (psTile->jammers[psObj->player] == 0)
+				uint16_t &jammers = mapState.jammers[psObj->player][tileIndex];
+				ASSERT(jammers > 0, "Not jamming watched tile (%d, %d)", (int)pos.x, (int)pos.y);
+				jammers--;
+				if (jammers == 0)
 				{
 					psTile->jammerBits &= ~(1 << psObj->player);
 				}
 			}
-			updateTileVis(psTile, psObj->player);
+			updateTileVis(mapState, psTile, tileIndex, psObj->player);
 		}
 	}
 	psObj->watchedTiles.clear();
@@ -614,8 +625,9 @@ int visibleObject(const BASE_OBJECT *psViewer, const BASE_OBJECT *psTarget, bool
 		*gNumWalls = help.numWalls;
 	}
 
-	bool tileWatched = psTile->watchers[psViewer->player] > 0;
-	bool tileWatchedSensor = psTile->sensors[psViewer->player] > 0;
+	const size_t tileIndex = mapTileIndex(gameWorld.map, psTile);
+	bool tileWatched = gameWorld.map.watchers[psViewer->player][tileIndex] > 0;
+	bool tileWatchedSensor = gameWorld.map.sensors[psViewer->player][tileIndex] > 0;
 
 	// Show objects hidden by ECM jamming with radar blips
 	if (jammed)
@@ -711,8 +723,34 @@ static void setSeenByInstantly(BASE_OBJECT *psObj, unsigned viewer, int val /*=
 	}
 }
 
+/// A target of a CB sensor, which processVisibility() makes visible instantly to the sensor's player once the self pass is done.
+struct VisCBTarget
+{
+	BASE_OBJECT *psTarget;
+	unsigned player;
+};
+
+/// A call to triggerEventSeen() found by the vision pass. sequence is the viewer's index in visObjects.
+struct VisSeenEvent
+{
+	size_t sequence;
+	BASE_OBJECT *psViewer;
+	BASE_OBJECT *psObj;
+};
+
+/// An object which just became visible to player in the level pass.
+struct VisBecameVisible
+{
+	BASE_OBJECT *psObj;
+	unsigned player;
+};
+
+/// Droids and structures of each player, then features, which is the order the passes used to visit them in.
+static std::vector<BASE_OBJECT *> visObjects;
+
 // Calculate which objects we should know about based on alliances and satellite view.
-static void processVisibilitySelf(BASE_OBJECT *psObj)
+// Only writes to psObj itself, targets of CB sensors are added to cbTargets instead.
+static void processVisibilitySelf(BASE_OBJECT *psObj, std::vector<VisCBTarget> &cbTargets)
 {
 	if (psObj->type != OBJ_FEATURE && objSensorRange(psObj) > 0)
 	{
@@ -739,19 +777,20 @@ static void processVisibilitySelf(BASE_OBJECT *psObj)
 	// You have been warned!!
 	if (psStruct != nullptr && psStruct->status == SS_BUILT && (structCBSensor(psStruct) || structVTOLCBSensor(psStruct)) && psStruct->psTarget[0] != nullptr)
 	{
-		setSeenByInstantly(psStruct->psTarget[0], psObj->player, UBYTE_MAX);
+		cbTargets.push_back({psStruct->psTarget[0], psObj->player});
 	}
 	DROID *psDroid = castDroid(psObj);
 	if (psDroid != nullptr && psDroid->action == DACTION_OBSERVE && cbSensorDroid(psDroid) && psDroid->psActionTarget[0] != nullptr)
 	{
 		// Anyone commenting this out will get a knee capping from John.
 		// You have been warned!!
-		setSeenByInstantly(psDroid->psActionTarget[0], psObj->player, UBYTE_MAX);
+		cbTargets.push_back({psDroid->psActionTarget[0], psObj->player});
 	}
 }
 
 // Calculate which objects we can see. Better to call after processVisibilitySelf, since that check is cheaper.
-static void processVisibilityVision(BASE_OBJECT *psViewer)
+// Only writes the seenThisTick[] of players sharing vision with the viewer. Script events are added to seenEvents.
+static void processVisibilityVision(BASE_OBJECT *psViewer, size_t sequence, GridQueryContext &context, std::vector<VisSeenEvent> &seenEvents)
 {
 	if (psViewer->type == OBJ_FEATURE)
 	{
@@ -760,8 +799,7 @@ static void processVisibilityVision(BASE_OBJECT *psViewer)
 
 	// get all the objects from the grid the droid is in
 	// Will give inconsistent results if hasSharedVision is not an equivalence relation.
-	static GridList gridList;  // static to avoid allocations.
-	gridList = gridStartIterateUnseen(psViewer->pos.x, psViewer->pos.y, objSensorRange(psViewer), psViewer->player);
+	GridList const &gridList = gridStartIterateUnseen(context, psViewer->pos.x, psViewer->pos.y, objSensorRange(psViewer), psViewer->player);
 	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
 	{
 		BASE_OBJECT *psObj = *gi;
@@ -775,14 +813,15 @@ static void processVisibilityVision(BASE_OBJECT *psViewer)
 			setSeenBy(psObj, psViewer->player, val);
 
 			// Check if scripting system wants to trigger an event for this
-			triggerEventSeen(psViewer, psObj);
+			seenEvents.push_back({sequence, psViewer, psObj});
 		}
 	}
 }
 
 /* Find out what can see this object */
 // Fade in/out of view. Must be called after calculation of which objects are seen.
-static void processVisibilityLevel(BASE_OBJECT *psObj, bool& addedMessage)
+// Only writes to psObj itself, the rest is left to processVisibilityBecameVisible.
+static void processVisibilityLevel(BASE_OBJECT *psObj, std::vector<VisBecameVisible> &becameVisible)
 {
 	// update the visibility levels
 	for (unsigned player = 0; player < MAX_PLAYERS; player++)
@@ -814,111 +853,212 @@ static void processVisibilityLevel(BASE_OBJECT *psObj, bool& addedMessage)
 			psObj->visible[player] = MAX(psObj->visible[player] - visLevelDec, visLevel);
 		}
 
-		if (justBecameVisible)
+		if (justBecameVisible && (psObj->type == OBJ_STRUCTURE || psObj->type == OBJ_FEATURE))
 		{
-			/* Make sure all tiles under a feature/structure become visible when you see it */
-			if (psObj->type == OBJ_STRUCTURE || psObj->type == OBJ_FEATURE)
-			{
-				setUnderTilesVis(psObj, gameWorld.map, player);
-			}
+			becameVisible.push_back({psObj, player});
+		}
+	}
+}
 
-			// if a feature has just become visible set the message blips
-			if (psObj->type == OBJ_FEATURE)
-			{
-				MESSAGE *psMessage;
-				INGAME_AUDIO type = NO_SOUND;
+static void processVisibilityBecameVisible(BASE_OBJECT *psObj, unsigned player, bool& addedMessage)
+{
+	/* Make sure all tiles under a feature/structure become visible when you see it */
+	setUnderTilesVis(psObj, gameWorld.map, player);
 
-				/* If this is an oil resource we want to add a proximity message for
-				 * the selected Player - if there isn't an Resource Extractor on it. */
-				if (((FEATURE *)psObj)->psStats->subType == FEAT_OIL_RESOURCE && !TileHasStructure(mapTile(gameWorld.map, map_coord(psObj->pos.x), map_coord(psObj->pos.y))))
-				{
-					type = ID_SOUND_RESOURCE_HERE;
-				}
-				else if (((FEATURE *)psObj)->psStats->subType == FEAT_GEN_ARTE)
-				{
-					type = ID_SOUND_ARTEFACT_DISC;
-				}
+	// if a feature has just become visible set the message blips
+	if (psObj->type == OBJ_FEATURE)
+	{
+		MESSAGE *psMessage;
+		INGAME_AUDIO type = NO_SOUND;
 
-				if (type != NO_SOUND)
-				{
-					psMessage = addMessage(MSG_PROXIMITY, true, player);
-					if (psMessage)
-					{
-						psMessage->psObj = psObj;
-						debug(LOG_MSG, "Added message for oil well or artefact, pViewData=%p", static_cast<void *>(psMessage->pViewData));
-						addedMessage = true;
-					}
-					if (!bInTutorial && player == selectedPlayer)
-					{
-						// play message to indicate been seen
-						audio_QueueTrackPos(type, psObj->pos.x, psObj->pos.y, psObj->pos.z);
-					}
-				}
+		/* If this is an oil resource we want to add a proximity message for
+		 * the selected Player - if there isn't an Resource Extractor on it. */
+		if (((FEATURE *)psObj)->psStats->subType == FEAT_OIL_RESOURCE && !TileHasStructure(mapTile(gameWorld.map, map_coord(psObj->pos.x), map_coord(psObj->pos.y))))
+		{
+			type = ID_SOUND_RESOURCE_HERE;
+		}
+		else if (((FEATURE *)psObj)->psStats->subType == FEAT_GEN_ARTE)
+		{
+			type = ID_SOUND_ARTEFACT_DISC;
+		}
+
+		if (type != NO_SOUND)
+		{
+			psMessage = addMessage(MSG_PROXIMITY, true, player);
+			if (psMessage)
+			{
+				psMessage->psObj = psObj;
+				debug(LOG_MSG, "Added message for oil well or artefact, pViewData=%p", static_cast<void *>(psMessage->pViewData));
+				addedMessage = true;
+			}
+			if (!bInTutorial && player == selectedPlayer)
+			{
+				// play message to indicate been seen
+				audio_QueueTrackPos(type, psObj->pos.x, psObj->pos.y, psObj->pos.z);
 			}
 		}
 	}
 }
 
-void processVisibility()
+// Show active radars as radar blips to the players of radar detectors in range of them.
+static void processVisibilityRadarDetectors()
 {
-	WZ_PROFILE_SCOPE(processVisibility);
-	updateSpotters();
-	for (int player = 0; player < MAX_PLAYERS; ++player)
+	static PointTree radars;
+	static PointTree::QueryContext query;
+
+	radars.clear();
+	bool haveDetectors = false;
+	for (BASE_OBJECT *psObj : gameWorld.objects.sensors[0])
 	{
-		for (BASE_OBJECT* psObj : gameWorld.objects.droids[player])
-		{
-			processVisibilitySelf(psObj);
-		}
-		for (BASE_OBJECT* psObj : gameWorld.objects.structures[player])
+		if (objActiveRadar(psObj))
 		{
-			processVisibilitySelf(psObj);
+			radars.insert(psObj, psObj->pos.x, psObj->pos.y);
 		}
+		haveDetectors = haveDetectors || objRadarDetector(psObj);
 	}
-	for (BASE_OBJECT* psObj : gameWorld.objects.features[0])
+	if (!haveDetectors)
 	{
-		processVisibilitySelf(psObj);
+		return;
 	}
+	radars.sort();
+
+	// Setting visible[] to UBYTE_MAX / 2 if it's lower gives the same result in any order.
+	for (const BASE_OBJECT *psObj : gameWorld.objects.sensors[0])
+	{
+		if (!objRadarDetector(psObj))
+		{
+			continue;
+		}
+		const int range = objSensorRange(psObj) * 10;
+		for (void *point : radars.query(query, psObj->pos.x, psObj->pos.y, std::max(range, 0)))
+		{
+			BASE_OBJECT *psTarget = static_cast<BASE_OBJECT *>(point);
+			if (psObj != psTarget && psTarget->visible[psObj->player] < UBYTE_MAX / 2
+			    && iHypot((psTarget->pos - psObj->pos).xy()) < range)
+			{
+				psTarget->visible[psObj->player] = UBYTE_MAX / 2;
+			}
+		}
+	}
+}
+
+/* The passes are split into tasks which write disjoint state, and everything else they used to do (script
+ * events, messages, and effects on other objects) is collected per task and done afterwards in the order the
+ * serial passes did it, so the results don't depend on the number of threads.
+ * The self and level passes are split into chunks of visObjects. The vision pass is split by groups of players
+ * sharing vision, since viewers only write the seenThisTick[] of their group, and which objects a viewer checks
+ * depends on what the viewers before it in the same group saw. */
+void processVisibility()
+{
+	WZ_PROFILE_SCOPE(processVisibility);
+	updateSpotters();
+
+	visObjects.clear();
 	for (int player = 0; player < MAX_PLAYERS; ++player)
 	{
-		for (BASE_OBJECT* psObj : gameWorld.objects.droids[player])
+		visObjects.insert(visObjects.end(), gameWorld.objects.droids[player].begin(), gameWorld.objects.droids[player].end());
+		visObjects.insert(visObjects.end(), gameWorld.objects.structures[player].begin(), gameWorld.objects.structures[player].end());
+	}
+	const size_t numViewers = visObjects.size();
+	visObjects.insert(visObjects.end(), gameWorld.objects.features[0].begin(), gameWorld.objects.features[0].end());
+
+	const size_t numChunks = (visObjects.size() + VIS_CHUNK_SIZE - 1) / VIS_CHUNK_SIZE;
+	auto chunkBegin = [](size_t chunk) { return chunk * VIS_CHUNK_SIZE; };
+	auto chunkEnd = [](size_t chunk) { return std::min((chunk + 1) * VIS_CHUNK_SIZE, visObjects.size()); };
+
+	static std::vector<std::vector<VisCBTarget>> cbTargets;
+	cbTargets.resize(std::max(cbTargets.size(), numChunks));
+	wzTaskParallelFor(numChunks, [&](size_t chunk) {
+		cbTargets[chunk].clear();
+		for (size_t i = chunkBegin(chunk); i < chunkEnd(chunk); ++i)
 		{
-			processVisibilityVision(psObj);
+			processVisibilitySelf(visObjects[i], cbTargets[chunk]);
 		}
-		for (BASE_OBJECT* psObj : gameWorld.objects.structures[player])
+	});
+	for (size_t chunk = 0; chunk < numChunks; ++chunk)
+	{
+		for (VisCBTarget const &cbTarget : cbTargets[chunk])
 		{
-			processVisibilityVision(psObj);
+			setSeenByInstantly(cbTarget.psTarget, cbTarget.player, UBYTE_MAX);
 		}
 	}
-	for (const BASE_OBJECT *psObj : gameWorld.objects.sensors[0])
+
+	// Group the players sharing vision, as the connected components of hasSharedVision.
+	unsigned group[MAX_PLAYERS];
+	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
 	{
-		if (objRadarDetector(psObj))
+		group[player] = player;
+		for (unsigned other = 0; other < player; ++other)
 		{
-			for (BASE_OBJECT *psTarget : gameWorld.objects.sensors[0])
+			if (group[other] != group[player] && (hasSharedVision(player, other) || hasSharedVision(other, player)))
 			{
-				if (psObj != psTarget && psTarget->visible[psObj->player] < UBYTE_MAX / 2
-				    && objActiveRadar(psTarget)
-				    && iHypot((psTarget->pos - psObj->pos).xy()) < objSensorRange(psObj) * 10)
+				const unsigned from = std::max(group[player], group[other]), to = std::min(group[player], group[other]);
+				for (unsigned p = 0; p <= player; ++p)
 				{
-					psTarget->visible[psObj->player] = UBYTE_MAX / 2;
+					group[p] = group[p] == from ? to : group[p];
 				}
 			}
 		}
 	}
-	bool addedMessage = false;
-	for (int player = 0; player < MAX_PLAYERS; ++player)
+	unsigned groupIndex[MAX_PLAYERS];
+	size_t numGroups = 0;
+	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
 	{
-		for (BASE_OBJECT* psObj : gameWorld.objects.droids[player])
+		groupIndex[player] = group[player] == player ? numGroups++ : groupIndex[group[player]];
+	}
+
+	static std::vector<size_t> groupViewers[MAX_PLAYERS];
+	static std::vector<VisSeenEvent> groupSeenEvents[MAX_PLAYERS];
+	static std::unique_ptr<GridQueryContext> groupContexts[MAX_PLAYERS];
+	for (size_t g = 0; g < numGroups; ++g)
+	{
+		groupViewers[g].clear();
+		groupSeenEvents[g].clear();
+		if (!groupContexts[g])
 		{
-			processVisibilityLevel(psObj, addedMessage);
+			groupContexts[g] = std::make_unique<GridQueryContext>();
 		}
-		for (BASE_OBJECT* psObj : gameWorld.objects.structures[player])
+	}
+	for (size_t i = 0; i < numViewers; ++i)
+	{
+		groupViewers[groupIndex[visObjects[i]->player]].push_back(i);
+	}
+	wzTaskParallelFor(numGroups, [&](size_t g) {
+		for (size_t i : groupViewers[g])
 		{
-			processVisibilityLevel(psObj, addedMessage);
+			processVisibilityVision(visObjects[i], i, *groupContexts[g], groupSeenEvents[g]);
 		}
+	});
+	static std::vector<VisSeenEvent> seenEvents;
+	seenEvents.clear();
+	for (size_t g = 0; g < numGroups; ++g)
+	{
+		seenEvents.insert(seenEvents.end(), groupSeenEvents[g].begin(), groupSeenEvents[g].end());
+	}
+	std::stable_sort(seenEvents.begin(), seenEvents.end(), [](VisSeenEvent const &a, VisSeenEvent const &b) { return a.sequence < b.sequence; });
+	for (VisSeenEvent const &seenEvent : seenEvents)
+	{
+		triggerEventSeen(seenEvent.psViewer, seenEvent.psObj);
 	}
-	for (BASE_OBJECT* psObj : gameWorld.objects.features[0])
+
+	processVisibilityRadarDetectors();
+
+	static std::vector<std::vector<VisBecameVisible>> becameVisible;
+	becameVisible.resize(std::max(becameVisible.size(), numChunks));
+	wzTaskParallelFor(numChunks, [&](size_t chunk) {
+		becameVisible[chunk].clear();
+		for (size_t i = chunkBegin(chunk); i < chunkEnd(chunk); ++i)
+		{
+			processVisibilityLevel(visObjects[i], becameVisible[chunk]);
+		}
+	});
+	bool addedMessage = false;
+	for (size_t chunk = 0; chunk < numChunks; ++chunk)
 	{
-		processVisibilityLevel(psObj, addedMessage);
+		for (VisBecameVisible const &event : becameVisible[chunk])
+		{
+			processVisibilityBecameVisible(event.psObj, event.player, addedMessage);
+		}
 	}
 	if (addedMessage)
 	{
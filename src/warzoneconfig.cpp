@@ -91,6 +91,7 @@ struct WARZONE_GLOBALS
 	int autoDesyncKickSeconds = 10;
 	int autoNotReadyKickSeconds = 0;
 	bool disableReplayRecording = false;
+	bool replayKeyframes = false;
 	bool devForceOldSavegameLoad = false;
 	int maxReplaysSaved = MAX_REPLAY_FILES;
 	int oldLogsLimit = MAX_OLD_LOGS;
@@ -675,6 +676,16 @@ void war_setDisableReplayRecording(bool disable)
 	warGlobs.disableReplayRecording = disable;
 }
 
+bool war_getReplayKeyframes()
+{
+	return warGlobs.replayKeyframes;
+}
+
+void war_setReplayKeyframes(bool enabled)
+{
+	warGlobs.replayKeyframes = enabled;
+}
+
 bool war_getDevForceOldSavegameLoad()
 {
 	return warGlobs.devForceOldSavegameLoad;
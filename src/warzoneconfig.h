@@ -192,6 +192,9 @@ int war_getAutoNotReadyKickSeconds();
 void war_setAutoNotReadyKickSeconds(int seconds);
 bool war_getDisableReplayRecording();
 void war_setDisableReplayRecording(bool disable);
+// Save GameState keyframes in replays, for seeking. Always done by autohosts, which have no player to notice the periodic hitch.
+bool war_getReplayKeyframes();
+void war_setReplayKeyframes(bool enabled);
 // Dev-only: force preferring the legacy folder savegame over the new GameState blob when a save has both.
 bool war_getDevForceOldSavegameLoad();
 void war_setDevForceOldSavegameLoad(bool force);
@@ -26,8 +26,10 @@
 #include "lib/framework/frame.h"
 #include "gateway.h"
 
+#include <algorithm>
 #include <array>
 #include <memory>
+#include <vector>
 
 #include <stdint.h>
 
@@ -39,14 +41,15 @@
 struct BASE_OBJECT;
 
 /// <summary>
-/// Information stored with each tile on a given map.
+/// Information stored with each tile on a given map, used by the game simulation.
+/// Per-player visibility counters and display-only values are kept in separate planes in WorldMapState,
+/// so that simulation scans over tiles do not drag them through the cache.
 /// </summary>
 struct MAPTILE
 {
 	uint8_t         tileInfoBits;
 	PlayerMask      tileExploredBits;
 	PlayerMask      sensorBits;             ///< bit per player, who can see tile with sensor
-	uint16_t        watchers[MAX_PLAYERS];  // player sees through fog of war here with this many objects
 	uint16_t        texture;                // Which graphics texture is on this tile
 	int32_t         height;                 ///< The height at the top left of the tile
 	BASE_OBJECT *   psObject;               // Any object sitting on the location (e.g. building)
@@ -55,10 +58,13 @@ struct MAPTILE
 	uint16_t        fireEndTime;            ///< The (uint16_t)(gameTime / GAME_TICKS_PER_UPDATE) that BITS_ON_FIRE should be cleared.
 	int32_t         waterLevel;             ///< At what height is the water for this tile
 	PlayerMask      jammerBits;             ///< bit per player, who is jamming tile
-	uint16_t        sensors[MAX_PLAYERS];   ///< player sees this tile with this many radar sensors
-	uint16_t        jammers[MAX_PLAYERS];   ///< player jams the tile with this many objects
+};
 
-	// DISPLAY ONLY (NOT for use in game calculations)
+/// <summary>
+/// DISPLAY ONLY (NOT for use in game calculations) information stored with each tile.
+/// </summary>
+struct MAPTILE_DISPLAY
+{
 	uint8_t         ground;                 ///< The ground type used for the terrain renderer
 	uint8_t         illumination;           // How bright is this tile? = diffuseSunLight * ambientOcclusion
 	uint8_t         ambientOcclusion;       // ambient occlusion. from 1 (max occlusion) to 254 (no occlusion), similar to illumination.
@@ -76,6 +82,38 @@ struct WorldScrollLimits
 	int32_t maxY = 0;
 };
 
+/// <summary>
+/// Record of the tiles whose aux or blocking bits changed (per-world), so that pathfinding
+/// can update its blocking maps incrementally instead of regenerating them every tick.
+/// </summary>
+struct WorldBlockingJournal
+{
+	uint32_t epoch = 0;                ///< Changes whenever the journal stops describing all changes (map load, restore, overflow). 0 is never valid.
+	std::vector<uint32_t> tiles;       ///< Indices of changed tiles, oldest first. May contain duplicates.
+	std::array<uint32_t, MAX_PLAYERS> dangerGeneration = {};  ///< Incremented whenever a player's threat bits are replaced wholesale.
+
+	void noteTile(size_t index, size_t mapSize)
+	{
+		if (tiles.size() >= std::max<size_t>(mapSize / 16, 256))
+		{
+			reset();  // Cheaper for readers to regenerate everything than to replay this many changes.
+			return;
+		}
+		tiles.push_back(static_cast<uint32_t>(index));
+	}
+
+	void reset()
+	{
+		static uint32_t lastEpoch = 0;
+		epoch = ++lastEpoch;
+		tiles.clear();
+		for (auto &generation : dangerGeneration)
+		{
+			++generation;
+		}
+	}
+};
+
 /// <summary>
 /// A simple wrapper around the map state (per-world).
 /// </summary>
@@ -84,9 +122,35 @@ struct WorldMapState
 	std::unique_ptr<MAPTILE[]> tiles;
 	int32_t width = 0;
 	int32_t height = 0;
+	/// Planes parallel to tiles, one per player, so that updating one player's visibility only touches that player's counters.
+	std::array<std::unique_ptr<uint16_t[]>, MAX_PLAYERS> watchers;  ///< player sees through fog of war here with this many objects
+	std::array<std::unique_ptr<uint16_t[]>, MAX_PLAYERS> sensors;   ///< player sees this tile with this many radar sensors
+	std::array<std::unique_ptr<uint16_t[]>, MAX_PLAYERS> jammers;   ///< player jams the tile with this many objects
+	/// Plane parallel to tiles. DISPLAY ONLY (NOT for use in game calculations)
+	std::unique_ptr<MAPTILE_DISPLAY[]> display;
 	std::array<std::unique_ptr<uint8_t[]>, AUX_MAX> blockMap;
 	std::array<std::unique_ptr<uint8_t[]>, MAX_PLAYERS + AUX_MAX> auxMap; ///< yes, we waste one element... eyes wide open... makes API nicer
+	/// Working copy of each player's aux map which the background danger map flood fill writes, harvested into auxMap by mapUpdate().
+	std::array<std::unique_ptr<uint8_t[]>, MAX_PLAYERS> dangerWork;
 	WorldScrollLimits scroll;
+	/// changes to blockMap[AUX_MAP] and the per-player auxMap entries
+	WorldBlockingJournal blockingJournal;
 	/// the list of gateways on the current map
 	GATEWAY_LIST gateways;
+
+	/// Allocates tiles and the planes parallel to it, all zeroed.
+	void allocateTiles(int32_t newWidth, int32_t newHeight)
+	{
+		const size_t size = static_cast<size_t>(newWidth) * static_cast<size_t>(newHeight);
+		tiles = std::make_unique<MAPTILE[]>(size);
+		for (int player = 0; player < MAX_PLAYERS; ++player)
+		{
+			watchers[player] = std::make_unique<uint16_t[]>(size);
+			sensors[player] = std::make_unique<uint16_t[]>(size);
+			jammers[player] = std::make_unique<uint16_t[]>(size);
+		}
+		display = std::make_unique<MAPTILE_DISPLAY[]>(size);
+		width = newWidth;
+		height = newHeight;
+	}
 };